@@ -0,0 +1,109 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "./utils.hpp"
+
+using namespace ctseg_bench;
+
+// Micro-benchmarks of the configuration primitives, as a function of the number of segments per color
+// (first argument) and of the number of colors (second argument, when relevant).
+
+namespace {
+
+  auto const seglist_sizes = {1, 10, 100, 1000};
+
+  void segment_counts(benchmark::internal::Benchmark *b) {
+    for (long n : seglist_sizes) b->Arg(n);
+  }
+
+  void segment_and_color_counts(benchmark::internal::Benchmark *b) {
+    for (long n_color : {2, 4, 10})
+      for (long n : seglist_sizes) b->Args({n, n_color});
+  }
+
+} // namespace
+
+// ------------------------------
+
+static void BM_overlap(benchmark::State &state) {
+  tau_t::set_beta(beta);
+  auto rng  = std::mt19937_64{1};
+  auto sl   = random_seglist(rng, state.range(0));
+  auto segs = random_segments(rng, 256);
+  long k    = 0;
+  for (auto _ : state) benchmark::DoNotOptimize(overlap(sl, segs[k++ % segs.size()]));
+}
+BENCHMARK(BM_overlap)->Apply(segment_counts);
+
+static void BM_is_insertable_into(benchmark::State &state) {
+  tau_t::set_beta(beta);
+  auto rng = std::mt19937_64{1};
+  auto sl  = random_seglist(rng, state.range(0));
+  // Short segments, insertable in the holes between the segments or not
+  auto segs = std::vector<segment_t>{};
+  for (auto const &s : random_segments(rng, 256)) segs.push_back(segment_t{s.tau_c, s.tau_c - tau_t{1.e-3 * beta}});
+  long k = 0;
+  for (auto _ : state) benchmark::DoNotOptimize(is_insertable_into(segs[k++ % segs.size()], sl));
+}
+BENCHMARK(BM_is_insertable_into)->Apply(segment_counts);
+
+static void BM_cdag_in_window(benchmark::State &state) {
+  tau_t::set_beta(beta);
+  auto rng  = std::mt19937_64{1};
+  auto sl   = random_seglist(rng, state.range(0));
+  auto segs = random_segments(rng, 256);
+  long k    = 0;
+  for (auto _ : state) {
+    auto const &w = segs[k++ % segs.size()];
+    benchmark::DoNotOptimize(cdag_in_window(w.tau_c, w.tau_cdag, sl));
+  }
+}
+BENCHMARK(BM_cdag_in_window)->Apply(segment_counts);
+
+static void BM_flip(benchmark::State &state) {
+  tau_t::set_beta(beta);
+  auto rng = std::mt19937_64{1};
+  auto sl  = random_seglist(rng, state.range(0));
+  for (auto _ : state) benchmark::DoNotOptimize(flip(sl));
+}
+BENCHMARK(BM_flip)->Apply(segment_counts);
+
+static void BM_K_overlap(benchmark::State &state) {
+  tau_t::set_beta(beta);
+  auto rng      = std::mt19937_64{1};
+  long n_color  = state.range(1);
+  auto seglists = random_seglists(rng, state.range(0), n_color);
+  auto segs     = random_segments(rng, 256);
+  auto K        = make_kernel(n_color, 1001);
+  long k        = 0;
+  // Sum over the colors, as for the insertion of a segment
+  for (auto _ : state) {
+    auto const &s = segs[k++ % segs.size()];
+    double res    = 0;
+    for (long c = 0; c < n_color; ++c) res += K_overlap(seglists[c], s.tau_c, s.tau_cdag, K, 0, c);
+    benchmark::DoNotOptimize(res);
+  }
+}
+BENCHMARK(BM_K_overlap)->Apply(segment_and_color_counts);
+
+static void BM_colored_ordered_ops(benchmark::State &state) {
+  tau_t::set_beta(beta);
+  auto rng      = std::mt19937_64{1};
+  auto seglists = random_seglists(rng, state.range(0), state.range(1));
+  for (auto _ : state) benchmark::DoNotOptimize(colored_ordered_ops(seglists));
+}
+BENCHMARK(BM_colored_ordered_ops)->Apply(segment_and_color_counts);
@@ -0,0 +1,89 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include <cmath>
+#include <memory>
+#include <triqs_ctseg/work_data.hpp>
+#include <triqs_ctseg/configuration.hpp>
+#include <triqs_ctseg/dets.hpp>
+#include "./utils.hpp"
+
+using namespace ctseg_bench;
+
+// Micro-benchmarks of the evaluation of the hybridization in the dets and of the trace sign
+
+namespace {
+
+  // A random configuration with n segments per color, with its dets, for a model with n_color blocks of size 1
+  // and the hybridization of a single bath level
+  struct chain_state_t {
+    std::shared_ptr<model_t const> model;
+    std::unique_ptr<work_data_t> wdata;
+    configuration_t config;
+
+    chain_state_t(long n, long n_color) : config(int(n_color)) {
+      tau_t::set_beta(beta);
+      auto cp = constr_params_t{};
+      cp.beta = beta;
+      for (long c = 0; c < n_color; ++c) cp.gf_struct.emplace_back(std::to_string(c), 1);
+      auto inputs     = inputs_t{};
+      inputs.Delta    = block_gf<imtime>({beta, Fermion, cp.n_tau}, cp.gf_struct);
+      inputs.D0t      = make_block2_gf<imtime>({beta, Boson, cp.n_tau_bosonic}, cp.gf_struct);
+      inputs.Jperpt   = gf<imtime>({beta, Boson, cp.n_tau_bosonic}, {1, 1});
+      inputs.D0t()    = 0;
+      inputs.Jperpt() = 0;
+      double eps      = 0.3;
+      for (auto &Delta_bl : inputs.Delta)
+        for (auto t : Delta_bl.mesh()) Delta_bl[t](0, 0) = -std::exp(-eps * double(t)) / (1 + std::exp(-beta * eps));
+
+      auto p = params_t{cp, solve_params_t{}};
+      model  = std::make_shared<model_t>(p, inputs, mpi::communicator{});
+      wdata  = std::make_unique<work_data_t>(model, p);
+
+      auto rng        = std::mt19937_64{1};
+      config.seglists = random_seglists(rng, n, n_color);
+      config.update_counters();
+      wdata->initialize_from(config);
+    }
+  };
+
+} // namespace
+
+// ------------------------------
+
+static void BM_Delta_block_adaptor(benchmark::State &state) {
+  tau_t::set_beta(beta);
+  auto rng   = std::mt19937_64{1};
+  long dim   = state.range(0);
+  auto Delta = Delta_block_adaptor{make_kernel(dim, 10001)};
+  auto x     = std::vector<std::pair<tau_t, int>>{};
+  for (int k = 0; k < 256; ++k) x.emplace_back(tau_t{uint64_t(rng())}, int(rng() % dim));
+  // A row of the det, as in a try_insert
+  for (auto _ : state) {
+    double res = 0;
+    for (auto const &y : x) res += Delta(x[0], y);
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetItemsProcessed(state.iterations() * long(x.size()));
+}
+BENCHMARK(BM_Delta_block_adaptor)->Arg(1)->Arg(2)->Arg(4);
+
+static void BM_trace_sign(benchmark::State &state) {
+  auto chain = chain_state_t{state.range(0), state.range(1)};
+  for (auto _ : state) benchmark::DoNotOptimize(trace_sign(*chain.wdata));
+}
+BENCHMARK(BM_trace_sign)->ArgsProduct({{1, 10, 100}, {2, 4, 10}});
@@ -0,0 +1,168 @@
+# End-to-end throughput of the solver on a set of reference models.
+#
+# Each model is solved --repetitions times with independent random seeds, with a wall-clock budget
+# of --time seconds per solve (max_time). For each model, the benchmark reports
+#
+#   - moves/s: attempted moves per second and per core,
+#   - measures/s: calls to the G(tau) measure per second and per core,
+#   - the statistical efficiency: error bar of G(tau) (averaged over tau and blocks) and of the densities
+#     (averaged over the colors) estimated from the spread of the repetitions, times sqrt(core-seconds),
+#     i.e. the error bar expected after one core-second. Lower is better.
+#
+# Usage: mpirun -np N python throughput.py [--time 10] [--repetitions 4] [--threads 1] [--models anderson ...]
+#                                         [--output throughput.json]
+import os
+import json
+import time
+import argparse
+import numpy as np
+from h5 import HDFArchive
+from triqs.gf import *
+from triqs.gf import make_gf_imtime
+from triqs.gf.descriptors import Function
+from triqs.operators import n, util
+import triqs.utility.mpi as mpi
+from triqs_ctseg import SolverCore as Solver
+
+input_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'test', 'python')
+
+
+def bosonic_kernel(beta, n_tau, g, wp):
+    """g wp^2 / (w^2 - wp^2) in imaginary time"""
+    d0_iw = GfImFreq(indices=[0], beta=beta, statistic="Boson", n_points=n_tau // 2)
+    d0_tau = GfImTime(indices=[0], beta=beta, statistic="Boson", n_points=n_tau)
+    d0_iw << Function(lambda w: g * wp**2 / (w**2 - wp**2))
+    d0_tau << Fourier(d0_iw)
+    return d0_tau
+
+
+def single_level_Delta(S, beta, n_tau, eps):
+    """Hybridization with a single bath level eps, in all the blocks"""
+    delta_iw = GfImFreq(indices=[0], mesh=MeshImFreq(beta, 'Fermion', n_tau // 2))
+    delta_iw << inverse(iOmega_n - eps)
+    for name, block in S.Delta_tau:
+        block << Fourier(delta_iw)
+
+
+def anderson():
+    """Single orbital at half-filling (see test/python/anderson.py)"""
+    beta, U, n_tau = 10, 4.0, 2051
+    S = Solver(gf_struct=[('down', 1), ('up', 1)], beta=beta, n_tau=n_tau, n_tau_bosonic=2001)
+    single_level_Delta(S, beta, n_tau, 0.2)
+    h_int = U * n("up", 0) * n("down", 0)
+    h_loc0 = -U / 2 * (n("up", 0) + n("down", 0))
+    return S, dict(h_int=h_int, h_loc0=h_loc0, length_cycle=50)
+
+
+def kanamori_D0():
+    """3 orbitals with the density-density Kanamori interaction and a retarded interaction D0(tau)"""
+    beta, n_orb, U, J, n_tau, n_tau_bosonic = 10, 3, 4.0, 0.6, 2051, 2001
+    spins = ['down', 'up']
+    gf_struct = [(f"{s}_{o}", 1) for s in spins for o in range(n_orb)]
+    S = Solver(gf_struct=gf_struct, beta=beta, n_tau=n_tau, n_tau_bosonic=n_tau_bosonic)
+    single_level_Delta(S, beta, n_tau, 0.2)
+    d0_tau = bosonic_kernel(beta, n_tau_bosonic, 0.5, 1.0)
+    for a, _ in gf_struct:
+        for b, _ in gf_struct:
+            S.D0_tau[a, b] << d0_tau
+    Umat, Upmat = util.U_matrix_kanamori(n_orb=n_orb, U_int=U, J_hund=J)
+    h_int = util.h_int_density(spins, n_orb, off_diag=False, U=Umat, Uprime=Upmat)
+    # Half-filling of the static interaction
+    mu = U / 2 + (n_orb - 1) * (U - 2 * J + U - 3 * J) / 2
+    h_loc0 = sum(-mu * n(bl, 0) for bl, _ in gf_struct)
+    return S, dict(h_int=h_int, h_loc0=h_loc0, length_cycle=50)
+
+
+def dynamic_int_multiorb():
+    """Multi-orbital model with a retarded interaction from a GW calculation (see test/python/dynamic_int_multiorb.py)"""
+    with HDFArchive(os.path.join(input_dir, 'dynamic_int_multiorb_input.h5'), 'r') as ar:
+        delta_tau = ar['delta_tau']
+        chemical_potential = ar['chemical_potential']
+        Uloc_dlr_2idx = ar['Uloc_dlr_2idx']
+        Uloc_dlr_2idx_prime = ar['Uloc_dlr_2idx_prime']
+        Vloc = ar['Vloc']
+    n_orb, n_tau_bosonic = Vloc.shape[0], 10001
+    gf_struct = [(block, 1) for block in delta_tau.indices]
+    S = Solver(gf_struct=gf_struct, beta=delta_tau.mesh.beta, n_tau=len(delta_tau.mesh), n_tau_bosonic=n_tau_bosonic)
+    for name, block in S.Delta_tau:
+        block << delta_tau[name]
+    Umat, Upmat = util.reduce_4index_to_2index(Vloc)
+    h_int = util.h_int_density(['down', 'up'], n_orb, off_diag=False, U=Umat, Uprime=Upmat)
+    h_loc0 = sum(-chemical_potential[i] * n(block, 0) for i, (block, s) in enumerate(gf_struct))
+    U_tau = make_gf_imtime(Uloc_dlr_2idx, n_tau=n_tau_bosonic)
+    Up_tau = make_gf_imtime(Uloc_dlr_2idx_prime, n_tau=n_tau_bosonic)
+    for a in range(n_orb):
+        for b in range(n_orb):
+            for s1 in ['up', 'down']:
+                for s2 in ['up', 'down']:
+                    D = U_tau if s1 == s2 else Up_tau
+                    S.D0_tau[f"{s1}_{a}", f"{s2}_{b}"][0, 0] << D[a, b].real
+    return S, dict(h_int=h_int, h_loc0=h_loc0, length_cycle=100)
+
+
+def jperp():
+    """Single orbital with a spin-boson coupling Jperp(tau) (see test/python/Jperp.py)"""
+    beta, U, n_tau, n_tau_bosonic = 10, 4.0, 2051, 2001
+    S = Solver(gf_struct=[('down', 1), ('up', 1)], beta=beta, n_tau=n_tau, n_tau_bosonic=n_tau_bosonic)
+    single_level_Delta(S, beta, n_tau, 0.2)
+    S.Jperp_tau << bosonic_kernel(beta, n_tau_bosonic, 4, 1)
+    h_int = U * n("up", 0) * n("down", 0)
+    h_loc0 = -U / 2 * (n("up", 0) + n("down", 0))
+    return S, dict(h_int=h_int, h_loc0=h_loc0, length_cycle=50)
+
+
+models = {'anderson': anderson, 'kanamori_D0': kanamori_D0, 'dynamic_int_multiorb': dynamic_int_multiorb,
+          'jperp': jperp}
+
+
+def run(name, args):
+    """Solve the model args.repetitions times, and return its throughput and efficiency metrics"""
+    cores = mpi.size * args.threads
+    G, dens, n_moves, n_measures, wall = [], [], 0.0, 0.0, 0.0
+    for r in range(args.repetitions):
+        S, solve_params = models[name]()
+        solve_params.update(n_warmup_cycles=args.warmup_cycles, n_cycles=2**31 - 1, max_time=args.time,
+                            n_threads=args.threads, random_seed=34788 + 928374 * r + 17 * mpi.rank,
+                            measure_timings=True)
+        start = time.perf_counter()
+        S.solve(**solve_params)
+        wall += time.perf_counter() - start
+        res = S.results
+        n_moves += sum(v[0] for v in res.move_timings.values())
+        n_measures += res.measure_timings["G(tau)/F(tau)"][0]
+        G.append(np.concatenate([g.data[:, 0, 0].real for _, g in res.G_tau]))
+        dens.append(np.concatenate([d for d in res.densities.values()]))
+    core_seconds = cores * wall / args.repetitions
+    # The results are reduced over the ranks: n_moves and n_measures are totals over the ranks and threads
+    return {
+        'cores': cores,
+        'wall_time_per_solve': wall / args.repetitions,
+        'moves_per_core_second': n_moves / (cores * wall),
+        'measures_per_core_second': n_measures / (cores * wall),
+        'G_tau_error_per_core_second': float(np.mean(np.std(G, axis=0, ddof=1))) * np.sqrt(core_seconds),
+        'densities_error_per_core_second': float(np.mean(np.std(dens, axis=0, ddof=1))) * np.sqrt(core_seconds),
+    }
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="End-to-end throughput of ctseg on reference models")
+    parser.add_argument('--time', type=int, default=10, help="Wall-clock budget of each solve [s]")
+    parser.add_argument('--repetitions', type=int, default=4, help="Independent solves per model (at least 2)")
+    parser.add_argument('--warmup-cycles', type=int, default=1000, help="Warmup cycles of each solve")
+    parser.add_argument('--threads', type=int, default=1, help="Markov chains per MPI rank (n_threads)")
+    parser.add_argument('--models', nargs='+', default=list(models), choices=list(models))
+    parser.add_argument('--output', default=None, help="Write the metrics to this JSON file")
+    args = parser.parse_args()
+    assert args.repetitions >= 2, "The error bars are estimated from at least 2 repetitions"
+
+    report = {name: run(name, args) for name in args.models}
+
+    if mpi.is_master_node():
+        print(f"\n{'model':<22}{'moves/core/s':>14}{'measures/core/s':>17}{'err G(tau)*sqrt(core s)':>26}"
+              f"{'err n*sqrt(core s)':>21}")
+        for name, m in report.items():
+            print(f"{name:<22}{m['moves_per_core_second']:>14.4g}{m['measures_per_core_second']:>17.4g}"
+                  f"{m['G_tau_error_per_core_second']:>26.4g}{m['densities_error_per_core_second']:>21.4g}")
+        if args.output:
+            with open(args.output, 'w') as f:
+                json.dump(report, f, indent=2)
@@ -0,0 +1,69 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <benchmark/benchmark.h>
+#include <triqs/gfs.hpp>
+#include <triqs_ctseg/configuration.hpp>
+#include <triqs_ctseg/kernels.hpp>
+
+// Random configurations and kernels for the benchmarks
+namespace ctseg_bench {
+
+  using namespace triqs::gfs;
+  using namespace triqs_ctseg;
+
+  inline constexpr double beta = 20;
+
+  /// A list of n random non-cyclic segments, in decreasing time order
+  inline seglist_t random_seglist(std::mt19937_64 &rng, long n) {
+    auto times = std::vector<uint64_t>(2 * n);
+    for (auto &t : times) t = rng() % (tau_t::n_max - 1) + 1;
+    std::sort(times.begin(), times.end(), std::greater<>{});
+    auto sl = seglist_t{};
+    for (long k = 0; k < n; ++k) sl.push_back(segment_t{tau_t{times[2 * k]}, tau_t{times[2 * k + 1]}});
+    return sl;
+  }
+
+  /// n random non-cyclic segments for each of the n_color colors
+  inline std::vector<seglist_t> random_seglists(std::mt19937_64 &rng, long n, long n_color) {
+    auto seglists = std::vector<seglist_t>{};
+    for (long c = 0; c < n_color; ++c) seglists.push_back(random_seglist(rng, n));
+    return seglists;
+  }
+
+  /// n segments of random position and length, cyclic or not, to query the lists with
+  inline std::vector<segment_t> random_segments(std::mt19937_64 &rng, long n) {
+    auto segs = std::vector<segment_t>{};
+    for (long k = 0; k < n; ++k) segs.push_back(segment_t{tau_t{uint64_t(rng())}, tau_t{uint64_t(rng())}});
+    return segs;
+  }
+
+  /// A smooth dim x dim kernel on n_tau points
+  inline kernel_table_t make_kernel(long dim, long n_tau) {
+    auto g = gf<imtime, matrix_real_valued>{{beta, Boson, n_tau}, {dim, dim}};
+    for (auto t : g.mesh())
+      for (auto a : range(dim))
+        for (auto b : range(dim)) g[t](a, b) = std::cosh(0.1 * double(a + b + 1) * (double(t) - beta / 2));
+    return kernel_table_t{g};
+  }
+
+} // namespace ctseg_bench
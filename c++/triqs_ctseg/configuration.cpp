@@ -16,6 +16,8 @@
 // Authors: Nikita Kavokine, Hao Lu, Olivier Parcollet, Nils Wentzell
 
 #include "configuration.hpp"
+#include "tracing.hpp"
+#include <ranges>
 
 namespace triqs_ctseg {
 
@@ -72,9 +74,9 @@ namespace triqs_ctseg {
     return double(tau_start - tau_end);
   };
 
-  // =================== Functions to manipulate std::vector<segment_t> ========
+  // =================== Functions to manipulate seglist_t ========
 
-  vec_seg_iter_t lower_bound(std::vector<segment_t> const &seglist, tau_t const &tau) {
+  vec_seg_iter_t lower_bound(seglist_t const &seglist, tau_t const &tau) {
     // comparison is s.tau > tau as in the tau_t comparison
     return std::lower_bound(seglist.begin(), seglist.end(), tau, [](auto &&s, auto &&t) { return s.tau_c > t; });
   }
@@ -84,14 +86,14 @@ namespace triqs_ctseg {
   // Iterator on the closest segment on the left of seg.
   // If there is none, returns the first on the right (or end)
   // the list shoud not be empty
-  vec_seg_iter_t find_segment_left(std::vector<segment_t> const &seglist, segment_t const &seg) {
+  vec_seg_iter_t find_segment_left(seglist_t const &seglist, segment_t const &seg) {
     auto seg_iter = std::upper_bound(seglist.begin(), seglist.end(), seg);
     return (seg_iter == seglist.begin()) ? seg_iter : --seg_iter;
   }
 
   // ---------------------------
 
-  int n_at_boundary(std::vector<segment_t> const &sl) {
+  int n_at_boundary(seglist_t const &sl) {
     if (sl.empty()) return 0;
     return (is_cyclic(sl.back()) or is_full_line(sl.back())) ? 1 : 0;
   }
@@ -99,144 +101,269 @@ namespace triqs_ctseg {
   // ---------------------------
 
   // Find density in seglist to the right of time tau.
-  int n_tau(tau_t const &tau, std::vector<segment_t> const &seglist) {
+  int n_tau(tau_t const &tau, seglist_t const &seglist) {
     if (seglist.empty()) return 0;
     auto it = find_segment_left(seglist, segment_t{tau, tau});
     return (tau_in_seg(tau, *it) or tau_in_seg(tau, seglist.back())) ? 1 : 0;
   }
 
+  // ---------------------------
+
+  // n is 1 iff tau_cdag < tau <= tau_c for a segment (split at beta and 0 if cyclic), see tau_in_seg.
+  // The segments are ordered by decreasing tau_c, hence also by decreasing tau_cdag, except for the last one if it is
+  // cyclic: a segment with tau_cdag >= tau contains none of the times after tau.
+  void n_tau(std::vector<tau_t> const &taus, seglist_t const &seglist, int *res) {
+    bool cyclic = not seglist.empty() and is_cyclic(seglist.back());
+    long N      = long(seglist.size()) - (cyclic ? 1 : 0); // Number of non cyclic segments
+    long i      = 0;                                       // First non cyclic segment with tau_cdag < tau
+    for (auto const &[k, tau] : itertools::enumerate(taus)) {
+      while (i < N and seglist[i].tau_cdag >= tau) ++i;
+      bool in_seg = (i < N and tau <= seglist[i].tau_c);
+      if (cyclic) {
+        auto const &s = seglist.back();
+        in_seg        = in_seg or tau > s.tau_cdag or (tau <= s.tau_c and tau > tau_t::zero());
+      }
+      res[k] = in_seg ? 1 : 0;
+    }
+  }
+
   // ---------------------------
   // Flip seglist
-  std::vector<segment_t> flip(std::vector<segment_t> const &sl) {
-    if (sl.empty()) // Flipped seglist is full line
-      return {segment_t::full_line()};
+  seglist_t flip(seglist_t const &sl) {
+    auto fsl = seglist_t{};
+    flip(sl, fsl);
+    return fsl;
+  }
+
+  void flip(seglist_t const &sl, seglist_t &fsl) {
+    assert(&sl != &fsl);
+    fsl.clear();
+    if (sl.empty()) { // Flipped seglist is full line
+      fsl.push_back(segment_t::full_line());
+      return;
+    }
 
     if (sl.size() == 1 and is_full_line(sl[0])) // Do nothing: flipped config empty
-      return {};
+      return;
 
-    long N   = sl.size();
-    auto fsl = std::vector<segment_t>(N); // NB must be () here, not {} !
+    long N = sl.size();
+    fsl.reserve(N);
     if (is_cyclic(sl.back()))
       for (auto i : range(N)) {
         long ind = (i == 0) ? N - 1 : i - 1;
-        fsl[i]   = segment_t{sl[ind].tau_cdag, sl[i].tau_c, sl[ind].J_cdag, sl[i].J_c};
+        fsl.push_back(segment_t{sl[ind].tau_cdag, sl[i].tau_c, sl[ind].J_cdag, sl[i].J_c});
       }
     else
       for (auto i : range(N)) {
         long ind = (i == N - 1) ? 0 : i + 1;
-        fsl[i]   = segment_t{sl[i].tau_cdag, sl[ind].tau_c, sl[i].J_cdag, sl[ind].J_c};
+        fsl.push_back(segment_t{sl[i].tau_cdag, sl[ind].tau_c, sl[i].J_cdag, sl[ind].J_c});
       }
-    return fsl;
   }
 
   // ---------------------------
 
-  // Overlap between segment and a list of segments.
-  double overlap(std::vector<segment_t> const &seglist, segment_t const &seg) {
-    if (seglist.empty()) return 0;
-    // If seg is cyclic, need to split it because of the condition in the for later
-    if (is_cyclic(seg)) {
-      auto [sl, sr] = split_cyclic_segment(seg);
-      return overlap(seglist, sl) + overlap(seglist, sr);
+  namespace {
+
+    // Index of the first segment of sl (seglist_t or flipped_seglist_t) for which pred is false.
+    // pred must be true, then false on sl.
+    template <typename Seglist, typename Pred> long partition_index(Seglist const &sl, Pred pred) {
+      auto indices = std::views::iota(0l, long(sl.size()));
+      return std::ranges::partition_point(indices, [&](long i) { return pred(sl[i]); }) - indices.begin();
     }
 
-    // Compute overlap with all segments
-    double result = 0;
-    // first loop on all segment but the last one
-    auto last = seglist.end() - 1;
-    for (auto it = find_segment_left(seglist, seg); it != last and it->tau_c > seg.tau_cdag; ++it) //
-      result += overlap(*it, seg);
-
-    // the last can be cyclic, hence be unreached due to it->tau_c condition
-    // nb : overlap is ok to call on cyclic segment
-    result += overlap(*last, seg);
-    return result;
+    // Index of the segment strictly after seg, or size (as std::upper_bound)
+    template <typename Seglist> long upper_bound_index(Seglist const &sl, segment_t const &seg) {
+      return partition_index(sl, [&](segment_t const &s) { return not(seg < s); });
+    }
+
+    // Overlap between a non-cyclic segment and a non-empty list of segments.
+    template <typename Seglist> double overlap_non_cyclic(Seglist const &seglist, segment_t const &seg) {
+      double result = 0;
+      // first loop on all segment but the last one, from the closest segment on the left of seg
+      long last = long(seglist.size()) - 1;
+      long R    = upper_bound_index(seglist, seg);
+      for (long i = (R == 0) ? R : R - 1; i != last and seglist[i].tau_c > seg.tau_cdag; ++i) //
+        result += overlap(seglist[i], seg);
+
+      // the last can be cyclic, hence be unreached due to it->tau_c condition
+      // nb : overlap is ok to call on cyclic segment
+      result += overlap(seglist[last], seg);
+      return result;
+    }
+
+    // Overlap between segment and a list of segments.
+    template <typename Seglist> double overlap_impl(Seglist const &seglist, segment_t const &seg) {
+      if (seglist.empty()) return 0;
+      // If seg is cyclic, need to split it because of the condition in the for loop of overlap_non_cyclic
+      if (is_cyclic(seg)) {
+        auto [sl, sr] = split_cyclic_segment(seg);
+        return overlap_non_cyclic(seglist, sl) + overlap_non_cyclic(seglist, sr);
+      }
+      return overlap_non_cyclic(seglist, seg);
+    }
+
+    // Checks if segment is insertable to a given color
+    template <typename Seglist> bool is_insertable_impl(segment_t const &seg, Seglist const &seglist) {
+      if (seglist.empty()) return true;
+
+      // If seg is cyclic, split it
+      if (is_cyclic(seg)) {
+        auto [sl, sr] = split_cyclic_segment(seg);
+        return is_insertable_impl(sl, seglist) and is_insertable_impl(sr, seglist);
+      }
+
+      // R is the segment strictly after seg or end.
+      // L the segment before or begin
+      // Then the segment is insertable iif it does not overlap with L not with R (if not end)
+      // Proof : it overlaps with any segment before of equal L iff it does with L
+      //         it overlaps with any segment after of equal L iif it does with R
+      // see all cases.
+      // 1-  L------       R-----  : s in [L,R]
+      //           s------
+      long R = upper_bound_index(seglist, seg);
+      long L = (R == 0) ? R : R - 1;
+      if (not disjoint(seg, seglist[L])) return false;
+      if (R != long(seglist.size()) and not disjoint(seg, seglist[R])) return false;
+      // We must recheck the last segment as it may be cyclic (it might also have been R, in which case it is superfluous but ok)
+      if (not disjoint(seg, seglist.back())) return false;
+      return true;
+    }
+
+  } // namespace
+
+  long lower_bound(flipped_seglist_t const &fsl, tau_t const &tau) {
+    return partition_index(fsl, [&](segment_t const &s) { return s.tau_c > tau; });
+  }
+
+  // Overlap between segment and a list of segments.
+  double overlap(seglist_t const &seglist, segment_t const &seg) {
+    CTSEG_TRACE_SCOPE("overlap");
+    return overlap_impl(seglist, seg);
+  }
+
+  double overlap(flipped_seglist_t const &fsl, segment_t const &seg) {
+    CTSEG_TRACE_SCOPE("overlap");
+    return overlap_impl(fsl, seg);
   }
 
   // ---------------------------
 
-  // Checks if segment is insertable to a given color
-  bool is_insertable_into(segment_t const &seg, std::vector<segment_t> const &seglist) {
-    if (seglist.empty()) return true;
+  // Overlaps of a segment with the seglists of all colors
+  void overlaps(std::vector<seglist_t> const &seglists, segment_t const &seg, std::vector<double> &result) {
+    CTSEG_TRACE_SCOPE("overlaps");
+    result.resize(seglists.size());
+    bool cyclic   = is_cyclic(seg);
+    auto [sl, sr] = cyclic ? split_cyclic_segment(seg) : std::pair{seg, seg};
+    dispatch_n_color(seglists.size(), [&, sl = sl, sr = sr]<long N>(std::integral_constant<long, N>) {
+      long n_col = (N > 0 ? N : long(seglists.size()));
+      for (long c = 0; c < n_col; ++c) {
+        auto const &seglist = seglists[c];
+        if (seglist.empty()) {
+          result[c] = 0;
+          continue;
+        }
+        result[c] = overlap_non_cyclic(seglist, sl);
+        if (cyclic) result[c] += overlap_non_cyclic(seglist, sr);
+      }
+    });
+  }
 
-    // If seg is cyclic, split it
-    if (is_cyclic(seg)) {
-      auto [sl, sr] = split_cyclic_segment(seg);
-      return is_insertable_into(sl, seglist) and is_insertable_into(sr, seglist);
-    }
+  // ---------------------------
 
-    // R is the iterator on the segment strictly after seg or end.
-    // L the segment before or begin
-    // Then the segment is insertable iif it does not overlap with L not with R (if not end)
-    // Proof : it overlaps with any segment before of equal L iff it does with L
-    //         it overlaps with any segment after of equal L iif it does with R
-    // see all cases.
-    // 1-  L------       R-----  : s in [L,R]
-    //           s------
-    auto R = std::upper_bound(seglist.begin(), seglist.end(), seg);
-    auto L = (R == seglist.begin()) ? R : R - 1;
-    if (not disjoint(seg, *L)) return false;
-    if (R != seglist.end() and not disjoint(seg, *R)) return false;
-    // We must recheck the last segment as it may be cyclic (it might also have been R, in which case it is superfluous but ok)
-    if (not disjoint(seg, seglist.back())) return false;
-    return true;
+  // Density-density interaction of a segment with the other colors
+  double U_overlap(std::vector<seglist_t> const &seglists, segment_t const &seg, nda::matrix<double> const &U,
+                   int color) {
+    bool cyclic   = is_cyclic(seg);
+    auto [sl, sr] = cyclic ? split_cyclic_segment(seg) : std::pair{seg, seg};
+    return dispatch_n_color(seglists.size(), [&, sl = sl, sr = sr]<long N>(std::integral_constant<long, N>) {
+      long n_col    = (N > 0 ? N : long(seglists.size()));
+      double result = 0;
+      for (long c = 0; c < n_col; ++c) {
+        auto const &seglist = seglists[c];
+        if (c == color or seglist.empty() or U(color, c) == 0) continue;
+        double ov = overlap_non_cyclic(seglist, sl);
+        if (cyclic) ov += overlap_non_cyclic(seglist, sr);
+        result += U(color, c) * ov;
+      }
+      return result;
+    });
   }
+
+  // ---------------------------
+
+  // Checks if segment is insertable to a given color
+  bool is_insertable_into(segment_t const &seg, seglist_t const &seglist) { return is_insertable_impl(seg, seglist); }
+
+  bool is_insertable_into(segment_t const &seg, flipped_seglist_t const &fsl) { return is_insertable_impl(seg, fsl); }
   // ---------------------------
   // FIXME : do we have TESTS ???
   // Find the indices of the segments whose cdag are in ]wtau_left,wtau_right[
-  std::vector<long> cdag_in_window(tau_t const &wtau_left, tau_t const &wtau_right,
-                                   std::vector<segment_t> const &seglist) {
-    if (seglist.empty()) return {}; // should never happen, but protect
-
-    if (wtau_left < wtau_right) {
-      auto left_list  = cdag_in_window(tau_t::beta(), wtau_right, seglist);
-      auto right_list = cdag_in_window(wtau_left, tau_t::zero(), seglist);
-      // concatenate
-      left_list.insert(left_list.end(), right_list.begin(), right_list.end());
-      return left_list;
-    }
+  std::vector<long> cdag_in_window(tau_t const &wtau_left, tau_t const &wtau_right, seglist_t const &seglist) {
     std::vector<long> found_indices;
-    found_indices.reserve(seglist.size());
-    auto last = seglist.end() - 1;
-    auto it   = find_segment_left(seglist, segment_t{wtau_left, wtau_left});
-    for (; it->tau_cdag > wtau_right and it != last; ++it)
-      if (it->tau_cdag < wtau_left) found_indices.push_back(std::distance(seglist.cbegin(), it));
-
-    // Check separately for last segment (may be cyclic)
-    if (seglist.back().tau_cdag < wtau_left and seglist.back().tau_cdag > wtau_right)
-      found_indices.push_back(seglist.size() - 1);
+    cdag_in_window(wtau_left, wtau_right, seglist, found_indices);
     return found_indices;
   }
 
+  namespace {
+    // Append the indices of the segments whose cdag are in ]wtau_left,wtau_right[ to found_indices
+    void append_cdag_in_window(tau_t const &wtau_left, tau_t const &wtau_right, seglist_t const &seglist,
+                               std::vector<long> &found_indices) {
+      if (wtau_left < wtau_right) {
+        append_cdag_in_window(tau_t::beta(), wtau_right, seglist, found_indices);
+        append_cdag_in_window(wtau_left, tau_t::zero(), seglist, found_indices);
+        return;
+      }
+      auto last = seglist.end() - 1;
+      auto it   = find_segment_left(seglist, segment_t{wtau_left, wtau_left});
+      for (; it->tau_cdag > wtau_right and it != last; ++it)
+        if (it->tau_cdag < wtau_left) found_indices.push_back(std::distance(seglist.cbegin(), it));
+
+      // Check separately for last segment (may be cyclic)
+      if (seglist.back().tau_cdag < wtau_left and seglist.back().tau_cdag > wtau_right)
+        found_indices.push_back(seglist.size() - 1);
+    }
+  } // namespace
+
+  void cdag_in_window(tau_t const &wtau_left, tau_t const &wtau_right, seglist_t const &seglist,
+                      std::vector<long> &result) {
+    result.clear();
+    if (seglist.empty()) return; // should never happen, but protect
+    append_cdag_in_window(wtau_left, wtau_right, seglist, result);
+  }
+
   // ---------------------------
 
   // Contribution of the dynamical interaction kernel K to the overlap between a segment and a list of segments.
   // Computes the sum of the s_a s_b K(tau_a - tau_b) where s_a is 1 for cdag and - 1 for c
-  double K_overlap(std::vector<segment_t> const &seglist, tau_t const &tau_c, tau_t const &tau_cdag,
-                   gf<imtime, matrix_valued> const &K, int c1, int c2) {
-
-    auto Ks = slice_target_to_scalar(K, c1, c2);
-
-    // seglist empty covered by the loop
-    double result = 0;
-    for (auto const &s : seglist) {
-      result += real(Ks(double(tau_c - s.tau_c)) + Ks(double(tau_cdag - s.tau_cdag)) - Ks(double(tau_cdag - s.tau_c))
-                     - Ks(double(tau_c - s.tau_cdag)));
-    }
-    return result;
+  double K_overlap(seglist_t const &seglist, tau_t const &tau_c, tau_t const &tau_cdag, kernel_table_t const &K,
+                   int c1, int c2) {
+    CTSEG_TRACE_SCOPE("K_overlap");
+    return K.visit([&](auto const &slice) {
+      auto Ks = slice(c1, c2);
+
+      // seglist empty covered by the loop
+      double result = 0;
+      for (auto const &s : seglist) {
+        result += Ks(tau_c - s.tau_c) + Ks(tau_cdag - s.tau_cdag) - Ks(tau_cdag - s.tau_c) - Ks(tau_c - s.tau_cdag);
+      }
+      return result;
+    });
   }
 
   // ---------------------------
 
   // Contribution of the dynamical interaction kernel K to the overlap between an operator and a list of segments.
   // Computes the sum of the s_a s_b K(tau_a - tau_b) where s_a is 1 for cdag and - 1 for c
-  double K_overlap(std::vector<segment_t> const &seglist, tau_t const &tau, bool is_c,
-                   gf<imtime, matrix_valued> const &K, int c1, int c2) {
-    auto Ks = slice_target_to_scalar(K, c1, c2);
-
-    double result = 0;
-    // The order of the times is important for the measure of F
-    for (auto const &s : seglist) { result += real(Ks(double(s.tau_c - tau)) - Ks(double(s.tau_cdag - tau))); }
+  double K_overlap(seglist_t const &seglist, tau_t const &tau, bool is_c, kernel_table_t const &K, int c1,
+                   int c2) {
+    CTSEG_TRACE_SCOPE("K_overlap");
+    double result = K.visit([&](auto const &slice) {
+      auto Ks    = slice(c1, c2);
+      double res = 0;
+      // The order of the times is important for the measure of F
+      for (auto const &s : seglist) { res += Ks(s.tau_c - tau) - Ks(s.tau_cdag - tau); }
+      return res;
+    });
     return is_c ? result : -result;
   }
 
@@ -244,29 +371,124 @@ namespace triqs_ctseg {
 
   // List of operators containing all colors.
   // Time are ordered in decreasing order, in agreement with the whole physic literature.
-  std::vector<colored_ops_t> colored_ordered_ops(std::vector<std::vector<segment_t>> const &seglists) {
-    int c = 0;                           // index of color
-    std::vector<colored_ops_t> ops_list; // list of all the operators
-    for (auto const &seglist : seglists) {
-      for (auto const &s : seglist) {
-        ops_list.push_back({s.tau_c, c, false});
-        ops_list.push_back({s.tau_cdag, c, true});
-        if (is_cyclic(s)) {
-          ops_list.push_back({tau_t::beta(), c, false});
-          ops_list.push_back({tau_t::zero(), c, true});
-        }
+  std::vector<colored_ops_t> colored_ordered_ops(std::vector<seglist_t> const &seglists) {
+    return colored_ops_merger_t{}(seglists);
+  }
+
+  // ---------------------------
+
+  namespace {
+
+    // Number of operators of a seglist. A cyclic segment gives 2 additional operators, at beta and 0.
+    long n_ops(seglist_t const &sl) { return sl.empty() ? 0 : 2 * long(sl.size()) + (is_cyclic(sl.back()) ? 2 : 0); }
+
+    // k-th operator of color c, in decreasing time order.
+    // The cyclic segment (the last one, cf fix_ordering_first_last) is split into [beta, tau_cdag] and [tau_c, 0].
+    colored_ops_t nth_op(seglist_t const &sl, int c, long k) {
+      long n = sl.size();
+      if (is_cyclic(sl.back())) {
+        if (k == 0) return {tau_t::beta(), c, false};
+        if (k == 1) return {sl.back().tau_cdag, c, true};
+        if (k == 2 * n) return {sl.back().tau_c, c, false};
+        if (k == 2 * n + 1) return {tau_t::zero(), c, true};
+        k -= 2;
       }
-      ++c;
+      auto const &s = sl[k / 2];
+      return (k % 2 == 0) ? colored_ops_t{s.tau_c, c, false} : colored_ops_t{s.tau_cdag, c, true};
     }
-    std::sort(ops_list.begin(), ops_list.end(), [](const colored_ops_t &a, const colored_ops_t &b) {
-      return b.tau < a.tau; // Note the order of b and a for descending sort
-    });
-    return ops_list;
+
+  } // namespace
+
+  std::vector<colored_ops_t> const &colored_ops_merger_t::operator()(std::vector<seglist_t> const &seglists) {
+    // Max heap on the time of the next operator of each color
+    auto cmp = [](head_t const &x, head_t const &y) { return x.op.tau < y.op.tau; };
+
+    heap.clear();
+    ops.clear();
+    for (int c = 0; c < int(seglists.size()); ++c)
+      if (n_ops(seglists[c]) > 0) heap.push_back({nth_op(seglists[c], c, 0), 0});
+    std::make_heap(heap.begin(), heap.end(), cmp);
+
+    while (not heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end(), cmp);
+      auto &h = heap.back();
+      ops.push_back(h.op);
+      auto const &sl = seglists[h.op.color];
+      if (++h.k < n_ops(sl)) {
+        h.op = nth_op(sl, h.op.color, h.k);
+        std::push_heap(heap.begin(), heap.end(), cmp);
+      } else
+        heap.pop_back();
+    }
+    return ops;
+  }
+
+  // ===================  h5 ========================
+
+  void h5_write(h5::group h5group, std::string subgroup_name, configuration_t const &config) {
+    auto grp = h5group.create_group(subgroup_name);
+    h5_write(grp, "n_color", long(config.n_color()));
+    for (auto const &[c, sl] : itertools::enumerate(config.seglists)) {
+      long n = sl.size();
+      nda::vector<uint64_t> tau_c(n), tau_cdag(n);
+      nda::vector<int> J_c(n), J_cdag(n);
+      for (auto const &[i, seg] : itertools::enumerate(sl)) {
+        tau_c(i)    = seg.tau_c.integer();
+        tau_cdag(i) = seg.tau_cdag.integer();
+        J_c(i)      = seg.J_c;
+        J_cdag(i)   = seg.J_cdag;
+      }
+      auto gr = grp.create_group("seglist_" + std::to_string(c));
+      h5_write(gr, "tau_c", tau_c);
+      h5_write(gr, "tau_cdag", tau_cdag);
+      h5_write(gr, "J_c", J_c);
+      h5_write(gr, "J_cdag", J_cdag);
+    }
+    long n = config.Jperp_list.size();
+    nda::vector<uint64_t> tau_Splus(n), tau_Sminus(n);
+    nda::vector<int> orbital(n);
+    for (auto const &[i, line] : itertools::enumerate(config.Jperp_list)) {
+      tau_Splus(i)  = line.tau_Splus.integer();
+      tau_Sminus(i) = line.tau_Sminus.integer();
+      orbital(i)    = line.orbital;
+    }
+    h5_write(grp, "tau_Splus", tau_Splus);
+    h5_write(grp, "tau_Sminus", tau_Sminus);
+    h5_write(grp, "Jperp_orbital", orbital);
+  }
+
+  // ---------------------------
+
+  void h5_read(h5::group h5group, std::string subgroup_name, configuration_t &config) {
+    auto grp     = h5group.open_group(subgroup_name);
+    long n_color = 0;
+    h5_read(grp, "n_color", n_color);
+    config = configuration_t{int(n_color)};
+    for (int c = 0; c < n_color; ++c) {
+      nda::vector<uint64_t> tau_c, tau_cdag;
+      nda::vector<int> J_c, J_cdag;
+      auto gr = grp.open_group("seglist_" + std::to_string(c));
+      h5_read(gr, "tau_c", tau_c);
+      h5_read(gr, "tau_cdag", tau_cdag);
+      h5_read(gr, "J_c", J_c);
+      h5_read(gr, "J_cdag", J_cdag);
+      for (long i = 0; i < tau_c.size(); ++i)
+        config.seglists[c].push_back(segment_t{tau_t{tau_c(i)}, tau_t{tau_cdag(i)}, bool(J_c(i)), bool(J_cdag(i))});
+    }
+    nda::vector<uint64_t> tau_Splus, tau_Sminus;
+    h5_read(grp, "tau_Splus", tau_Splus);
+    h5_read(grp, "tau_Sminus", tau_Sminus);
+    // Configurations written before the multi-orbital Jperp expansion have no orbital (single orbital)
+    auto orbital = nda::zeros<int>(tau_Splus.size());
+    if (grp.has_key("Jperp_orbital")) h5_read(grp, "Jperp_orbital", orbital);
+    for (long i = 0; i < tau_Splus.size(); ++i)
+      config.add_Jperp_line(Jperp_line_t{tau_t{tau_Sminus(i)}, tau_t{tau_Splus(i)}, orbital(i)});
+    config.update_counters();
   }
 
   // ===================  PRINTING ========================
 
-  std::ostream &operator<<(std::ostream &out, std::vector<segment_t> const &sl) {
+  std::ostream &operator<<(std::ostream &out, seglist_t const &sl) {
     out << '\n';
     for (auto const &[i, seg] : itertools::enumerate(sl))
       out << ". Position " << i << " : [ J:" << seg.J_c << " " << seg.tau_c << ", " << seg.tau_cdag
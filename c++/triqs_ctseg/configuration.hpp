@@ -17,8 +17,12 @@
 
 #pragma once
 #include <vector>
+#include <map>
+#include <type_traits>
 #include "tau_t.hpp"
 #include "dets.hpp"
+#include "kernels.hpp"
+#include "ring_vector.hpp"
 #include "work_data.hpp"
 
 namespace triqs_ctseg {
@@ -59,15 +63,29 @@ namespace triqs_ctseg {
     static segment_t full_line() { return {tau_t::beta(), tau_t::zero()}; }
   };
 
+  // --------------- Seglist -------------------
+  //
+  // The ordered list of segments of a color.
+  // Stored in a std::vector by default, or in a ring_vector_t (see ring_vector.hpp) if compiled with
+  // CTSEG_RING_SEGLIST (CMake option of the same name): insert/erase move at most half of the segments
+  // and the rotations of fix_ordering_first_last are O(1), at the price of a slightly more costly indexing.
+#ifdef CTSEG_RING_SEGLIST
+  using seglist_t = ring_vector_t<segment_t>;
+#else
+  using seglist_t = std::vector<segment_t>;
+#endif
+
   // simple alias
-  using vec_seg_iter_t = std::vector<segment_t>::const_iterator;
+  using vec_seg_iter_t = seglist_t::const_iterator;
 
   // ----------------- Jperp line -------------------
-  // Stores the times of a couple (S+, S-)
-  // Note: Jperp expansion only implemented for single orbital
-  // (two colors, spin up and spin down).
+  // Stores the times of a couple (S+, S-), and the orbital o of the spins.
+  // The S operators act on the colors 2o (spin up) and 2o + 1 (spin down), see model_t::color_up.
+  // For two colors (a single orbital), o = 0.
   struct Jperp_line_t {
     tau_t tau_Sminus, tau_Splus; // times of the S-, S+
+    int orbital = 0;             // orbital of the S-, S+
+    bool operator==(Jperp_line_t const &) const = default;
   };
 
   // ----------------- Operator -------------------
@@ -84,17 +102,89 @@ namespace triqs_ctseg {
   struct configuration_t {
     // A list of segments for each color.
     // NB: ordered in DECREASING time order of the tau_c.
-    std::vector<std::vector<segment_t>> seglists;
+    std::vector<seglist_t> seglists;
 
     // List of Jperp lines, NOT ordered.
+    // NB: modify it with add_Jperp_line, erase_Jperp_line and set_Jperp_line, which keep Jperp_index in sync,
+    // or call update_Jperp_index after a direct modification.
     std::vector<Jperp_line_t> Jperp_list;
 
+    // The Jperp lines, by the times of their two ends (2 entries per line), ordered in time.
+    // Lookup of the line attached to an S operator in O(log N). See find_Jperp_line
+    std::map<tau_t, Jperp_line_t> Jperp_index;
+
+    // Cached counts of segments and full lines, per color and in total. See update_counters.
+    std::vector<long> n_segments_per_color, n_full_lines_per_color;
+    long n_segments_total = 0, n_full_lines_total = 0;
+
     // Construct from the number of colors
-    configuration_t(int n_color) : seglists(n_color) {}
+    configuration_t(int n_color)
+       : seglists(n_color), n_segments_per_color(n_color, 0), n_full_lines_per_color(n_color, 0) {}
+
+    // Update the cached counts after a change of seglists[color]. O(1).
+    // To be called by the moves (in accept) for every modified color.
+    void update_counters(int color) {
+      auto const &sl = seglists[color];
+      // Full line, see is_full_line
+      long n_full = (sl.size() == 1 and sl[0].tau_c == tau_t::beta() and sl[0].tau_cdag == tau_t::zero()) ? 1 : 0;
+      n_segments_total += long(sl.size()) - n_segments_per_color[color];
+      n_full_lines_total += n_full - n_full_lines_per_color[color];
+      n_segments_per_color[color]   = sl.size();
+      n_full_lines_per_color[color] = n_full;
+    }
+
+    // Update the cached counts of all colors
+    void update_counters() {
+      for (int c = 0; c < n_color(); ++c) update_counters(c);
+    }
+
+    // Number of segments (including full lines). O(1)
+    long n_segments() const { return n_segments_total; }
+
+    // Number of segments of a color
+    long n_segments(int color) const { return n_segments_per_color[color]; }
 
-    // Number of segments
-    long n_segments() const {
-      return std::accumulate(begin(seglists), end(seglists), 0l, [](long r, auto &v) { return r + v.size(); });
+    // Add a Jperp line at the back of Jperp_list. O(log N)
+    void add_Jperp_line(Jperp_line_t const &line) {
+      Jperp_list.push_back(line);
+      Jperp_index.emplace(line.tau_Sminus, line);
+      Jperp_index.emplace(line.tau_Splus, line);
+    }
+
+    // Erase the Jperp line at position i of Jperp_list (the order of the others is kept). O(N) (vector erase)
+    void erase_Jperp_line(long i) {
+      Jperp_index.erase(Jperp_list[i].tau_Sminus);
+      Jperp_index.erase(Jperp_list[i].tau_Splus);
+      Jperp_list.erase(Jperp_list.begin() + i);
+    }
+
+    // Replace the Jperp line at position i of Jperp_list. O(log N)
+    // The lines may exchange their ends one at a time (e.g. swap_spin_lines): an end is only removed from the index
+    // if it still points to the old line, i.e. if it has not been taken by another line yet.
+    void set_Jperp_line(long i, Jperp_line_t const &line) {
+      auto old = Jperp_list[i];
+      for (auto tau : {old.tau_Sminus, old.tau_Splus}) {
+        auto it = Jperp_index.find(tau);
+        if (it != Jperp_index.end() and it->second == old) Jperp_index.erase(it);
+      }
+      Jperp_list[i] = line;
+      Jperp_index.insert_or_assign(line.tau_Sminus, line);
+      Jperp_index.insert_or_assign(line.tau_Splus, line);
+    }
+
+    // Rebuild Jperp_index from Jperp_list. O(N log N)
+    void update_Jperp_index() {
+      Jperp_index.clear();
+      for (auto const &line : Jperp_list) {
+        Jperp_index.emplace(line.tau_Sminus, line);
+        Jperp_index.emplace(line.tau_Splus, line);
+      }
+    }
+
+    // The Jperp line with an end (S+ or S-) at tau, or nullptr. O(log N)
+    [[nodiscard]] Jperp_line_t const *find_Jperp_line(tau_t const &tau) const {
+      auto it = Jperp_index.find(tau);
+      return it == Jperp_index.end() ? nullptr : &it->second;
     }
 
     // Expansion order in Jperp
@@ -103,6 +193,15 @@ namespace triqs_ctseg {
     // Expansion order in Delta
     long Delta_order() const { return n_segments() - 2 * Jperp_order(); }
 
+    // Number of operators (c and cdag), hybridized or linked to Jperp lines. O(1)
+    long n_operators() const { return 2 * (n_segments_total - n_full_lines_total); }
+
+    // Number of operators linked to Jperp lines (each line links 4 operators)
+    long n_Jperp_operators() const { return 4 * Jperp_order(); }
+
+    // Number of operators linked to Delta
+    long n_hybridized_operators() const { return n_operators() - n_Jperp_operators(); }
+
     // Accessor number of colors
     [[nodiscard]] int n_color() const { return seglists.size(); }
   };
@@ -132,58 +231,153 @@ namespace triqs_ctseg {
   // Flip a segment. J are set to default
   inline segment_t flip(segment_t const &s) { return {s.tau_cdag, s.tau_c}; }
 
-  // =================== Functions to manipulate std::vector<segment_t> ========
+  // Call f(std::integral_constant<long, N>{}) with N = n for the common numbers of colors n = 2, 4, 6 (one, two and
+  // three orbitals), N = 0 otherwise. With long n_col = (N > 0 ? N : n), the loops over the colors in f have a
+  // compile-time trip count in the common cases, and are unrolled.
+  template <typename F> decltype(auto) dispatch_n_color(long n, F &&f) {
+    switch (n) {
+      case 2: return f(std::integral_constant<long, 2>{});
+      case 4: return f(std::integral_constant<long, 4>{});
+      case 6: return f(std::integral_constant<long, 6>{});
+      default: return f(std::integral_constant<long, 0>{});
+    }
+  }
+
+  // =================== Functions to manipulate seglist_t ========
 
   // lower_bound : find segment at tau if present or the first after tau
-  vec_seg_iter_t lower_bound(std::vector<segment_t> const &seglist, tau_t const &tau);
+  vec_seg_iter_t lower_bound(seglist_t const &seglist, tau_t const &tau);
 
   // Value of n (= 0 or 1) at tau = beta = 0
   // 1 iif there is a cyclic segment or a full line
-  int n_at_boundary(std::vector<segment_t> const &seglist);
+  int n_at_boundary(seglist_t const &seglist);
 
   // Find density (0 or 1)in seglist to the right of time tau.
-  int n_tau(tau_t const &tau, std::vector<segment_t> const &seglist);
+  int n_tau(tau_t const &tau, seglist_t const &seglist);
+
+  // Densities n_tau(taus[k], seglist) for all k, in res[k], for times taus sorted by decreasing time.
+  // A single merge-walk over the segments, instead of one search per time.
+  void n_tau(std::vector<tau_t> const &taus, seglist_t const &seglist, int *res);
 
   // Flip config
-  std::vector<segment_t> flip(std::vector<segment_t> const &sl);
+  seglist_t flip(seglist_t const &sl);
+
+  // Same as flip, in fsl (its memory is reused). fsl must not be sl.
+  void flip(seglist_t const &sl, seglist_t &fsl);
+
+  /**
+  * The antisegments of a seglist, i.e. flip(sl), without a copy : the i-th antisegment is built on the fly
+  * from two segments of sl. O(1) construction and access, for the proposals of the antisegment moves.
+  * The seglist must outlive the view, and not be modified while it is used.
+  */
+  class flipped_seglist_t {
+    seglist_t const *sl;
+    long N;      // Number of segments of sl
+    bool cyclic; // Is the last segment of sl cyclic ?
+
+    public:
+    explicit flipped_seglist_t(seglist_t const &sl_)
+       : sl{&sl_}, N{long(sl_.size())}, cyclic{N > 0 and is_cyclic(sl_.back())} {}
+
+    // empty seglist : one full line. full line : no antisegment.
+    [[nodiscard]] long size() const { return (N == 0) ? 1 : (N == 1 and is_full_line((*sl)[0])) ? 0 : N; }
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    /// The i-th segment of flip(sl)
+    segment_t operator[](long i) const {
+      auto const &s = *sl;
+      if (N == 0) return segment_t::full_line();
+      if (cyclic) {
+        long ind = (i == 0) ? N - 1 : i - 1;
+        return {s[ind].tau_cdag, s[i].tau_c, s[ind].J_cdag, s[i].J_c};
+      }
+      long ind = (i == N - 1) ? 0 : i + 1;
+      return {s[i].tau_cdag, s[ind].tau_c, s[i].J_cdag, s[ind].J_c};
+    }
+
+    [[nodiscard]] segment_t back() const { return (*this)[size() - 1]; }
+  };
+
+  // Index of the first antisegment at tau or after tau (as lower_bound)
+  long lower_bound(flipped_seglist_t const &fsl, tau_t const &tau);
+
+  // Overlap between a segment and the antisegments. O(log n + number of overlapping antisegments)
+  double overlap(flipped_seglist_t const &fsl, segment_t const &seg);
+
+  // Checks if segment seg can be inserted between the antisegments (as is_insertable_into). O(log n)
+  bool is_insertable_into(segment_t const &seg, flipped_seglist_t const &fsl);
 
   // Overlap between segment and a list of segments.
-  double overlap(std::vector<segment_t> const &seglist, segment_t const &seg);
+  double overlap(seglist_t const &seglist, segment_t const &seg);
+
+  // Overlaps of a segment with the seglists of all colors: result[c] = overlap(seglists[c], seg).
+  // A cyclic seg is split once for all colors. result is resized to the number of colors.
+  void overlaps(std::vector<seglist_t> const &seglists, segment_t const &seg, std::vector<double> &result);
+
+  // Density-density interaction of a segment of a given color with the other colors:
+  // sum over c != color of U(color, c) * overlap(seglists[c], seg). The colors with U(color, c) = 0 are skipped.
+  double U_overlap(std::vector<seglist_t> const &seglists, segment_t const &seg, nda::matrix<double> const &U,
+                   int color);
 
   // Checks if segment seg can be inserted into the list, i.e. without
   // overlap with other segment.
-  bool is_insertable_into(segment_t const &seg, std::vector<segment_t> const &seglist);
+  bool is_insertable_into(segment_t const &seg, seglist_t const &seglist);
 
   // Find the indices of the segments whose cdag are in ]wtau_left,wtau_right[
-  std::vector<long> cdag_in_window(tau_t const &wtau_left, tau_t const &wtau_right,
-                                   std::vector<segment_t> const &seglist);
+  std::vector<long> cdag_in_window(tau_t const &wtau_left, tau_t const &wtau_right, seglist_t const &seglist);
+
+  // Same as cdag_in_window, in result (its memory is reused)
+  void cdag_in_window(tau_t const &wtau_left, tau_t const &wtau_right, seglist_t const &seglist,
+                      std::vector<long> &result);
 
   // Fix the list after a change of operator c time in some move
   // to restore the invariants
   // 1 -if first segment is cyclic (c has move beyond beta),  put it at end
   // 2- if last segment is such that its tau is > tau of first (c has moved beyond 0), put it first
   // Only useful when # segments > 1
-  inline void fix_ordering_first_last(std::vector<segment_t> &sl) {
+  inline void fix_ordering_first_last(seglist_t &sl) {
     if (sl.size() <= 1) return;
-    if (is_cyclic(sl[0])) std::rotate(begin(sl), begin(sl) + 1, end(sl));
-    if (sl.back().tau_c > sl[0].tau_c) std::rotate(begin(sl), end(sl) - 1, end(sl));
+    if (is_cyclic(sl[0])) rotate_front_to_back(sl);
+    if (sl.back().tau_c > sl[0].tau_c) rotate_back_to_front(sl);
   }
 
   // Contribution of the dynamical interaction kernel K to the overlap between a segment and a list of segments.
   // Computes the sum of the s_a s_b K(tau_a - tau_b) where s_a is 1 for cdag and - 1 for c
-  double K_overlap(std::vector<segment_t> const &seglist, tau_t const &tau_c, tau_t const &tau_cdag,
-                   gf<imtime, matrix_valued> const &K, int c1, int c2);
+  double K_overlap(seglist_t const &seglist, tau_t const &tau_c, tau_t const &tau_cdag, kernel_table_t const &K,
+                   int c1, int c2);
 
   // Contribution of the dynamical interaction kernel K to the overlap between an operator and a list of segments.
-  double K_overlap(std::vector<segment_t> const &seglist, tau_t const &tau, bool is_c,
-                   gf<imtime, matrix_valued> const &K, int c1, int c2);
+  double K_overlap(seglist_t const &seglist, tau_t const &tau, bool is_c, kernel_table_t const &K, int c1,
+                   int c2);
 
   // List of operators containing all colors.
-  std::vector<colored_ops_t> colored_ordered_ops(std::vector<std::vector<segment_t>> const &seglists);
+  std::vector<colored_ops_t> colored_ordered_ops(std::vector<seglist_t> const &seglists);
+
+  // List of operators containing all colors, ordered by decreasing time, by a k-way merge of the
+  // (already ordered) seglists in O(N_ops log n_color).
+  // The buffers are kept between calls, so that it does not allocate once they have reached their maximal size.
+  class colored_ops_merger_t {
+    struct head_t {
+      colored_ops_t op; // Next operator of the color
+      long k;           // Its position in the list of operators of the color
+    };
+    std::vector<head_t> heap;
+    std::vector<colored_ops_t> ops;
+
+    public:
+    std::vector<colored_ops_t> const &operator()(std::vector<seglist_t> const &seglists);
+  };
+
+  // ===================  h5 ========================
+
+  // Checkpoint of a configuration: the seglists (with their J flags) and the Jperp lines.
+  // The times are stored as their integer representation, i.e. as fractions of beta.
+  void h5_write(h5::group h5group, std::string subgroup_name, configuration_t const &config);
+  void h5_read(h5::group h5group, std::string subgroup_name, configuration_t &config);
 
   // ===================  PRINTING ========================
 
-  std::ostream &operator<<(std::ostream &out, std::vector<segment_t> const &sl);
+  std::ostream &operator<<(std::ostream &out, seglist_t const &sl);
 
   std::ostream &operator<<(std::ostream &out, configuration_t const &config);
 
@@ -20,6 +20,7 @@
 #include <triqs/det_manip.hpp>
 
 #include "./tau_t.hpp"
+#include "./kernels.hpp"
 
 using namespace triqs::gfs;
 using namespace triqs::mesh;
@@ -27,11 +28,12 @@ using namespace triqs::mesh;
 namespace triqs_ctseg {
 
   /// A lambda to adapt Delta(tau) for the call by det_manip.
+  /// Delta(tau) is evaluated from a precomputed interpolation table (see kernels.hpp).
   struct Delta_block_adaptor {
-    gf<imtime, matrix_real_valued> Delta;
+    kernel_table_t Delta;
 
     double operator()(std::pair<tau_t, int> const &x, std::pair<tau_t, int> const &y) const {
-      double res = Delta(double(x.first - y.first))(x.second, y.second);
+      double res = Delta(x.first - y.first, x.second, y.second);
       return (x.first >= y.first ? res : -res); // x,y first are tau_t, wrapping is automatic in
                                                 // the - operation, but need to compute the sign
     }
@@ -25,6 +25,9 @@ namespace triqs_ctseg {
     check_segments(config);
     check_dets(config, wdata);
     check_jlines(config);
+    check_counters(config);
+    if (wdata.model->has_Dt) check_retarded_potential(config, wdata);
+    check_trace_sign(config, wdata);
   }
 
   void check_segments(configuration_t const &config) {
@@ -49,7 +52,7 @@ namespace triqs_ctseg {
   void check_dets(configuration_t const &config, work_data_t const &wdata) {
     for (auto bl : range(wdata.dets.size())) {
       auto const &D    = wdata.dets[bl];
-      auto const n_orb = wdata.gf_struct[bl].second;
+      auto const n_orb = wdata.model->gf_struct[bl].second;
       // Times in det must be ordered
       if (D.size() != 0) {
         for (int i = 0; i < D.size() - 1; ++i) {
@@ -62,7 +65,7 @@ namespace triqs_ctseg {
       // Each time in det must correspond to a time in a segment
       long n_hyb_c = 0, n_hyb_cdag = 0;
       for (auto c : range(n_orb)) {
-        auto const &sl = config.seglists[wdata.block_to_color(bl, c)];
+        auto const &sl = config.seglists[wdata.model->block_to_color(bl, c)];
         if (not sl.empty()) {
           long det_index_c = 0, det_index_cdag = 0;
           for (auto const &seg : sl) {
@@ -97,59 +100,79 @@ namespace triqs_ctseg {
   }
 
   void check_jlines(configuration_t const &config) {
-    // Prepare lists of times in spin lines
     auto const &jl = config.Jperp_list;
-    if (jl.empty()) return;
-    std::vector<tau_t> Splus, Sminus;
-    for (auto const &[i, line] : itertools::enumerate(config.Jperp_list)) {
-      Splus.push_back(line.tau_Splus);
-      Sminus.push_back(line.tau_Sminus);
+
+    // The index has the 2 ends of every line, and nothing else
+    ALWAYS_EXPECTS(config.Jperp_index.size() == 2 * jl.size(),
+                   "Error: the Jperp index has {} entries for {} spin lines. Config: \n{}", config.Jperp_index.size(),
+                   jl.size(), config);
+    for (auto const &[i, line] : itertools::enumerate(jl)) {
+      for (auto tau : {line.tau_Sminus, line.tau_Splus}) {
+        auto *l = config.find_Jperp_line(tau);
+        ALWAYS_EXPECTS(l != nullptr and *l == line, "Error: spin line {} is not in the Jperp index. Config: \n{}", i,
+                       config);
+      }
     }
-    std::sort(Splus.begin(), Splus.end());
-    std::sort(Sminus.begin(), Sminus.end());
+    if (jl.empty()) return;
 
+    // Spin lines: each tag has to correspond to the time in a line of the orbital of the color, found in O(log N)
+    // in the index. The times are all different, so the 2 N ends of the N lines of the orbital are all tagged iff
+    // there are 2 N tags.
     for (auto const &[c, sl] : itertools::enumerate(config.seglists)) {
-      auto Splus_  = Splus;
-      auto Sminus_ = Sminus; // will be emptied throughout the checks
-      // Spin lines: each tag has to correpond to the time in a line
+      int orbital   = model_t::Jperp_orbital(c);
+      long n_lines  = std::count_if(jl.begin(), jl.end(), [&](auto const &l) { return l.orbital == orbital; });
+      long n_tags   = 0;
+      auto in_lines = [&](tau_t const &tau) {
+        auto *l = config.find_Jperp_line(tau);
+        return l != nullptr and l->orbital == orbital;
+      };
       for (int i = 0; i < sl.size(); ++i) {
         if (sl[i].J_c) {
-          auto splus_it  = std::lower_bound(Splus_.begin(), Splus_.end(), sl[i].tau_c);
-          auto sminus_it = std::lower_bound(Sminus_.begin(), Sminus_.end(), sl[i].tau_c);
-          tau_t tau_plus = tau_t::zero(), tau_minus = tau_t::zero();
-          if (splus_it != Splus_.end()) tau_plus = *splus_it;
-          if (sminus_it != Sminus_.end()) tau_minus = *sminus_it;
-          bool time_in_jlist = sl[i].tau_c == tau_plus or sl[i].tau_c == tau_minus;
           ALWAYS_EXPECTS(
-             time_in_jlist,
+             in_lines(sl[i].tau_c),
              "Error: the c in segment at position {} in color {} has a J flag but is not in J list. Config : \n{}", i,
              c, config);
-          if (sl[i].tau_c == tau_plus)
-            Splus_.erase(splus_it);
-          else
-            Sminus_.erase(sminus_it);
+          ++n_tags;
         }
         if (sl[i].J_cdag) {
-          auto splus_it  = std::lower_bound(Splus_.begin(), Splus_.end(), sl[i].tau_cdag);
-          auto sminus_it = std::lower_bound(Sminus_.begin(), Sminus_.end(), sl[i].tau_cdag);
-          tau_t tau_plus = tau_t::zero(), tau_minus = tau_t::zero();
-          if (splus_it != Splus_.end()) tau_plus = *splus_it;
-          if (sminus_it != Sminus_.end()) tau_minus = *sminus_it;
-          bool time_in_jlist = sl[i].tau_cdag == tau_plus or sl[i].tau_cdag == tau_minus;
           ALWAYS_EXPECTS(
-             time_in_jlist,
+             in_lines(sl[i].tau_cdag),
              "Error: the cdag in segment at position {} in color {} has a J flag but is not in J list. Config : \n{}",
              i, c, config);
-          if (sl[i].tau_cdag == tau_plus)
-            Splus_.erase(splus_it);
-          else
-            Sminus_.erase(sminus_it);
+          ++n_tags;
         }
       }
-      ALWAYS_EXPECTS(Splus_.empty() and Sminus_.empty(),
+      ALWAYS_EXPECTS(n_tags == 2 * n_lines,
                      "Error: some spin lines do not have corresponding tags on segments. Config: \n{}", config);
     }
     LOG("J lines OK.");
   }
 
+  void check_retarded_potential(configuration_t const &config, work_data_t const &wdata) {
+    double err = wdata.retarded_potential.max_error(config.seglists, wdata.model->K_table);
+    ALWAYS_EXPECTS((err < 1.e-10), "Error: the retarded potential cache is off by {}. Config: \n{}", err, config);
+    LOG("Retarded potential OK.");
+  }
+
+  void check_counters(configuration_t const &config) {
+    long n_segments = 0, n_full_lines = 0;
+    for (auto const &[c, sl] : itertools::enumerate(config.seglists)) {
+      bool full = (sl.size() == 1 and is_full_line(sl[0]));
+      ALWAYS_EXPECTS((config.n_segments(c) == long(sl.size()) and config.n_full_lines_per_color[c] == (full ? 1 : 0)),
+                     "Error: cached counts of color {} are wrong. Config: \n{}", c, config);
+      n_segments += sl.size();
+      n_full_lines += full ? 1 : 0;
+    }
+    ALWAYS_EXPECTS((config.n_segments() == n_segments and config.n_full_lines_total == n_full_lines),
+                   "Error: cached total counts are wrong. Config: \n{}", config);
+    LOG("Counters OK.");
+  }
+
+  void check_trace_sign(configuration_t const &config, work_data_t const &wdata) {
+    double sign = trace_sign(wdata);
+    ALWAYS_EXPECTS((sign == wdata.current_trace_sign), "Error: the tracked trace sign {} should be {}. Config: \n{}",
+                   wdata.current_trace_sign, sign, config);
+    LOG("Trace sign OK.");
+  }
+
 } // namespace triqs_ctseg
@@ -30,4 +30,10 @@ namespace triqs_ctseg {
 
   void check_jlines(configuration_t const &config);
 
+  void check_retarded_potential(configuration_t const &config, work_data_t const &wdata);
+
+  void check_counters(configuration_t const &config);
+
+  void check_trace_sign(configuration_t const &config, work_data_t const &wdata);
+
 } // namespace triqs_ctseg
@@ -0,0 +1,186 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <vector>
+#include <memory>
+#include <complex>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "./tau_t.hpp"
+#include "./logs.hpp"
+#include "./shared_memory.hpp"
+
+namespace triqs_ctseg {
+
+  /**
+  * Interpolation table for a real, matrix-valued kernel $f_{ij}(\tau)$ given on a uniform mesh of $[0,\beta]$.
+  *
+  * The kernel is evaluated directly from the integer representation of a tau_t, with the same
+  * linear interpolation as the gf<imtime> evaluator, but without bounds checks, mesh lookup or matrix slicing.
+  * For each (i, j), the values and slopes of the mesh intervals are stored contiguously, so that
+  * a loop over many times at fixed (i, j) (see slice) only touches a single contiguous array.
+  * The table is immutable once built and shared between copies (e.g. the Markov chains of the different threads).
+  * It can also be allocated once per node in an MPI shared-memory window (see shared_memory.hpp).
+  *
+  * Alternatively, the kernel can be given in closed form as a short sum of exponentials (e.g. K(tau) for
+  * a retarded interaction made of a few bosonic modes), evaluated exactly at any time from a small table
+  * of coefficients, without a mesh.
+  *
+  */
+  class kernel_table_t {
+
+    // One interval [tau_k, tau_{k+1}] of the mesh: f(tau) = f_k + slope_k * x, with x in [0,1]
+    struct alignas(16) node_t {
+      double f, slope;
+    };
+
+    public:
+    /// A term p exp(-w tau) + q exp(-w (beta - tau)) of a kernel given as a sum of exponentials (w >= 0)
+    struct exp_term_t {
+      double w, p, q;
+    };
+
+    private:
+    long n_tau = 0, dim1 = 0, dim2 = 0;
+    double scale = 0; // Number of mesh intervals per unit of tau_t integer
+    std::shared_ptr<node_t const[]> table;
+
+    // Sum of exponentials: n_terms terms and a constant for each (i, j), in the same order as the table
+    long n_terms = 0;
+    double beta  = 0;
+    std::shared_ptr<exp_term_t const[]> terms;
+    std::shared_ptr<double const[]> constants;
+
+    public:
+    kernel_table_t() = default;
+
+    /// Construct from a sum of exponentials: f_ij(tau) = constants[i * dim2 + j] + sum_k terms[i * dim2 + j][k](tau),
+    /// with the same number of terms for all (i, j).
+    kernel_table_t(long dim1_, long dim2_, double beta_, std::vector<double> const &constants_,
+                   std::vector<std::vector<exp_term_t>> const &terms_)
+       : dim1{dim1_}, dim2{dim2_}, beta{beta_} {
+      ALWAYS_EXPECTS((long(constants_.size()) == dim1 * dim2 and long(terms_.size()) == dim1 * dim2),
+                     "Error : a kernel of size {}x{} needs {} sums of exponentials", dim1, dim2, dim1 * dim2);
+      n_terms = terms_.empty() ? 0 : long(terms_[0].size());
+      ALWAYS_EXPECTS((n_terms > 0), "Error : a kernel given as a sum of exponentials needs at least one term");
+      auto t = std::shared_ptr<exp_term_t[]>(new exp_term_t[dim1 * dim2 * n_terms]);
+      auto a = std::shared_ptr<double[]>(new double[dim1 * dim2]);
+      for (long ij = 0; ij < dim1 * dim2; ++ij) {
+        ALWAYS_EXPECTS((long(terms_[ij].size()) == n_terms), "Error : all the elements of a kernel need {} terms",
+                       n_terms);
+        std::copy(terms_[ij].begin(), terms_[ij].end(), t.get() + ij * n_terms);
+        a[ij] = constants_[ij];
+      }
+      terms     = std::move(t);
+      constants = std::move(a);
+    }
+
+    /// Construct from a matrix-valued gf<imtime>. The real part is taken.
+    /// The table is allocated with shm (private to the process by default).
+    template <typename G> explicit kernel_table_t(G const &g, shared_memory_t const &shm = shared_memory_t{}) {
+      auto const &data = g.data();
+      n_tau            = data.extent(0);
+      dim1             = data.extent(1);
+      dim2             = data.extent(2);
+      ALWAYS_EXPECTS((n_tau >= 2), "Error : kernel interpolation needs at least 2 mesh points, got {}", n_tau);
+      scale = double(n_tau - 1) / double(tau_t::n_max);
+      table = shm.make_array<node_t>(dim1 * dim2 * (n_tau - 1), [&](node_t *t) {
+        for (long i = 0; i < dim1; ++i)
+          for (long j = 0; j < dim2; ++j) {
+            auto *p = t + (i * dim2 + j) * (n_tau - 1);
+            for (long k = 0; k < n_tau - 1; ++k) {
+              double f0 = std::real(data(k, i, j)), f1 = std::real(data(k + 1, i, j));
+              p[k] = {f0, f1 - f0};
+            }
+          }
+      });
+    }
+
+    /// Number of mesh points (0 for a sum of exponentials)
+    [[nodiscard]] long size() const { return n_tau; }
+
+    /// Number of exponentials of each element (0 for an interpolation table)
+    [[nodiscard]] long n_exp_terms() const { return n_terms; }
+
+    /// The tabulated kernel f_ij for a fixed (i, j), to be hoisted out of loops over many times. Branch free.
+    class slice_t {
+      node_t const *nodes = nullptr;
+      double scale        = 0;
+      long k_max          = 0;
+
+      public:
+      slice_t(node_t const *nodes_, double scale_, long k_max_) : nodes{nodes_}, scale{scale_}, k_max{k_max_} {}
+
+      /// Evaluate f_ij(tau)
+      [[nodiscard]] double operator()(tau_t const &tau) const {
+        double x = double(tau.integer()) * scale;
+        long k   = std::min(long(x), k_max);
+        return nodes[k].f + nodes[k].slope * (x - double(k));
+      }
+    };
+
+    /// The kernel f_ij for a fixed (i, j), given as a sum of exponentials
+    class exp_slice_t {
+      exp_term_t const *terms = nullptr;
+      long n_terms            = 0;
+      double constant         = 0;
+      double beta             = 0;
+
+      public:
+      exp_slice_t(exp_term_t const *terms_, long n_terms_, double constant_, double beta_)
+         : terms{terms_}, n_terms{n_terms_}, constant{constant_}, beta{beta_} {}
+
+      /// Evaluate f_ij(tau)
+      [[nodiscard]] double operator()(tau_t const &tau) const {
+        double x   = double(tau);
+        double res = constant;
+        for (long k = 0; k < n_terms; ++k)
+          res += terms[k].p * std::exp(-terms[k].w * x) + terms[k].q * std::exp(-terms[k].w * (beta - x));
+        return res;
+      }
+    };
+
+    /// Slice of an interpolation table at fixed (i, j)
+    [[nodiscard]] slice_t slice(long i, long j) const {
+      assert(n_terms == 0);
+      return {table.get() + (i * dim2 + j) * (n_tau - 1), scale, n_tau - 2};
+    }
+
+    /// Slice of a sum of exponentials at fixed (i, j)
+    [[nodiscard]] exp_slice_t exp_slice(long i, long j) const {
+      assert(n_terms > 0);
+      return {terms.get() + (i * dim2 + j) * n_terms, n_terms, constants[i * dim2 + j], beta};
+    }
+
+    /// Call f(slice), where slice(i, j) returns the slice of the kernel at fixed (i, j) : a slice_t for an
+    /// interpolation table, an exp_slice_t for a sum of exponentials. The kind of kernel is checked once, out of
+    /// the loops of f, which are compiled for each kind.
+    template <typename F> decltype(auto) visit(F &&f) const {
+      if (n_terms > 0) return f([this](long i, long j) { return exp_slice(i, j); });
+      return f([this](long i, long j) { return slice(i, j); });
+    }
+
+    /// Evaluate f_ij(tau)
+    [[nodiscard]] double operator()(tau_t const &tau, long i, long j) const {
+      return visit([&](auto const &s) { return s(i, j)(tau); });
+    }
+  };
+
+} // namespace triqs_ctseg
@@ -19,9 +19,16 @@
 
 #include "./measures/G_F_tau.hpp"
 #include "./measures/nn_tau.hpp"
+#include "./measures/G2_iw.hpp"
 #include "./measures/Sperp_tau.hpp"
 #include "./measures/nn_static.hpp"
 #include "./measures/densities.hpp"
 #include "./measures/average_sign.hpp"
 #include "./measures/pert_order.hpp"
+#include "./measures/sign_diagnostics.hpp"
 #include "./measures/state_hist.hpp"
+#include "./measures/sample_stream.hpp"
+#include "./measures/interval.hpp"
+#include "./measures/timed.hpp"
+#include "./measures/collectable.hpp"
+#include "./measures/precision_probe.hpp"
@@ -0,0 +1,184 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "./G2_iw.hpp"
+#include "../logs.hpp"
+#include "../reduction.hpp"
+
+namespace triqs_ctseg::measures {
+
+  G2_iw::G2_iw(params_t const &p, work_data_t const &wdata, configuration_t const &config, results_t &results,
+               precompute_fprefactor_t *fprefactors)
+     : wdata{wdata}, config{config}, results{results}, fprefactors{fprefactors} {
+
+    beta           = p.beta;
+    reduce_to_root = p.reduce_to_root;
+    measure_F2     = p.measure_F_tau and wdata.model->rot_inv;
+    gf_struct      = p.gf_struct;
+    n_f            = p.n_iw_G2;
+    n_b            = p.n_iw_G2_bosonic;
+    ALWAYS_EXPECTS((n_f > 0), "Error : n_iw_G2 must be positive, got {}", n_f);
+    ALWAYS_EXPECTS((n_b > 0), "Error : n_iw_G2_bosonic must be positive, got {}", n_b);
+    ALWAYS_EXPECTS((not measure_F2 or fprefactors), "Error : the measure of F2(iw) needs the fprefactors");
+    n_nu = 2 * n_f + n_b - 1;
+
+    for (auto const &[name1, size1] : gf_struct) {
+      M_iw.push_back(nda::zeros<dcomplex>(n_nu * size1, n_nu * size1));
+      auto &acc = G2_acc.emplace_back();
+      for (auto const &[name2, size2] : gf_struct)
+        acc.push_back(nda::zeros<dcomplex>(n_b, 2 * n_f, 2 * n_f, size1, size1, size2, size2));
+    }
+    if (measure_F2) {
+      MI_iw  = M_iw;
+      F2_acc = G2_acc;
+    }
+  }
+
+  // -------------------------------------
+
+  // M_ab(nu_p, nu_q) of block bl, from the tables of the exponentials of the times of its operators
+  void G2_iw::compute_M(long bl) {
+    auto const &det = wdata.dets[bl];
+    long N          = det.size();
+    long n          = M_iw[bl].extent(0) / n_nu; // Block size
+    if (N == 0) {
+      M_iw[bl] = 0;
+      if (measure_F2) MI_iw[bl] = 0;
+      return;
+    }
+
+    exp_c.resize(n_nu * n, N);
+    exp_cdag.resize(N, n_nu * n);
+    M_inv.resize(N, N);
+    exp_c()    = 0;
+    exp_cdag() = 0;
+    for (long k : range(N)) {
+      // e^{i nu_p tau} for all p, by successive multiplications from nu_0 = (1 - 2 n_f) pi / beta
+      auto [tau_c, a]    = det.get_y(k);
+      auto [tau_cdag, b] = det.get_x(k);
+      double tc          = double(tau_c);
+      double tcd         = double(tau_cdag);
+      auto z_c           = std::exp(dcomplex{0, M_PI * double(1 - 2 * n_f) * tc / beta});
+      auto z_cdag        = std::exp(dcomplex{0, -M_PI * double(1 - 2 * n_f) * tcd / beta});
+      auto step_c        = std::exp(dcomplex{0, 2 * M_PI * tc / beta});
+      auto step_cdag     = std::exp(dcomplex{0, -2 * M_PI * tcd / beta});
+      for (long p = 0; p < n_nu; ++p, z_c *= step_c, z_cdag *= step_cdag) {
+        exp_c(p * n + a, k)    = z_c;
+        exp_cdag(k, p * n + b) = z_cdag;
+      }
+      for (long l : range(N)) M_inv(k, l) = det.inverse_matrix(k, l);
+    }
+    exp_M    = exp_c * M_inv;
+    M_iw[bl] = exp_M * exp_cdag;
+
+    // M^I : the rows of M multiplied by I(tau_c)
+    if (measure_F2) {
+      auto const &I = (*fprefactors)()[bl];
+      for (long k : range(N))
+        for (long l : range(N)) M_inv(k, l) *= I[k];
+      exp_M     = exp_c * M_inv;
+      MI_iw[bl] = exp_M * exp_cdag;
+    }
+  }
+
+  // -------------------------------------
+
+  void G2_iw::accumulate(double s) {
+
+    LOG("\n =================== MEASURE G2(iw) ================ \n");
+
+    Z += s;
+
+    for (long bl : range(long(M_iw.size()))) compute_M(bl);
+
+    for (long bl1 : range(long(M_iw.size()))) {
+      accumulate_blocks(G2_acc[bl1], M_iw, bl1, s);
+      if (measure_F2) accumulate_blocks(F2_acc[bl1], MI_iw, bl1, s);
+    }
+  }
+
+  // -------------------------------------
+
+  // Add s [X_ab(nu, nu + omega) M_cd(nu' + omega, nu') - delta_{bl1 bl2} X_ad(nu, nu') M_cb(nu' + omega, nu + omega)]
+  // to acc[bl2] for all the blocks bl2, with X = M1_iw[bl1] (M for G2, M^I for F2)
+  void G2_iw::accumulate_blocks(std::vector<nda::array<dcomplex, 7>> &acc,
+                                std::vector<nda::matrix<dcomplex>> const &M1_iw, long bl1, double s) {
+    for (long bl2 : range(long(M_iw.size()))) {
+      // M is zero for an empty det
+      if (wdata.dets[bl1].size() == 0 or wdata.dets[bl2].size() == 0) continue;
+      auto const &X  = M1_iw[bl1];
+      auto const &M1 = M_iw[bl1];
+      auto const &M2 = M_iw[bl2];
+      long n1        = M1.extent(0) / n_nu;
+      long n2        = M2.extent(0) / n_nu;
+      bool same      = (bl1 == bl2);
+
+      // Loop in the layout of the accumulator (omega, nu, nu', a, b, c, d)
+      dcomplex *g = acc[bl2].data();
+      for (long w = 0; w < n_b; ++w)
+        for (long m = 0; m < 2 * n_f; ++m)     // nu = nu_m, nu + omega = nu_{m + w}
+          for (long mp = 0; mp < 2 * n_f; ++mp) // nu' = nu_mp, nu' + omega = nu_{mp + w}
+            for (long a = 0; a < n1; ++a)
+              for (long b = 0; b < n1; ++b)
+                for (long c = 0; c < n2; ++c)
+                  for (long d = 0; d < n2; ++d, ++g) {
+                    dcomplex val = X(m * n1 + a, (m + w) * n1 + b) * M2((mp + w) * n2 + c, mp * n2 + d);
+                    if (same) val -= X(m * n1 + a, mp * n1 + d) * M1((mp + w) * n1 + c, (m + w) * n1 + b);
+                    *g += s * val;
+                  }
+    }
+  }
+
+  // -------------------------------------
+
+  void G2_iw::collect_results(mpi::communicator const &c) {
+
+    Z = mpi::all_reduce(Z, c);
+
+    // Reduce all the accumulators together, in place, by chunks (see buffer_reduction_t)
+    {
+      auto reduction = buffer_reduction_t{c, reduce_to_root};
+      for (auto *accs : {&G2_acc, &F2_acc})
+        for (auto &v : *accs)
+          for (auto &acc : v) reduction.add(acc);
+    }
+
+    using mesh_t   = prod<imfreq, imfreq, imfreq>;
+    auto bosonic   = imfreq{beta, Boson, n_b, imfreq::option::positive_frequencies_only};
+    auto fermionic = imfreq{beta, Fermion, n_f};
+    auto mesh      = mesh_t{bosonic, fermionic, fermionic};
+
+    auto names = std::vector<std::string>{};
+    for (auto const &[name, size] : gf_struct) names.push_back(name);
+
+    auto make_G2 = [&](std::vector<std::vector<nda::array<dcomplex, 7>>> const &accs) {
+      auto blocks = std::vector<std::vector<gf<mesh_t, tensor_valued<4>>>>(gf_struct.size());
+      for (long bl1 : range(long(gf_struct.size()))) {
+        for (long bl2 : range(long(gf_struct.size()))) {
+          long n1  = gf_struct[bl1].second, n2 = gf_struct[bl2].second;
+          auto g   = gf<mesh_t, tensor_valued<4>>{mesh, {n1, n1, n2, n2}};
+          g.data() = accs[bl1][bl2] / (beta * Z);
+          blocks[bl1].push_back(std::move(g));
+        }
+      }
+      return block2_gf<mesh_t, tensor_valued<4>>{names, names, std::move(blocks)};
+    };
+    results.G2_iw = make_G2(G2_acc);
+    if (measure_F2) results.F2_iw = make_G2(F2_acc);
+  }
+
+} // namespace triqs_ctseg::measures
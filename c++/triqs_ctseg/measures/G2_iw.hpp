@@ -0,0 +1,85 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include "../configuration.hpp"
+#include "../work_data.hpp"
+#include "../results.hpp"
+#include "../precompute_fprefactor.hpp"
+
+namespace triqs_ctseg::measures {
+
+  /**
+  * Two-particle Green's function in Matsubara frequencies (particle-hole convention)
+  *
+  *   G2_abcd(i omega, i nu, i nu') = 1/beta int dtau_1 ... dtau_4 e^{i nu tau_1 - i (nu + omega) tau_2}
+  *                                   e^{i (nu' + omega) tau_3 - i nu' tau_4}
+  *                                   < T c_a(tau_1) c^+_b(tau_2) c_c(tau_3) c^+_d(tau_4) >
+  *
+  * for a, b in the block bl1 and c, d in the block bl2, on n_iw_G2_bosonic frequencies omega >= 0 and 2 n_iw_G2
+  * frequencies nu, nu'. It is the Wick contraction of the inverse matrix M of the dets, in frequencies:
+  *
+  *   M_ab(nu_1, nu_2) = sum_{k, l} e^{i nu_1 tau_c(k)} M(k, l) e^{-i nu_2 tau_cdag(l)}
+  *   G2_abcd = 1 / (beta Z) sum s [M_ab(nu, nu + omega) M_cd(nu' + omega, nu')
+  *                                 - delta_{bl1 bl2} M_ad(nu, nu') M_cb(nu' + omega, nu + omega)]
+  *
+  * M is computed for all the frequencies at once, by two matrix products of M with the tables of the exponentials of
+  * the operator times, i.e. in O(n_nu N^2 + n_nu^2 N) instead of O(n_nu^2 N^2).
+  *
+  * With measure_F_tau, the improved estimator F2_abcd is accumulated as well: it is G2 with the first M replaced by
+  * M^I, the rows of M being multiplied by the prefactor I(tau_c) of F(tau) (see precompute_fprefactor_t).
+  */
+  struct G2_iw {
+
+    work_data_t const &wdata;
+    configuration_t const &config;
+    results_t &results;
+    double beta;
+    bool reduce_to_root, measure_F2;
+    gf_struct_t gf_struct;
+    long n_f;  // Number of positive fermionic frequencies nu, nu' of G2
+    long n_b;  // Number of bosonic frequencies omega of G2
+    long n_nu; // Number of fermionic frequencies of M : nu_p = (2 (p - n_f) + 1) pi / beta, p < 2 n_f + n_b - 1
+
+    // M_ab(nu_p, nu_q) (and M^I_ab(nu_p, nu_q) if measure_F2) for each block, as a matrix (p * n + a, q * n + b)
+    // where n is the block size
+    std::vector<nda::matrix<dcomplex>> M_iw, MI_iw;
+
+    // The prefactors I(tau) of the improved estimator, shared between the measures (measure_F2)
+    precompute_fprefactor_t *fprefactors;
+
+    // Tables of e^{i nu_p tau_c(k)} as (p * n + a, k) and of e^{-i nu_p tau_cdag(l)} as (l, p * n + b), zero unless
+    // a, b are the inner indices of the operators, the inverse matrix of the det, and exp_c * M_inv
+    // (kept to avoid reallocation)
+    nda::matrix<dcomplex> exp_c, exp_cdag, M_inv, exp_M;
+
+    // Accumulators of G2 (and F2) for each pair of blocks, in the layout (omega, nu, nu', a, b, c, d) of the gf data
+    std::vector<std::vector<nda::array<dcomplex, 7>>> G2_acc, F2_acc;
+
+    double Z = 0;
+
+    G2_iw(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results,
+          precompute_fprefactor_t *fprefactors = nullptr);
+
+    void accumulate(double s);
+    void collect_results(mpi::communicator const &c);
+    void compute_M(long bl);
+    void accumulate_blocks(std::vector<nda::array<dcomplex, 7>> &acc, std::vector<nda::matrix<dcomplex>> const &M1_iw,
+                           long bl1, double s);
+  };
+
+} // namespace triqs_ctseg::measures
@@ -17,21 +17,97 @@
 
 #include "./G_F_tau.hpp"
 #include "../logs.hpp"
+#include "../reduction.hpp"
 
 namespace triqs_ctseg::measures {
 
-  G_F_tau::G_F_tau(params_t const &p, work_data_t const &wdata, configuration_t const &config, results_t &results)
-     : wdata{wdata}, config{config}, results{results} {
+  namespace {
 
-    beta          = p.beta;
-    measure_F_tau = p.measure_F_tau and wdata.rot_inv;
-    gf_struct     = p.gf_struct;
+    // Add the row vals[0:N] of a det, i.e. sign * M^-1(id_y, id_x) for all id_x, to the tau bins of G(tau)
+    // (and of F(tau) with the factor f_fact, if f_acc is not null) of a block of size n.
+    // acc is in the layout (tau bin, i, j) of G_tau_acc. Only flat arrays, no det nor gf access.
+    template <typename T>
+    void bin_row(long N, double const *vals, long const *bins, long const *x_idx, long i, long n, double f_fact,
+                 T *g_acc, T *f_acc) {
+      if (f_acc) {
+        for (long id_x = 0; id_x < N; ++id_x) {
+          long pos = (bins[id_x] * n + i) * n + x_idx[id_x];
+          g_acc[pos] += T(vals[id_x]);
+          f_acc[pos] += T(vals[id_x] * f_fact);
+        }
+      } else {
+        for (long id_x = 0; id_x < N; ++id_x) g_acc[(bins[id_x] * n + i) * n + x_idx[id_x]] += T(vals[id_x]);
+      }
+    }
+
+  } // namespace
+
+  // -------------------------------------
+
+  G_F_tau::G_F_tau(params_t const &p, work_data_t const &wdata, configuration_t const &config, results_t &results,
+                   precompute_fprefactor_t *fprefactors, precision_probe_t *probe)
+     : wdata{wdata}, config{config}, results{results}, fprefactors{fprefactors}, probe{probe} {
+
+    beta           = p.beta;
+    measure_G_tau  = p.measure_G_tau;
+    measure_F_tau  = p.measure_F_tau and wdata.model->rot_inv;
+    measure_G_l    = p.measure_G_l;
+    measure_G_iw   = p.measure_G_iw;
+    reduce_to_root = p.reduce_to_root;
+    gf_struct      = p.gf_struct;
+    n_l            = p.n_legendre_G;
+    n_iw           = p.n_iw_G;
+    ALWAYS_EXPECTS((not measure_G_l or n_l > 0), "Error : n_legendre_G must be positive, got {}", n_l);
+    ALWAYS_EXPECTS((not measure_G_iw or n_iw > 0), "Error : n_iw_G must be positive, got {}", n_iw);
+    ALWAYS_EXPECTS((not measure_F_tau or fprefactors), "Error : the measure of F(tau) needs the fprefactors");
+    rep  = wdata.model->representative_block;
+    n_eq = wdata.model->n_equivalent_blocks;
+
+    if (measure_G_tau) {
+      G_tau     = block_gf<imtime>{triqs::mesh::imtime{beta, Fermion, p.n_tau_G}, p.gf_struct};
+      F_tau     = block_gf<imtime>{triqs::mesh::imtime{beta, Fermion, p.n_tau_G}, p.gf_struct};
+      bin_scale = double(p.n_tau_G - 1) / double(tau_t::n_max);
+    }
+    for (auto const &[bl, name_size] : itertools::enumerate(gf_struct)) {
+      // Empty accumulators (and disabled buffers and binning) for the blocks equivalent to a previous block
+      long size = (rep[bl] == bl) ? name_size.second : 0;
+      long n_t  = (rep[bl] == bl) ? p.n_tau_G : 0;
+      if (measure_G_tau) {
+        G_tau_acc.push_back(nda::zeros<double>(n_t, size, size));
+        G_tau_buf.emplace_back(G_tau_acc.back(), p.float_histograms);
+        if (rep[bl] == bl)
+          G_tau_bins.emplace_back(p.n_bins, nda::zeros<double>(n_t, size, size));
+        else
+          G_tau_bins.emplace_back();
+        if (measure_F_tau) {
+          F_tau_acc.push_back(nda::zeros<double>(n_t, size, size));
+          F_tau_buf.emplace_back(F_tau_acc.back(), p.float_histograms);
+        }
+      }
+      if (measure_G_l) {
+        G_l_acc.push_back(nda::zeros<double>(size, size, n_l));
+        if (measure_F_tau) F_l_acc.push_back(nda::zeros<double>(size, size, n_l));
+      }
+      if (measure_G_iw) {
+        G_iw_acc.push_back(nda::zeros<dcomplex>(size, size, n_iw));
+        if (measure_F_tau) F_iw_acc.push_back(nda::zeros<dcomplex>(size, size, n_iw));
+      }
+    }
+    legendre_P.resize(n_l);
+    phases.resize(n_iw);
+    Z = 0;
 
-    G_tau   = block_gf<imtime>{triqs::mesh::imtime{beta, Fermion, p.n_tau_G}, p.gf_struct};
-    F_tau   = block_gf<imtime>{triqs::mesh::imtime{beta, Fermion, p.n_tau_G}, p.gf_struct};
-    G_tau() = 0;
-    F_tau() = 0;
-    Z       = 0;
+    if (probe) {
+      auto points = p.target_G_tau_points.empty() ? std::vector<double>{beta / 2} : p.target_G_tau_points;
+      for (double tau : points) {
+        ALWAYS_EXPECTS((tau >= 0 and tau <= beta), "Error : target_G_tau_points must be in [0, beta], got {}", tau);
+        probe_tau.push_back(std::lround(tau / beta * (p.n_tau_G - 1)));
+      }
+      long n_diag = 0;
+      for (auto const &[bl, name_size] : itertools::enumerate(gf_struct))
+        if (rep[bl] == bl) n_diag += name_size.second;
+      probe->start(p.n_bins, n_diag * long(probe_tau.size()));
+    }
   }
 
   // -------------------------------------
@@ -42,25 +118,148 @@ namespace triqs_ctseg::measures {
 
     Z += s;
 
+    // I(tau) at the rows of the dets, shared with the other improved estimators
+    auto const *f_facts = measure_F_tau ? &(*fprefactors)() : nullptr;
+
     for (auto [bl_idx, det] : itertools::enumerate(wdata.dets)) {
-      long N  = det.size();
-      auto &g = G_tau[bl_idx];
-      auto &f = F_tau[bl_idx];
+      long N = det.size();
+      if (N == 0) continue;
+
+      // Copy the times and inner indices of the det into contiguous arrays
+      x_tau.resize(N);
+      y_tau.resize(N);
+      x_idx.resize(N);
+      y_idx.resize(N);
+      bins.resize(N);
+      dtaus.resize(N);
+      vals.resize(N);
+      for (long k : range(N)) {
+        auto x   = det.get_x(k);
+        auto y   = det.get_y(k);
+        x_tau[k] = x.first.integer();
+        y_tau[k] = y.first.integer();
+        x_idx[k] = x.second;
+        y_idx[k] = y.second;
+      }
+
+      long r        = rep[bl_idx]; // The accumulators of the class of the block
+      long n        = G_tau_acc.empty() ? 0 : G_tau_acc[r].extent(1); // Block size
+      double *g_tau = G_tau_acc.empty() ? nullptr : G_tau_acc[r].data();
+      double *f_tau = F_tau_acc.empty() ? nullptr : F_tau_acc[r].data();
+      float *g_buf  = G_tau_buf.empty() ? nullptr : G_tau_buf[r].data(); // Null if not float_histograms
+      float *f_buf  = F_tau_buf.empty() ? nullptr : F_tau_buf[r].data();
+
       for (long id_y : range(N)) {
-        auto y        = det.get_y(id_y);
         double f_fact = 0;
-        if (measure_F_tau) f_fact = fprefactor(bl_idx, y);
+        if (measure_F_tau) f_fact = (*f_facts)[bl_idx][id_y];
+        long i = y_idx[id_y];
+
+        // Time differences, tau bins and the row of M^-1 times the signs, gathered in contiguous arrays.
+        // beta-periodicity is implicit in the (modular) difference, just fix the sign properly
+        uint64_t ty = y_tau[id_y];
+        for (long id_x = 0; id_x < N; ++id_x) {
+          uint64_t dn = ty - x_tau[id_x];
+          dtaus[id_x] = beta * (double(dn) / double(tau_t::n_max));
+          bins[id_x]  = long(double(dn) * bin_scale + 0.5);
+          vals[id_x]  = ((ty >= x_tau[id_x]) ? s : -s) * det.inverse_matrix(id_y, id_x);
+        }
+
+        if (measure_G_tau) {
+          if (g_buf)
+            bin_row(N, vals.data(), bins.data(), x_idx.data(), i, n, f_fact, g_buf, f_buf);
+          else
+            bin_row(N, vals.data(), bins.data(), x_idx.data(), i, n, f_fact, g_tau, f_tau);
+        }
+
+        if (not(measure_G_l or measure_G_iw)) continue;
         for (long id_x : range(N)) {
-          auto x    = det.get_x(id_x);
-          auto Minv = det.inverse_matrix(id_y, id_x);
-          // beta-periodicity is implicit in the argument, just fix the sign properly
-          auto val  = (y.first >= x.first ? s : -s) * Minv;
-          auto dtau = double(y.first - x.first);
-          g[closest_mesh_pt(dtau)](y.second, x.second) += val;
-          if (measure_F_tau) f[closest_mesh_pt(dtau)](y.second, x.second) += val * f_fact;
+          double val  = vals[id_x];
+          double dtau = dtaus[id_x];
+          long j      = x_idx[id_x];
+
+          if (measure_G_l) {
+            compute_legendre(2 * dtau / beta - 1);
+            auto g = G_l_acc[r](i, j, range::all);
+            for (long l = 0; l < n_l; ++l) g(l) += val * legendre_P[l];
+            if (measure_F_tau) {
+              auto f = F_l_acc[r](i, j, range::all);
+              for (long l = 0; l < n_l; ++l) f(l) += val * f_fact * legendre_P[l];
+            }
+          }
+
+          if (measure_G_iw) {
+            compute_phases(dtau);
+            auto g = G_iw_acc[r](i, j, range::all);
+            for (long k = 0; k < n_iw; ++k) g(k) += val * phases[k];
+            if (measure_F_tau) {
+              auto f = F_iw_acc[r](i, j, range::all);
+              for (long k = 0; k < n_iw; ++k) f(k) += val * f_fact * phases[k];
+            }
+          }
         }
       }
     }
+
+    for (auto [bl_idx, b] : itertools::enumerate(G_tau_buf)) b.end_measure(G_tau_acc[bl_idx]);
+    for (auto [bl_idx, b] : itertools::enumerate(F_tau_buf)) b.end_measure(F_tau_acc[bl_idx]);
+
+    if (measure_G_tau)
+      for (auto [bl_idx, b] : itertools::enumerate(G_tau_bins))
+        b.accumulate(Z, [&] {
+          G_tau_buf[bl_idx].flush(G_tau_acc[bl_idx]);
+          return G_tau_acc[bl_idx];
+        });
+    if (probe)
+      probe->bins.accumulate(Z, [&] {
+        flush_buffers();
+        return probed_values();
+      });
+  }
+
+  // -------------------------------------
+
+  // Add the single precision buffers to G_tau_acc and F_tau_acc (float_histograms)
+  void G_F_tau::flush_buffers() {
+    for (auto [bl_idx, b] : itertools::enumerate(G_tau_buf)) b.flush(G_tau_acc[bl_idx]);
+    for (auto [bl_idx, b] : itertools::enumerate(F_tau_buf)) b.flush(F_tau_acc[bl_idx]);
+  }
+
+  // -------------------------------------
+
+  // Diagonal of G(tau) at the tau bins probe_tau, normalized as in collect_results (up to the division by Z),
+  // for the representative blocks only
+  nda::array<double, 1> G_F_tau::probed_values() const {
+    long n_tau_G = G_tau_acc[0].extent(0);
+    double delta = beta / double(n_tau_G - 1);
+    long n_diag  = 0;
+    for (auto const &acc : G_tau_acc) n_diag += acc.extent(1);
+    auto res = nda::array<double, 1>(n_diag * long(probe_tau.size()));
+    long pos = 0;
+    for (auto const &[bl, acc] : itertools::enumerate(G_tau_acc))
+      for (long k : probe_tau) {
+        double f = (k == 0 or k == n_tau_G - 1) ? 2.0 / n_eq[bl] : 1.0 / n_eq[bl]; // See collect_results
+        for (long i = 0; i < acc.extent(1); ++i) res(pos++) = -f * acc(k, i, i) / (beta * delta);
+      }
+    return res;
+  }
+
+  // -------------------------------------
+
+  // Legendre polynomials P_l(x) for l < n_l, from (l + 1) P_{l+1} = (2l + 1) x P_l - l P_{l-1}
+  void G_F_tau::compute_legendre(double x) {
+    if (n_l > 0) legendre_P[0] = 1;
+    if (n_l > 1) legendre_P[1] = x;
+    for (long l = 1; l < n_l - 1; ++l)
+      legendre_P[l + 1] = (double(2 * l + 1) * x * legendre_P[l] - double(l) * legendre_P[l - 1]) / double(l + 1);
+  }
+
+  // exp(i omega_n tau) for omega_n = (2n + 1) pi / beta, n < n_iw, by successive multiplications
+  void G_F_tau::compute_phases(double tau) {
+    if (n_iw == 0) return;
+    auto z0   = std::exp(dcomplex{0, M_PI * tau / beta});
+    auto step = z0 * z0;
+    phases[0] = z0;
+    for (long n = 1; n < n_iw; ++n) phases[n] = phases[n - 1] * step;
   }
 
   // -------------------------------------
@@ -69,47 +268,86 @@ namespace triqs_ctseg::measures {
 
     Z = mpi::all_reduce(Z, c);
 
-    G_tau = mpi::all_reduce(G_tau, c);
-    G_tau = G_tau / (-beta * Z * G_tau[0].mesh().delta());
-
-    // Fix the point at zero and beta, for each block
-    for (auto &g : G_tau) {
-      g[0] *= 2;
-      g[g.mesh().size() - 1] *= 2;
+    // Reduce all the accumulators together, in place, by chunks (see buffer_reduction_t)
+    flush_buffers();
+    {
+      auto reduction = buffer_reduction_t{c, reduce_to_root};
+      for (auto *v : {&G_tau_acc, &F_tau_acc, &G_l_acc, &F_l_acc})
+        for (auto &acc : *v) reduction.add(acc);
+      for (auto *v : {&G_iw_acc, &F_iw_acc})
+        for (auto &acc : *v) reduction.add(acc);
     }
-    // store the result (not reused later, hence we can move it).
-    results.G_tau = std::move(G_tau);
 
-    if (measure_F_tau) {
-      F_tau = mpi::all_reduce(F_tau, c);
-      F_tau = F_tau / (-beta * Z * F_tau[0].mesh().delta());
+    if (measure_G_tau) {
+      // Error bars, from the bins of this rank
+      if (not G_tau_bins.empty() and G_tau_bins[0].enabled()) {
+        auto G_tau_error = G_tau;
+        auto errors      = std::vector<nda::array<double, 3>>(G_tau_bins.size());
+        for (auto [bl, b] : itertools::enumerate(G_tau_bins))
+          if (rep[bl] == bl) errors[bl] = b.error(c);
+        for (auto [bl, g] : itertools::enumerate(G_tau_error)) {
+          g.data() = errors[rep[bl]] / (beta * n_eq[bl] * g.mesh().delta());
+          g[0] *= 2;
+          g[g.mesh().size() - 1] *= 2;
+        }
+        results.G_tau_error = std::move(G_tau_error);
+      }
+
+      for (auto [bl, g] : itertools::enumerate(G_tau)) g.data() = G_tau_acc[rep[bl]] / double(n_eq[bl]);
+      G_tau = G_tau / (-beta * Z * G_tau[0].mesh().delta());
 
-      for (auto &f : F_tau) {
-        f[0] *= 2;
-        f[f.mesh().size() - 1] *= 2;
+      // Fix the point at zero and beta, for each block
+      for (auto &g : G_tau) {
+        g[0] *= 2;
+        g[g.mesh().size() - 1] *= 2;
       }
-      results.F_tau = std::move(F_tau);
-    }
-  }
+      // store the result (not reused later, hence we can move it).
+      results.G_tau = std::move(G_tau);
 
-  // -------------------------------------
+      if (measure_F_tau) {
+        for (auto [bl, f] : itertools::enumerate(F_tau)) f.data() = F_tau_acc[rep[bl]] / double(n_eq[bl]);
+        F_tau = F_tau / (-beta * Z * F_tau[0].mesh().delta());
 
-  double G_F_tau::fprefactor(long const &block, std::pair<tau_t, long> const &y) {
-    int color    = wdata.block_to_color(block, y.second);
-    double I_tau = 0;
-    for (auto const &[c, sl] : itertools::enumerate(config.seglists)) {
-      auto ntau = n_tau(y.first, sl); // Density to the right of y.first in sl
-      if (c != color) I_tau += wdata.U(c, color) * ntau;
-      if (wdata.has_Dt) {
-        I_tau -= K_overlap(sl, y.first, false, wdata.Kprime, c, color);
-        if (c == color) I_tau -= 2 * real(wdata.Kprime(0)(c, c));
+        for (auto &f : F_tau) {
+          f[0] *= 2;
+          f[f.mesh().size() - 1] *= 2;
+        }
+        results.F_tau = std::move(F_tau);
+      }
+    }
+
+    // G_l = -sqrt(2l + 1) / (beta Z) sum val P_l(x), i.e. sqrt(2l + 1) int_0^beta dtau P_l(x(tau)) G(tau)
+    auto make_G_l = [&](std::vector<nda::array<double, 3>> const &acc) {
+      auto G_l = block_gf<legendre>{triqs::mesh::legendre{beta, Fermion, n_l}, gf_struct};
+      for (auto [bl, g] : itertools::enumerate(G_l)) {
+        auto const &a = acc[rep[bl]];
+        double norm   = beta * Z * double(n_eq[bl]);
+        for (long l = 0; l < n_l; ++l)
+          g.data()(l, range::all, range::all) = -std::sqrt(2 * l + 1) * a(range::all, range::all, l) / norm;
       }
-      if (wdata.has_Jperp) {
-        I_tau -= 4 * real(wdata.Kprime_spin(0)(c, color)) * ntau;
-        I_tau -= 2 * K_overlap(sl, y.first, false, wdata.Kprime_spin, c, color);
+      return G_l;
+    };
+    if (measure_G_l) {
+      results.G_l = make_G_l(G_l_acc);
+      if (measure_F_tau) results.F_l = make_G_l(F_l_acc);
+    }
+
+    // G(i omega_n) = -1 / (beta Z) sum val exp(i omega_n dtau). G(tau) is real : G(-i omega_n) = G(i omega_n)^*
+    auto make_G_iw = [&](std::vector<nda::array<dcomplex, 3>> const &acc) {
+      auto G_iw = block_gf<imfreq>{triqs::mesh::imfreq{beta, Fermion, n_iw}, gf_struct};
+      for (auto [bl, g] : itertools::enumerate(G_iw)) {
+        auto const &a = acc[rep[bl]];
+        for (long n = 0; n < n_iw; ++n) {
+          g.data()(n_iw + n, range::all, range::all)     = -a(range::all, range::all, n) / (beta * Z * n_eq[bl]);
+          g.data()(n_iw - 1 - n, range::all, range::all) = conj(g.data()(n_iw + n, range::all, range::all));
+        }
       }
+      return G_iw;
+    };
+    if (measure_G_iw) {
+      results.G_iw = make_G_iw(G_iw_acc);
+      if (measure_F_tau) results.F_iw = make_G_iw(F_iw_acc);
     }
-    return I_tau;
   }
 
 } // namespace triqs_ctseg::measures
@@ -19,6 +19,10 @@
 #include "../configuration.hpp"
 #include "../work_data.hpp"
 #include "../results.hpp"
+#include "../precompute_fprefactor.hpp"
+#include "./binning.hpp"
+#include "./float_buffer.hpp"
+#include "./precision_probe.hpp"
 
 namespace triqs_ctseg::measures {
 
@@ -28,19 +32,63 @@ namespace triqs_ctseg::measures {
     configuration_t const &config;
     results_t &results;
     double beta;
-    bool measure_F_tau;
+    bool measure_G_tau, measure_F_tau, measure_G_l, measure_G_iw, reduce_to_root;
     gf_struct_t gf_struct;
+    long n_l, n_iw;
 
     block_gf<imtime> G_tau;
     block_gf<imtime> F_tau;
 
+    // Representative of the class and number of blocks in the class, for each block (equivalent_blocks).
+    // All the accumulators below are indexed by block, but only allocated for the representative blocks:
+    // equivalent blocks accumulate into their representative, and get the average of the class in collect_results.
+    std::vector<long> rep, n_eq;
+
+    // Accumulators of G(tau) and F(tau) for each block, in the layout (tau bin, i, j) of the gf data.
+    // Converted to G_tau and F_tau in collect_results.
+    std::vector<nda::array<double, 3>> G_tau_acc, F_tau_acc;
+    double bin_scale = 0; // Number of tau bins per unit of tau_t integer
+
+    // Single precision buffers of G_tau_acc and F_tau_acc (float_histograms)
+    std::vector<float_buffer_t<3>> G_tau_buf, F_tau_buf;
+
+    // Error bars of G(tau) (n_bins), for each block
+    std::vector<binning_t<nda::array<double, 3>>> G_tau_bins;
+
+    // The prefactors of the improved estimator F(tau) (measure_F_tau), shared between the measures
+    precompute_fprefactor_t *fprefactors;
+
+    // The diagonal of G(tau) at the tau bins probe_tau of each block (target_G_tau_error), if not null
+    precision_probe_t *probe;
+    std::vector<long> probe_tau;
+
+    // Times (tau_t integers) and inner indices of the columns (x) and rows (y) of the det of the current block,
+    // the time difference, tau bin and signed M^-1 element of each pair of the current row (kept to avoid
+    // reallocation)
+    std::vector<uint64_t> x_tau, y_tau;
+    std::vector<long> x_idx, y_idx, bins;
+    std::vector<double> dtaus, vals;
+
+    // Accumulators of the Legendre and Matsubara coefficients, for each block.
+    // Stored as (i, j, l) and (i, j, n), so that the loop over l or n is contiguous.
+    std::vector<nda::array<double, 3>> G_l_acc, F_l_acc;
+    std::vector<nda::array<dcomplex, 3>> G_iw_acc, F_iw_acc;
+
+    // P_l(x) and exp(i omega_n tau) at the time difference of the current pair (kept to avoid reallocation)
+    std::vector<double> legendre_P;
+    std::vector<dcomplex> phases;
+
     double Z;
 
-    G_F_tau(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results);
+    G_F_tau(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results,
+            precompute_fprefactor_t *fprefactors = nullptr, precision_probe_t *probe = nullptr);
 
     void accumulate(double s);
     void collect_results(mpi::communicator const &c);
-    double fprefactor(long const &block, std::pair<tau_t, long> const &y);
+    nda::array<double, 1> probed_values() const;
+    void flush_buffers();
+    void compute_legendre(double x);
+    void compute_phases(double tau);
   };
 
 } // namespace triqs_ctseg::measures
@@ -23,9 +23,15 @@ namespace triqs_ctseg::measures {
   Sperp_tau::Sperp_tau(params_t const &p, work_data_t const &wdata, configuration_t const &config, results_t &results)
      : wdata{wdata}, config{config}, results{results} {
 
-    beta = p.beta;
+    beta                = p.beta;
+    translation_average = p.Sperp_tau_translation_average;
+    rng                 = std::mt19937_64(p.random_seed);
 
     n_color = config.n_color();
+    ALWAYS_EXPECTS((n_color == 2 or not wdata.model->has_Jperp),
+                   "Error : measure_Sperp_tau is only implemented for a single orbital, got {} colors", n_color);
+    ALWAYS_EXPECTS((not translation_average or n_color == 2),
+                   "Error : Sperp_tau_translation_average is only implemented for 2 colors, got {}", n_color);
 
     ss_tau   = gf<imtime>({beta, Boson, p.n_tau_chi2}, {1, 1});
     ss_tau() = 0;
@@ -40,11 +46,98 @@ namespace triqs_ctseg::measures {
 
     Z += s;
 
+    if (translation_average) {
+      accumulate_translation_average(s);
+      return;
+    }
+
     for (auto const &[k, line] : itertools::enumerate(config.Jperp_list)) {
-      auto dtau1 = double(line.tau_Splus - line.tau_Sminus);
-      auto dtau2 = double(line.tau_Sminus - line.tau_Splus);
-      ss_tau[closest_mesh_pt(dtau1)] += 0.5 / (real(wdata.Jperp(dtau1)(0, 0)));
-      ss_tau[closest_mesh_pt(dtau2)] += 0.5 / (real(wdata.Jperp(dtau2)(0, 0)));
+      auto dtau1 = line.tau_Splus - line.tau_Sminus;
+      auto dtau2 = line.tau_Sminus - line.tau_Splus;
+      ss_tau[closest_mesh_pt(double(dtau1))] += 0.5 / wdata.model->Jperp_table(dtau1, 0, 0);
+      ss_tau[closest_mesh_pt(double(dtau2))] += 0.5 / wdata.model->Jperp_table(dtau2, 0, 0);
+    }
+  }
+
+  // -------------------------------------
+
+  // Translation-averaged insertion estimator.
+  //
+  // <S^-(tau) S^+(0)> is the average over tau' of the ratio of the weights of the configuration with and without the
+  // spin flips S^+(tau') and S^-(tau' + tau). It is not zero if orig = down is occupied and dest = up is empty on
+  // [tau', tau' + tau], i.e. in the arcs of the state |down>. For an arc of length L, the measure of these tau' is
+  // (L - tau)_+ (beta for the full line). With a static interaction, the ratio exp((mu_dest - mu_orig) tau) does not
+  // depend on tau', and the average is exact. With a retarded interaction, it is the ratio at a random tau'.
+  // <S_x(tau) S_x(0)> = (<S^-(tau) S^+(0)> + <S^+(tau) S^-(0)>) / 4 : the other term exchanges the colors.
+  // It sees all the configuration instead of only the Jperp lines, in O(n_arcs n_tau_chi2) (times the number of
+  // segments with a retarded interaction).
+  void Sperp_tau::accumulate_translation_average(double s) {
+    auto &data  = ss_tau.data();
+    long n_tau  = ss_tau.mesh().size();
+    double dtau = beta / double(n_tau - 1);
+    auto const &K = wdata.model->K_table;
+
+    for (int orig : {0, 1}) {
+      int dest = 1 - orig;
+      compute_arcs(orig, dest);
+      double dmu = wdata.model->mu(dest) - wdata.model->mu(orig);
+      for (auto const &[start, L] : arcs) {
+        bool full = (L >= beta); // Full line in orig, dest empty : no boundary
+        for (long u = 0; u < n_tau; ++u) {
+          double tau = double(u) * dtau;
+          double w   = full ? beta : L - tau; // Measure of the tau' with [tau', tau' + tau] in the arc
+          if (w <= 0) break;
+          double ln_ratio = dmu * tau;
+          if (wdata.model->has_Dt and u > 0) {
+            // Same ratio as insert_spin_segment, without the Jperp line, at tau' uniform in the valid positions
+            double t0     = start + w * std::uniform_real_distribution<double>{}(rng);
+            auto spin_seg = segment_t{tau_t{std::fmod(t0 + tau, beta)}, tau_t{std::fmod(t0, beta)}, true, true};
+            for (auto const &[c, sl] : itertools::enumerate(config.seglists)) {
+              ln_ratio += K_overlap(sl, spin_seg.tau_cdag, spin_seg.tau_c, K, orig, c);
+              ln_ratio += K_overlap(sl, spin_seg.tau_c, spin_seg.tau_cdag, K, dest, c);
+            }
+            auto len = spin_seg.length();
+            ln_ratio -= K(len, orig, orig) + K(len, dest, dest) - 2 * K(len, orig, dest);
+          }
+          data(u, 0, 0) += s * w * std::exp(ln_ratio) / (4 * beta);
+        }
+      }
+    }
+  }
+
+  // -------------------------------------
+
+  // The arcs (start, length) of the circle [0, beta[ on which orig is occupied and dest is empty
+  void Sperp_tau::compute_arcs(int orig, int dest) {
+    // Sorted intervals [a, b] of [0, beta] of the segments of a seglist, cyclic segments being split at beta/0
+    auto intervals = [&](auto const &sl, auto &res) {
+      res.clear();
+      for (long i = 0; i < long(sl.size()); ++i) {
+        auto seg = sl[i];
+        if (is_cyclic(seg)) {
+          res.emplace_back(double(seg.tau_cdag), beta);
+          res.emplace_back(0.0, double(seg.tau_c));
+        } else
+          res.emplace_back(double(seg.tau_cdag), double(seg.tau_c));
+      }
+      std::sort(res.begin(), res.end());
+    };
+    intervals(config.seglists[orig], occupied);
+    intervals(flipped_seglist_t{config.seglists[dest]}, empty);
+
+    // Intersection of the two sorted lists of disjoint intervals
+    arcs.clear();
+    for (long i = 0, j = 0; i < long(occupied.size()) and j < long(empty.size());) {
+      double a = std::max(occupied[i].first, empty[j].first);
+      double b = std::min(occupied[i].second, empty[j].second);
+      if (b > a) arcs.emplace_back(a, b - a);
+      (occupied[i].second < empty[j].second) ? ++i : ++j;
+    }
+
+    // An arc ending at beta continues with the one starting at 0
+    if (arcs.size() > 1 and arcs.front().first == 0 and arcs.back().first + arcs.back().second == beta) {
+      arcs.back().second += arcs.front().second;
+      arcs.erase(arcs.begin());
     }
   }
 
@@ -55,6 +148,10 @@ namespace triqs_ctseg::measures {
     Z = mpi::all_reduce(Z, c);
 
     ss_tau = mpi::all_reduce(ss_tau, c);
+    if (translation_average) {
+      results.Sperp_tau = ss_tau / Z;
+      return;
+    }
     ss_tau = ss_tau / (-beta * Z * ss_tau.mesh().delta());
 
     // Fix the point at zero and beta
@@ -20,6 +20,7 @@
 #include "../work_data.hpp"
 #include "../results.hpp"
 //#include "../precompute_fprefactor.hpp"
+#include <random>
 
 namespace triqs_ctseg::measures {
 
@@ -29,15 +30,25 @@ namespace triqs_ctseg::measures {
     configuration_t const &config;
     results_t &results;
     double beta;
+    bool translation_average;
 
     gf<imtime> ss_tau;
 
     double Z = 0;
     int n_color;
 
+    // Arcs (start, length) of [0, beta[ where a color is occupied and the other empty (translation average only),
+    // and the occupied intervals of the first and of the second (kept to avoid reallocation)
+    std::vector<std::pair<double, double>> arcs, occupied, empty;
+
+    // Random positions of the spin flips with a retarded interaction (translation average only)
+    std::mt19937_64 rng;
+
     Sperp_tau(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results);
 
     void accumulate(double s);
+    void accumulate_translation_average(double s);
+    void compute_arcs(int orig, int dest);
     void collect_results(mpi::communicator const &c);
   };
 
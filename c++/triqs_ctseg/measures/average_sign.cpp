@@ -21,11 +21,12 @@
 
 namespace triqs_ctseg::measures {
 
-  average_sign::average_sign(params_t const &, work_data_t const &wdata, configuration_t const &config,
-                             results_t &results)
-     : wdata{wdata}, config{config}, results{results} {
+  average_sign::average_sign(params_t const &p, work_data_t const &wdata, configuration_t const &config,
+                             results_t &results, precision_probe_t *probe)
+     : wdata{wdata}, config{config}, results{results}, bins{p.n_bins, 0.0}, probe{probe} {
     Z = 0.0;
     N = 0.0;
+    if (probe) probe->start(p.n_bins, 1);
   }
 
   // -------------------------------------
@@ -33,6 +34,8 @@ namespace triqs_ctseg::measures {
   void average_sign::accumulate(double s) {
     Z += s;
     N += 1.0;
+    bins.accumulate(N, [&] { return Z; });
+    if (probe) probe->bins.accumulate(N, [&] { return nda::array<double, 1>{Z}; });
   }
 
   // -------------------------------------
@@ -42,6 +45,7 @@ namespace triqs_ctseg::measures {
     N = mpi::all_reduce(N, c);
 
     results.average_sign = Z / N;
+    if (bins.enabled()) results.average_sign_error = bins.error(c);
   }
 
 } // namespace triqs_ctseg::measures
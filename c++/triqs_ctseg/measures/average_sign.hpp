@@ -19,6 +19,8 @@
 #include "../configuration.hpp"
 #include "../results.hpp"
 #include "../work_data.hpp"
+#include "./binning.hpp"
+#include "./precision_probe.hpp"
 
 namespace triqs_ctseg::measures {
 
@@ -31,7 +33,11 @@ namespace triqs_ctseg::measures {
     double N = 0;
     double Z = 0;
 
-    average_sign(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results);
+    binning_t<double> bins;   // Error bar (n_bins), with N as the normalization
+    precision_probe_t *probe; // The average sign (target_average_sign_error), if not null
+
+    average_sign(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results,
+                 precision_probe_t *probe = nullptr);
 
     void accumulate(double s);
     void collect_results(mpi::communicator const &c);
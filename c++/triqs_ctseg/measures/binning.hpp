@@ -0,0 +1,125 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <cmath>
+#include <vector>
+#include <type_traits>
+#include <mpi/mpi.hpp>
+#include <nda/nda.hpp>
+#include "../logs.hpp"
+
+namespace triqs_ctseg::measures {
+
+  /**
+  * Binned accumulation of a measure, for jackknife error bars (solve parameter n_bins).
+  *
+  * A measure accumulates sum = sum_i s_i X_i and Z = sum_i s_i over its measurements i.
+  * The binning keeps the values of (sum, Z) at the end of each bin of bin_size consecutive measurements, so that
+  * the bins are the differences of consecutive values. Starting from bin_size = 1, when n_bins bins are full,
+  * they are merged by pairs and bin_size is doubled: there are always between n_bins / 2 and n_bins full bins,
+  * whatever the number of measurements. The sum is only copied at the end of a bin, i.e. O(n_bins log N) times.
+  *
+  * T is double or a real nda::array.
+  */
+  template <typename T> class binning_t {
+
+    long n_bins = 0, bin_size = 1, n_measures = 0;
+    T zero;
+    std::vector<T> sums;   // sum at the end of each full bin
+    std::vector<double> Z; // Z at the end of each full bin
+
+    public:
+    binning_t() = default;
+
+    /// zero is a T of the shape of the sum, set to 0. No binning if n_bins_ = 0.
+    binning_t(long n_bins_, T zero_) : n_bins{n_bins_}, zero{std::move(zero_)} {
+      ALWAYS_EXPECTS((n_bins == 0 or (n_bins >= 2 and n_bins % 2 == 0)),
+                     "Error : n_bins must be 0 or an even number >= 2, got {}", n_bins);
+    }
+
+    [[nodiscard]] bool enabled() const { return n_bins > 0; }
+
+    /// Number of full bins (on this rank)
+    [[nodiscard]] long size() const { return long(sums.size()); }
+
+    /// Z at the end of the last full bin (on this rank)
+    [[nodiscard]] double weight() const { return Z.empty() ? 0.0 : Z.back(); }
+
+    /// To be called after each measurement with the new Z. sum() returns the new sum, and is only called at the
+    /// end of a bin (it may be expensive, e.g. for nn_tau).
+    template <typename F> void accumulate(double Z_, F &&sum) {
+      if (n_bins == 0 or ++n_measures % bin_size != 0) return;
+      sums.push_back(sum());
+      Z.push_back(Z_);
+      if (long(sums.size()) < n_bins) return;
+      // Merge the bins by pairs : keep the ends of the odd bins
+      for (long k = 0; k < n_bins / 2; ++k) {
+        sums[k] = std::move(sums[2 * k + 1]);
+        Z[k]    = Z[2 * k + 1];
+      }
+      sums.resize(n_bins / 2);
+      Z.resize(n_bins / 2);
+      bin_size *= 2;
+    }
+
+    /**
+    * Jackknife error bar of sum / Z, from the full bins of all the ranks of c.
+    *
+    * With X_j and Z_j the sum and Z of bin j, and N the total number of bins, the leave-one-out estimates are
+    * theta_j = (X - X_j) / (Z - Z_j) and the error is sqrt((N - 1) / N sum_j (theta_j - mean(theta))^2).
+    * Returns 0 if there are less than 2 bins in total. Must be called on all the ranks of c.
+    */
+    [[nodiscard]] T error(mpi::communicator const &c) const {
+      T X_tot      = mpi::all_reduce(sums.empty() ? zero : sums.back(), c);
+      double Z_tot = mpi::all_reduce(Z.empty() ? 0.0 : Z.back(), c);
+      long N       = mpi::all_reduce(long(sums.size()), c);
+      if (N < 2) return zero;
+
+      auto theta = [&](long j) {
+        T X_j      = (j == 0) ? sums[0] : T{sums[j] - sums[j - 1]};
+        double Z_j = (j == 0) ? Z[0] : Z[j] - Z[j - 1];
+        return T{(X_tot - X_j) / (Z_tot - Z_j)};
+      };
+
+      T mean = zero;
+      for (long j = 0; j < long(sums.size()); ++j) mean += theta(j);
+      mean = mpi::all_reduce(mean, c) / double(N);
+
+      T var = zero;
+      for (long j = 0; j < long(sums.size()); ++j) var += squares(T{theta(j) - mean});
+      var = mpi::all_reduce(var, c) * (double(N - 1) / N);
+      return square_roots(var);
+    }
+
+    private:
+    static T squares(T const &x) {
+      if constexpr (std::is_arithmetic_v<T>)
+        return x * x;
+      else
+        return T{x * x}; // elementwise for nda::array
+    }
+
+    static T square_roots(T const &x) {
+      if constexpr (std::is_arithmetic_v<T>)
+        return std::sqrt(x);
+      else
+        return T{nda::sqrt(x)};
+    }
+  };
+
+} // namespace triqs_ctseg::measures
@@ -0,0 +1,49 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <mpi/mpi.hpp>
+
+namespace triqs_ctseg::measures {
+
+  /**
+  * A measure whose results can also be collected during the run (solve parameter partial_results_file).
+  *
+  * While *partial is true, collect_results works on a copy of the measure, whose accumulators are left unchanged
+  * so that the accumulation can go on. The measure must not modify anything else than the results in
+  * collect_results, and the copy holds the memory of one measure at a time.
+  */
+  template <typename Measure> struct collectable {
+
+    Measure measure;
+    bool const *partial;
+
+    collectable(Measure measure_, bool const *partial_) : measure{std::move(measure_)}, partial{partial_} {}
+
+    void accumulate(double s) { measure.accumulate(s); }
+
+    void collect_results(mpi::communicator const &c) {
+      if (not *partial) {
+        measure.collect_results(c);
+        return;
+      }
+      auto copy = measure;
+      copy.collect_results(c);
+    }
+  };
+
+} // namespace triqs_ctseg::measures
@@ -21,10 +21,13 @@
 
 namespace triqs_ctseg::measures {
 
-  densities::densities(params_t const &, work_data_t const &wdata, configuration_t const &config, results_t &results)
-     : wdata{wdata}, config{config}, results{results} {
+  densities::densities(params_t const &p, work_data_t const &wdata, configuration_t const &config, results_t &results,
+                       precision_probe_t *probe)
+     : wdata{wdata}, config{config}, results{results}, probe{probe} {
 
-    n = nda::zeros<double>(config.n_color());
+    n    = nda::zeros<double>(config.n_color());
+    bins = {p.n_bins, n};
+    if (probe) probe->start(p.n_bins, n.size());
   }
 
   // -------------------------------------
@@ -35,8 +38,20 @@ namespace triqs_ctseg::measures {
     for (auto const &[c, seglist] : itertools::enumerate(config.seglists)) {
       double sum = 0;
       for (auto &seg : seglist) sum += double(seg.length()); // accounts for cyclicity
-      n[c] += s * sum;
+      n[wdata.model->representative_color[c]] += s * sum;
     }
+    bins.accumulate(Z, [&] { return n; });
+    if (probe) probe->bins.accumulate(Z, [&] { return nda::array<double, 1>{symmetrized(n) / double(tau_t::beta())}; });
+  }
+
+  // -------------------------------------
+
+  nda::array<double, 1> densities::symmetrized(nda::array<double, 1> const &x) const {
+    auto const &m = *wdata.model;
+    auto res      = nda::array<double, 1>(x.size());
+    for (long c = 0; c < x.size(); ++c)
+      res[c] = x[m.representative_color[c]] / double(m.n_equivalent_blocks[m.block_number[c]]);
+    return res;
   }
 
   // -------------------------------------
@@ -44,19 +59,24 @@ namespace triqs_ctseg::measures {
   void densities::collect_results(mpi::communicator const &c) {
     Z = mpi::all_reduce(Z, c);
     n = mpi::all_reduce(n, c);
-    n /= (Z * tau_t::beta());
+    n = symmetrized(n) / (Z * tau_t::beta());
 
-    std::map<std::string, nda::array<double, 1>> densities;
-    for (long offset = 0; auto [bl_name, bl_size] : wdata.gf_struct) {
-      densities[bl_name] = n[range(offset, offset + bl_size)];
-      offset += bl_size;
-    }
+    // Per block, in place in the results
+    auto by_block = [&](nda::array<double, 1> const &x, auto &res) {
+      if (not res) res.emplace();
+      for (long offset = 0; auto [bl_name, bl_size] : wdata.model->gf_struct) {
+        (*res)[bl_name] = x[range(offset, offset + bl_size)];
+        offset += bl_size;
+      }
+    };
+    by_block(n, results.densities);
     if (c.rank() == 0) {
       SPDLOG_INFO("Densities:");
-      for (auto &[bl, dens] : densities) SPDLOG_INFO("  {}: {}", bl, dens);
+      for (auto &[bl, dens] : *results.densities) SPDLOG_INFO("  {}: {}", bl, dens);
     }
 
-    results.densities = std::move(densities);
+    if (bins.enabled())
+      by_block(nda::array<double, 1>{symmetrized(bins.error(c)) / double(tau_t::beta())}, results.densities_error);
   }
 
 } // namespace triqs_ctseg::measures
@@ -19,6 +19,8 @@
 #include "../configuration.hpp"
 #include "../results.hpp"
 #include "../work_data.hpp"
+#include "./binning.hpp"
+#include "./precision_probe.hpp"
 
 namespace triqs_ctseg::measures {
 
@@ -28,14 +30,23 @@ namespace triqs_ctseg::measures {
     configuration_t const &config;
     results_t &results;
 
+    // Accumulated per color. The colors of equivalent blocks (equivalent_blocks) accumulate into the color of their
+    // representative block
     nda::array<double, 1> n;
 
     double Z = 0;
 
-    densities(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results);
+    binning_t<nda::array<double, 1>> bins; // Error bars (n_bins)
+    precision_probe_t *probe;              // All the densities (target_densities_error), if not null
+
+    densities(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results,
+              precision_probe_t *probe = nullptr);
 
     void accumulate(double s);
     void collect_results(mpi::communicator const &c);
+
+    // The average over its class of equivalent blocks of x, for each color
+    [[nodiscard]] nda::array<double, 1> symmetrized(nda::array<double, 1> const &x) const;
   };
 
 } // namespace triqs_ctseg::measures
@@ -0,0 +1,70 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <nda/nda.hpp>
+
+namespace triqs_ctseg::measures {
+
+  /**
+  * Single precision buffer of a double precision histogram (solve parameter float_histograms).
+  *
+  * The measure adds its contributions to the float buffer, which is added to the double precision histogram
+  * and reset every flush_interval measurements (and before any use of the histogram). The rounding error of the
+  * float buffer is thus relative to the contributions of at most flush_interval measurements, not to the whole
+  * histogram: after the flush, the histogram is summed in double precision, which compensates for the low
+  * precision of the buffer. The memory touched at each measurement is halved.
+  */
+  template <int R> class float_buffer_t {
+
+    nda::array<float, R> buf;
+    long n_measures = 0;
+
+    public:
+    static constexpr long flush_interval = 64;
+
+    float_buffer_t() = default;
+
+    /// A buffer of the shape of the histogram h, if enabled (otherwise empty)
+    float_buffer_t(nda::array<double, R> const &h, bool enabled) {
+      if (enabled) buf = nda::zeros<float>(h.shape());
+    }
+
+    [[nodiscard]] bool enabled() const { return buf.size() > 0; }
+
+    /// The data of the buffer (null if not enabled)
+    [[nodiscard]] float *data() { return enabled() ? buf.data() : nullptr; }
+
+    template <typename... I> float &operator()(I... i) { return buf(i...); }
+
+    /// Add the buffer to h and reset it
+    void flush(nda::array<double, R> &h) {
+      if (not enabled()) return;
+      double *p      = h.data();
+      float const *q = buf.data();
+      for (long k = 0; k < h.size(); ++k) p[k] += double(q[k]);
+      buf()      = 0;
+      n_measures = 0;
+    }
+
+    /// Count a measurement, and flush into h every flush_interval measurements
+    void end_measure(nda::array<double, R> &h) {
+      if (enabled() and ++n_measures == flush_interval) flush(h);
+    }
+  };
+
+} // namespace triqs_ctseg::measures
@@ -0,0 +1,48 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "./interval.hpp"
+
+namespace triqs_ctseg::measures {
+
+  double integrated_autocorrelation_time(std::vector<double> const &x) {
+    long n = x.size();
+    if (n < 2) return 0.5;
+
+    double mean = 0;
+    for (auto v : x) mean += v;
+    mean /= double(n);
+
+    // Autocovariance at lag t
+    auto cov = [&](long t) {
+      double r = 0;
+      for (long i = 0; i + t < n; ++i) r += (x[i] - mean) * (x[i + t] - mean);
+      return r / double(n - t);
+    };
+
+    double c0 = cov(0);
+    if (c0 <= 0) return 0.5;
+
+    double tau = 0.5;
+    for (long t = 1; t < n / 2; ++t) {
+      tau += cov(t) / c0;
+      if (double(t) >= 5 * tau) break; // Sokal's window
+    }
+    return std::max(tau, 0.5);
+  }
+
+} // namespace triqs_ctseg::measures
@@ -0,0 +1,57 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <mpi/mpi.hpp>
+
+namespace triqs_ctseg::measures {
+
+  /**
+  * Run a measure only once every n cycles.
+  *
+  * For expensive measures whose successive values are strongly correlated.
+  * n is the maximum of a fixed interval and of *min_interval (if not null), which may be changed during the run
+  * (see the solve parameter measure_interval_auto).
+  * The measure must be normalized by its own sum of signs, which is the case of all the measures of the solver.
+  */
+  template <typename Measure> struct interval {
+
+    Measure measure;
+    long n;
+    long const *min_interval = nullptr;
+    long counter             = 0;
+
+    interval(Measure measure_, long n_, long const *min_interval_ = nullptr)
+       : measure{std::move(measure_)}, n{n_}, min_interval{min_interval_} {}
+
+    void accumulate(double s) {
+      if (++counter < std::max(n, min_interval ? *min_interval : 1)) return;
+      counter = 0;
+      measure.accumulate(s);
+    }
+
+    void collect_results(mpi::communicator const &c) { measure.collect_results(c); }
+  };
+
+  /// Integrated autocorrelation time of a time series, tau_int = 1/2 + sum_{t >= 1} rho(t), where rho is the
+  /// normalized autocorrelation function. The sum is truncated with the automatic window of Sokal (t <= 5 tau_int).
+  /// Returns 1/2 (uncorrelated series) if x has less than 2 elements or no variance.
+  double integrated_autocorrelation_time(std::vector<double> const &x);
+
+} // namespace triqs_ctseg::measures
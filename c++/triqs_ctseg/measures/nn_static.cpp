@@ -17,15 +17,20 @@
 
 #include "./nn_static.hpp"
 #include "../logs.hpp"
+#include "../reduction.hpp"
 
 namespace triqs_ctseg::measures {
 
   nn_static::nn_static(params_t const &p, work_data_t const &wdata, configuration_t const &config, results_t &results)
      : wdata{wdata}, config{config}, results{results} {
 
-    beta    = p.beta;
-    n_color = config.n_color();
-    nn      = nda::zeros<double>(n_color, n_color);
+    beta           = p.beta;
+    reduce_to_root = p.reduce_to_root;
+    n_color        = config.n_color();
+    nn             = nda::zeros<double>(n_color, n_color);
+    start          = nda::zeros<double>(n_color, n_color);
+    occupied.resize(n_color);
+    bins = {p.n_bins, nda::array<double, 2>{start}};
   }
 
   // -------------------------------------
@@ -36,33 +41,53 @@ namespace triqs_ctseg::measures {
 
     Z += s;
 
-    for (int a = 0; a < n_color; ++a)
-      for (int b = 0; b < n_color; ++b) {
-        for (auto const &sa : config.seglists[a]) {
-          for (auto const &sb : config.seglists[b]) //
-            nn(a, b) += s * overlap(sa, sb);
+    // Sweep over all the operators in decreasing time order, keeping track of the occupations.
+    // start(a, b) is the time at which colors a and b became both occupied (only meaningful while they are),
+    // when a becomes empty, the time spent with a and b occupied is added to nn(a, b).
+    // O(N_ops log n_color + N_ops * n_color) instead of the O(n_color^2 n_seg^2) of the sum of all segment overlaps.
+    std::fill(occupied.begin(), occupied.end(), false);
+    for (auto const &op : ordered_ops(config.seglists)) {
+      int a    = op.color;
+      double t = double(op.tau);
+      if (not op.is_cdag) { // a becomes occupied (c operator)
+        occupied[a] = true;
+        for (int b = 0; b < n_color; ++b)
+          if (occupied[b]) start(a, b) = start(b, a) = t;
+      } else { // a becomes empty (cdag operator)
+        for (int b = 0; b < n_color; ++b) {
+          if (not occupied[b]) continue;
+          nn(a, b) += s * (start(a, b) - t);
+          if (b != a) nn(b, a) += s * (start(a, b) - t);
         }
+        occupied[a] = false;
       }
+    }
+    bins.accumulate(Z, [&] { return nda::array<double, 2>{nn}; });
   }
   // -------------------------------------
 
   void nn_static::collect_results(mpi::communicator const &c) {
 
-    Z  = mpi::all_reduce(Z, c);
-    nn = mpi::all_reduce(nn, c);
+    Z = mpi::all_reduce(Z, c);
+    buffer_reduction_t{c, reduce_to_root}.add(nn);
     nn = nn / Z / beta;
 
-    std::map<std::pair<std::string, std::string>, nda::matrix<double>> nn_block;
-    for (long x1 = 0; auto &[bl1, bl1_size] : wdata.gf_struct) {
-      for (long x2 = 0; auto &[bl2, bl2_size] : wdata.gf_struct) {
-        nn_block[{bl1, bl2}] = nn(range(x1, x1 + bl1_size), range(x2, x2 + bl2_size));
-        x2 += bl2_size;
+    // Split into blocks
+    auto by_block = [&](nda::matrix<double> const &x) {
+      std::map<std::pair<std::string, std::string>, nda::matrix<double>> res;
+      for (long x1 = 0; auto &[bl1, bl1_size] : wdata.model->gf_struct) {
+        for (long x2 = 0; auto &[bl2, bl2_size] : wdata.model->gf_struct) {
+          res[{bl1, bl2}] = x(range(x1, x1 + bl1_size), range(x2, x2 + bl2_size));
+          x2 += bl2_size;
+        }
+        x1 += bl1_size;
       }
-      x1 += bl1_size;
-    }
+      return res;
+    };
 
     // store the result (not reused later, hence we can move it).
-    results.nn_static = std::move(nn_block);
+    results.nn_static = by_block(nn);
+    if (bins.enabled()) results.nn_static_error = by_block(nda::matrix<double>{bins.error(c) / beta});
   }
 
 } // namespace triqs_ctseg::measures
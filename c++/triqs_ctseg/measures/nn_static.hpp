@@ -19,6 +19,7 @@
 #include "../configuration.hpp"
 #include "../work_data.hpp"
 #include "../results.hpp"
+#include "./binning.hpp"
 
 namespace triqs_ctseg::measures {
 
@@ -28,12 +29,20 @@ namespace triqs_ctseg::measures {
     configuration_t const &config;
     results_t &results;
     double beta;
+    bool reduce_to_root;
 
     nda::matrix<double> nn;
 
+    // Scratch for the sweep in accumulate (kept to avoid reallocation)
+    nda::matrix<double> start;
+    std::vector<bool> occupied;
+    colored_ops_merger_t ordered_ops;
+
     double Z = 0;
     int n_color;
 
+    binning_t<nda::array<double, 2>> bins; // Error bars (n_bins)
+
     nn_static(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results);
 
     void accumulate(double s);
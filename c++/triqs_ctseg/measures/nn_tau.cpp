@@ -17,39 +17,87 @@
 
 #include "./nn_tau.hpp"
 #include "../logs.hpp"
+#include "../reduction.hpp"
+#include <itertools/itertools.hpp>
+#include <algorithm>
 
 namespace triqs_ctseg::measures {
 
   nn_tau::nn_tau(params_t const &p, work_data_t const &wdata, configuration_t const &config, results_t &results)
      : wdata{wdata}, config{config}, results{results} {
 
-    beta           = p.beta;
-    ntau           = p.n_tau_chi2;
-    dtau           = p.beta / (ntau - 1);
-    n_color        = config.n_color();
-    block_number   = wdata.block_number;
-    index_in_block = wdata.index_in_block;
-
-    q_tau       = gf<imtime>({beta, Boson, ntau}, {n_color, n_color});
-    q_tau()     = 0;
-    q_tau_block = make_block2_gf<imtime>({beta, Boson, ntau}, p.gf_struct);
+    beta                = p.beta;
+    ntau                = p.n_tau_chi2;
+    dtau                = p.beta / (ntau - 1);
+    n_color             = config.n_color();
+    block_number        = wdata.model->block_number;
+    index_in_block      = wdata.model->index_in_block;
+    translation_average = p.nn_tau_translation_average;
+    reduce_to_root      = p.reduce_to_root;
+    gf_struct           = p.gf_struct;
+
+    // The color pairs to measure: all of them, or those of the block pairs of nn_tau_pairs and of their transposes,
+    // each unordered pair {a, b} being measured once
+    auto wanted = nda::array<int, 2>(n_color, n_color);
+    wanted()    = p.nn_tau_pairs.empty() ? 1 : 0;
+    for (auto const &[A, B] : p.nn_tau_pairs) {
+      auto block_index = [&](std::string const &name) {
+        auto it = std::find_if(gf_struct.begin(), gf_struct.end(), [&](auto const &x) { return x.first == name; });
+        ALWAYS_EXPECTS((it != gf_struct.end()), "Error : unknown block {} in nn_tau_pairs", name);
+        return long(it - gf_struct.begin());
+      };
+      long bl_A = block_index(A), bl_B = block_index(B);
+      for (int a = 0; a < n_color; ++a)
+        for (int b = 0; b < n_color; ++b)
+          if (block_number[a] == bl_A and block_number[b] == bl_B) wanted(a, b) = wanted(b, a) = 1;
+    }
+    for (int a = 0; a < n_color; ++a)
+      for (int b = 0; b < n_color; ++b) {
+        if (not wanted(a, b)) continue;
+        if (p.nn_tau_pairs.empty())
+          pairs.push_back({a, b, false});
+        else if (a <= b)
+          pairs.push_back({a, b, a != b});
+      }
+    pairs_of_b.resize(n_color);
+    for (auto const &[k, pr] : itertools::enumerate(pairs)) pairs_of_b[pr.b].emplace_back(pr.a, k);
+    long n_pairs = pairs.size();
+
+    diff = nda::zeros<double>(n_pairs, ntau + 1);
+    if (translation_average) diff_tau = nda::zeros<double>(n_pairs, ntau + 1);
+    diff_buf = {diff, p.float_histograms};
+    if (translation_average) diff_tau_buf = {diff_tau, p.float_histograms};
+    pieces.resize(n_color);
+    bins = {p.n_bins, nda::zeros<double>(ntau, n_pairs)};
   }
 
   // -------------------------------------
 
-  // FIXME mv to nda
-  inline static range::all_t nda_all = range::all_t{};
-
   void nn_tau::accumulate(double s) {
 
     LOG("\n =================== MEASURE nn(tau) ================ \n");
 
     Z += s;
 
+    auto end_measure = [&] {
+      diff_buf.end_measure(diff);
+      diff_tau_buf.end_measure(diff_tau);
+      bins.accumulate(Z, [&] {
+        flush_buffers();
+        return sum_differences();
+      });
+    };
+
+    if (translation_average) {
+      accumulate_translation_average(s);
+      end_measure();
+      return;
+    }
+
     // <n_a(tau) n_b(0) >
     for (int b = 0; b < n_color; ++b) {
-      if (n_at_boundary(config.seglists[b]) == 0) continue; // nb = 0, nothing to accumulate
-      for (int a = 0; a < n_color; ++a)
+      if (pairs_of_b[b].empty() or n_at_boundary(config.seglists[b]) == 0) continue; // nb = 0, nothing to accumulate
+      for (auto const &[a, k] : pairs_of_b[b])
         for (auto const &seg : config.seglists[a]) {
 
           // find closest mesh point to the right of c
@@ -57,11 +105,16 @@ namespace triqs_ctseg::measures {
           // find closest mesh point to the left of cdag
           int u_idx_cdag = int(std::ceil(seg.tau_cdag / dtau));
 
-          auto d = q_tau.data()(nda_all, a, b); // a view of the data for fixed a,b
-          // add + s to the data. NB : id1 > id2
-          auto fill = [s, &d](long u_idx1, long u_idx2) {
+          // add + s to the data at u_idx2 <= u <= u_idx1, with the difference array. NB : id1 > id2
+          auto fill = [&, k = k](long u_idx1, long u_idx2) {
             ALWAYS_EXPECTS((u_idx1 >= u_idx2), "error", 1);
-            for (auto u = u_idx1; u >= u_idx2; --u) d(u) += s;
+            if (diff_buf.enabled()) {
+              diff_buf(k, u_idx2) += float(s);
+              diff_buf(k, u_idx1 + 1) -= float(s);
+            } else {
+              diff(k, u_idx2) += s;
+              diff(k, u_idx1 + 1) -= s;
+            }
           };
 
           // Execute with 2 cases : cyclic segment or not
@@ -74,6 +127,83 @@ namespace triqs_ctseg::measures {
           }
         }
     }
+    end_measure();
+  }
+
+  // -------------------------------------
+
+  // Translation-averaged estimator (1/beta) int_0^beta dtau' n_a(tau + tau') n_b(tau'), at the mesh points.
+  //
+  // For two intervals A = [a1, a2] and B = [b1, b2] of [0, beta], g(tau) = |B inter (A - tau)| is piecewise linear:
+  // g(tau) = r(tau - a1 + b2) - r(tau - a1 + b1) - r(tau - a2 + b2) + r(tau - a2 + b1), with r(x) = max(x, 0),
+  // and the beta-periodic correlation is g(tau) + g(tau - beta) for tau in [0, beta].
+  // A ramp w r(tau - p) at the mesh points tau_u >= p is tau_u w - w p : w and w p are accumulated in
+  // difference arrays (diff and diff_tau) at the first mesh point after p, and summed in collect_results.
+  // O(n_seg^2) per measurement, independent of the number of mesh points.
+  void nn_tau::accumulate_translation_average(double s) {
+
+    // Occupied intervals [tau_cdag, tau_c] of each color, cyclic segments being split at beta/0
+    for (int c = 0; c < n_color; ++c) {
+      pieces[c].clear();
+      for (auto const &seg : config.seglists[c]) {
+        if (is_cyclic(seg)) {
+          pieces[c].emplace_back(double(seg.tau_cdag), beta);
+          pieces[c].emplace_back(0.0, double(seg.tau_c));
+        } else
+          pieces[c].emplace_back(double(seg.tau_cdag), double(seg.tau_c));
+      }
+    }
+
+    for (auto const &[k, pr] : itertools::enumerate(pairs)) {
+      auto add_ramp = [&, k = k](double p, double w) {
+        for (double q : {p, p + beta}) {
+          long u = (q <= 0) ? 0 : long(std::ceil(q / dtau));
+          if (u >= ntau) continue;
+          if (diff_buf.enabled()) {
+            diff_buf(k, u) += float(s * w);
+            diff_tau_buf(k, u) += float(s * w * q);
+          } else {
+            diff(k, u) += s * w;
+            diff_tau(k, u) += s * w * q;
+          }
+        }
+      };
+      for (auto const &[a1, a2] : pieces[pr.a])
+        for (auto const &[b1, b2] : pieces[pr.b]) {
+          add_ramp(a1 - b2, 1);
+          add_ramp(a1 - b1, -1);
+          add_ramp(a2 - b2, -1);
+          add_ramp(a2 - b1, 1);
+        }
+    }
+  }
+
+  // -------------------------------------
+
+  // Add the single precision buffers to the difference arrays (float_histograms)
+  void nn_tau::flush_buffers() {
+    diff_buf.flush(diff);
+    diff_tau_buf.flush(diff_tau);
+  }
+
+  // -------------------------------------
+
+  // Sum the difference arrays, in the layout [tau, measured pair]
+  nda::array<double, 2> nn_tau::sum_differences() const {
+    long n_pairs = pairs.size();
+    auto res     = nda::array<double, 2>(ntau, n_pairs);
+    for (long k = 0; k < n_pairs; ++k) {
+      double w = 0, w_tau = 0;
+      for (int u = 0; u < ntau; ++u) {
+        w += diff(k, u);
+        if (translation_average) {
+          w_tau += diff_tau(k, u);
+          res(u, k) = (u * dtau * w - w_tau) / beta;
+        } else
+          res(u, k) = w;
+      }
+    }
+    return res;
   }
 
   // -------------------------------------
@@ -82,17 +212,41 @@ namespace triqs_ctseg::measures {
 
     Z = mpi::all_reduce(Z, c);
 
-    q_tau = mpi::all_reduce(q_tau, c);
-    q_tau = q_tau / Z; //(beta * Z * q_tau.mesh().delta());
+    // Error bars, from the bins of this rank
+    auto error = bins.enabled() ? bins.error(c) : nda::array<double, 2>{};
 
-    // store the result
-    for (int c1 : range(n_color)) {
-      for (int c2 : range(n_color)) {
-        q_tau_block(block_number[c1], block_number[c2]).data()(range::all, index_in_block[c1], index_in_block[c2]) =
-           q_tau.data()(range::all, c1, c2);
-      }
+    // Reduce the difference arrays together, in place, by chunks (see buffer_reduction_t)
+    flush_buffers();
+    {
+      auto reduction = buffer_reduction_t{c, reduce_to_root};
+      reduction.add(diff);
+      if (translation_average) reduction.add(diff_tau);
     }
-    results.nn_tau = std::move(q_tau_block);
+    auto q_tau = sum_differences();
+    q_tau /= Z;
+
+    // Distribute the colors into the blocks of the result, in place: no intermediate block2_gf, and the blocks are
+    // only allocated by the first call (there is one call per partial result with partial_results_file)
+    // The blocks of the pairs which are not measured (nn_tau_pairs) are 0.
+    auto to_blocks = [&](nda::array<double, 2> const &x, std::optional<block2_gf<imtime>> &res) {
+      if (not res) {
+        res = make_block2_gf<imtime>({beta, Boson, ntau}, gf_struct);
+        for (auto bl1 : range(res->size1()))
+          for (auto bl2 : range(res->size2())) (*res)(bl1, bl2).data() = 0;
+      }
+      for (auto const &[k, pr] : itertools::enumerate(pairs)) {
+        auto [a, b, mirror] = pr;
+        (*res)(block_number[a], block_number[b]).data()(range::all, index_in_block[a], index_in_block[b]) =
+           x(range::all, k);
+        if (not mirror) continue;
+        auto &chi_ba = (*res)(block_number[b], block_number[a]).data();
+        for (long u = 0; u < ntau; ++u) chi_ba(u, index_in_block[b], index_in_block[a]) = x(ntau - 1 - u, k);
+      }
+    };
+
+    // store the result
+    to_blocks(q_tau, results.nn_tau);
+    if (bins.enabled()) to_blocks(error, results.nn_tau_error);
   }
 
 } // namespace triqs_ctseg::measures
@@ -19,6 +19,8 @@
 #include "../configuration.hpp"
 #include "../work_data.hpp"
 #include "../results.hpp"
+#include "./binning.hpp"
+#include "./float_buffer.hpp"
 
 namespace triqs_ctseg::measures {
 
@@ -32,15 +34,39 @@ namespace triqs_ctseg::measures {
     int ntau;
     std::vector<long> block_number, index_in_block;
 
-    gf<imtime> q_tau;
-    block2_gf<imtime> q_tau_block;
+    bool translation_average, reduce_to_root;
+
+    gf_struct_t gf_struct;
+
+    // A measured color pair (a, b). If mirror, (b, a) is given by chi_ba(tau) = chi_ab(beta - tau) (nn_tau_pairs)
+    struct color_pair_t {
+      int a, b;
+      bool mirror;
+    };
+    std::vector<color_pair_t> pairs;
+
+    // For each color b, the (a, index in pairs) of the measured pairs (a, b)
+    std::vector<std::vector<std::pair<int, long>>> pairs_of_b;
+
+    // Difference arrays, for each measured color pair, summed over the mesh points in collect_results
+    nda::array<double, 2> diff, diff_tau;
+    float_buffer_t<2> diff_buf, diff_tau_buf; // Single precision buffers (float_histograms)
+
+    // Occupied intervals of each color (translation average only, kept to avoid reallocation)
+    std::vector<std::vector<std::pair<double, double>>> pieces;
 
     double Z = 0;
     int n_color;
 
+    binning_t<nda::array<double, 2>> bins; // Error bars (n_bins), in the layout of sum_differences
+
+
     nn_tau(params_t const &params, work_data_t const &wdata, configuration_t const &config, results_t &results);
 
     void accumulate(double s);
+    void accumulate_translation_average(double s);
+    [[nodiscard]] nda::array<double, 2> sum_differences() const;
+    void flush_buffers();
     void collect_results(mpi::communicator const &c);
   };
 
@@ -28,26 +28,29 @@ namespace triqs_ctseg::measures {
 
   void pert_order::accumulate(double) {
     auto order = get_order();
-    while (order >= hist.size()) hist.resize(2 * hist.size());
-    hist[order] += 1;
+    while (order >= counts.size()) counts.resize(2 * counts.size());
+    counts[order] += 1;
     ++N;
   }
 
   // -------------------------------------
 
   void pert_order::collect_results(mpi::communicator const &c) {
-    N = mpi::all_reduce(N, c);
+    // The accumulated counts are left unchanged (partial results, see collectable)
+    auto N_tot = mpi::all_reduce(N, c);
 
     // Make sure that all mpi threads have an equally sized hist
-    auto max_size = mpi::all_reduce(hist.size(), c, MPI_MAX);
+    auto max_size = mpi::all_reduce(counts.size(), c, MPI_MAX);
+    hist          = counts;
     hist.resize(max_size, 0.0);
 
     // Reduce hist over mpi threads
     hist = mpi::all_reduce(hist, c);
 
     // Normalize and Calculate average order
+    average_order = 0;
     for (int order : range(hist.size())) {
-      hist[order] /= N;
+      hist[order] /= N_tot;
       average_order += hist[order] * order;
     }
   }
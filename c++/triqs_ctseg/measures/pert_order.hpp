@@ -37,12 +37,13 @@ namespace triqs_ctseg::measures {
     // Function to get the pert order
     std::function<int()> get_order;
 
-    // Histogram
+    // Histogram and average order (results)
     std::vector<double> &hist;
-
-    // Average order
     double &average_order;
 
+    // Accumulated histogram
+    std::vector<double> counts = std::vector<double>(4, 0.0);
+
     // Accumulation counter
     long N = 0;
   };
@@ -0,0 +1,51 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "./precision_probe.hpp"
+#include <cmath>
+#include <limits>
+
+namespace triqs_ctseg::measures {
+
+  double max_relative_error(std::vector<std::deque<precision_probe_t> const *> const &probes,
+                            mpi::communicator const &c) {
+    if (probes.empty()) return 0;
+    double res = 0;
+    for (long k = 0; k < long(probes[0]->size()); ++k) {
+      double tolerance = (*probes[0])[k].tolerance;
+      auto var         = nda::array<double, 1>{};
+      double W         = 0;
+      bool trusted     = true;
+      for (auto const *pr : probes) {
+        auto const &bins = (*pr)[k].bins;
+        double w         = mpi::all_reduce(bins.weight(), c);
+        trusted          = trusted and mpi::all_reduce(bins.size(), c) >= 16;
+        auto e           = bins.error(c);
+        if (var.size() == 0) var = nda::zeros<double>(e.size());
+        var += w * w * e * e;
+        W += w;
+      }
+      if (not trusted or W == 0) return std::numeric_limits<double>::infinity();
+      for (long i = 0; i < var.size(); ++i) {
+        double e = std::sqrt(var(i)) / std::abs(W);
+        if (e > 0) res = std::max(res, e / tolerance);
+      }
+    }
+    return res;
+  }
+
+} // namespace triqs_ctseg::measures
@@ -0,0 +1,54 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <deque>
+#include <string>
+#include <vector>
+#include "./binning.hpp"
+
+namespace triqs_ctseg::measures {
+
+  /**
+  * Binned running values of a few scalars of a measure, whose error bars are checked during the accumulation
+  * (target-precision stop, solve parameters target_*_error).
+  *
+  * The probes are owned by the chain and filled by the measure at each measurement, with the values already
+  * normalized as in the results (e.g. the densities divided by beta), so that the error bars are in the units
+  * of the results.
+  */
+  struct precision_probe_t {
+    std::string name;
+    double tolerance;
+    binning_t<nda::array<double, 1>> bins = {};
+
+    /// Start the binning of size scalars, with n_bins bins (32 if n_bins = 0)
+    void start(long n_bins, long size) { bins = {n_bins > 0 ? n_bins : 32, nda::zeros<double>(size)}; }
+  };
+
+  /**
+  * Largest ratio of the error bar to the tolerance, over the probes and their scalars.
+  *
+  * probes[k] are the probes of chain k (the same on all the chains and ranks). The error bar of a probe is the
+  * jackknife over the ranks for each chain, combined over the chains in quadrature with the weights of the chains.
+  * Returns +infinity as long as a chain has less than 16 bins over the ranks, i.e. before the error bars can be
+  * trusted. Must be called on all the ranks of c.
+  */
+  double max_relative_error(std::vector<std::deque<precision_probe_t> const *> const &probes,
+                            mpi::communicator const &c);
+
+} // namespace triqs_ctseg::measures
@@ -0,0 +1,96 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "./sample_stream.hpp"
+#include <itertools/itertools.hpp>
+
+namespace triqs_ctseg::measures {
+
+  sample_stream::sample_stream(params_t const &p, configuration_t const &config, std::string const &filename)
+     : config{config}, beta{p.beta}, block_size{p.sample_stream_block_size}, file{filename, 'w'} {
+
+    ALWAYS_EXPECTS((block_size > 0), "Error : sample_stream_block_size must be positive, got {}", block_size);
+    ALWAYS_EXPECTS((config.n_color() <= 53), "sample_stream : at most 53 colors, got {}", config.n_color());
+
+    long width = 4 + config.n_color();
+    front      = nda::zeros<double>(block_size, width);
+    back       = nda::zeros<double>(block_size, width);
+
+    auto columns = std::vector<std::string>{"sign", "Delta_order", "Jperp_order", "state"};
+    for (auto c : range(config.n_color())) columns.push_back("n_" + std::to_string(c));
+
+    group = h5::group(file).create_group("samples");
+    h5_write(group, "columns", columns);
+  }
+
+  // -------------------------------------
+
+  void sample_stream::accumulate(double s) {
+
+    long i      = n_front;
+    front(i, 0) = s;
+    front(i, 1) = config.Delta_order();
+    front(i, 2) = config.Jperp_order();
+
+    uint64_t state = 0;
+    for (auto const &[c, seglist] : itertools::enumerate(config.seglists)) {
+      double sum = 0;
+      for (auto &seg : seglist) sum += double(seg.length()); // accounts for cyclicity
+      front(i, 4 + c) = sum / beta;
+      if (n_at_boundary(seglist)) state |= uint64_t{1} << c;
+    }
+    front(i, 3) = double(state); // Exact : at most 53 colors
+
+    if (++n_front == block_size) {
+      // Wait for the previous block, then write this one in the background while filling the other buffer
+      if (writer.joinable()) writer.join();
+      std::swap(front, back);
+      write_block(block_size, true);
+      n_front = 0;
+    }
+  }
+
+  // -------------------------------------
+
+  void sample_stream::write_block(long n, bool async) {
+    auto write = [g = &group, name = std::to_string(n_blocks), v = back(range(0, n), range::all)]() {
+      auto lock = std::lock_guard{h5_mutex};
+      h5_write(*g, name, v);
+    };
+    ++n_blocks;
+    if (async)
+      writer = std::thread(std::move(write));
+    else
+      write();
+  }
+
+  // -------------------------------------
+
+  void sample_stream::collect_results(mpi::communicator const &) {
+    // The records are local to the chain : no reduction.
+    if (writer.joinable()) writer.join();
+    if (n_front > 0) {
+      std::swap(front, back);
+      write_block(n_front, false);
+      n_front = 0;
+    }
+    auto lock = std::lock_guard{h5_mutex};
+    h5_write(group, "n_blocks", n_blocks);
+    file.flush();
+  }
+
+} // namespace triqs_ctseg::measures
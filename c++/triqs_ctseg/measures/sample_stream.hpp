@@ -0,0 +1,75 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include "../configuration.hpp"
+#include "../params.hpp"
+#include <h5/h5.hpp>
+#include <mutex>
+#include <thread>
+
+namespace triqs_ctseg::measures {
+
+  /// HDF5 is not thread safe : the h5 calls of the background writers (sample_stream, partial results) are serialized
+  inline std::mutex h5_mutex;
+
+  /**
+  * Stream of one record per measurement to an h5 file (solve parameter sample_stream_file), for the analysis
+  * of the time series (autocorrelation, custom estimators).
+  *
+  * A record is [sign, Delta order, Jperp order, state, n_0 ... n_{n_color - 1}], where
+  *
+  *   - state is the index of the atomic state at tau = 0 (bit c is the occupation of color c, as in state_hist),
+  *   - n_c is the occupation of color c averaged over [0, beta] in the configuration.
+  *
+  * The records are written in the group "samples" of the file, in blocks of sample_stream_block_size records
+  * (compressed datasets "0", "1", ..., with n_blocks), with the names of the columns in "columns".
+  *
+  * The records are double buffered : a full buffer is written by a background thread while the next one is filled,
+  * so the accumulation only waits if the writer is slower than the measures. collect_results writes the
+  * incomplete buffer, and can be called several times (partial results).
+  */
+  class sample_stream {
+
+    configuration_t const &config;
+    double beta;
+    long block_size;
+
+    h5::file file;
+    h5::group group;
+
+    nda::array<double, 2> front, back; // Buffer filled by accumulate, buffer being written
+    long n_front = 0;                  // Number of records in front
+    long n_blocks = 0;                 // Number of blocks written or being written
+    std::thread writer;
+
+    // Write the n first records of back to the block n_blocks, in the background thread if async
+    void write_block(long n, bool async);
+
+    public:
+    sample_stream(params_t const &p, configuration_t const &config, std::string const &filename);
+
+    sample_stream(sample_stream &&) = default;
+    ~sample_stream() {
+      if (writer.joinable()) writer.join();
+    }
+
+    void accumulate(double s);
+    void collect_results(mpi::communicator const &c);
+  };
+
+} // namespace triqs_ctseg::measures
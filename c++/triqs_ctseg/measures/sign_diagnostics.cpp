@@ -0,0 +1,58 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+
+#include "./sign_diagnostics.hpp"
+#include <itertools/itertools.hpp>
+#include "../logs.hpp"
+
+namespace triqs_ctseg::measures {
+
+  sign_diagnostics::sign_diagnostics(params_t const &, work_data_t const &wdata, configuration_t const &config,
+                                     results_t &results)
+     : wdata{wdata}, config{config}, results{results}, negative_det(wdata.dets.size(), 0.0) {}
+
+  // -------------------------------------
+
+  void sign_diagnostics::accumulate(double s) {
+    N += 1;
+    for (auto const &[bl, D] : itertools::enumerate(wdata.dets))
+      if (D.determinant() < 0) negative_det[bl] += 1;
+    if (s > 0) return;
+    long order = config.Delta_order();
+    while (order >= long(negative_order.size())) negative_order.resize(2 * negative_order.size(), 0.0);
+    negative_order[order] += 1;
+  }
+
+  // -------------------------------------
+
+  void sign_diagnostics::collect_results(mpi::communicator const &c) {
+    // The accumulated counts are left unchanged (partial results, see collectable)
+    auto N_tot = mpi::all_reduce(N, c);
+
+    auto &fractions = results.negative_det_fraction.emplace();
+    auto n          = mpi::all_reduce(negative_det, c);
+    for (auto const &[bl, block] : itertools::enumerate(wdata.model->gf_struct)) fractions[block.first] = n[bl] / N_tot;
+
+    // All the ranks must reduce histograms of the same size
+    auto &hist = results.pert_order_Delta_negative.emplace(negative_order);
+    hist.resize(mpi::all_reduce(negative_order.size(), c, MPI_MAX), 0.0);
+    hist = mpi::all_reduce(hist, c);
+    for (auto &h : hist) h /= N_tot;
+  }
+
+} // namespace triqs_ctseg::measures
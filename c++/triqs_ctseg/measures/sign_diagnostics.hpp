@@ -0,0 +1,56 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+
+#pragma once
+#include "../configuration.hpp"
+#include "../results.hpp"
+#include "../work_data.hpp"
+
+namespace triqs_ctseg::measures {
+
+  /**
+  * Where the negative weights come from (solve parameter measure_sign_diagnostics).
+  *
+  * Measures the fraction of the configurations in which the det of each block is negative, and the
+  * histogram of the perturbation order in Delta of the configurations with a negative sign, normalized
+  * as pert_order_Delta (the fraction of negative configurations at order k is their ratio).
+  * The number of sign changes of each move is recorded by moves::instrumented.
+  */
+  struct sign_diagnostics {
+
+    work_data_t const &wdata;
+    configuration_t const &config;
+    results_t &results;
+
+    // Number of configurations with a negative det, per block
+    std::vector<double> negative_det;
+
+    // Number of configurations with a negative sign, per order in Delta
+    std::vector<double> negative_order = std::vector<double>(4, 0.0);
+
+    // Accumulation counter
+    double N = 0;
+
+    sign_diagnostics(params_t const &params, work_data_t const &wdata, configuration_t const &config,
+                     results_t &results);
+
+    void accumulate(double s);
+    void collect_results(mpi::communicator const &c);
+  };
+
+} // namespace triqs_ctseg::measures
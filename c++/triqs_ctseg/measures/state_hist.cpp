@@ -23,8 +23,10 @@ namespace triqs_ctseg::measures {
   state_hist::state_hist(params_t const &p, work_data_t const &wdata, configuration_t const &config, results_t &results)
      : wdata{wdata}, config{config}, results{results} {
 
-    beta = p.beta;
-    H    = nda::zeros<double>(ipow(2, config.n_color()));
+    beta   = p.beta;
+    sparse = config.n_color() > max_n_color_dense;
+    ALWAYS_EXPECTS((config.n_color() < 64), "state_hist : at most 63 colors, got {}", config.n_color());
+    if (not sparse) H = nda::zeros<double>(ipow(2, config.n_color()));
   }
 
   // -------------------------------------
@@ -41,33 +43,62 @@ namespace triqs_ctseg::measures {
     *
     * - the index of a state in the histogram is given by $\sum_i n_i 2^i$
     *
-    * - the length of the histogram is 2^n_colors
+    * - the length of the histogram is 2^n_colors (or the number of visited states if sparse)
     */
 
     Z += s;
 
-    double tau_prev         = beta; // time of prevous operator; start with beta
-    nda::vector<bool> state = nda::zeros<bool>(config.n_color());
-    for (auto const &op : colored_ordered_ops(config.seglists)) {
-      int state_idx = 0;
-      for (auto c : range(config.n_color()))
-        if (state(c)) state_idx += ipow(2, c); // get the index of the impurity state
-      H(state_idx) += (tau_prev - op.tau);
+    auto add = [&](uint64_t state, double dtau) {
+      if (sparse)
+        H_sparse[state] += dtau;
+      else
+        H(state) += dtau;
+    };
+
+    double tau_prev = beta; // time of prevous operator; start with beta
+    uint64_t state  = 0;    // index of the impurity state, bit c is the occupation of color c
+    for (auto const &op : ordered_ops(config.seglists)) {
+      add(state, tau_prev - double(op.tau));
       tau_prev = (double)op.tau;
-      ALWAYS_EXPECTS((state(op.color) == op.is_cdag), "Operator error at color {}", op.color);
-      state(op.color) = !op.is_cdag;
+      ALWAYS_EXPECTS((((state >> op.color) & 1) == op.is_cdag), "Operator error at color {}", op.color);
+      state ^= uint64_t{1} << op.color;
     }
 
     // get edge state contribution; tau_prev has time of last operator
-    ALWAYS_EXPECTS((state == nda::zeros<bool>(config.n_color())), "Operator error");
-    H(0) += tau_prev;
+    ALWAYS_EXPECTS((state == 0), "Operator error");
+    add(0, tau_prev);
   }
   // -------------------------------------
 
   void state_hist::collect_results(mpi::communicator const &c) {
 
     Z = mpi::all_reduce(Z, c);
-    H = mpi::all_reduce(H, c);
+
+    if (sparse) {
+      // The visited states differ between the nodes : the histograms are broadcast and merged one node at a time.
+      auto H_all = std::map<long, double>{};
+      for (int r = 0; r < c.size(); ++r) {
+        auto states = nda::vector<long>(r == c.rank() ? H_sparse.size() : 0);
+        auto values = nda::vector<double>(states.size());
+        if (r == c.rank())
+          for (long i = 0; auto const &[state, h] : H_sparse) {
+            states(i)   = long(state);
+            values(i++) = h;
+          }
+        mpi::broadcast(states, c, r);
+        mpi::broadcast(values, c, r);
+        for (long i = 0; i < states.size(); ++i) H_all[states(i)] += values(i);
+      }
+      H = nda::vector<double>(H_all.size());
+      auto states = nda::vector<long>(H_all.size());
+      for (long i = 0; auto const &[state, h] : H_all) {
+        states(i) = state;
+        H(i++)    = h;
+      }
+      results.state_hist_states = std::move(states);
+    } else
+      H = mpi::all_reduce(H, c);
+
     H = H / (Z * beta);
 
     // store the result (not reused later, hence we can move it).
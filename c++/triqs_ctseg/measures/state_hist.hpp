@@ -20,6 +20,7 @@
 #include "../work_data.hpp"
 #include "../results.hpp"
 #include "../util.hpp"
+#include <unordered_map>
 
 namespace triqs_ctseg::measures {
 
@@ -30,7 +31,15 @@ namespace triqs_ctseg::measures {
     results_t &results;
     double beta;
 
+    // Above this number of colors, the histogram is sparse (only the visited states are stored)
+    static constexpr int max_n_color_dense = 20;
+    bool sparse;
+
     nda::vector<double> H;
+    std::unordered_map<uint64_t, double> H_sparse;
+
+    // Buffer of the ordered operators (kept to avoid reallocation)
+    colored_ops_merger_t ordered_ops;
 
     double Z = 0;
 
@@ -0,0 +1,47 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <chrono>
+#include <mpi/mpi.hpp>
+
+namespace triqs_ctseg::measures {
+
+  /// Number of calls and time spent [s] in the accumulate of a measure (see timed)
+  struct measure_stats_t {
+    double n_calls = 0, time = 0;
+  };
+
+  /// A measure recording its number of calls and the time spent in accumulate (solve parameter measure_timings)
+  template <typename Measure> struct timed {
+
+    Measure measure;
+    measure_stats_t *stats;
+
+    timed(Measure measure_, measure_stats_t *stats_) : measure{std::move(measure_)}, stats{stats_} {}
+
+    void accumulate(double s) {
+      auto start = std::chrono::steady_clock::now();
+      measure.accumulate(s);
+      stats->n_calls += 1;
+      stats->time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void collect_results(mpi::communicator const &c) { measure.collect_results(c); }
+  };
+
+} // namespace triqs_ctseg::measures
@@ -0,0 +1,432 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "model.hpp"
+#include <algorithm>
+#include <numeric>
+#include <nda/basic_functions.hpp>
+#include <nda/traits.hpp>
+#include <triqs/gfs/functions/functions2.hpp>
+#include <triqs/operators/util/extractors.hpp>
+#include "logs.hpp"
+#include "spdlog/common.h"
+#include "spdlog/spdlog.h"
+
+using namespace triqs::operators::utils;
+
+namespace triqs_ctseg {
+
+  // Model constructor
+  model_t::model_t(params_t const &p, inputs_t const &inputs, mpi::communicator c) {
+
+    // Set logger level
+    spdlog::set_pattern("%v");
+    spdlog::set_level(spdlog::level::info);
+    if constexpr (print_logs) spdlog::set_level(spdlog::level::debug);
+
+    // Allocation of the tables, once per node in shared memory if requested
+    auto shm = shared_memory_t{c, p.use_shared_memory};
+    if (c.rank() == 0 and shm.enabled()) spdlog::info("Kernel tables allocated in MPI shared memory (once per node)");
+
+    // Copy data from inputs
+    double beta = p.beta;
+    gf_struct   = p.gf_struct;
+
+    // Count colors
+    n_color = 0;
+    for (auto const &[bl_name, bl_size] : gf_struct) { n_color += bl_size; }
+
+    // Compute color/block conversion tables
+    for (auto const &color : range(n_color)) {
+      block_number.push_back(find_block_number(color));
+      index_in_block.push_back(find_index_in_block(color));
+    }
+
+    // Print block/index/color correspondence
+    if (c.rank() == 0) {
+      spdlog::info("\n");
+      for (auto const &color : range(n_color)) {
+        spdlog::info("Block: {}    Index: {}    Color: {}", gf_struct[block_number[color]].first, index_in_block[color],
+                     color);
+      }
+    }
+
+    // Extract color-dependent chemical potential from operator
+    mu          = nda::zeros<double>(n_color);
+    auto h_loc0 = dict_to_matrix(extract_h_dict(p.h_loc0), p.gf_struct);
+    for (auto const &col : range(n_color)) { mu(col) = -h_loc0(col, col); }
+
+    // .............. Interactions .................
+    // Extract the U from the operator
+    auto U_full = dict_to_matrix(extract_U_dict2(p.h_int), p.gf_struct);
+    U           = nda::matrix<double>{real(U_full)};
+    // We ensure that U(a, a) is 0, which must be true
+    for (int a = 0; a < U.extent(0); ++a)
+      ALWAYS_EXPECTS((abs(U(a, a)) < 1.e-15), "Error. A diagonal element of the interaction matrix is not 0.");
+
+    // Report
+    if (c.rank() == 0) {
+      spdlog::info("\n Interaction matrix: U = {} \n", U);
+      spdlog::info("Orbital energies: mu - eps = {} \n", mu);
+    }
+
+    // Dynamical interactions: convert Block2Gf to matrix Gf of size n_colors
+    // The kernels are only needed to build the interpolation tables, and are not kept
+    auto D0t = gf<imtime>({beta, Boson, p.n_tau_bosonic}, {n_color, n_color});
+    gf<imtime> K, Kprime, Kprime_spin;
+    for (int c1 : range(n_color)) {
+      for (int c2 : range(n_color)) {
+        D0t.data()(range::all, c1, c2) =
+           inputs.D0t(block_number[c1], block_number[c2]).data()(range::all, index_in_block[c1], index_in_block[c2]);
+      }
+    }
+    // Symetrize, in place
+    auto &D0_data = D0t.data();
+    for (long t = 0; t < D0_data.extent(0); ++t)
+      for (int c1 = 0; c1 < n_color; ++c1)
+        for (int c2 = c1 + 1; c2 < n_color; ++c2)
+          D0_data(t, c1, c2) = D0_data(t, c2, c1) = 0.5 * (D0_data(t, c1, c2) + D0_data(t, c2, c1));
+
+    // Do we have D(tau) and Jperp(tau)? Yes, unless the data is 0
+    has_Dt    = max_element(abs(D0t.data())) > 1.e-13;
+    has_Jperp = max_element(abs(inputs.Jperpt.data())) > 1.e-13;
+
+    // Or is D(tau) given as bosonic modes?
+    long n_modes = long(p.D0_mode_frequencies.size());
+    if (n_modes > 0) {
+      auto const &g = p.D0_mode_couplings;
+      ALWAYS_EXPECTS((not has_Dt), "Error : the retarded interaction is given both in D0_tau and as bosonic modes");
+      ALWAYS_EXPECTS((g.extent(0) == n_modes and g.extent(1) == n_color and g.extent(2) == n_color),
+                     "Error : D0_mode_couplings must be of shape ({}, {}, {})", n_modes, n_color, n_color);
+      has_Dt = true;
+    }
+
+    // Check: the Jperp expansion needs the two spins of each orbital, each in its own block of size 1
+    if (has_Jperp) {
+      ALWAYS_EXPECTS((n_color % 2 == 0), "Error : has_jperp is true and we have an odd number of colors {}", n_color);
+      n_Jperp_orbitals = n_color / 2;
+      if (n_color > 2)
+        for (auto const &[s, l] : gf_struct)
+          ALWAYS_EXPECTS((l == 1), "Error : the Jperp expansion needs blocks of size 1, got {} of size {}", s, l);
+    }
+
+    // Dynamical interactions, given as bosonic modes
+    if (n_modes > 0) {
+      // For each mode of frequency w and coupling g, with K(0) = K(beta) = 0 and int_0^beta K'(tau) = 0
+      //   K(tau)  = g / (2 w) [1 + e^{-w beta} - e^{-w tau} - e^{-w (beta - tau)}] / (1 - e^{-w beta})
+      //   K'(tau) = g / 2 [e^{-w tau} - e^{-w (beta - tau)}] / (1 - e^{-w beta})
+      long n_cc         = long(n_color) * n_color;
+      auto K_terms      = std::vector<std::vector<kernel_table_t::exp_term_t>>(n_cc);
+      auto Kprime_terms = K_terms;
+      auto K_const      = std::vector<double>(n_cc, 0);
+      for (auto k : range(n_modes)) {
+        double w = p.D0_mode_frequencies[k];
+        ALWAYS_EXPECTS((w > 0), "Error : the frequencies of the bosonic modes must be positive, got {}", w);
+        double e = std::exp(-w * beta);
+        for (auto c1 : range(n_color))
+          for (auto c2 : range(n_color)) {
+            double g = 0.5 * (p.D0_mode_couplings(k, c1, c2) + p.D0_mode_couplings(k, c2, c1)); // Symetrize
+            long ij  = c1 * n_color + c2;
+            K_terms[ij].push_back({w, -g / (2 * w * (1 - e)), -g / (2 * w * (1 - e))});
+            Kprime_terms[ij].push_back({w, g / (2 * (1 - e)), -g / (2 * (1 - e))});
+            K_const[ij] += g * (1 + e) / (2 * w * (1 - e));
+          }
+      }
+      K_table      = kernel_table_t{n_color, n_color, beta, K_const, K_terms};
+      Kprime_table = kernel_table_t{n_color, n_color, beta, std::vector<double>(n_cc, 0), Kprime_terms};
+      // K'(tau) on the bosonic mesh, for the analysis of the spin part below
+      Kprime = gf<imtime>({beta, Boson, p.n_tau_bosonic}, {n_color, n_color});
+      for (auto t : Kprime.mesh())
+        for (auto c1 : range(n_color))
+          for (auto c2 : range(n_color)) Kprime[t](c1, c2) = Kprime_table(tau_t{double(t)}, c1, c2);
+      // Renormalize U and mu
+      for (auto c1 : range(n_color)) {
+        for (auto c2 : range(n_color))
+          if (c1 != c2) U(c1, c2) -= 2 * Kprime_table(tau_t::zero(), c1, c2);
+        mu(c1) += Kprime_table(tau_t::zero(), c1, c1);
+      }
+    }
+
+    // Dynamical interactions, given as D(tau)
+    else if (has_Dt) {
+      // Compute interaction kernels K(tau), K'(tau) by integrating D(tau) twice (trapezoidal rule).
+      // The integrals are prefix sums over tau, done for all the color pairs at once, directly in the data of
+      // K and Kprime: the inner loop runs over the contiguous (c1, c2) elements at fixed tau, without temporaries.
+      K           = gf<imtime>({beta, Boson, p.n_tau_bosonic}, {n_color, n_color});
+      Kprime      = K;
+      long n_tau  = p.n_tau_bosonic;
+      long n_cc   = long(n_color) * n_color;
+      double h    = beta / double(n_tau - 1);
+      auto *D     = D0_data.data();
+      auto *first = Kprime.data().data();
+      auto *secnd = K.data().data();
+      for (long k = 0; k < n_cc; ++k) first[k] = secnd[k] = 0;
+      for (long i = n_cc; i < n_tau * n_cc; ++i) {
+        first[i] = first[i - n_cc] + 0.5 * h * (D[i] + D[i - n_cc]);
+        secnd[i] = secnd[i - n_cc] + 0.5 * h * (first[i] + first[i - n_cc]);
+      }
+      // Enforce K(0) = K(beta) = 0
+      auto secnd_beta = std::vector<dcomplex>(secnd + (n_tau - 1) * n_cc, secnd + n_tau * n_cc);
+      for (long t = 0; t < n_tau; ++t)
+        for (long k = 0; k < n_cc; ++k) {
+          first[t * n_cc + k] -= secnd_beta[k] / beta;
+          secnd[t * n_cc + k] -= double(t) * h * secnd_beta[k] / beta;
+        }
+      // Renormalize U and mu
+      for (auto c1 : range(n_color)) {
+        for (auto c2 : range(n_color))
+          if (c1 != c2) U(c1, c2) -= real(2 * Kprime.data()(0, c1, c2));
+        mu(c1) += real(Kprime.data()(0, c1, c1));
+      }
+      K_table      = kernel_table_t{K, shm};
+      Kprime_table = kernel_table_t{Kprime, shm};
+    }
+
+    // Jperp interactions
+    if (has_Jperp) {
+      Jperp       = inputs.Jperpt;
+      Jperp_table = kernel_table_t{Jperp, shm};
+      if (not has_Dt)
+        rot_inv = false;
+      else {
+        Kprime_spin = gf<imtime>({beta, Boson, p.n_tau_bosonic}, {n_color, n_color}); // used in computation of F(tau)
+        // Integrate Jperp to obtain the S_z.S_z part of K'(tau) (called Kprime_spin)
+        auto Kprime_J                  = Jperp;
+        nda::array<dcomplex, 1> J_data = Jperp.data()(range::all, 0, 0);
+        auto first_integral            = nda::zeros<dcomplex>(p.n_tau_bosonic);
+        // Trapezoidal integration
+        for (int i = 1; i < J_data.size(); ++i) {
+          first_integral(i) = first_integral(i - 1) + (J_data(i) + J_data(i - 1)) / 2;
+        }
+        // Noramlize by bin size
+        first_integral *= beta / (p.n_tau_bosonic - 1);
+        // Enforce Kprime_J(beta/2) = 0
+        Kprime_J.data()(range::all, 0, 0) = first_integral - first_integral((p.n_tau_bosonic - 1) / 2);
+        // Kprime_spin = +/- Kprime_J depending on the spins, for two colors of the same orbital
+        for (auto c1 : range(n_color)) {
+          for (auto c2 : range(n_color)) {
+            int s = (Jperp_orbital(c1) != Jperp_orbital(c2)) ? 0 : (c1 == c2 ? 1 : -1);
+            Kprime_spin.data()(range::all, c1, c2) = s * Kprime_J.data()(range::all, 0, 0) / 4;
+          }
+        }
+        auto Kprime_0 = gf<imtime>({beta, Boson, p.n_tau_bosonic}, {n_color, n_color});
+        Kprime_0      = Kprime - Kprime_spin;
+        // The "remainder" Kprime_0 must be spin-independent for there to be rotational invariance
+        auto const &K0 = Kprime_0.data();
+        for (int a : range(n_Jperp_orbitals))
+          for (int b : range(n_Jperp_orbitals))
+            if (max_element(abs(K0(range::all, color_up(a), color_up(b)) - K0(range::all, color_up(a), color_dn(b))))
+                > 1.e-13)
+              rot_inv = false;
+        Kprime_spin_table = kernel_table_t{Kprime_spin, shm};
+      }
+    }
+
+    // Report
+    if (c.rank() == 0) {
+      spdlog::info("Dynamical interactions = {}, Jperp interactions = {} \n", has_Dt, has_Jperp);
+      if (p.measure_F_tau and !rot_inv)
+        spdlog::info("WARNING: Cannot measure F(tau) because spin-spin interaction is not rotationally invariant.");
+    }
+
+    // ................  Hybridization .....................
+    set_hybridization(p, inputs, shm, c);
+  } // model constructor
+
+  // -------------------------------------
+
+  model_t::model_t(model_t const &previous, params_t const &p, inputs_t const &inputs, mpi::communicator c)
+     : model_t{previous} {
+    auto shm = shared_memory_t{c, p.use_shared_memory};
+    set_hybridization(p, inputs, shm, c);
+  }
+
+  // -------------------------------------
+
+  void model_t::set_hybridization(params_t const &p, inputs_t const &inputs, shared_memory_t const &shm,
+                                  mpi::communicator c) {
+    has_Delta     = false;
+    offdiag_Delta = false;
+    Delta_table.clear();
+    proposal_length_segment.clear();
+    proposal_length_antisegment.clear();
+    set_equivalent_blocks(p, inputs);
+
+    // Is there a non-zero Delta(tau)?
+    for (auto const &bl : range(inputs.Delta.size())) {
+      if (max_element(abs(inputs.Delta[bl].data())) > 1.e-13) has_Delta = true;
+      // Report if Delta(tau) has imaginary part.
+      if (!is_gf_real(inputs.Delta[bl], 1e-10)) {
+        if (c.rank() == 0) {
+          spdlog::info("WARNING: The Delta(tau) block number {} is not real in tau space", bl);
+          spdlog::info("WARNING: max(Im[Delta(tau)]) = {}", max_element(abs(imag(inputs.Delta[bl].data()))));
+          spdlog::info("WARNING: Disregarding the imaginary component in the calculation.");
+        }
+      }
+    }
+    if (not has_Delta) {
+      ALWAYS_EXPECTS(has_Jperp, "Error : both Jperp(tau) and Delta(tau) are 0: there is nothing to expand.");
+      if (c.rank() == 0) { spdlog::info("Delta(tau) is 0, running only spin moves."); }
+    }
+
+    // Does gf_struct allow for off-diagonal Delta?
+    for (auto const &[s, l] : gf_struct) {
+      if (l > 1) offdiag_Delta = true;
+    }
+
+    // Interpolation tables of Delta(tau), one per block (the real part is taken), or its closed form from the poles.
+    // Equivalent blocks share the storage of the table of their representative (which comes first)
+    for (auto const &bl : range(inputs.Delta.size())) {
+      if (representative_block[bl] != bl)
+        Delta_table.push_back(Delta_table[representative_block[bl]]);
+      else if (p.Delta_pole_energies.empty())
+        Delta_table.emplace_back(inputs.Delta[bl], shm);
+      else
+        Delta_table.push_back(Delta_pole_table(p, bl));
+    }
+
+    // Decay lengths of the proposed segments (importance_sampled_lengths).
+    // For Delta(tau) ~ exp(-e tau) + exp(-e (beta - tau)), the length int |Delta| / (|Delta(0)| + |Delta(beta)|)
+    // is 1/e.
+    // A negative (positive) mu further suppresses long segments (antisegments).
+    if (p.importance_sampled_lengths and has_Delta) {
+      double beta = p.beta;
+      long n_tau  = 200;
+      for (auto color : range(n_color)) {
+        auto idx      = index_in_block[color];
+        auto const &D = Delta_table[block_number[color]];
+        auto f        = [&](tau_t const &tau) { return D(tau, idx, idx); };
+        double ends   = std::abs(f(tau_t::epsilon())) + std::abs(f(tau_t::beta() - tau_t::epsilon()));
+        double weight = 0;
+        for (auto k : range(n_tau)) weight += std::abs(f(tau_t{(k + 0.5) * beta / n_tau})) * beta / n_tau;
+        double l = (ends > 0 and weight > 0) ? std::min(weight / ends, beta) : beta;
+        proposal_length_segment.push_back(1 / (1 / l + std::max(0.0, -mu(color))));
+        proposal_length_antisegment.push_back(1 / (1 / l + std::max(0.0, mu(color))));
+      }
+    }
+  }
+
+  // -------------------------------------
+
+  void model_t::set_equivalent_blocks(params_t const &p, inputs_t const &inputs) {
+    long n_blocks = long(gf_struct.size());
+    representative_block.resize(n_blocks);
+    std::iota(representative_block.begin(), representative_block.end(), 0);
+    n_equivalent_blocks.assign(n_blocks, 1);
+
+    for (auto const &cls : p.equivalent_blocks) {
+      auto blocks = std::vector<long>{};
+      for (auto const &name : cls) {
+        auto it = std::find_if(gf_struct.begin(), gf_struct.end(), [&](auto const &x) { return x.first == name; });
+        ALWAYS_EXPECTS((it != gf_struct.end()), "Error : equivalent_blocks has an unknown block {}", name);
+        long bl = std::distance(gf_struct.begin(), it);
+        ALWAYS_EXPECTS((n_equivalent_blocks[bl] == 1 and std::find(blocks.begin(), blocks.end(), bl) == blocks.end()),
+                       "Error : the block {} appears more than once in equivalent_blocks", name);
+        blocks.push_back(bl);
+      }
+      if (blocks.empty()) continue;
+      long rep = *std::min_element(blocks.begin(), blocks.end());
+      for (auto bl : blocks) {
+        ALWAYS_EXPECTS((gf_struct[bl].second == gf_struct[rep].second),
+                       "Error : the equivalent blocks {} and {} have different sizes", gf_struct[bl].first,
+                       gf_struct[rep].first);
+        ALWAYS_EXPECTS((max_element(abs(inputs.Delta[bl].data() - inputs.Delta[rep].data())) < 1.e-10),
+                       "Error : the equivalent blocks {} and {} have different Delta(tau)", gf_struct[bl].first,
+                       gf_struct[rep].first);
+        representative_block[bl] = rep;
+        n_equivalent_blocks[bl]  = long(blocks.size());
+      }
+    }
+
+    representative_color.clear();
+    for (auto color : range(n_color)) {
+      representative_color.push_back(block_to_color(representative_block[block_number[color]], index_in_block[color]));
+      ALWAYS_EXPECTS((std::abs(mu(color) - mu(representative_color.back())) < 1.e-10),
+                     "Error : the colors {} and {} of equivalent blocks have different chemical potentials", color,
+                     representative_color.back());
+    }
+  }
+
+  // -------------------------------------
+
+  // For 0 < tau < beta, a pole e with weight W gives Delta(tau) = -W exp(-e tau) / (1 + exp(-e beta)).
+  // Written with a positive exponent w = |e| in each case, so that it never overflows:
+  //   e >= 0 : -W / (1 + exp(-w beta)) exp(-w tau),   e < 0 : -W / (1 + exp(-w beta)) exp(-w (beta - tau))
+  kernel_table_t Delta_pole_table(params_t const &p, long bl) {
+    auto const &[name, size] = p.gf_struct[bl];
+    long n_poles             = long(p.Delta_pole_energies.size());
+    for (auto const &[block, W] : p.Delta_pole_weights) {
+      bool found = std::any_of(p.gf_struct.begin(), p.gf_struct.end(), [&](auto const &x) { return x.first == block; });
+      ALWAYS_EXPECTS(found, "Error : Delta_pole_weights has an unknown block {}", block);
+    }
+    auto it = p.Delta_pole_weights.find(name);
+    if (it != p.Delta_pole_weights.end()) {
+      auto const &W = it->second;
+      ALWAYS_EXPECTS((W.extent(0) == n_poles and W.extent(1) == size and W.extent(2) == size),
+                     "Error : Delta_pole_weights[{}] must be of shape ({}, {}, {})", name, n_poles, size, size);
+    }
+    auto terms = std::vector<std::vector<kernel_table_t::exp_term_t>>(size * size);
+    for (auto k : range(n_poles)) {
+      double e = p.Delta_pole_energies[k], w = std::abs(e);
+      for (auto i : range(size))
+        for (auto j : range(size)) {
+          double W = (it == p.Delta_pole_weights.end()) ? 0 : it->second(k, i, j);
+          double c = -W / (1 + std::exp(-w * p.beta));
+          if (e >= 0)
+            terms[i * size + j].push_back({w, c, 0});
+          else
+            terms[i * size + j].push_back({w, 0, c});
+        }
+    }
+    return {size, size, p.beta, std::vector<double>(size * size, 0), terms};
+  }
+
+  // -------------------------------------
+
+  int model_t::block_to_color(int block, int idx) const {
+    std::vector<long> gf_block_size_partial_sum;
+    long acc = 0;
+    for (auto const &[s, l] : gf_struct) {
+      gf_block_size_partial_sum.push_back(acc);
+      acc += l;
+    }
+    return gf_block_size_partial_sum[block] + idx;
+  }
+
+  long model_t::find_block_number(int color) const {
+    long bl            = 0;
+    long colors_so_far = 0;
+    for (auto const &[s, l] : gf_struct) {
+      colors_so_far += l;
+      if (color < colors_so_far) { return bl; }
+      bl++;
+    }
+    ALWAYS_EXPECTS((colors_so_far == n_color), "Error in color-to-block conversion.");
+    return 0;
+  }
+
+  long model_t::find_index_in_block(int color) const {
+    long colors_so_far = 0;
+    for (auto const &[s, l] : gf_struct) {
+      colors_so_far += l;
+      if (color < colors_so_far) { return color - (colors_so_far - l); }
+    }
+    ALWAYS_EXPECTS((colors_so_far == n_color), "Error in color-to-block conversion.");
+    return 0;
+  }
+
+} // namespace triqs_ctseg
@@ -0,0 +1,118 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <mpi/mpi.hpp>
+#include <triqs/gfs.hpp>
+
+#include "params.hpp"
+#include "inputs.hpp"
+#include "util.hpp"
+#include "kernels.hpp"
+#include "shared_memory.hpp"
+
+namespace triqs_ctseg {
+
+  /**
+  * The model: interactions, kernels and block structure, computed once from the inputs.
+  *
+  * It is read-only after construction, and shared (via std::shared_ptr<model_t const>) by the work data of all
+  * the Markov chains. The per-chain mutable state is in work_data_t.
+  * With use_shared_memory, the large tables are allocated once per node in MPI shared memory: the construction
+  * (and destruction) is then collective on the communicator.
+  */
+  struct model_t {
+
+    model_t(params_t const &p, inputs_t const &inputs, mpi::communicator c);
+
+    // Same model as previous, with a new hybridization function inputs.Delta (see warm_start).
+    // The interactions and kernels are shared with previous, only the Delta tables are rebuilt.
+    model_t(model_t const &previous, params_t const &p, inputs_t const &inputs, mpi::communicator c);
+
+    model_t(model_t const &) = default;
+
+    nda::matrix<double> U;  // Density-density interaction: U_ab n_a n_b
+    gf_struct_t gf_struct;  // gf_struct of the Green's function (input copied)
+    int n_color;            // Number of colors
+    nda::vector<double> mu; // Chemical potential per color
+
+    bool has_Delta     = false; // There is a non-zero hybridization term
+    bool has_Dt        = false; // There is a non-zero dynamical nn interaction
+    bool has_Jperp     = false; // There is a non-zero Jperp interaction
+    bool rot_inv       = true;  // The spin-spin interaction is rotationally invariant (matters for F(tau) measure)
+    bool offdiag_Delta = false; // Does Delta(tau) have blocks of size larger than 1?
+
+    // Spin-spin interaction kernel, and its interpolation table for the spin moves (real part of the (0, 0) element)
+    gf<imtime> Jperp;
+    kernel_table_t Jperp_table;
+
+    // Orbitals of the Jperp expansion: colors 2o and 2o + 1 are the spins up and down of orbital o, coupled by the
+    // same Jperp(tau) for all o. As the two colors are adjacent, the S operators of an orbital do not cross the
+    // operators of the other colors when the operators are ordered by color: the trace sign is the same as for a
+    // single orbital. 1 for two colors
+    int n_Jperp_orbitals = 1;
+
+    // Orbital of a color, and colors of the two spins of an orbital (Jperp expansion)
+    [[nodiscard]] static int Jperp_orbital(int color) { return color / 2; }
+    [[nodiscard]] static int color_up(int orbital) { return 2 * orbital; }
+    [[nodiscard]] static int color_dn(int orbital) { return 2 * orbital + 1; }
+
+    // Interpolation tables of the dynamical interaction kernels K, Kprime and of the S_z.S_z part Kprime_spin of
+    // Kprime, for fast evaluation in moves and measures. Possibly in shared memory. See kernels.hpp
+    kernel_table_t K_table, Kprime_table, Kprime_spin_table;
+
+    // Interpolation tables of the hybridization function, one per block of the input Delta(tau).
+    // The blocks of a class of equivalent_blocks share the table of their representative
+    std::vector<kernel_table_t> Delta_table;
+
+    // Classes of equivalent blocks (equivalent_blocks), per block: the representative of its class (its first block
+    // in gf_struct), and the number of blocks in the class. Each block is its own representative by default
+    std::vector<long> representative_block, n_equivalent_blocks;
+
+    // Color of the representative block with the same index in block, per color
+    std::vector<long> representative_color;
+
+    // Decay lengths per color of the lengths of the segments (insert_segment) and antisegments (split_segment)
+    // proposed with importance_sampled_lengths, estimated from Delta(tau) and mu. Empty : uniform proposals
+    std::vector<double> proposal_length_segment, proposal_length_antisegment;
+
+    // Color to (block, idx) conversion tables
+    std::vector<long> block_number;   // block numbers corresponding to colors
+    std::vector<long> index_in_block; // index in block of a given color
+
+    // Find color corresponding to (block, idx)
+    int block_to_color(int block, int idx) const;
+
+    // Find block of color
+    long find_block_number(int color) const;
+
+    // Find index of color in its block
+    long find_index_in_block(int color) const;
+
+    private:
+    // Set the classes of equivalent blocks from p.equivalent_blocks, checked against inputs.Delta
+    void set_equivalent_blocks(params_t const &p, inputs_t const &inputs);
+
+    // Set has_Delta, offdiag_Delta, the Delta tables and the proposal lengths from inputs.Delta
+    void set_hybridization(params_t const &p, inputs_t const &inputs, shared_memory_t const &shm,
+                           mpi::communicator c);
+  };
+
+  /// Delta(tau) of the block bl from its poles (Delta_pole_energies and Delta_pole_weights), in closed form
+  kernel_table_t Delta_pole_table(params_t const &p, long bl);
+
+} // namespace triqs_ctseg
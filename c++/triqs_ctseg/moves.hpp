@@ -27,3 +27,5 @@
 #include "./moves/split_spin_segment.hpp"
 #include "./moves/regroup_spin_segment.hpp"
 #include "./moves/swap_spin_lines.hpp"
+#include "./moves/swap_colors.hpp"
+#include "./moves/instrumented.hpp"
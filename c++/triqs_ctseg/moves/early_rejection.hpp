@@ -0,0 +1,45 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <cmath>
+#include "../rng.hpp"
+
+namespace triqs_ctseg::moves {
+
+  /**
+  * Early rejection (see the solve parameter early_rejection), used by insert_segment, split_segment, move_segment
+  * and their reverse moves remove_segment and regroup_segment.
+  *
+  * The Metropolis test on the acceptance ratio r = r_1 r_det is split in two successive tests: the move is
+  * first accepted with probability min(1, r_1), where r_1 = trace_ratio * prop_ratio is known before the det,
+  * then with min(1, |r_det|) by mc_generic. Each factor satisfies detailed balance on its own, so the chain
+  * samples the same distribution, and the proposals rejected by the first test never call the O(N) det try.
+  * The price is a slightly lower acceptance rate, min(1, r_1) min(1, |r_det|) <= min(1, |r|).
+  * A move and its reverse must both use it (r_1 -> 1 / r_1), or detailed balance is broken.
+  *
+  * Returns true if the move passes the first test.
+  */
+  inline bool passes_early_test(rng_t &rng, double r_1) { return r_1 >= 1 or rng() < r_1; }
+
+  /// Return value of attempt: the full ratio, or only the det ratio if the first test was done
+  inline double attempt_ratio(bool early_rejection, double r_1, double det_ratio, double det_sign) {
+    double prod = (early_rejection ? 1 : r_1) * det_ratio;
+    return (std::isfinite(prod) ? prod : det_sign);
+  }
+
+} // namespace triqs_ctseg::moves
@@ -16,12 +16,15 @@
 // Authors: Nikita Kavokine, Hao Lu, Olivier Parcollet, Nils Wentzell
 
 #include "insert_segment.hpp"
+#include "segment_proposal.hpp"
+#include "early_rejection.hpp"
 #include "../logs.hpp"
+#include "../tracing.hpp"
 #include <cmath>
 
 namespace triqs_ctseg::moves {
 
-  double insert_segment::attempt() {
+  template <bool HasDt, bool OffdiagDelta> double insert_segment<HasDt, OffdiagDelta>::attempt() {
 
     LOG("\n =================== ATTEMPT INSERT ================ \n");
 
@@ -52,9 +55,16 @@ namespace triqs_ctseg::moves {
     LOG("Insertion window is tau_left = {}, tau_right = {}", tau_left, tau_right);
     tau_t window_length = tau_left - tau_right;
 
-    // Choose two random times in insertion window
-    auto dt1 = tau_t::random(rng, window_length);
-    auto dt2 = tau_t::random(rng, window_length);
+    // Choose two random times in insertion window, or a random start and a length (importance_sampled_lengths)
+    auto const &l0  = wdata.model->proposal_length_segment;
+    bool importance = not l0.empty() and not sl.empty();
+    tau_t dt1, dt2;
+    if (importance)
+      std::tie(dt1, dt2) = propose_segment(rng, l0[color], window_length);
+    else {
+      dt1 = tau_t::random(rng, window_length);
+      dt2 = tau_t::random(rng, window_length);
+    }
     if (dt1 == dt2) {
       LOG("Insert_segment: generated equal times. Rejecting");
       return 0;
@@ -70,32 +80,18 @@ namespace triqs_ctseg::moves {
     LOG("Inserting segment with c at {}, cdag at {}", prop_seg.tau_c, prop_seg.tau_cdag);
 
     // ------------  Trace ratio  -------------
-    double ln_trace_ratio = wdata.mu(color) * prop_seg.length(); // chemical potential
+    double ln_trace_ratio = wdata.model->mu(color) * prop_seg.length(); // chemical potential
     // Overlaps
-    for (auto c : range(config.n_color())) {
-      if (c != color) ln_trace_ratio += -wdata.U(color, c) * overlap(config.seglists[c], prop_seg);
-      if (wdata.has_Dt)
-        ln_trace_ratio += K_overlap(config.seglists[c], prop_seg.tau_c, prop_seg.tau_cdag, wdata.K, color, c);
+    ln_trace_ratio += -U_overlap(config.seglists, prop_seg, wdata.model->U, color);
+    if constexpr (HasDt) {
+      for (auto c : range(config.n_color()))
+        ln_trace_ratio +=
+           K_overlap(config.seglists[c], prop_seg.tau_c, prop_seg.tau_cdag, wdata.model->K_table, color, c);
     }
-    if (wdata.has_Dt)
-      ln_trace_ratio += -real(wdata.K(double(prop_seg.length()))(color, color)); // Correct double counting
+    if constexpr (HasDt)
+      ln_trace_ratio += -wdata.model->K_table(prop_seg.length(), color, color); // Correct double counting
     double trace_ratio = std::exp(ln_trace_ratio);
 
-    // ------------  Det ratio  ---------------
-    //  insert tau_cdag as a line (first index) and tau_c as a column (second index).
-    auto &bl     = wdata.block_number[color];
-    auto &bl_idx = wdata.index_in_block[color];
-    auto &D      = wdata.dets[bl];
-    if (wdata.offdiag_Delta) {
-      if (cdag_in_det(prop_seg.tau_cdag, D) or c_in_det(prop_seg.tau_c, D)) {
-        LOG("One of the proposed times already exists in another line of the same block. Rejecting.");
-        return 0;
-      }
-    }
-    auto det_ratio = D.try_insert(det_lower_bound_x(D, prop_seg.tau_cdag), //
-                                  det_lower_bound_y(D, prop_seg.tau_c),    //
-                                  {prop_seg.tau_cdag, bl_idx}, {prop_seg.tau_c, bl_idx});
-
     // ------------  Proposition ratio ------------
 
     double current_number_intervals = std::max(long(1), long(sl.size()));
@@ -106,38 +102,61 @@ namespace triqs_ctseg::moves {
     double prop_ratio =
        (current_number_intervals * window_length * window_length / (sl.empty() ? 1 : 2)) / future_number_segments;
     // Account for absence of time swapping when inserting into empty line.
+    if (importance)
+      prop_ratio = current_number_intervals
+         / (proposal_density(l0[color], double(window_length), double(dt1), double(dt2 - dt1))
+            * future_number_segments);
 
-    LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
+    // ------------  Det ratio  ---------------
+    //  insert tau_cdag as a line (first index) and tau_c as a column (second index).
+    auto &bl     = wdata.model->block_number[color];
+    auto &bl_idx = wdata.model->index_in_block[color];
+    auto &D      = wdata.dets[bl];
+    if constexpr (OffdiagDelta) {
+      if (cdag_in_det(prop_seg.tau_cdag, D) or c_in_det(prop_seg.tau_c, D)) {
+        LOG("One of the proposed times already exists in another line of the same block. Rejecting.");
+        return 0;
+      }
+    }
+    if (wdata.early_rejection and not passes_early_test(rng, trace_ratio * prop_ratio)) {
+      LOG("Rejected before the det ratio.");
+      return 0;
+    }
+    auto det_ratio = CTSEG_TRACED("det try", D.try_insert(det_lower_bound_x(D, prop_seg.tau_cdag), //
+                                                          det_lower_bound_y(D, prop_seg.tau_c),    //
+                                                          {prop_seg.tau_cdag, bl_idx}, {prop_seg.tau_c, bl_idx}));
 
-    double prod = trace_ratio * det_ratio * prop_ratio;
-    det_sign    = (det_ratio > 0) ? 1.0 : -1.0;
+    LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
 
-    return (std::isfinite(prod) ? prod : det_sign);
+    det_sign = (det_ratio > 0) ? 1.0 : -1.0;
+    return attempt_ratio(wdata.early_rejection, trace_ratio * prop_ratio, det_ratio, det_sign);
   }
 
   //--------------------------------------------------
 
-  double insert_segment::accept() {
+  template <bool HasDt, bool OffdiagDelta> double insert_segment<HasDt, OffdiagDelta>::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
-    double initial_sign = trace_sign(wdata);
-    LOG("Initial sign is {}. Initial configuration: {}", initial_sign, config);
+    // Change of the trace sign, from the positions of the inserted operators in the det
+    auto bl           = wdata.model->block_number[color];
+    auto idx          = wdata.model->index_in_block[color];
+    double sign_ratio = trace_sign_ratio(wdata, bl, idx, prop_seg.tau_cdag, prop_seg.tau_c, true);
+    wdata.current_trace_sign *= sign_ratio;
+    LOG("Sign ratio is {}. Initial configuration: {}", sign_ratio, config);
 
     // Insert the times into the det
-    wdata.dets[wdata.block_number[color]].complete_operation();
+    CTSEG_TRACED("det complete", wdata.dets[bl].complete_operation());
 
     // Insert the segment in an ordered list
     auto &sl = config.seglists[color];
     sl.insert(std::upper_bound(sl.begin(), sl.end(), prop_seg), prop_seg);
+    config.update_counters(color);
+    if constexpr (HasDt) wdata.retarded_potential.update(color, config.seglists, wdata.model->K_table);
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
 
-    double final_sign = trace_sign(wdata);
-    double sign_ratio = final_sign / initial_sign;
-    LOG("Final sign is {}", final_sign);
-
     if (sign_ratio * det_sign == -1.0) wdata.minus_sign = true;
 
     LOG("Configuration is {}", config);
@@ -146,9 +165,15 @@ namespace triqs_ctseg::moves {
   }
 
   //--------------------------------------------------
-  void insert_segment::reject() {
+  template <bool HasDt, bool OffdiagDelta> void insert_segment<HasDt, OffdiagDelta>::reject() {
     LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
-    wdata.dets[wdata.block_number[color]].reject_last_try();
+    wdata.dets[wdata.model->block_number[color]].reject_last_try();
   }
 
+  // Instantiations for the features of the model, chosen in solver_core
+  template class insert_segment<false, false>;
+  template class insert_segment<false, true>;
+  template class insert_segment<true, false>;
+  template class insert_segment<true, true>;
+
 } // namespace triqs_ctseg::moves
@@ -21,19 +21,16 @@
 
 namespace triqs_ctseg::moves {
 
-  insert_spin_segment::insert_spin_segment(work_data_t &data_, configuration_t &config_,
-                                           triqs::mc_tools::random_generator &rng_)
+  template <bool HasDt>
+  insert_spin_segment<HasDt>::insert_spin_segment(work_data_t &data_, configuration_t &config_, rng_t &rng_)
      : wdata(data_), config(config_), rng(rng_) {
-    ALWAYS_EXPECTS(config.n_color() == 2, "spin add/remove move only implemented for n_color == 2, got {}",
-                   config.n_color());
+    ALWAYS_EXPECTS(config.n_color() == 2 * wdata.model->n_Jperp_orbitals,
+                   "spin add/remove move needs the two spins of each orbital, got n_color = {}", config.n_color());
   }
 
   // --------------------------------------------------
 
-  double insert_spin_segment::attempt() {
-
-    ALWAYS_EXPECTS((config.n_color() == 2),
-                   "Insert spin segment only implemented for n_color = 2, but here n_color = {}", config.n_color());
+  template <bool HasDt> double insert_spin_segment<HasDt>::attempt() {
 
     LOG("\n =================== ATTEMPT INSERT SPIN ================ \n");
 
@@ -49,7 +46,9 @@ namespace triqs_ctseg::moves {
       return 0;
     }
 
-    dest_color = (orig_color == 0) ? 1 : 0;
+    // The other spin of the same orbital (colors 2o and 2o + 1)
+    orbital    = model_t::Jperp_orbital(orig_color);
+    dest_color = orig_color ^ 1;
     auto &dsl  = config.seglists[dest_color];
 
     // Randomly choose one existing segment
@@ -84,21 +83,21 @@ namespace triqs_ctseg::moves {
 
     // ------------  Trace ratio  -------------
 
-    double ln_trace_ratio = (wdata.mu(dest_color) - wdata.mu(orig_color)) * spin_seg.length();
-    if (wdata.has_Dt) {
+    double ln_trace_ratio = (wdata.model->mu(dest_color) - wdata.model->mu(orig_color)) * spin_seg.length();
+    if constexpr (HasDt) {
       for (auto [c, slist] : itertools::enumerate(config.seglists)) {
         // "antisegment" - careful with order
-        ln_trace_ratio += K_overlap(slist, spin_seg.tau_cdag, spin_seg.tau_c, wdata.K, orig_color, c);
-        ln_trace_ratio += K_overlap(slist, spin_seg.tau_c, spin_seg.tau_cdag, wdata.K, dest_color, c);
+        ln_trace_ratio += K_overlap(slist, spin_seg.tau_cdag, spin_seg.tau_c, wdata.model->K_table, orig_color, c);
+        ln_trace_ratio += K_overlap(slist, spin_seg.tau_c, spin_seg.tau_cdag, wdata.model->K_table, dest_color, c);
       }
       // Add interactions of the inserted operators with themselves
-      auto Kl = wdata.K(double(spin_seg.length())); // matrix
-      ln_trace_ratio -= real(Kl(orig_color, orig_color));
-      ln_trace_ratio -= real(Kl(dest_color, dest_color));
-      ln_trace_ratio += 2 * real(Kl(orig_color, dest_color));
+      auto len = spin_seg.length();
+      ln_trace_ratio -= wdata.model->K_table(len, orig_color, orig_color);
+      ln_trace_ratio -= wdata.model->K_table(len, dest_color, dest_color);
+      ln_trace_ratio += 2 * wdata.model->K_table(len, orig_color, dest_color);
     }
     double trace_ratio = std::exp(ln_trace_ratio);
-    trace_ratio *= -(real(wdata.Jperp(double(spin_seg.length()))(0, 0)) / 2);
+    trace_ratio *= -wdata.model->Jperp_table(spin_seg.length(), 0, 0) / 2;
 
     // ------------  Det ratio  ---------------
 
@@ -122,7 +121,7 @@ namespace triqs_ctseg::moves {
 
   //--------------------------------------------------
 
-  double insert_spin_segment::accept() {
+  template <bool HasDt> double insert_spin_segment<HasDt>::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
@@ -145,13 +144,18 @@ namespace triqs_ctseg::moves {
 
     // Insert segment at destination
     dsl.insert(std::upper_bound(begin(dsl), end(dsl), spin_seg), spin_seg);
+    config.update_counters(orig_color);
+    config.update_counters(dest_color);
+    if constexpr (HasDt) {
+      wdata.retarded_potential.update(orig_color, config.seglists, wdata.model->K_table);
+      wdata.retarded_potential.update(dest_color, config.seglists, wdata.model->K_table);
+    }
 
     // Insert Jperp line
-    auto &jl = config.Jperp_list;
-    if (dest_color == 0)
-      jl.push_back(Jperp_line_t{spin_seg.tau_c, spin_seg.tau_cdag});
+    if (dest_color == model_t::color_up(orbital))
+      config.add_Jperp_line(Jperp_line_t{spin_seg.tau_c, spin_seg.tau_cdag, orbital});
     else
-      jl.push_back(Jperp_line_t{spin_seg.tau_cdag, spin_seg.tau_c});
+      config.add_Jperp_line(Jperp_line_t{spin_seg.tau_cdag, spin_seg.tau_c, orbital});
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
@@ -161,6 +165,12 @@ namespace triqs_ctseg::moves {
   }
 
   //--------------------------------------------------
-  void insert_spin_segment::reject() { LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n"); }
+  template <bool HasDt> void insert_spin_segment<HasDt>::reject() {
+    LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
+  }
+
+  // Instantiations for the features of the model, chosen in solver_core
+  template class insert_spin_segment<false>;
+  template class insert_spin_segment<true>;
 
 } // namespace triqs_ctseg::moves
@@ -18,17 +18,18 @@
 #pragma once
 #include "../work_data.hpp"
 #include "../configuration.hpp"
+#include "../rng.hpp"
 #include "../invariants.hpp"
 
 namespace triqs_ctseg::moves {
 
-  class insert_spin_segment {
+  template <bool HasDt> class insert_spin_segment {
     work_data_t &wdata;
     configuration_t &config;
-    triqs::mc_tools::random_generator &rng;
+    rng_t &rng;
 
     // Internal data
-    int orig_color, dest_color;
+    int orig_color, dest_color, orbital;
     segment_t prop_seg, spin_seg;
     int prop_seg_idx;
     bool splitting_full_line;
@@ -36,7 +37,7 @@ namespace triqs_ctseg::moves {
     double det_sign;
 
     public:
-    insert_spin_segment(work_data_t &data_, configuration_t &config_, triqs::mc_tools::random_generator &rng_);
+    insert_spin_segment(work_data_t &data_, configuration_t &config_, rng_t &rng_);
     double attempt();
     double accept();
     void reject();
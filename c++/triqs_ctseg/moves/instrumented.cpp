@@ -0,0 +1,42 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "./instrumented.hpp"
+#include <algorithm>
+
+namespace triqs_ctseg::moves {
+
+  void tune_attempt_probabilities(std::vector<std::vector<move_stats_t *>> const &groups, double p_min) {
+    // Accepted proposals per second of each group. A group never attempted keeps its probability.
+    auto efficiency = [](std::vector<move_stats_t *> const &g) {
+      double n_accepted = 0, time = 0;
+      for (auto *s : g) {
+        n_accepted += s->n_accepted;
+        time += s->time;
+      }
+      return time > 0 ? n_accepted / time : -1;
+    };
+    double e_max = 0;
+    for (auto const &g : groups) e_max = std::max(e_max, efficiency(g));
+    for (auto const &g : groups) {
+      double e = efficiency(g);
+      if (e >= 0 and e_max > 0)
+        for (auto *s : g) s->attempt_probability = std::clamp(e / e_max, p_min, 1.0);
+    }
+  }
+
+} // namespace triqs_ctseg::moves
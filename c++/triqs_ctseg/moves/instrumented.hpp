@@ -0,0 +1,135 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <vector>
+#include <chrono>
+#include <string>
+#include <triqs/mc_tools/random_generator.hpp>
+#include "../tracing.hpp"
+
+namespace triqs_ctseg::moves {
+
+  /// Statistics of a move, and the resulting probability to attempt it (see instrumented)
+  struct move_stats_t {
+    double n_attempted = 0, n_zero_ratio = 0, n_accepted = 0;
+    double n_sign_changes      = 0; // Accepted proposals with a negative sign ratio
+    double time                = 0; // Time spent in the move [s]
+    double attempt_probability = 1;
+    bool recording             = true; // Record the statistics
+  };
+
+  /**
+  * A move with statistics and an attempt probability.
+  *
+  * While stats->recording, the wrapper records the number of attempts, of attempts returning a zero ratio
+  * (i.e. rejected at once by the move), of accepted proposals and of those changing the sign of the configuration,
+  * and the time spent in the move (solve parameters measure_timings, adaptive_move_weights and
+  * measure_sign_diagnostics).
+  *
+  * The move is only attempted with probability stats->attempt_probability. Otherwise the proposal is rejected
+  * at once, without calling the move. The proposal weights of the moves are fixed when they are added to the
+  * mc_generic: the effective weight of the move is its weight times attempt_probability, which is tuned at the end
+  * of the warmup with adaptive_move_weights (see tune_attempt_probabilities), then kept fixed.
+  * The proposal ratio of a move (e.g. insert) assumes that its inverse (remove) is proposed with the same weight:
+  * detailed balance only holds if a move and its inverse have the same weight and the same attempt_probability.
+  */
+  template <typename Move> struct instrumented {
+
+    Move move;
+    move_stats_t *stats;
+    triqs::mc_tools::random_generator *rng;
+    bool skipped = false;
+    std::chrono::steady_clock::time_point start;
+
+    instrumented(Move move_, move_stats_t *stats_, triqs::mc_tools::random_generator *rng_)
+       : move{std::move(move_)}, stats{stats_}, rng{rng_} {}
+
+    double attempt() {
+      skipped = (stats->attempt_probability < 1 and (*rng)() >= stats->attempt_probability);
+      if (skipped) return 0;
+      if (not stats->recording) return move.attempt();
+      start    = std::chrono::steady_clock::now();
+      double r = move.attempt();
+      stats->n_attempted += 1;
+      if (r == 0) stats->n_zero_ratio += 1;
+      record_time();
+      return r;
+    }
+
+    double accept() {
+      if (not stats->recording) return move.accept();
+      start    = std::chrono::steady_clock::now();
+      double r = move.accept();
+      stats->n_accepted += 1;
+      if (r < 0) stats->n_sign_changes += 1;
+      record_time();
+      return r;
+    }
+
+    void reject() {
+      if (skipped) return;
+      if (not stats->recording) return move.reject();
+      start = std::chrono::steady_clock::now();
+      move.reject();
+      record_time();
+    }
+
+    private:
+    void record_time() {
+      stats->time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  };
+
+#ifdef CTSEG_TRACE
+  /// A move traced as the region name, with the subregions attempt, accept and reject (see tracing.hpp)
+  template <typename Move> struct traced {
+
+    Move move;
+    int id, id_attempt, id_accept, id_reject;
+
+    traced(Move move_, std::string const &name)
+       : move{std::move(move_)},
+         id{trace::register_region(name)},
+         id_attempt{trace::register_region("attempt")},
+         id_accept{trace::register_region("accept")},
+         id_reject{trace::register_region("reject")} {}
+
+    double attempt() {
+      trace::scope_t s{id}, s_attempt{id_attempt};
+      return move.attempt();
+    }
+
+    double accept() {
+      trace::scope_t s{id}, s_accept{id_accept};
+      return move.accept();
+    }
+
+    void reject() {
+      trace::scope_t s{id}, s_reject{id_reject};
+      move.reject();
+    }
+  };
+#endif
+
+  /// Set the attempt probabilities of the groups of moves proportional to their number of accepted proposals per
+  /// second, relative to the most efficient group, and at least p_min (so that all moves are kept, for ergodicity).
+  /// The moves of a group (a move and its inverse) get the same probability, from their total accepted proposals
+  /// and time, so that detailed balance holds.
+  void tune_attempt_probabilities(std::vector<std::vector<move_stats_t *>> const &groups, double p_min);
+
+} // namespace triqs_ctseg::moves
@@ -16,11 +16,13 @@
 // Authors: Nikita Kavokine, Hao Lu, Olivier Parcollet, Nils Wentzell
 
 #include "move_segment.hpp"
+#include "early_rejection.hpp"
 #include "../logs.hpp"
+#include "../tracing.hpp"
 
 namespace triqs_ctseg::moves {
 
-  double move_segment::attempt() {
+  template <bool HasDt, bool OffdiagDelta> double move_segment<HasDt, OffdiagDelta>::attempt() {
 
     LOG("\n =================== ATTEMPT MOVE ================ \n");
 
@@ -34,84 +36,100 @@ namespace triqs_ctseg::moves {
     if (dest_color >= origin_color) ++dest_color; // little trick to select another color
     LOG("Moving to color {}", dest_color);
 
-    // Reject if colors within the same block because no appropriate det_manip function (FIXME)
-    auto const &origin_bl      = wdata.block_number[origin_color];
-    auto const &destination_bl = wdata.block_number[dest_color];
-    auto const &idx_dest       = wdata.index_in_block[dest_color];
-    if (origin_bl == destination_bl) {
-      LOG("Reject: colors are within the same block.");
-      return 0;
-    }
+    // If the colors are in the same block, the move only changes the index of a row and a column of its det
+    auto const &origin_bl      = wdata.model->block_number[origin_color];
+    auto const &destination_bl = wdata.model->block_number[dest_color];
+    auto const &idx_dest       = wdata.model->index_in_block[dest_color];
+    same_block                 = (origin_bl == destination_bl);
 
     // Do we want to move an antisegment ?
     flipped = (rng(2) == 0);
 
-    if (flipped) {
-      // if we want to move an antisegment, we simply flip the configuration
-      sl  = flip(config.seglists[origin_color]);
-      dsl = flip(config.seglists[dest_color]);
-      LOG("Moving antisegment.");
-    } else {
-      sl  = config.seglists[origin_color];
-      dsl = config.seglists[dest_color];
-    }
-
-    // If color has no segments, nothing to move
-    if (sl.empty()) {
-      LOG("Nothing to move!");
-      return 0;
-    }
+    // Choose the segment to move in sl, and its position in dsl. Returns false if the move is impossible.
+    // sl, dsl are the seglists, or views of their antisegments : the antisegments are not built, this is O(log n).
+    long origin_size = 0, dest_size = 0;
+    auto choose_segment = [&](auto const &sl, auto const &dsl) {
+      origin_size = sl.size();
+      dest_size   = dsl.size();
+
+      // If color has no segments, nothing to move
+      if (sl.empty()) {
+        LOG("Nothing to move!");
+        return false;
+      }
 
-    // Select segment to move
-    origin_index   = rng(sl.size());
-    origin_segment = sl[origin_index];
-    LOG("Moving segment at position {}", origin_index);
+      // Select segment to move
+      origin_index   = rng(sl.size());
+      origin_segment = sl[origin_index];
+      LOG("Moving segment at position {}", origin_index);
 
-    // Reject if the segment has spin lines attached
-    if (origin_segment.J_c or origin_segment.J_cdag) {
-      LOG("Segment has spin line attached: cannot move.");
-      return 0;
-    }
+      // Reject if the segment has spin lines attached
+      if (origin_segment.J_c or origin_segment.J_cdag) {
+        LOG("Segment has spin line attached: cannot move.");
+        return false;
+      }
 
-    // Reject if chosen segment overlaps with destination color
-    if (not is_insertable_into(origin_segment, dsl)) {
-      LOG("Space is occupied in destination color.");
-      return 0;
-    }
+      // Reject if chosen segment overlaps with destination color
+      if (not is_insertable_into(origin_segment, dsl)) {
+        LOG("Space is occupied in destination color.");
+        return false;
+      }
 
-    // Find where origin segment should be inserted in destination color
-    dest_index = std::upper_bound(dsl.begin(), dsl.end(), origin_segment) - dsl.cbegin();
-    LOG("Moving to position {}", dest_index);
+      // Find where origin segment should be inserted in destination color
+      // (no segment of dsl starts at origin_segment.tau_c, so lower_bound is also the upper_bound)
+      if constexpr (std::is_same_v<std::decay_t<decltype(dsl)>, flipped_seglist_t>)
+        dest_index = lower_bound(dsl, origin_segment.tau_c);
+      else
+        dest_index = std::upper_bound(dsl.begin(), dsl.end(), origin_segment) - dsl.cbegin();
+      LOG("Moving to position {}", dest_index);
+      return true;
+    };
+
+    auto const &origin_sl = config.seglists[origin_color];
+    auto const &dest_sl   = config.seglists[dest_color];
+    if (flipped) { LOG("Moving antisegment."); }
+    bool possible = flipped ? choose_segment(flipped_seglist_t{origin_sl}, flipped_seglist_t{dest_sl}) :
+                              choose_segment(origin_sl, dest_sl);
+    if (not possible) return 0;
 
     // ------------  Trace ratio  -------------
 
-    double ln_trace_ratio =
-       (flipped ? -1 : 1) * (wdata.mu(dest_color) - wdata.mu(origin_color)) * double(origin_segment.length());
-
-    for (auto const &[c, slist] : itertools::enumerate(config.seglists)) {
-      if (c != dest_color && c != origin_color) {
-        ln_trace_ratio += -wdata.U(dest_color, c) * overlap(slist, origin_segment) * (flipped ? -1 : 1);
-        ln_trace_ratio -= -wdata.U(origin_color, c) * overlap(slist, origin_segment) * (flipped ? -1 : 1);
+    double ln_trace_ratio = (flipped ? -1 : 1) * (wdata.model->mu(dest_color) - wdata.model->mu(origin_color))
+       * double(origin_segment.length());
+
+    overlaps(config.seglists, origin_segment, overlap_with_colors);
+    dispatch_n_color(config.n_color(), [&]<long N>(std::integral_constant<long, N>) {
+      long n_col = (N > 0 ? N : config.n_color());
+      for (long c = 0; c < n_col; ++c) {
+        if (c != dest_color && c != origin_color) {
+          double dU = wdata.model->U(dest_color, c) - wdata.model->U(origin_color, c);
+          ln_trace_ratio += -dU * overlap_with_colors[c] * (flipped ? -1 : 1);
+        }
       }
-    }
+    });
 
-    if (wdata.has_Dt) {
+    if constexpr (HasDt) {
       auto tau_c    = origin_segment.tau_c;
       auto tau_cdag = origin_segment.tau_cdag;
       if (flipped) std::swap(tau_c, tau_cdag);
 
       for (auto const &[c, slist] : itertools::enumerate(config.seglists)) {
-        ln_trace_ratio += K_overlap(slist, tau_c, tau_cdag, wdata.K, dest_color, c);
-        ln_trace_ratio -= K_overlap(slist, tau_c, tau_cdag, wdata.K, origin_color, c);
+        ln_trace_ratio += K_overlap(slist, tau_c, tau_cdag, wdata.model->K_table, dest_color, c);
       }
+      // The operators removed from the origin color are cached (except when moving the antisegment of an empty line)
+      ln_trace_ratio -= wdata.retarded_potential.overlap(origin_color, tau_c, tau_cdag, wdata.model->K_table);
       // Correct double counting
-      auto Kl = wdata.K(double(origin_segment.length())); // matrix
-      ln_trace_ratio -= real(Kl(origin_color, origin_color));
-      ln_trace_ratio -= real(Kl(dest_color, dest_color));
-      ln_trace_ratio += 2 * real(Kl(origin_color, dest_color));
+      auto len = origin_segment.length();
+      ln_trace_ratio -= wdata.model->K_table(len, origin_color, origin_color);
+      ln_trace_ratio -= wdata.model->K_table(len, dest_color, dest_color);
+      ln_trace_ratio += 2 * wdata.model->K_table(len, origin_color, dest_color);
     }
     double trace_ratio = std::exp(ln_trace_ratio);
 
+    // ------------  Proposition ratio -----------
+
+    double prop_ratio = double(origin_size) / (dest_size + 1);
+
     // ------------  Det ratio  ---------------
     // Times are ordered in det. We insert tau_cdag as a line (first index) and tau_c as a column.
     // c and cdag are inverted if we flip
@@ -119,61 +137,87 @@ namespace triqs_ctseg::moves {
     auto seg         = (flipped ? flip(origin_segment) : origin_segment);
     auto &D_dest     = wdata.dets[destination_bl];
     auto &D_orig     = wdata.dets[origin_bl];
-    if (wdata.offdiag_Delta) {
+    if (OffdiagDelta and not same_block) {
       if (cdag_in_det(seg.tau_cdag, D_dest) or c_in_det(seg.tau_c, D_dest)) {
         LOG("Proposed times already exist in destination block.");
         return 0;
       }
     }
-    if (not is_full_line(origin_segment))
-      det_ratio = D_dest.try_insert(det_lower_bound_x(D_dest, seg.tau_cdag), det_lower_bound_y(D_dest, seg.tau_c),
-                                    {seg.tau_cdag, idx_dest}, {seg.tau_c, idx_dest})
-         * D_orig.try_remove(det_lower_bound_x(D_orig, seg.tau_cdag), det_lower_bound_y(D_orig, seg.tau_c));
-
-    // ------------  Proposition ratio -----------
-
-    double prop_ratio = double(sl.size()) / (dsl.size() + 1);
+    if (wdata.early_rejection and not passes_early_test(rng, trace_ratio * prop_ratio)) {
+      LOG("Rejected before the det ratio.");
+      return 0;
+    }
+    if (is_full_line(origin_segment)) {
+      // No hybridized operators
+    } else if (same_block)
+      // Same times in the same det : change the row of tau_cdag and the column of tau_c to the destination index
+      det_ratio = CTSEG_TRACED("det try", D_dest.try_change_col_row(det_lower_bound_x(D_dest, seg.tau_cdag),
+                                                                    det_lower_bound_y(D_dest, seg.tau_c),
+                                                                    {seg.tau_cdag, idx_dest}, {seg.tau_c, idx_dest}));
+    else
+      det_ratio = CTSEG_TRACED("det try", D_dest.try_insert(det_lower_bound_x(D_dest, seg.tau_cdag),
+                                                            det_lower_bound_y(D_dest, seg.tau_c),
+                                                            {seg.tau_cdag, idx_dest}, {seg.tau_c, idx_dest}))
+         * CTSEG_TRACED("det try", D_orig.try_remove(det_lower_bound_x(D_orig, seg.tau_cdag),
+                                                     det_lower_bound_y(D_orig, seg.tau_c)));
 
     LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
 
-    double prod = trace_ratio * det_ratio * prop_ratio;
-    det_sign    = (det_ratio > 0) ? 1.0 : -1.0;
-    return (std::isfinite(prod) ? prod : det_sign);
+    det_sign = (det_ratio > 0) ? 1.0 : -1.0;
+    return attempt_ratio(wdata.early_rejection, trace_ratio * prop_ratio, det_ratio, det_sign);
   }
 
   //--------------------------------------------------
 
-  double move_segment::accept() {
+  template <bool HasDt, bool OffdiagDelta> double move_segment<HasDt, OffdiagDelta>::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
-    double initial_sign = trace_sign(wdata);
-    LOG("Initial sign is {}. Initial configuration: {}", initial_sign, config);
+    // Change of the trace sign, from the positions of the moved operators in the dets
+    double sign_ratio = 1;
+    if (same_block and not is_full_line(origin_segment)) {
+      // Only the color ordering of the operators changes : recompute the trace sign after the change of the det
+      CTSEG_TRACED("det complete", wdata.dets[wdata.model->block_number[origin_color]].complete_operation());
+      sign_ratio = trace_sign(wdata) / wdata.current_trace_sign;
+    } else if (not is_full_line(origin_segment)) {
+      auto seg = (flipped ? flip(origin_segment) : origin_segment);
+      sign_ratio =
+         trace_sign_ratio(wdata, wdata.model->block_number[origin_color], wdata.model->index_in_block[origin_color],
+                          seg.tau_cdag, seg.tau_c, false)
+         * trace_sign_ratio(wdata, wdata.model->block_number[dest_color], wdata.model->index_in_block[dest_color],
+                            seg.tau_cdag, seg.tau_c, true);
+    }
+    wdata.current_trace_sign *= sign_ratio;
+    LOG("Sign ratio is {}. Initial configuration: {}", sign_ratio, config);
 
     // Update the dets
-    auto const &origin_bl      = wdata.block_number[origin_color];
-    auto const &destination_bl = wdata.block_number[dest_color];
-    wdata.dets[origin_bl].complete_operation();
-    wdata.dets[destination_bl].complete_operation();
-
-    // Add the segment at destination
-    dsl.insert(begin(dsl) + dest_index, origin_segment);
-
-    // Remove the segment at origin
-    sl.erase(begin(sl) + origin_index);
+    auto const &origin_bl      = wdata.model->block_number[origin_color];
+    auto const &destination_bl = wdata.model->block_number[dest_color];
+    if (not same_block) {
+      CTSEG_TRACED("det complete", wdata.dets[origin_bl].complete_operation());
+      CTSEG_TRACED("det complete", wdata.dets[destination_bl].complete_operation());
+    }
 
+    // Move the segment. For an antisegment, it is moved in the flipped seglists, which are then flipped back.
+    // sl, dsl keep their memory for the next accepts
+    auto move = [&](seglist_t &sl, seglist_t &dsl) {
+      dsl.insert(begin(dsl) + dest_index, origin_segment); // Add the segment at destination
+      sl.erase(begin(sl) + origin_index);                  // Remove the segment at origin
+    };
     if (flipped) {
-      config.seglists[origin_color] = flip(sl);
-      config.seglists[dest_color]   = flip(dsl);
-    } else {
-      config.seglists[origin_color] = std::move(sl);
-      config.seglists[dest_color]   = std::move(dsl);
+      flip(config.seglists[origin_color], sl);
+      flip(config.seglists[dest_color], dsl);
+      move(sl, dsl);
+      flip(sl, config.seglists[origin_color]);
+      flip(dsl, config.seglists[dest_color]);
+    } else
+      move(config.seglists[origin_color], config.seglists[dest_color]);
+    config.update_counters(origin_color);
+    config.update_counters(dest_color);
+    if constexpr (HasDt) {
+      wdata.retarded_potential.update(origin_color, config.seglists, wdata.model->K_table);
+      wdata.retarded_potential.update(dest_color, config.seglists, wdata.model->K_table);
     }
-    // WARNING : do not use sl, dsl AFTER !
-
-    double final_sign = trace_sign(wdata);
-    double sign_ratio = final_sign / initial_sign;
-    LOG("Final sign is {}", final_sign);
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
@@ -186,12 +230,18 @@ namespace triqs_ctseg::moves {
   }
 
   //--------------------------------------------------
-  void move_segment::reject() {
+  template <bool HasDt, bool OffdiagDelta> void move_segment<HasDt, OffdiagDelta>::reject() {
     LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
-    auto const &origin_bl      = wdata.block_number[origin_color];
-    auto const &destination_bl = wdata.block_number[dest_color];
+    auto const &origin_bl      = wdata.model->block_number[origin_color];
+    auto const &destination_bl = wdata.model->block_number[dest_color];
     wdata.dets[origin_bl].reject_last_try();
-    wdata.dets[destination_bl].reject_last_try();
+    if (destination_bl != origin_bl) wdata.dets[destination_bl].reject_last_try();
   }
 
+  // Instantiations for the features of the model, chosen in solver_core
+  template class move_segment<false, false>;
+  template class move_segment<false, true>;
+  template class move_segment<true, false>;
+  template class move_segment<true, true>;
+
 } // namespace triqs_ctseg::moves
@@ -18,25 +18,28 @@
 #pragma once
 #include "../work_data.hpp"
 #include "../configuration.hpp"
+#include "../rng.hpp"
 #include "../invariants.hpp"
 
 namespace triqs_ctseg::moves {
 
-  class move_segment {
+  template <bool HasDt, bool OffdiagDelta> class move_segment {
     work_data_t &wdata;
     configuration_t &config;
-    triqs::mc_tools::random_generator &rng;
+    rng_t &rng;
 
     // Internal data
-    bool flipped; // whether we flip an antisegment
+    bool flipped;    // whether we flip an antisegment
+    bool same_block; // whether origin and destination colors are in the same block
     int origin_color, dest_color;
     segment_t origin_segment;
     long origin_index, dest_index;
     double det_sign;
-    std::vector<segment_t> sl, dsl;
+    seglist_t sl, dsl; // Buffers for the flipped seglists, when an antisegment is accepted
+    std::vector<double> overlap_with_colors; // Overlaps of origin_segment with all colors (kept to avoid reallocation)
 
     public:
-    move_segment(work_data_t &data_, configuration_t &config_, triqs::mc_tools::random_generator &rng_)
+    move_segment(work_data_t &data_, configuration_t &config_, rng_t &rng_)
        : wdata(data_), config(config_), rng(rng_) {};
     // ------------------
     double attempt();
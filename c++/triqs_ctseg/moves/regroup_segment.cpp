@@ -16,11 +16,14 @@
 // Authors: Nikita Kavokine, Hao Lu, Olivier Parcollet, Nils Wentzell
 
 #include "regroup_segment.hpp"
+#include "segment_proposal.hpp"
+#include "early_rejection.hpp"
 #include "../logs.hpp"
+#include "../tracing.hpp"
 
 namespace triqs_ctseg::moves {
 
-  double regroup_segment::attempt() {
+  template <bool HasDt> double regroup_segment<HasDt>::attempt() {
 
     LOG("\n =================== ATTEMPT REGROUP ================ \n");
 
@@ -63,27 +66,18 @@ namespace triqs_ctseg::moves {
     // ------------  Trace ratio  -------------
 
     auto inserted_seg = segment_t{left_seg.tau_cdag, right_seg.tau_c}; // "antisegment" : careful with order of c, cdag
-    double ln_trace_ratio = wdata.mu(color) * inserted_seg.length();
-
-    for (auto c : range(config.n_color())) {
-      if (c != color) { ln_trace_ratio += -wdata.U(color, c) * overlap(config.seglists[c], inserted_seg); }
-      if (wdata.has_Dt) {
-        ln_trace_ratio -= K_overlap(config.seglists[c], right_seg.tau_c, left_seg.tau_cdag, wdata.K, color, c);
-      }
+    double ln_trace_ratio = wdata.model->mu(color) * inserted_seg.length();
+
+    ln_trace_ratio += -U_overlap(config.seglists, inserted_seg, wdata.model->U, color);
+    if constexpr (HasDt) {
+      // The removed operators are in the configuration: their retarded potential is cached
+      auto const &K = wdata.model->K_table;
+      ln_trace_ratio -= wdata.retarded_potential.overlap(color, right_seg.tau_c, left_seg.tau_cdag, K);
+      ln_trace_ratio -= K(right_seg.tau_c - left_seg.tau_cdag, color, color); // Correct double counting
     }
-    if (wdata.has_Dt)
-      ln_trace_ratio -=
-         real(wdata.K(double(right_seg.tau_c - left_seg.tau_cdag))(color, color)); // Correct double counting
 
     double trace_ratio = std::exp(ln_trace_ratio);
 
-    // ------------  Det ratio  ---------------
-    // We remove a cdag (first index) from the left segment and a c (second index) from the right segment.
-    auto bl        = wdata.block_number[color];
-    auto &D        = wdata.dets[bl];
-    auto det_ratio = D.try_remove(det_lower_bound_x(D, left_seg.tau_cdag), //
-                                  det_lower_bound_y(D, right_seg.tau_c));
-
     // ------------  Proposition ratio ------------
 
     double future_number_segments   = making_full_line ? 1 : sl.size() - 1;
@@ -95,26 +89,46 @@ namespace triqs_ctseg::moves {
     // T inverse = 1/ future_number_segments / len_of_new_seg ^2 * (2 iif !full line)
     double prop_ratio =
        current_number_intervals / (future_number_segments * new_seg_len * new_seg_len / (making_full_line ? 1 : 2));
+    // Importance-sampled reverse proposal: the antisegment starts at the end of the left segment
+    auto const &l0 = wdata.model->proposal_length_antisegment;
+    if (not l0.empty() and not making_full_line)
+      prop_ratio = current_number_intervals
+         * proposal_density(l0[color], double(new_seg_len), double(left_seg.length()),
+                            double(left_seg.tau_cdag - right_seg.tau_c))
+         / future_number_segments;
 
-    LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
+    // ------------  Det ratio  ---------------
+    // We remove a cdag (first index) from the left segment and a c (second index) from the right segment.
+    auto bl        = wdata.model->block_number[color];
+    auto &D        = wdata.dets[bl];
+    if (wdata.early_rejection and not passes_early_test(rng, trace_ratio * prop_ratio)) {
+      LOG("Rejected before the det ratio.");
+      return 0;
+    }
+    auto det_ratio = CTSEG_TRACED("det try", D.try_remove(det_lower_bound_x(D, left_seg.tau_cdag), //
+                                                          det_lower_bound_y(D, right_seg.tau_c)));
 
-    det_sign    = (det_ratio > 0) ? 1.0 : -1.0;
-    double prod = trace_ratio * det_ratio * prop_ratio;
+    LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
 
-    return (std::isfinite(prod)) ? prod : det_sign;
+    det_sign = (det_ratio > 0) ? 1.0 : -1.0;
+    return attempt_ratio(wdata.early_rejection, trace_ratio * prop_ratio, det_ratio, det_sign);
   }
 
   //--------------------------------------------------
 
-  double regroup_segment::accept() {
+  template <bool HasDt> double regroup_segment<HasDt>::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
-    double initial_sign = trace_sign(wdata);
-    LOG("Initial sign is {}. Initial configuration: {}", initial_sign, config);
+    // Change of the trace sign, from the positions of the removed operators in the det
+    auto bl           = wdata.model->block_number[color];
+    auto idx          = wdata.model->index_in_block[color];
+    double sign_ratio = trace_sign_ratio(wdata, bl, idx, left_seg.tau_cdag, right_seg.tau_c, false);
+    wdata.current_trace_sign *= sign_ratio;
+    LOG("Sign ratio is {}. Initial configuration: {}", sign_ratio, config);
 
     // Update the dets
-    wdata.dets[wdata.block_number[color]].complete_operation();
+    CTSEG_TRACED("det complete", wdata.dets[bl].complete_operation());
 
     // Regroup segments
     auto &sl = config.seglists[color];
@@ -126,10 +140,8 @@ namespace triqs_ctseg::moves {
       // Remove the right segment
       sl.erase(sl.begin() + right_seg_idx);
     }
-
-    double final_sign = trace_sign(wdata);
-    double sign_ratio = final_sign / initial_sign;
-    LOG("Final sign is {}", final_sign);
+    config.update_counters(color);
+    if constexpr (HasDt) wdata.retarded_potential.update(color, config.seglists, wdata.model->K_table);
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
@@ -141,9 +153,13 @@ namespace triqs_ctseg::moves {
   }
 
   //--------------------------------------------------
-  void regroup_segment::reject() {
+  template <bool HasDt> void regroup_segment<HasDt>::reject() {
     LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
-    wdata.dets[wdata.block_number[color]].reject_last_try();
+    wdata.dets[wdata.model->block_number[color]].reject_last_try();
   }
 
+  // Instantiations for the features of the model, chosen in solver_core
+  template class regroup_segment<false>;
+  template class regroup_segment<true>;
+
 } // namespace triqs_ctseg::moves
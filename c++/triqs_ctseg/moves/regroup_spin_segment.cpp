@@ -17,61 +17,69 @@
 
 #include "regroup_spin_segment.hpp"
 #include "../logs.hpp"
+#include "../tracing.hpp"
 #include "../configuration.hpp"
 #include <cmath>
 
 namespace triqs_ctseg::moves {
 
-  double regroup_spin_segment::attempt() {
+  template <bool HasDt> double regroup_spin_segment<HasDt>::attempt() {
 
     LOG("\n =================== ATTEMPT REGROUP SPIN ================ \n");
 
+    // Choose the orbital (no draw for a single orbital)
+    auto const &model = *wdata.model;
+    orbital           = (model.n_Jperp_orbitals == 1) ? 0 : rng(model.n_Jperp_orbitals);
+    up                = model.color_up(orbital);
+    dn                = model.color_dn(orbital);
+
     ln_trace_ratio = 0;
-    prop_ratio     = 1 / (double(config.Jperp_list.size()) + 1);
+    // T direct = 1 / n_orbitals ..., T inverse = 1 / (#Jperp + 1) (split_spin_segment)
+    prop_ratio = model.n_Jperp_orbitals / (double(config.Jperp_list.size()) + 1);
 
     // ----------- Propose move in each color ----------
     bool prop_failed;
-    std::tie(idx_c_up, idx_cdag_dn, tau_up, prop_failed) = propose(0); // spin up
+    std::tie(idx_c_up, idx_cdag_dn, tau_up, prop_failed) = propose(up); // spin up
     if (prop_failed) return 0;
-    std::tie(idx_c_dn, idx_cdag_up, tau_dn, prop_failed) = propose(1); // spin down
+    std::tie(idx_c_dn, idx_cdag_up, tau_dn, prop_failed) = propose(dn); // spin down
     if (prop_failed) return 0;
 
     // ----------- Trace ratio -----------
     // Correct for the overlap between the two modified segments
-    auto &sl_up     = config.seglists[0];
-    auto &sl_dn     = config.seglists[1];
+    auto &sl_up     = config.seglists[up];
+    auto &sl_dn     = config.seglists[dn];
     auto old_seg_up = sl_up[idx_c_up];
     auto old_seg_dn = sl_dn[idx_c_dn];
     auto new_seg_up = segment_t{tau_up, old_seg_up.tau_cdag};
     auto new_seg_dn = segment_t{tau_dn, old_seg_dn.tau_cdag};
 
-    ln_trace_ratio += -wdata.U(0, 1)
+    ln_trace_ratio += -wdata.model->U(up, dn)
        * (overlap(new_seg_up, new_seg_dn) + overlap(old_seg_up, old_seg_dn) //
           - overlap(new_seg_up, old_seg_dn) - overlap(new_seg_dn, old_seg_up));
 
     // Correct for the dynamical interaction between the two operators that have been moved
-    if (wdata.has_Dt) {
-      ln_trace_ratio -= real(wdata.K(double(tau_up - old_seg_dn.tau_c))(0, 1));
-      ln_trace_ratio -= real(wdata.K(double(tau_dn - old_seg_up.tau_c))(0, 1));
-      ln_trace_ratio += real(wdata.K(double(tau_dn - tau_up))(0, 1));
-      ln_trace_ratio += real(wdata.K(double(old_seg_up.tau_c - old_seg_dn.tau_c))(0, 1));
+    if constexpr (HasDt) {
+      ln_trace_ratio -= wdata.model->K_table(tau_up - old_seg_dn.tau_c, up, dn);
+      ln_trace_ratio -= wdata.model->K_table(tau_dn - old_seg_up.tau_c, up, dn);
+      ln_trace_ratio += wdata.model->K_table(tau_dn - tau_up, up, dn);
+      ln_trace_ratio += wdata.model->K_table(old_seg_up.tau_c - old_seg_dn.tau_c, up, dn);
     }
 
     double trace_ratio = std::exp(ln_trace_ratio);
-    trace_ratio *= -real(wdata.Jperp(double(tau_up - tau_dn))(0, 0)) / 2;
+    trace_ratio *= -wdata.model->Jperp_table(tau_up - tau_dn, 0, 0) / 2;
 
     // ----------- Det ratio -----------
     double det_ratio = 1;
 
     // Spin up
-    auto &D_up = wdata.dets[0];
-    det_ratio *= D_up.try_remove(det_lower_bound_x(D_up, sl_up[idx_cdag_up].tau_cdag),
-                                 det_lower_bound_y(D_up, sl_up[idx_c_up].tau_c));
+    auto &D_up = wdata.dets[up];
+    det_ratio *= CTSEG_TRACED("det try", D_up.try_remove(det_lower_bound_x(D_up, sl_up[idx_cdag_up].tau_cdag),
+                                                         det_lower_bound_y(D_up, sl_up[idx_c_up].tau_c)));
 
     // Spin down
-    auto &D_dn = wdata.dets[1];
-    det_ratio *= D_dn.try_remove(det_lower_bound_x(D_dn, sl_dn[idx_cdag_dn].tau_cdag),
-                                 det_lower_bound_y(D_dn, sl_dn[idx_c_dn].tau_c));
+    auto &D_dn = wdata.dets[dn];
+    det_ratio *= CTSEG_TRACED("det try", D_dn.try_remove(det_lower_bound_x(D_dn, sl_dn[idx_cdag_dn].tau_cdag),
+                                                         det_lower_bound_y(D_dn, sl_dn[idx_c_dn].tau_c)));
 
     LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
 
@@ -83,21 +91,24 @@ namespace triqs_ctseg::moves {
 
   //--------------------------------------------------
 
-  double regroup_spin_segment::accept() {
+  template <bool HasDt> double regroup_spin_segment<HasDt>::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
-    double initial_sign = trace_sign(wdata);
-    LOG("Initial sign is {}. Initial configuration: {}", initial_sign, config);
+    auto &sl_up = config.seglists[up];
+    auto &sl_dn = config.seglists[dn];
+
+    // Change of the trace sign, from the positions of the removed operators in the dets
+    double sign_ratio = trace_sign_ratio(wdata, up, 0, sl_up[idx_cdag_up].tau_cdag, sl_up[idx_c_up].tau_c, false)
+       * trace_sign_ratio(wdata, dn, 0, sl_dn[idx_cdag_dn].tau_cdag, sl_dn[idx_c_dn].tau_c, false);
+    wdata.current_trace_sign *= sign_ratio;
+    LOG("Sign ratio is {}. Initial configuration: {}", sign_ratio, config);
 
     // Update dets
-    wdata.dets[0].complete_operation();
-    wdata.dets[1].complete_operation();
+    CTSEG_TRACED("det complete", wdata.dets[up].complete_operation());
+    CTSEG_TRACED("det complete", wdata.dets[dn].complete_operation());
 
     // Update the segments
-    auto &sl_up = config.seglists[0];
-    auto &sl_dn = config.seglists[1];
-
     // Update tau_c
     sl_up[idx_c_up].tau_c = tau_up;
     sl_dn[idx_c_dn].tau_c = tau_dn;
@@ -110,14 +121,15 @@ namespace triqs_ctseg::moves {
 
     fix_ordering_first_last(sl_up);
     fix_ordering_first_last(sl_dn);
+    config.update_counters(up);
+    config.update_counters(dn);
+    if constexpr (HasDt) {
+      wdata.retarded_potential.update(up, config.seglists, wdata.model->K_table);
+      wdata.retarded_potential.update(dn, config.seglists, wdata.model->K_table);
+    }
 
     // Add spin line
-    config.Jperp_list.push_back(Jperp_line_t{tau_up, tau_dn});
-
-    // Compute sign
-    double final_sign = trace_sign(wdata);
-    double sign_ratio = final_sign / initial_sign;
-    LOG("Final sign is {}", final_sign);
+    config.add_Jperp_line(Jperp_line_t{tau_up, tau_dn, orbital});
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
@@ -130,19 +142,19 @@ namespace triqs_ctseg::moves {
 
   //--------------------------------------------------
 
-  void regroup_spin_segment::reject() {
+  template <bool HasDt> void regroup_spin_segment<HasDt>::reject() {
 
     LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
-    wdata.dets[0].reject_last_try();
-    wdata.dets[1].reject_last_try();
+    wdata.dets[up].reject_last_try();
+    wdata.dets[dn].reject_last_try();
   }
 
   //--------------------------------------------------
 
-  std::tuple<long, long, tau_t, bool> regroup_spin_segment::propose(int color) {
+  template <bool HasDt> std::tuple<long, long, tau_t, bool> regroup_spin_segment<HasDt>::propose(int color) {
 
     auto &sl        = config.seglists[color];
-    int other_color = 1 - color;
+    int other_color = (color == up) ? dn : up;
     auto &dsl       = config.seglists[other_color];
 
     // --------- Eliminate cases where move is impossible ---------
@@ -158,9 +170,9 @@ namespace triqs_ctseg::moves {
     // --------- Randomly choose a c operator -----------
 
     auto idx_c = rng(sl.size());
-    LOG("Spin {}: regrouping c at position {}.", (color == 0) ? "up" : "down", idx_c);
+    LOG("Spin {}: regrouping c at position {}.", (color == up) ? "up" : "down", idx_c);
     if (sl[idx_c].J_c) {
-      LOG("Spin {}: cannot regroup because c is connected to a spin line.", (color == 0) ? "up" : "down");
+      LOG("Spin {}: cannot regroup because c is connected to a spin line.", (color == up) ? "up" : "down");
       return {0, 0, tau_t::zero(), true};
     }
 
@@ -178,35 +190,34 @@ namespace triqs_ctseg::moves {
     }
 
     // Find the cdag in opposite spin that are within the window
-    auto cdag_list = cdag_in_window(wtau_left, wtau_right, dsl);
+    cdag_in_window(wtau_left, wtau_right, dsl, cdag_list);
     if (cdag_list.empty()) {
-      LOG("Spin {}: cannot regroup because there are no suitable cdag operators.", (color == 0) ? "up" : "down");
+      LOG("Spin {}: cannot regroup because there are no suitable cdag operators.", (color == up) ? "up" : "down");
       return {0, 0, tau_t::zero(), true};
     }
     // Choose one of them randomly
     auto idx_cdag = cdag_list[rng(cdag_list.size())];
     if (dsl[idx_cdag].J_cdag) {
-      LOG("Spin {}: cannot regroup because chosen cdag is connected to a spin line.", (color == 0) ? "up" : "down");
+      LOG("Spin {}: cannot regroup because chosen cdag is connected to a spin line.", (color == up) ? "up" : "down");
       return {0, 0, tau_t::zero(), true};
     }
     auto tau_c_new = dsl[idx_cdag].tau_cdag;
     auto new_seg   = segment_t{tau_c_new, sl[idx_c].tau_cdag};
-    LOG("Spin {}: moving c from {} to {}.", (color == 0) ? "up" : "down", tau_c, tau_c_new);
+    LOG("Spin {}: moving c from {} to {}.", (color == up) ? "up" : "down", tau_c, tau_c_new);
 
     // -------- Trace ratio ---------
-    ln_trace_ratio += wdata.mu(color) * (double(new_seg.length()) - double(sl[idx_c].length()));
-    LOG("Spin {}: ln trace ratio = {}", (color == 0) ? "up" : "down", ln_trace_ratio);
-    for (auto const &[c, slc] : itertools::enumerate(config.seglists)) {
-      if (c != color) {
-        ln_trace_ratio += -wdata.U(c, color) * overlap(slc, new_seg);
-        ln_trace_ratio -= -wdata.U(c, color) * overlap(slc, sl[idx_c]);
-      }
-      if (wdata.has_Dt) {
-        ln_trace_ratio += K_overlap(slc, tau_c_new, true, wdata.K, c, color);
-        ln_trace_ratio -= K_overlap(slc, tau_c, true, wdata.K, c, color);
+    ln_trace_ratio += wdata.model->mu(color) * (double(new_seg.length()) - double(sl[idx_c].length()));
+    LOG("Spin {}: ln trace ratio = {}", (color == up) ? "up" : "down", ln_trace_ratio);
+    // U is symmetric: U(c, color) = U(color, c)
+    ln_trace_ratio += -U_overlap(config.seglists, new_seg, wdata.model->U, color);
+    ln_trace_ratio -= -U_overlap(config.seglists, sl[idx_c], wdata.model->U, color);
+    if constexpr (HasDt) {
+      for (auto const &[c, slc] : itertools::enumerate(config.seglists)) {
+        ln_trace_ratio += K_overlap(slc, tau_c_new, true, wdata.model->K_table, c, color);
+        ln_trace_ratio -= K_overlap(slc, tau_c, true, wdata.model->K_table, c, color);
       }
     }
-    if (wdata.has_Dt) ln_trace_ratio -= real(wdata.K(double(tau_c_new - tau_c))(color, color));
+    if constexpr (HasDt) ln_trace_ratio -= wdata.model->K_table(tau_c_new - tau_c, color, color);
 
     // --------- Prop ratio ---------
     auto window_length = double(wtau_left - wtau_right);
@@ -215,4 +226,8 @@ namespace triqs_ctseg::moves {
     return {idx_c, idx_cdag, tau_c_new, false};
   }
 
+  // Instantiations for the features of the model, chosen in solver_core
+  template class regroup_spin_segment<false>;
+  template class regroup_spin_segment<true>;
+
 } // namespace triqs_ctseg::moves
@@ -18,23 +18,26 @@
 #pragma once
 #include "../work_data.hpp"
 #include "../configuration.hpp"
+#include "../rng.hpp"
 #include "../invariants.hpp"
 
 namespace triqs_ctseg::moves {
 
-  class regroup_spin_segment {
+  template <bool HasDt> class regroup_spin_segment {
     work_data_t &wdata;
     configuration_t &config;
-    triqs::mc_tools::random_generator &rng;
+    rng_t &rng;
 
     // Internal data
+    int orbital, up, dn; // The orbital and its colors of spin up and down
     long idx_c_up, idx_cdag_dn, idx_c_dn, idx_cdag_up;
     tau_t tau_up, tau_dn;
     double ln_trace_ratio, prop_ratio, det_sign;
+    std::vector<long> cdag_list; // Indices given by cdag_in_window (kept to avoid reallocation)
     std::tuple<long, long, tau_t, bool> propose(int color);
 
     public:
-    regroup_spin_segment(work_data_t &data_, configuration_t &config_, triqs::mc_tools::random_generator &rng_)
+    regroup_spin_segment(work_data_t &data_, configuration_t &config_, rng_t &rng_)
        : wdata(data_), config(config_), rng(rng_) {}
 
     // ------------------
@@ -16,11 +16,14 @@
 // Authors: Nikita Kavokine, Hao Lu, Olivier Parcollet, Nils Wentzell
 
 #include "remove_segment.hpp"
+#include "segment_proposal.hpp"
+#include "early_rejection.hpp"
 #include "../logs.hpp"
+#include "../tracing.hpp"
 
 namespace triqs_ctseg::moves {
 
-  double remove_segment::attempt() {
+  template <bool HasDt> double remove_segment<HasDt>::attempt() {
 
     LOG("\n =================== ATTEMPT REMOVE ================ \n");
 
@@ -53,23 +56,17 @@ namespace triqs_ctseg::moves {
     // ------------  Trace ratio  -------------
     // Same as insert, up to the sign
     // FIXME : pull it out ?
-    double ln_trace_ratio = -wdata.mu(color) * prop_seg.length();
-    for (auto c : range(config.n_color())) {
-      if (c != color) { ln_trace_ratio -= -wdata.U(color, c) * overlap(config.seglists[c], prop_seg); }
-      if (wdata.has_Dt)
-        ln_trace_ratio -= K_overlap(config.seglists[c], prop_seg.tau_c, prop_seg.tau_cdag, wdata.K, color, c);
+    double ln_trace_ratio = -wdata.model->mu(color) * prop_seg.length();
+    ln_trace_ratio -= -U_overlap(config.seglists, prop_seg, wdata.model->U, color);
+    if constexpr (HasDt) {
+      // The removed operators are in the configuration: their retarded potential is cached
+      auto const &K = wdata.model->K_table;
+      ln_trace_ratio -= wdata.retarded_potential.overlap(color, prop_seg.tau_c, prop_seg.tau_cdag, K);
+      ln_trace_ratio -= K(prop_seg.length(), color, color);
     }
-    if (wdata.has_Dt) ln_trace_ratio -= real(wdata.K(double(prop_seg.length()))(color, color));
 
     double trace_ratio = std::exp(ln_trace_ratio);
 
-    // ------------  Det ratio  ---------------
-    // same code as in insert. In Insert, it is a true bound, does not insert at same time
-    auto bl        = wdata.block_number[color];
-    auto &D        = wdata.dets[bl];
-    auto det_ratio = D.try_remove(det_lower_bound_x(D, prop_seg.tau_cdag), //
-                                  det_lower_bound_y(D, prop_seg.tau_c));
-
     // ------------  Proposition ratio ------------
 
     double current_number_segments = sl.size();
@@ -86,33 +83,51 @@ namespace triqs_ctseg::moves {
 
     double prop_ratio = current_number_segments
        / (future_number_intervals * window_length * window_length / (current_number_segments == 1 ? 1 : 2));
-    LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
+    // Importance-sampled reverse proposal
+    auto const &l0 = wdata.model->proposal_length_segment;
+    if (not l0.empty() and current_number_segments != 1)
+      prop_ratio = current_number_segments
+         * proposal_density(l0[color], window_length, double(tau_left - prop_seg.tau_c), double(prop_seg.length()))
+         / future_number_intervals;
+
+    // ------------  Det ratio  ---------------
+    // same code as in insert. In Insert, it is a true bound, does not insert at same time
+    auto bl        = wdata.model->block_number[color];
+    auto &D        = wdata.dets[bl];
+    if (wdata.early_rejection and not passes_early_test(rng, trace_ratio * prop_ratio)) {
+      LOG("Rejected before the det ratio.");
+      return 0;
+    }
+    auto det_ratio = CTSEG_TRACED("det try", D.try_remove(det_lower_bound_x(D, prop_seg.tau_cdag), //
+                                                          det_lower_bound_y(D, prop_seg.tau_c)));
 
-    det_sign    = (det_ratio > 0) ? 1.0 : -1.0;
-    double prod = trace_ratio * det_ratio * prop_ratio;
+    LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
 
-    return (std::isfinite(prod)) ? prod : det_sign;
+    det_sign = (det_ratio > 0) ? 1.0 : -1.0;
+    return attempt_ratio(wdata.early_rejection, trace_ratio * prop_ratio, det_ratio, det_sign);
   }
 
   //--------------------------------------------------
 
-  double remove_segment::accept() {
+  template <bool HasDt> double remove_segment<HasDt>::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
-    double initial_sign = trace_sign(wdata);
-    LOG("Initial sign is {}. Initial configuration: {}", initial_sign, config);
+    // Change of the trace sign, from the positions of the removed operators in the det
+    auto bl           = wdata.model->block_number[color];
+    auto idx          = wdata.model->index_in_block[color];
+    double sign_ratio = trace_sign_ratio(wdata, bl, idx, prop_seg.tau_cdag, prop_seg.tau_c, false);
+    wdata.current_trace_sign *= sign_ratio;
+    LOG("Sign ratio is {}. Initial configuration: {}", sign_ratio, config);
 
     // Update the dets
-    wdata.dets[wdata.block_number[color]].complete_operation();
+    CTSEG_TRACED("det complete", wdata.dets[bl].complete_operation());
 
     auto &sl = config.seglists[color];
     // Remove the segment
     sl.erase(sl.begin() + prop_seg_idx);
-
-    double final_sign = trace_sign(wdata);
-    double sign_ratio = initial_sign / final_sign;
-    LOG("Final sign is {}", final_sign);
+    config.update_counters(color);
+    if constexpr (HasDt) wdata.retarded_potential.update(color, config.seglists, wdata.model->K_table);
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
@@ -125,9 +140,13 @@ namespace triqs_ctseg::moves {
   }
 
   //--------------------------------------------------
-  void remove_segment::reject() {
+  template <bool HasDt> void remove_segment<HasDt>::reject() {
     LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
-    wdata.dets[wdata.block_number[color]].reject_last_try();
+    wdata.dets[wdata.model->block_number[color]].reject_last_try();
   }
 
+  // Instantiations for the features of the model, chosen in solver_core
+  template class remove_segment<false>;
+  template class remove_segment<true>;
+
 } // namespace triqs_ctseg::moves
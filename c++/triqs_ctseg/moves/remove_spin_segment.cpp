@@ -21,7 +21,7 @@
 
 namespace triqs_ctseg::moves {
 
-  double remove_spin_segment::attempt() {
+  template <bool HasDt> double remove_spin_segment<HasDt>::attempt() {
 
     LOG("\n =================== ATTEMPT REMOVE SPIN ================ \n");
 
@@ -38,15 +38,20 @@ namespace triqs_ctseg::moves {
 
     // ------------- Find the hanging segment -------------
 
+    // The two spins of the orbital of the line
+    auto const &line = jl[line_idx];
+    int up           = wdata.model->color_up(line.orbital);
+    int dn           = wdata.model->color_dn(line.orbital);
+
     // Find the two segments whose c is connected to the spin line
-    auto it_up   = lower_bound(config.seglists[0], config.Jperp_list[line_idx].tau_Sminus);
-    auto it_down = lower_bound(config.seglists[1], config.Jperp_list[line_idx].tau_Splus);
+    auto it_up   = lower_bound(config.seglists[up], line.tau_Sminus);
+    auto it_down = lower_bound(config.seglists[dn], line.tau_Splus);
 
     // The hanging segment if it is in spin up
-    auto spin_seg_up = segment_t{jl[line_idx].tau_Sminus, jl[line_idx].tau_Splus};
+    auto spin_seg_up = segment_t{line.tau_Sminus, line.tau_Splus};
 
     // The hanging segment if it is in spin down
-    auto spin_seg_down = segment_t{jl[line_idx].tau_Splus, jl[line_idx].tau_Sminus};
+    auto spin_seg_down = segment_t{line.tau_Splus, line.tau_Sminus};
 
     making_full_line = *it_up == spin_seg_up and *it_down == spin_seg_down;
 
@@ -55,33 +60,33 @@ namespace triqs_ctseg::moves {
       // Randomly choose one of the ways of making a full line
       if (rng(2) == 0) {
         spin_seg   = spin_seg_up;
-        orig_color = 0;
-        dest_color = 1;
+        orig_color = up;
+        dest_color = dn;
         orig_it    = it_up;
         dest_it    = it_down;
-        LOG("Removing segment at spin up (color 0)");
+        LOG("Removing segment at spin up (color {})", up);
       } else {
         spin_seg   = spin_seg_down;
-        orig_color = 1;
-        dest_color = 0;
+        orig_color = dn;
+        dest_color = up;
         orig_it    = it_down;
         dest_it    = it_up;
-        LOG("Removing segment at spin down (color 1)");
+        LOG("Removing segment at spin down (color {})", dn);
       }
     } else if (*it_up == spin_seg_up) {
       spin_seg   = spin_seg_up;
-      orig_color = 0;
-      dest_color = 1;
+      orig_color = up;
+      dest_color = dn;
       orig_it    = it_up;
       dest_it    = it_down;
-      LOG("Removing segment at spin up (color 0)");
+      LOG("Removing segment at spin up (color {})", up);
     } else if (*it_down == spin_seg_down) {
       spin_seg   = spin_seg_down;
-      orig_color = 1;
-      dest_color = 0;
+      orig_color = dn;
+      dest_color = up;
       orig_it    = it_down;
       dest_it    = it_up;
-      LOG("Removing segment at spin down (color 1)");
+      LOG("Removing segment at spin down (color {})", dn);
     } else {
       LOG("Bosonic line does not correspond to a segment.");
       return 0;
@@ -101,20 +106,20 @@ namespace triqs_ctseg::moves {
 
     // ------------  Trace ratio  -------------
 
-    double ln_trace_ratio = (wdata.mu(dest_color) - wdata.mu(orig_color)) * spin_seg.length();
-    if (wdata.has_Dt) {
-      for (auto c : range(config.n_color())) {
-        ln_trace_ratio -= K_overlap(config.seglists[c], spin_seg.tau_c, spin_seg.tau_cdag, wdata.K, orig_color, c);
-        // "antisegment" - careful with order
-        ln_trace_ratio -= K_overlap(config.seglists[c], spin_seg.tau_cdag, spin_seg.tau_c, wdata.K, dest_color, c);
-      }
+    double ln_trace_ratio = (wdata.model->mu(dest_color) - wdata.model->mu(orig_color)) * spin_seg.length();
+    if constexpr (HasDt) {
+      // The removed operators are in the configuration: their retarded potential is cached
+      auto const &rpot = wdata.retarded_potential;
+      ln_trace_ratio -= rpot.overlap(orig_color, spin_seg.tau_c, spin_seg.tau_cdag, wdata.model->K_table);
+      // "antisegment" - careful with order
+      ln_trace_ratio -= rpot.overlap(dest_color, spin_seg.tau_cdag, spin_seg.tau_c, wdata.model->K_table);
       // Correct for the interactions of the removed operators with themselves
-      ln_trace_ratio -= real(wdata.K(double(spin_seg.length()))(orig_color, orig_color));
-      ln_trace_ratio -= real(wdata.K(double(spin_seg.length()))(dest_color, dest_color));
-      ln_trace_ratio += 2 * real(wdata.K(double(spin_seg.length()))(orig_color, dest_color));
+      ln_trace_ratio -= wdata.model->K_table(spin_seg.length(), orig_color, orig_color);
+      ln_trace_ratio -= wdata.model->K_table(spin_seg.length(), dest_color, dest_color);
+      ln_trace_ratio += 2 * wdata.model->K_table(spin_seg.length(), orig_color, dest_color);
     }
     double trace_ratio = std::exp(ln_trace_ratio);
-    trace_ratio /= -(real(wdata.Jperp(double(spin_seg.length()))(0, 0)) / 2);
+    trace_ratio /= -wdata.model->Jperp_table(spin_seg.length(), 0, 0) / 2;
 
     // ------------  Det ratio  ---------------
 
@@ -140,7 +145,7 @@ namespace triqs_ctseg::moves {
 
   //--------------------------------------------------
 
-  double remove_spin_segment::accept() {
+  template <bool HasDt> double remove_spin_segment<HasDt>::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
@@ -159,10 +164,15 @@ namespace triqs_ctseg::moves {
       dsl[dest_left_idx] = new_seg;
       dsl.erase(dsl.begin() + dest_right_idx);
     }
+    config.update_counters(orig_color);
+    config.update_counters(dest_color);
+    if constexpr (HasDt) {
+      wdata.retarded_potential.update(orig_color, config.seglists, wdata.model->K_table);
+      wdata.retarded_potential.update(dest_color, config.seglists, wdata.model->K_table);
+    }
 
     // Remove Jperp line
-    auto &jl = config.Jperp_list;
-    jl.erase(jl.begin() + line_idx);
+    config.erase_Jperp_line(line_idx);
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
@@ -172,6 +182,12 @@ namespace triqs_ctseg::moves {
   }
 
   //--------------------------------------------------
-  void remove_spin_segment::reject() { LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n"); }
+  template <bool HasDt> void remove_spin_segment<HasDt>::reject() {
+    LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
+  }
+
+  // Instantiations for the features of the model, chosen in solver_core
+  template class remove_spin_segment<false>;
+  template class remove_spin_segment<true>;
 
 } // namespace triqs_ctseg::moves
@@ -0,0 +1,50 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <cmath>
+#include <utility>
+#include <tuple>
+#include "../rng.hpp"
+#include "../tau_t.hpp"
+
+namespace triqs_ctseg::moves {
+
+  /**
+  * Importance-sampled proposal of a segment in a window of length W (see the solve parameter
+  * importance_sampled_lengths), used by insert_segment and split_segment.
+  *
+  * The segment is given by its distances dt1 < dt2 to the left end of the window: dt1 is uniform in ]0, W[,
+  * and the length l = dt2 - dt1 in ]0, W - dt1[ has the density exp(-l / l0) / (l0 (1 - exp(-(W - dt1) / l0))).
+  * It replaces two uniform times in the window (density 2 / W^2), which mostly give long segments with tiny
+  * det ratios at large beta. The reverse moves (remove_segment, regroup_segment) need proposal_density.
+  */
+  inline std::pair<tau_t, tau_t> propose_segment(rng_t &rng, double l0,
+                                                 tau_t const &window) {
+    auto dt1 = tau_t::random(rng, window);
+    double m = double(window - dt1);
+    auto len = tau_t{std::min(-l0 * std::log1p(rng() * std::expm1(-m / l0)), m)};
+    if (len >= window - dt1) return {dt1, dt1}; // Rounding: the segment must be strictly inside (rejected)
+    return {dt1, dt1 + len};
+  }
+
+  /// Density of the proposal (dt1, dt1 + l) of propose_segment in a window of length W
+  inline double proposal_density(double l0, double W, double dt1, double l) {
+    return std::exp(-l / l0) / (W * l0 * (-std::expm1(-(W - dt1) / l0)));
+  }
+
+} // namespace triqs_ctseg::moves
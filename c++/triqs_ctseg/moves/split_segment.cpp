@@ -16,11 +16,14 @@
 // Authors: Nikita Kavokine, Hao Lu, Olivier Parcollet, Nils Wentzell
 
 #include "split_segment.hpp"
+#include "segment_proposal.hpp"
+#include "early_rejection.hpp"
 #include "../logs.hpp"
+#include "../tracing.hpp"
 
 namespace triqs_ctseg::moves {
 
-  double split_segment::attempt() {
+  template <bool HasDt, bool OffdiagDelta> double split_segment<HasDt, OffdiagDelta>::attempt() {
 
     LOG("\n =================== ATTEMPT SPLIT ================ \n");
 
@@ -41,9 +44,16 @@ namespace triqs_ctseg::moves {
     splitting_full_line = is_full_line(prop_seg);
     if (splitting_full_line) LOG("Splitting full line.");
 
-    // Select splitting points (tau_left,tau_right)
-    auto dt1 = tau_t::random(rng, prop_seg.length());
-    auto dt2 = tau_t::random(rng, prop_seg.length());
+    // Select splitting points (tau_left,tau_right), or a random start and a length (importance_sampled_lengths)
+    auto const &l0  = wdata.model->proposal_length_antisegment;
+    bool importance = not l0.empty() and not splitting_full_line;
+    tau_t dt1, dt2;
+    if (importance)
+      std::tie(dt1, dt2) = propose_segment(rng, l0[color], prop_seg.length());
+    else {
+      dt1 = tau_t::random(rng, prop_seg.length());
+      dt2 = tau_t::random(rng, prop_seg.length());
+    }
     if (dt1 == dt2) {
       LOG("Generated equal times");
       return 0;
@@ -60,29 +70,16 @@ namespace triqs_ctseg::moves {
 
     auto removed_segment = segment_t{tau_left, tau_right}; // "antisegment" : careful with order of c, cdag
 
-    double ln_trace_ratio = -wdata.mu(color) * removed_segment.length();
-    for (auto c : range(config.n_color())) {
-      if (c != color) { ln_trace_ratio -= -wdata.U(color, c) * overlap(config.seglists[c], removed_segment); }
-      if (wdata.has_Dt) { ln_trace_ratio += K_overlap(config.seglists[c], tau_right, tau_left, wdata.K, color, c); }
+    double ln_trace_ratio = -wdata.model->mu(color) * removed_segment.length();
+    ln_trace_ratio -= -U_overlap(config.seglists, removed_segment, wdata.model->U, color);
+    if constexpr (HasDt) {
+      for (auto c : range(config.n_color()))
+        ln_trace_ratio += K_overlap(config.seglists[c], tau_right, tau_left, wdata.model->K_table, color, c);
     }
-    if (wdata.has_Dt)
-      ln_trace_ratio += -real(wdata.K(double(tau_left - tau_right))(color, color)); // Correct double counting
+    if constexpr (HasDt)
+      ln_trace_ratio += -wdata.model->K_table(tau_left - tau_right, color, color); // Correct double counting
     double trace_ratio = std::exp(ln_trace_ratio);
 
-    // ------------  Det ratio  ---------------
-    auto &bl     = wdata.block_number[color];
-    auto &bl_idx = wdata.index_in_block[color];
-    auto &D      = wdata.dets[bl];
-    if (wdata.offdiag_Delta) {
-      if (cdag_in_det(tau_left, D) or c_in_det(tau_right, D)) {
-        LOG("One of the proposed times already exists in another line of the same block. Rejecting.");
-        return 0;
-      }
-    }
-    auto det_ratio = D.try_insert(det_lower_bound_x(D, tau_left),  //
-                                  det_lower_bound_y(D, tau_right), //
-                                  {tau_left, bl_idx}, {tau_right, bl_idx});
-
     // ------------  Proposition ratio ------------
 
     double current_number_segments = sl.size();
@@ -92,26 +89,50 @@ namespace triqs_ctseg::moves {
     double prop_ratio =
        (current_number_segments * prop_seg.length() * prop_seg.length() / (splitting_full_line ? 1 : 2))
        / (future_number_intervals);
+    if (importance)
+      prop_ratio = current_number_segments
+         / (proposal_density(l0[color], double(prop_seg.length()), double(dt1), double(dt2 - dt1))
+            * future_number_intervals);
 
-    LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
+    // ------------  Det ratio  ---------------
+    auto &bl     = wdata.model->block_number[color];
+    auto &bl_idx = wdata.model->index_in_block[color];
+    auto &D      = wdata.dets[bl];
+    if constexpr (OffdiagDelta) {
+      if (cdag_in_det(tau_left, D) or c_in_det(tau_right, D)) {
+        LOG("One of the proposed times already exists in another line of the same block. Rejecting.");
+        return 0;
+      }
+    }
+    if (wdata.early_rejection and not passes_early_test(rng, trace_ratio * prop_ratio)) {
+      LOG("Rejected before the det ratio.");
+      return 0;
+    }
+    auto det_ratio = CTSEG_TRACED("det try", D.try_insert(det_lower_bound_x(D, tau_left),  //
+                                                          det_lower_bound_y(D, tau_right), //
+                                                          {tau_left, bl_idx}, {tau_right, bl_idx}));
 
-    det_sign    = (det_ratio > 0) ? 1.0 : -1.0;
-    double prod = trace_ratio * det_ratio * prop_ratio;
+    LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
 
-    return (std::isfinite(prod) ? prod : det_sign);
+    det_sign = (det_ratio > 0) ? 1.0 : -1.0;
+    return attempt_ratio(wdata.early_rejection, trace_ratio * prop_ratio, det_ratio, det_sign);
   }
 
   //--------------------------------------------------
 
-  double split_segment::accept() {
+  template <bool HasDt, bool OffdiagDelta> double split_segment<HasDt, OffdiagDelta>::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
-    double initial_sign = trace_sign(wdata);
-    LOG("Initial sign is {}. Initial configuration: {}", initial_sign, config);
+    // Change of the trace sign, from the positions of the inserted operators in the det
+    auto bl           = wdata.model->block_number[color];
+    auto idx          = wdata.model->index_in_block[color];
+    double sign_ratio = trace_sign_ratio(wdata, bl, idx, tau_left, tau_right, true);
+    wdata.current_trace_sign *= sign_ratio;
+    LOG("Sign ratio is {}. Initial configuration: {}", sign_ratio, config);
 
     // Update the dets
-    wdata.dets[wdata.block_number[color]].complete_operation();
+    CTSEG_TRACED("det complete", wdata.dets[bl].complete_operation());
 
     // Split the segment
     auto &sl = config.seglists[color];
@@ -129,10 +150,8 @@ namespace triqs_ctseg::moves {
       bool insert_at_front = is_cyclic(prop_seg) and not is_cyclic(new_seg_right);
       sl.insert(sl.begin() + (insert_at_front ? 0 : prop_seg_idx + 1), new_seg_right);
     }
-
-    double final_sign = trace_sign(wdata);
-    double sign_ratio = final_sign / initial_sign;
-    LOG("Final sign is {}", final_sign);
+    config.update_counters(color);
+    if constexpr (HasDt) wdata.retarded_potential.update(color, config.seglists, wdata.model->K_table);
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
@@ -145,9 +164,15 @@ namespace triqs_ctseg::moves {
   }
 
   //--------------------------------------------------
-  void split_segment::reject() {
+  template <bool HasDt, bool OffdiagDelta> void split_segment<HasDt, OffdiagDelta>::reject() {
     LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
-    wdata.dets[wdata.block_number[color]].reject_last_try();
+    wdata.dets[wdata.model->block_number[color]].reject_last_try();
   }
 
+  // Instantiations for the features of the model, chosen in solver_core
+  template class split_segment<false, false>;
+  template class split_segment<false, true>;
+  template class split_segment<true, false>;
+  template class split_segment<true, true>;
+
 } // namespace triqs_ctseg::moves
@@ -18,14 +18,15 @@
 #pragma once
 #include "../work_data.hpp"
 #include "../configuration.hpp"
+#include "../rng.hpp"
 #include "../invariants.hpp"
 
 namespace triqs_ctseg::moves {
 
-  class split_segment {
+  template <bool HasDt, bool OffdiagDelta> class split_segment {
     work_data_t &wdata;
     configuration_t &config;
-    triqs::mc_tools::random_generator &rng;
+    rng_t &rng;
 
     // Internal data
     int color;
@@ -35,7 +36,7 @@ namespace triqs_ctseg::moves {
     double det_sign;
 
     public:
-    split_segment(work_data_t &data_, configuration_t &config_, triqs::mc_tools::random_generator &rng_)
+    split_segment(work_data_t &data_, configuration_t &config_, rng_t &rng_)
        : wdata(data_), config(config_), rng(rng_) {};
     // ------------------
     double attempt();
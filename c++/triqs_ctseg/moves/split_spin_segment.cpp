@@ -17,12 +17,13 @@
 
 #include "split_spin_segment.hpp"
 #include "../logs.hpp"
+#include "../tracing.hpp"
 #include <cmath>
 #include <tuple>
 
 namespace triqs_ctseg::moves {
 
-  double split_spin_segment::attempt() {
+  template <bool HasDt> double split_spin_segment<HasDt>::attempt() {
 
     LOG("\n =================== ATTEMPT SPLIT SPIN ================ \n");
 
@@ -39,52 +40,57 @@ namespace triqs_ctseg::moves {
     auto &line = jl[line_idx];
     LOG("Splitting S_plus at {}, S_minus at {}", line.tau_Splus, line.tau_Sminus);
 
+    orbital = line.orbital;
+    up      = wdata.model->color_up(orbital);
+    dn      = wdata.model->color_dn(orbital);
+
     ln_trace_ratio = 0;
-    prop_ratio     = jl.size();
+    // T direct = 1 / #Jperp, T inverse = 1 / n_orbitals ... (regroup_spin_segment)
+    prop_ratio = jl.size() / double(wdata.model->n_Jperp_orbitals);
 
     // ----------- Propose move in each color ----------
 
-    std::tie(idx_c_up, idx_cdag_dn, tau_up) = propose(0); // spin up
-    std::tie(idx_c_dn, idx_cdag_up, tau_dn) = propose(1); // spin down
+    std::tie(idx_c_up, idx_cdag_dn, tau_up) = propose(up); // spin up
+    std::tie(idx_c_dn, idx_cdag_up, tau_dn) = propose(dn); // spin down
 
     // ----------- Trace ratio ----------
     // Correct for the overlap between the two modified segments
-    auto &sl_up     = config.seglists[0];
-    auto &sl_dn     = config.seglists[1];
+    auto &sl_up     = config.seglists[up];
+    auto &sl_dn     = config.seglists[dn];
     auto old_seg_up = sl_up[idx_c_up];
     auto old_seg_dn = sl_dn[idx_c_dn];
     auto new_seg_up = segment_t{tau_up, old_seg_up.tau_cdag};
     auto new_seg_dn = segment_t{tau_dn, old_seg_dn.tau_cdag};
 
-    ln_trace_ratio += -wdata.U(0, 1)
+    ln_trace_ratio += -wdata.model->U(up, dn)
        * (overlap(new_seg_up, new_seg_dn) + overlap(old_seg_up, old_seg_dn) - //
           overlap(new_seg_up, old_seg_dn) - overlap(new_seg_dn, old_seg_up));
 
     // Correct for the dynamical interaction between the two operators that have been moved
-    if (wdata.has_Dt) {
-      ln_trace_ratio -= real(wdata.K(double(tau_up - old_seg_dn.tau_c))(0, 1));
-      ln_trace_ratio -= real(wdata.K(double(tau_dn - old_seg_up.tau_c))(0, 1));
-      ln_trace_ratio += real(wdata.K(double(tau_dn - tau_up))(0, 1));
-      ln_trace_ratio += real(wdata.K(double(old_seg_up.tau_c - old_seg_dn.tau_c))(0, 1));
+    if constexpr (HasDt) {
+      ln_trace_ratio -= wdata.model->K_table(tau_up - old_seg_dn.tau_c, up, dn);
+      ln_trace_ratio -= wdata.model->K_table(tau_dn - old_seg_up.tau_c, up, dn);
+      ln_trace_ratio += wdata.model->K_table(tau_dn - tau_up, up, dn);
+      ln_trace_ratio += wdata.model->K_table(old_seg_up.tau_c - old_seg_dn.tau_c, up, dn);
     }
 
     double trace_ratio = std::exp(ln_trace_ratio);
-    trace_ratio /= -real(wdata.Jperp(double(line.tau_Splus - line.tau_Sminus))(0, 0)) / 2;
+    trace_ratio /= -wdata.model->Jperp_table(line.tau_Splus - line.tau_Sminus, 0, 0) / 2;
 
     // ----------- Det ratio -----------
     double det_ratio = 1;
 
     // Spin up
-    auto &D_up = wdata.dets[0];
-    det_ratio *= D_up.try_insert(det_lower_bound_x(D_up, sl_up[idx_cdag_up].tau_cdag), //
-                                 det_lower_bound_y(D_up, tau_up),                      //
-                                 {sl_up[idx_cdag_up].tau_cdag, 0}, {tau_up, 0});
+    auto &D_up = wdata.dets[up];
+    det_ratio *= CTSEG_TRACED("det try", D_up.try_insert(det_lower_bound_x(D_up, sl_up[idx_cdag_up].tau_cdag), //
+                                                         det_lower_bound_y(D_up, tau_up),                      //
+                                                         {sl_up[idx_cdag_up].tau_cdag, 0}, {tau_up, 0}));
 
     // Spin down
-    auto &D_dn = wdata.dets[1];
-    det_ratio *=
-       D_dn.try_insert(det_lower_bound_x(D_dn, sl_dn[idx_cdag_dn].tau_cdag), det_lower_bound_y(D_dn, tau_dn), //
-                       {sl_dn[idx_cdag_dn].tau_cdag, 0}, {tau_dn, 0});
+    auto &D_dn = wdata.dets[dn];
+    det_ratio *= CTSEG_TRACED("det try", D_dn.try_insert(det_lower_bound_x(D_dn, sl_dn[idx_cdag_dn].tau_cdag), //
+                                                         det_lower_bound_y(D_dn, tau_dn),                      //
+                                                         {sl_dn[idx_cdag_dn].tau_cdag, 0}, {tau_dn, 0}));
 
     LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
 
@@ -96,20 +102,23 @@ namespace triqs_ctseg::moves {
 
   //--------------------------------------------------
 
-  double split_spin_segment::accept() {
+  template <bool HasDt> double split_spin_segment<HasDt>::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
-    double initial_sign = trace_sign(wdata);
-    LOG("Initial sign is {}. Initial configuration: {}", initial_sign, config);
+    // Change of the trace sign, from the positions of the inserted operators in the dets
+    double sign_ratio = trace_sign_ratio(wdata, up, 0, config.seglists[up][idx_cdag_up].tau_cdag, tau_up, true)
+       * trace_sign_ratio(wdata, dn, 0, config.seglists[dn][idx_cdag_dn].tau_cdag, tau_dn, true);
+    wdata.current_trace_sign *= sign_ratio;
+    LOG("Sign ratio is {}. Initial configuration: {}", sign_ratio, config);
 
     // Update the dets
-    wdata.dets[0].complete_operation();
-    wdata.dets[1].complete_operation();
+    CTSEG_TRACED("det complete", wdata.dets[up].complete_operation());
+    CTSEG_TRACED("det complete", wdata.dets[dn].complete_operation());
 
     // Update the segments
-    auto &sl_up = config.seglists[0];
-    auto &sl_dn = config.seglists[1];
+    auto &sl_up = config.seglists[up];
+    auto &sl_dn = config.seglists[dn];
 
     sl_up[idx_c_up].tau_c = tau_up;
     sl_dn[idx_c_dn].tau_c = tau_dn;
@@ -122,15 +131,15 @@ namespace triqs_ctseg::moves {
 
     fix_ordering_first_last(sl_up);
     fix_ordering_first_last(sl_dn);
+    config.update_counters(up);
+    config.update_counters(dn);
+    if constexpr (HasDt) {
+      wdata.retarded_potential.update(up, config.seglists, wdata.model->K_table);
+      wdata.retarded_potential.update(dn, config.seglists, wdata.model->K_table);
+    }
 
     // Remove Jperp line
-    auto &jl = config.Jperp_list;
-    jl.erase(begin(jl) + line_idx);
-
-    // Compute sign
-    double final_sign = trace_sign(wdata);
-    double sign_ratio = final_sign / initial_sign;
-    LOG("Final sign is {}", final_sign);
+    config.erase_Jperp_line(line_idx);
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
@@ -143,19 +152,19 @@ namespace triqs_ctseg::moves {
 
   //--------------------------------------------------
 
-  void split_spin_segment::reject() {
+  template <bool HasDt> void split_spin_segment<HasDt>::reject() {
 
     LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
-    wdata.dets[0].reject_last_try();
-    wdata.dets[1].reject_last_try();
+    wdata.dets[up].reject_last_try();
+    wdata.dets[dn].reject_last_try();
   }
 
   //--------------------------------------------------
 
-  std::tuple<long, long, tau_t> split_spin_segment::propose(int color) {
+  template <bool HasDt> std::tuple<long, long, tau_t> split_spin_segment<HasDt>::propose(int color) {
 
     auto &line      = config.Jperp_list[line_idx];
-    int other_color = 1 - color;
+    int other_color = (color == up) ? dn : up;
     auto &sl        = config.seglists[color];
     auto &dsl       = config.seglists[other_color];
 
@@ -163,13 +172,14 @@ namespace triqs_ctseg::moves {
 
     // In spin up   color, the c connected to the J line is a at tau_Sminus
     // In spin down color, the c connected to the J line is a at tau_Splus
-    long idx_c = lower_bound(sl, (color == 0 ? line.tau_Sminus : line.tau_Splus)) - sl.cbegin();
+    long idx_c = lower_bound(sl, (color == up ? line.tau_Sminus : line.tau_Splus)) - sl.cbegin();
     auto tau_c = sl[idx_c].tau_c;
 
     // ---------- Find the cdag in opposite color -----------
 
     // FIXME : ok, the vector is always of size 1 ...
-    auto idx_cdag = cdag_in_window(tau_c + tau_t::epsilon(), tau_c - tau_t::epsilon(), dsl).back();
+    cdag_in_window(tau_c + tau_t::epsilon(), tau_c - tau_t::epsilon(), dsl, cdag_list);
+    auto idx_cdag = cdag_list.back();
 
     // -------- Propose new position for the c ---------
 
@@ -187,29 +197,33 @@ namespace triqs_ctseg::moves {
     auto dt        = tau_t::random(rng, window_length);
     auto tau_c_new = sl[idx_left].tau_cdag - dt;
 
-    LOG("Spin {}: moving c at position {} from {} to {}.", (color == 0) ? "up" : "down", idx_c, tau_c, tau_c_new);
+    LOG("Spin {}: moving c at position {} from {} to {}.", (color == up) ? "up" : "down", idx_c, tau_c, tau_c_new);
     auto new_seg = segment_t{tau_c_new, sl[idx_c].tau_cdag};
 
     // -------- Trace ratio ---------
-    ln_trace_ratio += wdata.mu(color) * (double(new_seg.length()) - double(sl[idx_c].length()));
-    for (auto const &[c, slc] : itertools::enumerate(config.seglists)) {
-      if (c != color) {
-        ln_trace_ratio += -wdata.U(c, color) * overlap(slc, new_seg);
-        ln_trace_ratio -= -wdata.U(c, color) * overlap(slc, sl[idx_c]);
-      }
-      if (wdata.has_Dt) {
-        ln_trace_ratio += K_overlap(slc, tau_c_new, true, wdata.K, c, color);
-        ln_trace_ratio -= K_overlap(slc, tau_c, true, wdata.K, c, color);
+    ln_trace_ratio += wdata.model->mu(color) * (double(new_seg.length()) - double(sl[idx_c].length()));
+    // U is symmetric: U(c, color) = U(color, c)
+    ln_trace_ratio += -U_overlap(config.seglists, new_seg, wdata.model->U, color);
+    ln_trace_ratio -= -U_overlap(config.seglists, sl[idx_c], wdata.model->U, color);
+    if constexpr (HasDt) {
+      for (auto const &[c, slc] : itertools::enumerate(config.seglists)) {
+        ln_trace_ratio += K_overlap(slc, tau_c_new, true, wdata.model->K_table, c, color);
+        ln_trace_ratio -= K_overlap(slc, tau_c, true, wdata.model->K_table, c, color);
       }
     }
-    if (wdata.has_Dt) ln_trace_ratio -= real(wdata.K(double(tau_c_new - tau_c))(color, color));
+    if constexpr (HasDt) ln_trace_ratio -= wdata.model->K_table(tau_c_new - tau_c, color, color);
 
     // --------- Prop ratio ---------
     // T direct  = 1/window_length
     // T inverse =
-    prop_ratio *= window_length / (double(sl.size()) * cdag_in_window(wtau_left, wtau_right, dsl).size());
+    cdag_in_window(wtau_left, wtau_right, dsl, cdag_list);
+    prop_ratio *= window_length / (double(sl.size()) * cdag_list.size());
 
     return {idx_c, idx_cdag, tau_c_new};
   }
 
+  // Instantiations for the features of the model, chosen in solver_core
+  template class split_spin_segment<false>;
+  template class split_spin_segment<true>;
+
 } // namespace triqs_ctseg::moves
@@ -0,0 +1,177 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "swap_colors.hpp"
+#include "../logs.hpp"
+#include "../tracing.hpp"
+#include <cmath>
+#include <algorithm>
+
+namespace triqs_ctseg::moves {
+
+  namespace {
+
+    // ln of the weight of the dynamical interaction, up to the terms which do not involve colors a and b,
+    // with K evaluated on the colors a and b exchanged if exchange.
+    //   ln w_K = 1/2 sum_{c1, c2} sum_{s in c1} K_overlap(seglist c2, s, K, c1, c2) - sum_c n_c K_cc(0)
+    // (cf the double counting correction in insert_segment).
+    double ln_K_weight(std::vector<seglist_t> const &seglists, kernel_table_t const &K, int a, int b, bool exchange) {
+      auto pi  = [&](int c) { return (not exchange) ? c : (c == a ? b : (c == b ? a : c)); };
+      long n   = seglists.size();
+      double r = 0;
+      for (int c1 = 0; c1 < n; ++c1)
+        for (int c2 = 0; c2 < n; ++c2) {
+          if (c1 != a and c1 != b and c2 != a and c2 != b) continue;
+          for (auto const &s : seglists[c1])
+            r += 0.5 * K_overlap(seglists[c2], s.tau_c, s.tau_cdag, K, pi(c1), pi(c2));
+        }
+      for (int c : {a, b}) r -= double(seglists[c].size()) * K(tau_t::zero(), pi(c), pi(c));
+      return r;
+    }
+
+  } // namespace
+
+  double swap_colors::attempt() {
+
+    LOG("\n =================== ATTEMPT SWAP COLORS ================ \n");
+
+    // ------------ Choice of the colors --------------
+
+    blocks.clear();
+    color_a = rng(config.n_color());
+    color_b = rng(config.n_color() - 1);
+    if (color_b >= color_a) ++color_b; // trick to select color_b != color_a
+    if (color_a > color_b) std::swap(color_a, color_b);
+    LOG("Swapping colors {} and {}", color_a, color_b);
+
+    auto const &sla = config.seglists[color_a];
+    auto const &slb = config.seglists[color_b];
+    if (sla.empty() and slb.empty()) {
+      LOG("Nothing to swap!");
+      return 0;
+    }
+
+    // The spin lines of orbital o are attached to colors 2o and 2o + 1 : they can only follow a swap of these two
+    // colors (a spin flip of the orbital)
+    auto has_lines = [&](int color) {
+      return std::any_of(config.Jperp_list.begin(), config.Jperp_list.end(),
+                         [&](auto const &l) { return l.orbital == model_t::Jperp_orbital(color); });
+    };
+    bool spin_flip = (color_a % 2 == 0 and color_b == color_a + 1);
+    for (int c : {color_a, color_b}) {
+      if (not spin_flip and has_lines(c)) {
+        LOG("Reject: color {} has spin lines attached.", c);
+        return 0;
+      }
+    }
+
+    proposed.seglists = config.seglists;
+    std::swap(proposed.seglists[color_a], proposed.seglists[color_b]);
+    proposed.Jperp_list = config.Jperp_list;
+
+    // ------------  Trace ratio  -------------
+
+    auto const &model = *wdata.model;
+    double La = 0, Lb = 0;
+    for (auto const &s : sla) La += double(s.length());
+    for (auto const &s : slb) Lb += double(s.length());
+    double ln_trace_ratio = (model.mu(color_a) - model.mu(color_b)) * (Lb - La);
+
+    // Overlaps O_ac and O_bc of a and b with the other colors. U_ab O_ab is invariant.
+    for (auto const &[sl, sign] : {std::pair{&sla, -1}, std::pair{&slb, 1}}) {
+      for (auto const &s : *sl) {
+        overlaps(config.seglists, s, overlap_of_seg);
+        for (auto c : range(config.n_color())) {
+          if (c == color_a or c == color_b) continue;
+          ln_trace_ratio -= sign * (model.U(color_a, c) - model.U(color_b, c)) * overlap_of_seg[c];
+        }
+      }
+    }
+
+    if (model.has_Dt)
+      ln_trace_ratio += ln_K_weight(config.seglists, model.K_table, color_a, color_b, true)
+         - ln_K_weight(config.seglists, model.K_table, color_a, color_b, false);
+
+    double trace_ratio = std::exp(ln_trace_ratio);
+
+    // The spin lines : S+ and S- are exchanged
+    if (spin_flip) {
+      for (auto &line : proposed.Jperp_list) {
+        if (line.orbital != model_t::Jperp_orbital(color_a)) continue;
+        trace_ratio *= model.Jperp_table(line.tau_Splus - line.tau_Sminus, 0, 0)
+           / model.Jperp_table(line.tau_Sminus - line.tau_Splus, 0, 0);
+        std::swap(line.tau_Splus, line.tau_Sminus);
+      }
+    }
+
+    // ------------  Det ratio  ---------------
+    // The dets of the blocks of a and b are recomputed from the proposed configuration
+
+    blocks.assign(1, model.block_number[color_a]);
+    if (model.block_number[color_b] != blocks[0]) blocks.push_back(model.block_number[color_b]);
+    double det_ratio = 1;
+    for (auto bl : blocks) {
+      hybridized_operators(proposed, model, bl, x, y);
+      det_ratio *= CTSEG_TRACED("det try", wdata.dets[bl].try_refill(x, y));
+    }
+
+    // ------------  Proposition ratio ------------
+
+    double prop_ratio = 1.0;
+
+    LOG("trace_ratio  = {}, prop_ratio = {}, det_ratio = {}", trace_ratio, prop_ratio, det_ratio);
+
+    double prod = trace_ratio * det_ratio * prop_ratio;
+    return (std::isfinite(prod) ? prod : (det_ratio > 0 ? 1.0 : -1.0));
+  }
+
+  // --------------------------------------------
+
+  double swap_colors::accept() {
+
+    LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
+
+    for (auto bl : blocks) CTSEG_TRACED("det complete", wdata.dets[bl].complete_operation());
+    std::swap(config.seglists[color_a], config.seglists[color_b]);
+    config.Jperp_list = proposed.Jperp_list;
+    config.update_Jperp_index();
+    config.update_counters(color_a);
+    config.update_counters(color_b);
+
+    // The trace sign depends on the color ordering of the operators : recompute it
+    double new_trace_sign    = trace_sign(wdata);
+    double sign_ratio        = new_trace_sign / wdata.current_trace_sign;
+    wdata.current_trace_sign = new_trace_sign;
+    if (wdata.model->has_Dt) wdata.retarded_potential.rebuild(config.seglists, wdata.model->K_table);
+
+    // Check invariant
+    if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
+
+    if (configuration_sign(wdata) < 0) wdata.minus_sign = true;
+
+    LOG("Configuration is {}", config);
+
+    return sign_ratio;
+  }
+
+  //--------------------------------------------------
+  void swap_colors::reject() {
+    LOG("\n - - - - - ====> REJECT - - - - - - - - - - -\n");
+    for (auto bl : blocks) wdata.dets[bl].reject_last_try();
+  }
+
+} // namespace triqs_ctseg::moves
@@ -0,0 +1,57 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include "../work_data.hpp"
+#include "../configuration.hpp"
+#include "../rng.hpp"
+#include "../invariants.hpp"
+
+namespace triqs_ctseg::moves {
+
+  /**
+  * Global move: exchange the seglists of two colors a and b.
+  *
+  * The trace ratio is computed from mu, U and K for the whole configuration, and the dets of the blocks
+  * of a and b are recomputed from scratch (try_refill). When the colors are 0 and 1 (the two spin
+  * components coupled by Jperp), the spin lines follow the operators: S+ and S- are exchanged, i.e. this
+  * is a global spin flip. For symmetric models, it connects symmetry-broken states that the local moves
+  * only reach after a very long time. Cost O(N^2) in the number of segments of a and b, plus the dets.
+  *
+  */
+  class swap_colors {
+    work_data_t &wdata;
+    configuration_t &config;
+    rng_t &rng;
+
+    // Internal data
+    int color_a, color_b;
+    configuration_t proposed;            // The configuration with a and b exchanged
+    std::vector<long> blocks;            // Blocks of a and b (one or two)
+    std::vector<double> overlap_of_seg;  // Overlaps of a segment with all colors (kept to avoid reallocation)
+    std::vector<std::pair<tau_t, int>> x, y;
+
+    public:
+    swap_colors(work_data_t &data_, configuration_t &config_, rng_t &rng_)
+       : wdata(data_), config(config_), rng(rng_), proposed{config_.n_color()} {};
+    // ------------------
+    double attempt();
+    double accept();
+    void reject();
+  };
+
+} // namespace triqs_ctseg::moves
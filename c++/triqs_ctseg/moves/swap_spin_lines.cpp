@@ -18,6 +18,7 @@
 #include "swap_spin_lines.hpp"
 #include "../logs.hpp"
 #include <cmath>
+#include <numeric>
 
 namespace triqs_ctseg::moves {
 
@@ -34,6 +35,8 @@ namespace triqs_ctseg::moves {
       return 0;
     }
 
+    if (n_lines > 2) return attempt_heat_bath();
+
     first_line_idx  = rng(jl.size());
     second_line_idx = rng(jl.size() - 1);
     if (second_line_idx >= first_line_idx) ++second_line_idx; // trick to select second_line_idx ! = first_line_idx
@@ -41,15 +44,18 @@ namespace triqs_ctseg::moves {
     auto &l1 = jl[first_line_idx];
     auto &l2 = jl[second_line_idx];
 
+    // The S+ and S- of a line are in the same orbital
+    if (l1.orbital != l2.orbital) {
+      LOG("Lines in different orbitals");
+      return 0;
+    }
+
     // ------------  Trace ratio  -------------
 
-    double J_current =                                                 //
-       real(wdata.Jperp(double(l1.tau_Sminus - l1.tau_Splus))(0, 0)) * //
-       real(wdata.Jperp(double(l2.tau_Sminus - l2.tau_Splus))(0, 0));
+    auto const &Jperp = wdata.model->Jperp_table;
 
-    double J_future =                                                  //
-       real(wdata.Jperp(double(l1.tau_Sminus - l2.tau_Splus))(0, 0)) * //
-       real(wdata.Jperp(double(l2.tau_Sminus - l1.tau_Splus))(0, 0));
+    double J_current = Jperp(l1.tau_Sminus - l1.tau_Splus, 0, 0) * Jperp(l2.tau_Sminus - l2.tau_Splus, 0, 0);
+    double J_future  = Jperp(l1.tau_Sminus - l2.tau_Splus, 0, 0) * Jperp(l2.tau_Sminus - l1.tau_Splus, 0, 0);
 
     double trace_ratio = J_future / J_current;
 
@@ -69,16 +75,83 @@ namespace triqs_ctseg::moves {
 
   // --------------------------------------------
 
+  // Heat bath among the permutations of the S+ of min(n_lines, number of lines) random lines. This number does not
+  // change with the move, and the lines are chosen independently of the configuration: the chosen permutation sigma
+  // has probability |W_sigma| / sum |W|, and the move is always accepted with the sign of W_sigma / W_identity.
+  double swap_spin_lines::attempt_heat_bath() {
+
+    auto &jl = config.Jperp_list;
+    long m   = std::min(long(n_lines), long(jl.size()));
+
+    // m distinct random lines
+    line_idx.clear();
+    while (long(line_idx.size()) < m) {
+      long i = rng(long(jl.size()));
+      if (std::find(line_idx.begin(), line_idx.end(), i) == line_idx.end()) line_idx.push_back(i);
+    }
+
+    // The m^2 values of Jperp between the S- of a line and the S+ of another (0 in different orbitals)
+    auto const &Jperp = wdata.model->Jperp_table;
+    J.resize(m * m);
+    for (long a = 0; a < m; ++a)
+      for (long b = 0; b < m; ++b) {
+        auto const &la = jl[line_idx[a]], &lb = jl[line_idx[b]];
+        J[a * m + b]   = (la.orbital == lb.orbital) ? Jperp(la.tau_Sminus - lb.tau_Splus, 0, 0) : 0;
+      }
+
+    // Weights of all permutations (in lexicographic order, the identity first)
+    perm.resize(m);
+    std::iota(perm.begin(), perm.end(), 0);
+    weights.clear();
+    double total = 0;
+    do {
+      double w = 1;
+      for (long a = 0; a < m; ++a) w *= J[a * m + perm[a]];
+      weights.push_back(w);
+      total += std::abs(w);
+    } while (std::next_permutation(perm.begin(), perm.end()));
+
+    if (not std::isfinite(total) or weights[0] == 0) return 0;
+
+    // Choose the permutation
+    double r = rng() * total;
+    long k   = 0;
+    for (; k < long(weights.size()) - 1; ++k) {
+      r -= std::abs(weights[k]);
+      if (r < 0) break;
+    }
+    LOG("Heat bath among {} permutations of {} lines: permutation {}", weights.size(), m, k);
+    if (k == 0) return 0; // The identity: nothing changes
+
+    std::iota(perm.begin(), perm.end(), 0);
+    for (long i = 0; i < k; ++i) std::next_permutation(perm.begin(), perm.end());
+    chosen_perm = perm;
+    return (weights[k] * weights[0] > 0) ? 1 : -1;
+  }
+
+  // --------------------------------------------
+
   double swap_spin_lines::accept() {
 
     LOG("\n - - - - - ====> ACCEPT - - - - - - - - - - -\n");
 
     auto &jl = config.Jperp_list;
-    auto &l1 = jl[first_line_idx];
-    auto &l2 = jl[second_line_idx];
 
-    // Swap lines
-    std::swap(l1.tau_Splus, l2.tau_Splus);
+    if (n_lines > 2) {
+      // Line a gets the S+ of line chosen_perm[a]
+      long m = line_idx.size();
+      splus.resize(m);
+      for (long a = 0; a < m; ++a) splus[a] = jl[line_idx[chosen_perm[a]]].tau_Splus;
+      for (long a = 0; a < m; ++a) {
+        auto const &l = jl[line_idx[a]];
+        config.set_Jperp_line(line_idx[a], {l.tau_Sminus, splus[a], l.orbital});
+      }
+    } else {
+      // Swap lines
+      auto l1 = jl[first_line_idx], l2 = jl[second_line_idx];
+      config.set_Jperp_line(first_line_idx, {l1.tau_Sminus, l2.tau_Splus, l1.orbital});
+      config.set_Jperp_line(second_line_idx, {l2.tau_Sminus, l1.tau_Splus, l2.orbital});
+    }
 
     // Check invariant
     if constexpr (print_logs or ctseg_debug) check_invariant(config, wdata);
@@ -18,21 +18,42 @@
 #pragma once
 #include "../work_data.hpp"
 #include "../configuration.hpp"
+#include "../rng.hpp"
 #include "../invariants.hpp"
 
 namespace triqs_ctseg::moves {
 
+  /**
+  * Swap the S+ ends of two random spin lines (Metropolis).
+  *
+  * With n_lines > 2 (solve parameter swap_spin_lines_n_lines), the S+ ends of n_lines random lines are permuted
+  * instead, the permutation being chosen among the n_lines! ones by heat bath, from the n_lines^2 values of Jperp
+  * between their ends. The weight of the configuration only depends on the lines through the Jperp factors.
+  */
   class swap_spin_lines {
     work_data_t &wdata;
     configuration_t &config;
-    triqs::mc_tools::random_generator &rng;
+    rng_t &rng;
+    int n_lines;
 
     // Internal data
     int first_line_idx, second_line_idx;
 
+    // Heat bath: the chosen lines, Jperp(tau_Sminus[a] - tau_Splus[b]), the permutations and their |weights|
+    std::vector<long> line_idx;
+    std::vector<double> J;
+    std::vector<int> perm, chosen_perm;
+    std::vector<double> weights;
+    std::vector<tau_t> splus;
+
+    double attempt_heat_bath();
+
     public:
-    swap_spin_lines(work_data_t &data_, configuration_t &config_, triqs::mc_tools::random_generator &rng_)
-       : wdata(data_), config(config_), rng(rng_) {};
+    swap_spin_lines(work_data_t &data_, configuration_t &config_, rng_t &rng_, int n_lines_ = 2)
+       : wdata(data_), config(config_), rng(rng_), n_lines(n_lines_) {
+      ALWAYS_EXPECTS((n_lines >= 2 and n_lines <= 5), "Error : swap_spin_lines_n_lines must be in [2, 5], got {}",
+                     n_lines);
+    };
     // ------------------
     double attempt();
     double accept();
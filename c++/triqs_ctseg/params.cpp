@@ -49,15 +49,37 @@ namespace triqs_ctseg {
 
     h5_write(grp, "h_int", c.h_int);
     h5_write(grp, "h_loc0", c.h_loc0);
+    h5_write(grp, "D0_mode_frequencies", c.D0_mode_frequencies);
+    h5_write(grp, "D0_mode_couplings", c.D0_mode_couplings);
+    h5_write(grp, "Delta_pole_energies", c.Delta_pole_energies);
+    h5_write(grp, "Delta_pole_weights", c.Delta_pole_weights);
+    h5_write(grp, "equivalent_blocks", c.equivalent_blocks);
     h5_write(grp, "n_tau_G", c.n_tau_G);
     h5_write(grp, "n_tau_chi2", c.n_tau_chi2);
+    h5_write(grp, "n_legendre_G", c.n_legendre_G);
+    h5_write(grp, "n_iw_G", c.n_iw_G);
+    h5_write(grp, "n_iw_G2", c.n_iw_G2);
+    h5_write(grp, "n_iw_G2_bosonic", c.n_iw_G2_bosonic);
     h5_write(grp, "n_cycles", c.n_cycles);
     h5_write(grp, "length_cycle", c.length_cycle);
     h5_write(grp, "n_warmup_cycles", c.n_warmup_cycles);
+    h5_write(grp, "adaptive_warmup", c.adaptive_warmup);
+    h5_write(grp, "n_warmup_cycles_min", c.n_warmup_cycles_min);
+    h5_write(grp, "warmup_check_interval", c.warmup_check_interval);
+    h5_write(grp, "warmup_tolerance", c.warmup_tolerance);
+    h5_write(grp, "start_from_last_configuration", c.start_from_last_configuration);
+    h5_write(grp, "warm_start", c.warm_start);
+    h5_write(grp, "warm_start_warmup_fraction", c.warm_start_warmup_fraction);
+    h5_write(grp, "replica_U_scaling", c.replica_U_scaling);
+    h5_write(grp, "replica_mu_shift", c.replica_mu_shift);
+    h5_write(grp, "replica_exchange_interval", c.replica_exchange_interval);
     h5_write(grp, "random_seed", c.random_seed);
     h5_write(grp, "random_name", c.random_name);
     h5_write(grp, "max_time", c.max_time);
     h5_write(grp, "verbosity", c.verbosity);
+    h5_write(grp, "n_threads", c.n_threads);
+    h5_write(grp, "use_shared_memory", c.use_shared_memory);
+    h5_write(grp, "reduce_to_root", c.reduce_to_root);
     h5_write(grp, "move_insert_segment", c.move_insert_segment);
     h5_write(grp, "move_remove_segment", c.move_remove_segment);
     h5_write(grp, "move_move_segment", c.move_move_segment);
@@ -68,19 +90,52 @@ namespace triqs_ctseg {
     h5_write(grp, "move_split_spin_segment", c.move_split_spin_segment);
     h5_write(grp, "move_regroup_spin_segment", c.move_regroup_spin_segment);
     h5_write(grp, "move_swap_spin_lines", c.move_swap_spin_lines);
+    h5_write(grp, "swap_spin_lines_n_lines", c.swap_spin_lines_n_lines);
+    h5_write(grp, "move_swap_colors", c.move_swap_colors);
+    h5_write(grp, "importance_sampled_lengths", c.importance_sampled_lengths);
+    h5_write(grp, "early_rejection", c.early_rejection);
+    h5_write(grp, "move_weights", c.move_weights);
+    h5_write(grp, "adaptive_move_weights", c.adaptive_move_weights);
+    h5_write(grp, "adaptive_move_min_probability", c.adaptive_move_min_probability);
     h5_write(grp, "measure_pert_order", c.measure_pert_order);
     h5_write(grp, "measure_G_tau", c.measure_G_tau);
     h5_write(grp, "measure_F_tau", c.measure_F_tau);
+    h5_write(grp, "measure_G_l", c.measure_G_l);
+    h5_write(grp, "measure_G_iw", c.measure_G_iw);
     h5_write(grp, "measure_densities", c.measure_densities);
     h5_write(grp, "measure_average_sign", c.measure_average_sign);
+    h5_write(grp, "measure_sign_diagnostics", c.measure_sign_diagnostics);
     h5_write(grp, "measure_nn_static", c.measure_nn_static);
     h5_write(grp, "measure_nn_tau", c.measure_nn_tau);
+    h5_write(grp, "nn_tau_translation_average", c.nn_tau_translation_average);
+    h5_write(grp, "nn_tau_pairs", c.nn_tau_pairs);
     h5_write(grp, "measure_Sperp_tau", c.measure_Sperp_tau);
+    h5_write(grp, "Sperp_tau_translation_average", c.Sperp_tau_translation_average);
+    h5_write(grp, "measure_G2_iw", c.measure_G2_iw);
     h5_write(grp, "measure_state_hist", c.measure_state_hist);
+    h5_write(grp, "sample_stream_file", c.sample_stream_file);
+    h5_write(grp, "sample_stream_block_size", c.sample_stream_block_size);
+    h5_write(grp, "measure_G_tau_every", c.measure_G_tau_every);
+    h5_write(grp, "measure_nn_tau_every", c.measure_nn_tau_every);
+    h5_write(grp, "measure_nn_static_every", c.measure_nn_static_every);
+    h5_write(grp, "measure_Sperp_tau_every", c.measure_Sperp_tau_every);
+    h5_write(grp, "measure_G2_iw_every", c.measure_G2_iw_every);
+    h5_write(grp, "measure_interval_auto", c.measure_interval_auto);
+    h5_write(grp, "measure_timings", c.measure_timings);
+    h5_write(grp, "n_bins", c.n_bins);
+    h5_write(grp, "float_histograms", c.float_histograms);
+    h5_write(grp, "target_densities_error", c.target_densities_error);
+    h5_write(grp, "target_G_tau_error", c.target_G_tau_error);
+    h5_write(grp, "target_G_tau_points", c.target_G_tau_points);
+    h5_write(grp, "target_average_sign_error", c.target_average_sign_error);
+    h5_write(grp, "target_check_interval", c.target_check_interval);
+    h5_write(grp, "partial_results_file", c.partial_results_file);
+    h5_write(grp, "partial_results_interval", c.partial_results_interval);
     h5_write(grp, "det_init_size", c.det_init_size);
     h5_write(grp, "det_n_operations_before_check", c.det_n_operations_before_check);
     h5_write(grp, "det_precision_warning", c.det_precision_warning);
     h5_write(grp, "det_precision_error", c.det_precision_error);
+    h5_write(grp, "det_adaptive_check", c.det_adaptive_check);
     h5_write(grp, "det_singular_threshold", c.det_singular_threshold);
     h5_write(grp, "histogram_max_order", c.histogram_max_order);
   }
@@ -93,15 +148,37 @@ namespace triqs_ctseg {
 
     h5_read(grp, "h_int", c.h_int);
     h5_read(grp, "h_loc0", c.h_loc0);
+    h5_read(grp, "D0_mode_frequencies", c.D0_mode_frequencies);
+    h5_read(grp, "D0_mode_couplings", c.D0_mode_couplings);
+    h5_read(grp, "Delta_pole_energies", c.Delta_pole_energies);
+    h5_read(grp, "Delta_pole_weights", c.Delta_pole_weights);
+    h5_read(grp, "equivalent_blocks", c.equivalent_blocks);
     h5_read(grp, "n_tau_G", c.n_tau_G);
     h5_read(grp, "n_tau_chi2", c.n_tau_chi2);
+    h5_read(grp, "n_legendre_G", c.n_legendre_G);
+    h5_read(grp, "n_iw_G", c.n_iw_G);
+    h5_read(grp, "n_iw_G2", c.n_iw_G2);
+    h5_read(grp, "n_iw_G2_bosonic", c.n_iw_G2_bosonic);
     h5_read(grp, "n_cycles", c.n_cycles);
     h5_read(grp, "length_cycle", c.length_cycle);
     h5_read(grp, "n_warmup_cycles", c.n_warmup_cycles);
+    h5_read(grp, "adaptive_warmup", c.adaptive_warmup);
+    h5_read(grp, "n_warmup_cycles_min", c.n_warmup_cycles_min);
+    h5_read(grp, "warmup_check_interval", c.warmup_check_interval);
+    h5_read(grp, "warmup_tolerance", c.warmup_tolerance);
+    h5_read(grp, "start_from_last_configuration", c.start_from_last_configuration);
+    h5_read(grp, "warm_start", c.warm_start);
+    h5_read(grp, "warm_start_warmup_fraction", c.warm_start_warmup_fraction);
+    h5_read(grp, "replica_U_scaling", c.replica_U_scaling);
+    h5_read(grp, "replica_mu_shift", c.replica_mu_shift);
+    h5_read(grp, "replica_exchange_interval", c.replica_exchange_interval);
     h5_read(grp, "random_seed", c.random_seed);
     h5_read(grp, "random_name", c.random_name);
     h5_read(grp, "max_time", c.max_time);
     h5_read(grp, "verbosity", c.verbosity);
+    h5_read(grp, "n_threads", c.n_threads);
+    h5_read(grp, "use_shared_memory", c.use_shared_memory);
+    h5_read(grp, "reduce_to_root", c.reduce_to_root);
     h5_read(grp, "move_insert_segment", c.move_insert_segment);
     h5_read(grp, "move_remove_segment", c.move_remove_segment);
     h5_read(grp, "move_move_segment", c.move_move_segment);
@@ -112,19 +189,52 @@ namespace triqs_ctseg {
     h5_read(grp, "move_split_spin_segment", c.move_split_spin_segment);
     h5_read(grp, "move_regroup_spin_segment", c.move_regroup_spin_segment);
     h5_read(grp, "move_swap_spin_lines", c.move_swap_spin_lines);
+    h5_read(grp, "swap_spin_lines_n_lines", c.swap_spin_lines_n_lines);
+    h5_read(grp, "move_swap_colors", c.move_swap_colors);
+    h5_read(grp, "importance_sampled_lengths", c.importance_sampled_lengths);
+    h5_read(grp, "early_rejection", c.early_rejection);
+    h5_read(grp, "move_weights", c.move_weights);
+    h5_read(grp, "adaptive_move_weights", c.adaptive_move_weights);
+    h5_read(grp, "adaptive_move_min_probability", c.adaptive_move_min_probability);
     h5_read(grp, "measure_pert_order", c.measure_pert_order);
     h5_read(grp, "measure_G_tau", c.measure_G_tau);
     h5_read(grp, "measure_F_tau", c.measure_F_tau);
+    h5_read(grp, "measure_G_l", c.measure_G_l);
+    h5_read(grp, "measure_G_iw", c.measure_G_iw);
     h5_read(grp, "measure_densities", c.measure_densities);
     h5_read(grp, "measure_average_sign", c.measure_average_sign);
+    h5_read(grp, "measure_sign_diagnostics", c.measure_sign_diagnostics);
     h5_read(grp, "measure_nn_static", c.measure_nn_static);
     h5_read(grp, "measure_nn_tau", c.measure_nn_tau);
+    h5_read(grp, "nn_tau_translation_average", c.nn_tau_translation_average);
+    h5_read(grp, "nn_tau_pairs", c.nn_tau_pairs);
     h5_read(grp, "measure_Sperp_tau", c.measure_Sperp_tau);
+    h5_read(grp, "Sperp_tau_translation_average", c.Sperp_tau_translation_average);
+    h5_read(grp, "measure_G2_iw", c.measure_G2_iw);
     h5_read(grp, "measure_state_hist", c.measure_state_hist);
+    h5_read(grp, "sample_stream_file", c.sample_stream_file);
+    h5_read(grp, "sample_stream_block_size", c.sample_stream_block_size);
+    h5_read(grp, "measure_G_tau_every", c.measure_G_tau_every);
+    h5_read(grp, "measure_nn_tau_every", c.measure_nn_tau_every);
+    h5_read(grp, "measure_nn_static_every", c.measure_nn_static_every);
+    h5_read(grp, "measure_Sperp_tau_every", c.measure_Sperp_tau_every);
+    h5_read(grp, "measure_G2_iw_every", c.measure_G2_iw_every);
+    h5_read(grp, "measure_interval_auto", c.measure_interval_auto);
+    h5_read(grp, "measure_timings", c.measure_timings);
+    h5_read(grp, "n_bins", c.n_bins);
+    h5_read(grp, "float_histograms", c.float_histograms);
+    h5_read(grp, "target_densities_error", c.target_densities_error);
+    h5_read(grp, "target_G_tau_error", c.target_G_tau_error);
+    h5_read(grp, "target_G_tau_points", c.target_G_tau_points);
+    h5_read(grp, "target_average_sign_error", c.target_average_sign_error);
+    h5_read(grp, "target_check_interval", c.target_check_interval);
+    h5_read(grp, "partial_results_file", c.partial_results_file);
+    h5_read(grp, "partial_results_interval", c.partial_results_interval);
     h5_read(grp, "det_init_size", c.det_init_size);
     h5_read(grp, "det_n_operations_before_check", c.det_n_operations_before_check);
     h5_read(grp, "det_precision_warning", c.det_precision_warning);
     h5_read(grp, "det_precision_error", c.det_precision_error);
+    h5_read(grp, "det_adaptive_check", c.det_adaptive_check);
     h5_read(grp, "det_singular_threshold", c.det_singular_threshold);
     h5_read(grp, "histogram_max_order", c.histogram_max_order);
   }
@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <vector>
+#include <map>
+#include <string>
 #include <triqs/gfs.hpp>
 #include <triqs/operators/many_body_operator.hpp>
 using namespace triqs::gfs;
@@ -51,12 +54,48 @@ namespace triqs_ctseg {
     /// Quandratic part of the local Hamiltonian (including chemical potential)
     triqs::operators::many_body_operator h_loc0;
 
+    /// Retarded density-density interaction as a sum of bosonic modes, instead of D0_tau (which must then be 0):
+    /// D0_ab(i nu) = sum_k D0_mode_couplings(k, a, b) w_k^2 / ((i nu)^2 - w_k^2), w_k = D0_mode_frequencies[k] > 0.
+    /// K(tau) and K'(tau) are then evaluated in closed form. Empty: D0_tau is used
+    std::vector<double> D0_mode_frequencies = {};
+
+    /// Couplings of the modes of D0_mode_frequencies, of shape (n_modes, n_color, n_color), symmetric in the colors
+    nda::array<double, 3> D0_mode_couplings = {};
+
+    /// Hybridization given by its poles (e.g. the frequencies of a discrete Lehmann representation, or bath levels):
+    /// Delta_ij(i omega) = sum_k Delta_pole_weights[block](k, i, j) / (i omega - Delta_pole_energies[k]).
+    /// Delta(tau) is then evaluated in closed form, and Delta_tau is overwritten by its values.
+    /// Empty: Delta_tau is used
+    std::vector<double> Delta_pole_energies = {};
+
+    /// Weights of the poles of Delta_pole_energies for each block, by name (0 if absent), of shape
+    /// (n_poles, block size, block size)
+    std::map<std::string, nda::array<double, 3>> Delta_pole_weights = {};
+
+    /// Classes of equivalent blocks, by name, e.g. {{"up", "down"}} for a spin symmetric model. The blocks of a class
+    /// must have the same size, the same Delta(tau) and equivalent interactions: they then share their Delta table,
+    /// and G(tau), F(tau), G_l, G_iw and the densities are accumulated once per class (averaged over its blocks).
+    /// Empty: no equivalent blocks
+    std::vector<std::vector<std::string>> equivalent_blocks = {};
+
     /// Number of points on which to measure G(tau)/F(tau) (defaults to n_tau)
     int n_tau_G = 0;
 
     /// Number of points on which to measure 2-point functions (defaults to n_tau_bosonic)
     int n_tau_chi2 = 0;
 
+    /// Number of Legendre coefficients of G_l/F_l (see measure_G_l)
+    int n_legendre_G = 50;
+
+    /// Number of positive Matsubara frequencies of G_iw/F_iw (see measure_G_iw)
+    int n_iw_G = 100;
+
+    /// Number of positive fermionic Matsubara frequencies nu, nu' of G2_iw (see measure_G2_iw)
+    int n_iw_G2 = 10;
+
+    /// Number of non-negative bosonic Matsubara frequencies omega of G2_iw (see measure_G2_iw)
+    int n_iw_G2_bosonic = 1;
+
     /// Number of QMC cycles
     int n_cycles;
 
@@ -66,10 +105,45 @@ namespace triqs_ctseg {
     /// Number of cycles for thermalization
     int n_warmup_cycles = 5000;
 
+    /// Stop the warmup once the average perturbation orders and sign over warmup_check_interval cycles agree with
+    /// those of the previous interval within warmup_tolerance, after n_warmup_cycles_min to n_warmup_cycles cycles
+    bool adaptive_warmup = false;
+
+    /// Minimal number of warmup cycles with adaptive_warmup
+    int n_warmup_cycles_min = 500;
+
+    /// Number of cycles between two convergence checks of adaptive_warmup
+    int warmup_check_interval = 100;
+
+    /// Relative tolerance on the averages of adaptive_warmup (absolute below 1)
+    double warmup_tolerance = 0.02;
+
+    /// Start the Markov chains from the last configuration of the previous solve (or of the solver read from h5)
+    bool start_from_last_configuration = false;
+
+    /// Warm start from the previous solve if only Delta(tau) changed: reuse the interaction kernels and start from
+    /// the last configuration, with a warmup of n_warmup_cycles times the relative change of Delta(tau), at least
+    /// warm_start_warmup_fraction
+    bool warm_start = false;
+
+    /// Minimal fraction of n_warmup_cycles for a warm start (see warm_start)
+    double warm_start_warmup_fraction = 0.1;
+
+    /// Replica exchange: scaling factor of the static interaction U for each replica (replica 0 is the physical
+    /// model, with scaling 1). The number of MPI ranks must be a multiple of the number of replicas. Empty: all 1
+    std::vector<double> replica_U_scaling = {};
+
+    /// Replica exchange: shift of the chemical potential for each replica (0 for replica 0). Empty: all 0
+    std::vector<double> replica_mu_shift = {};
+
+    /// Number of cycles between two replica exchange attempts
+    int replica_exchange_interval = 10;
+
     /// Seed for random number generator
     int random_seed = 34788 + 928374 * mpi::communicator().rank();
 
-    /// Name of random number generator
+    /// Name of random number generator. "xoshiro256++": the moves use a xoshiro256++ generator, with independent
+    /// streams for all the MPI ranks and threads drawn from the random_seed of rank 0 (see rng.hpp)
     std::string random_name = "";
 
     /// Maximum runtime in seconds, use -1 to set infinite
@@ -78,6 +152,17 @@ namespace triqs_ctseg {
     /// Verbosity level
     int verbosity = mpi::communicator().rank() == 0 ? 3 : 0;
 
+    /// Number of independent Markov chains run in parallel threads on each MPI rank.
+    /// With several threads, the signals (e.g. SIGINT) are handled by the calling thread, which stops all the chains
+    int n_threads = 1;
+
+    /// Allocate the interpolation tables of the kernels and of Delta(tau) once per node in MPI shared memory
+    bool use_shared_memory = false;
+
+    /// Reduce the large measured functions (G(tau), F(tau), G_l, G_iw, <n(tau)n(0)>, <nn>) to rank 0 only, instead of
+    /// all the ranks. Their results on the other ranks are then the partial sums of the rank, and must not be used
+    bool reduce_to_root = false;
+
     // -------- Move control --------------
 
     /// Whether to perform the move insert segment
@@ -110,6 +195,32 @@ namespace triqs_ctseg {
     /// Whether to perform the move swap spin lines
     bool move_swap_spin_lines = true;
 
+    /// Number of spin lines of the move swap spin lines, in [2, 5]. 2: swap of two lines (Metropolis).
+    /// n > 2: the S+ of n lines are permuted, the permutation being chosen among the n! ones by heat bath
+    int swap_spin_lines_n_lines = 2;
+
+    /// Whether to perform the global move exchanging the segments of two colors (a spin flip for colors 0 and 1)
+    bool move_swap_colors = false;
+
+    /// Draw the lengths of the segments proposed by insert_segment and split_segment from an exponential distribution
+    /// with a decay length estimated from Delta(tau) and mu, instead of uniformly
+    bool importance_sampled_lengths = false;
+
+    /// Reject the segment moves (insert, remove, split, regroup, move) on their trace and proposal ratios first,
+    /// before computing the det ratio (two-stage Metropolis test, exact)
+    bool early_rejection = false;
+
+    /// Proposal weights of the moves, by name as in the acceptance rate report (e.g. "insert", "spin swap").
+    /// Default weight 1, 0 disables the move
+    std::map<std::string, double> move_weights = {};
+
+    /// Tune the weights of the moves during the warmup, to maximize the number of accepted moves per second.
+    /// They are kept fixed during the accumulation
+    bool adaptive_move_weights = false;
+
+    /// Minimal relative attempt probability of a move with adaptive_move_weights
+    double adaptive_move_min_probability = 0.1;
+
     // -------- Measure control --------------
 
     /// Whether to measure the perturbation order histograms (order in Delta and Jperp)
@@ -121,28 +232,116 @@ namespace triqs_ctseg {
     /// Whether to measure F(tau) (see measures/G_F_tau)
     bool measure_F_tau = false;
 
+    /// Whether to measure the Legendre coefficients G_l (and F_l if measure_F_tau) (see measures/G_F_tau)
+    bool measure_G_l = false;
+
+    /// Whether to measure G(i omega_n) (and F(i omega_n) if measure_F_tau) directly in Matsubara frequencies
+    bool measure_G_iw = false;
+
     /// Whether to measure densities (see measures/densities)
     bool measure_densities = true;
 
     /// Whether to measure the average sign (see measures/average_sign)
     bool measure_average_sign = true;
 
+    /// Whether to measure the origin of the negative weights: fraction of negative dets of each block, order in
+    /// Delta of the negative configurations, sign changes of each move (see measures/sign_diagnostics)
+    bool measure_sign_diagnostics = false;
+
     /// Whether to measure <n(0)n(0)> (see measures/nn_static)
     bool measure_nn_static = false;
 
     /// Whether to measure <n(tau)n(0)> (see measures/nn_tau)
     bool measure_nn_tau = false;
 
+    /// Whether to measure <n(tau)n(0)> with the translation-averaged estimator (see measures/nn_tau)
+    bool nn_tau_translation_average = false;
+
+    /// Block pairs (A, B) of <n(tau)n(0)> to measure (see measures/nn_tau), (B, A) being included. Of the color pairs
+    /// (a, b) and (b, a), only one is measured, the other one is given by chi_ba(tau) = chi_ab(beta - tau). The other
+    /// blocks of nn_tau are 0. Empty: all the pairs are measured
+    std::vector<std::pair<std::string, std::string>> nn_tau_pairs = {};
+
     /// Whether to measure <S_x(tau)S_x(0)> (see measures/Sperp_tau)
     bool measure_Sperp_tau = false;
 
+    /// Whether to measure <S_x(tau)S_x(0)> with the translation-averaged insertion estimator (see measures/Sperp_tau)
+    bool Sperp_tau_translation_average = false;
+
+    /// Whether to measure the two-particle Green's function G2(i omega, i nu, i nu') (see measures/G2_iw)
+    bool measure_G2_iw = false;
+
     /// Whether to measure state histograms (see measures/state_hist)
     bool measure_state_hist = false;
 
+    /// Write one record per measurement (sign, perturbation orders, state at tau = 0 and occupations, see
+    /// measures/sample_stream) to the h5 files <sample_stream_file>_<rank>_<chain>.h5. Empty: no records
+    std::string sample_stream_file = "";
+
+    /// Number of records per (compressed) block of the sample_stream_file
+    long sample_stream_block_size = 10000;
+
+    /// Measure G(tau)/F(tau) (and G_l, G_iw) only once every this number of cycles
+    int measure_G_tau_every = 1;
+
+    /// Measure <n(tau)n(0)> only once every this number of cycles
+    int measure_nn_tau_every = 1;
+
+    /// Measure <n(0)n(0)> only once every this number of cycles
+    int measure_nn_static_every = 1;
+
+    /// Measure <S_x(tau)S_x(0)> only once every this number of cycles
+    int measure_Sperp_tau_every = 1;
+
+    /// Measure G2(i omega, i nu, i nu') only once every this number of cycles
+    int measure_G2_iw_every = 1;
+
+    /// Whether to measure G(tau), <n(tau)n(0)>, <n(0)n(0)> and <S_x(tau)S_x(0)> at most once every 2 tau_int cycles,
+    /// where tau_int is the integrated autocorrelation time of the perturbation order estimated during warmup
+    bool measure_interval_auto = false;
+
+    /// Record the number of calls, zero-ratio attempts, acceptances and time of each move, and the number of calls
+    /// and time of each measure, during the accumulation (results move_timings and measure_timings)
+    bool measure_timings = false;
+
+    /// Number of bins for the jackknife error bars of G(tau), the densities, <n(0)n(0)>, <n(tau)n(0)> and the average
+    /// sign (results *_error). 0 for no error bars, otherwise an even number >= 2 (see measures/binning.hpp)
+    int n_bins = 0;
+
+    /// Accumulate the histograms of G(tau), F(tau) and <n(tau)n(0)> in single precision buffers, added to the double
+    /// precision histograms every 64 measurements. Halves the memory touched by the measures on large meshes
+    bool float_histograms = false;
+
+    /// Stop the accumulation (before n_cycles) once the error bars of all the densities are below this value.
+    /// No target if negative. The error bars are binned as for n_bins (32 bins if n_bins = 0)
+    double target_densities_error = -1;
+
+    /// Stop the accumulation once the error bars of the diagonal of G(tau) at the times target_G_tau_points are
+    /// below this value (with the other targets). No target if negative
+    double target_G_tau_error = -1;
+
+    /// Times in [0, beta] at which the error bars of G(tau) are checked (target_G_tau_error). Empty: beta / 2
+    std::vector<double> target_G_tau_points = {};
+
+    /// Stop the accumulation once the error bar of the average sign is below this value (with the other targets).
+    /// No target if negative
+    double target_average_sign_error = -1;
+
+    /// Number of cycles between two checks of the target error bars
+    int target_check_interval = 1000;
+
+    /// Write the partial results (reduced over all the ranks) and the current configuration to this h5 file every
+    /// partial_results_interval cycles of the accumulation, in a background thread. Empty: no partial results
+    std::string partial_results_file = "";
+
+    /// Number of cycles between two writes of the partial results (partial_results_file)
+    int partial_results_interval = 10000;
+
     // -------- Misc parameters --------------
 
-    /// The maximum size of the determinant matrix before a resize
-    int det_init_size = 100;
+    /// The maximum size of the determinant matrix before a resize. If 0, it is 16 times the block size
+    /// (the matrices grow as needed, so a small value only saves memory for problems with many blocks).
+    int det_init_size = 0;
 
     /// Max number of ops before the test of deviation of the det, M^-1 is performed.
     int det_n_operations_before_check = 100;
@@ -153,6 +352,12 @@ namespace triqs_ctseg {
     /// Threshold for determinant precision error
     double det_precision_error = 1.e-5;
 
+    /// Check the precision of M^-1 after whole cycles, at an interval of each block that doubles (up to 1024 cycles)
+    /// while the error is below det_precision_warning / 1000 and halves (down to 1 cycle) when it is above
+    /// det_precision_warning / 10, instead of every det_n_operations_before_check operations.
+    /// The number of checks and the largest error of each block are reported in results.det_precision_checks
+    bool det_adaptive_check = false;
+
     /// Bound for the determinant matrix being singular, abs(det) > singular_threshold. If <0, it is !isnormal(abs(det))
     double det_singular_threshold = -1;
 
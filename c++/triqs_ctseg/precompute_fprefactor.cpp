@@ -0,0 +1,77 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "./precompute_fprefactor.hpp"
+#include <algorithm>
+
+namespace triqs_ctseg {
+
+  template <typename F>
+  double precompute_fprefactor_t::fprefactor(long block, std::pair<tau_t, long> const &y, F &&ntau_of) const {
+    int color    = wdata.model->block_to_color(block, y.second);
+    double I_tau = 0;
+    for (auto const &[c, sl] : itertools::enumerate(config.seglists)) {
+      int ntau = ntau_of(c); // Density to the right of y.first in sl
+      if (c != color) I_tau += wdata.model->U(c, color) * ntau;
+      if (wdata.model->has_Dt) {
+        I_tau -= K_overlap(sl, y.first, false, wdata.model->Kprime_table, c, color);
+        if (c == color) I_tau -= 2 * wdata.model->Kprime_table(tau_t::zero(), c, c);
+      }
+      if (wdata.model->has_Jperp) {
+        I_tau -= 4 * wdata.model->Kprime_spin_table(tau_t::zero(), c, color) * ntau;
+        I_tau -= 2 * K_overlap(sl, y.first, false, wdata.model->Kprime_spin_table, c, color);
+      }
+    }
+    return I_tau;
+  }
+
+  // -------------------------------------
+
+  double precompute_fprefactor_t::fprefactor(long block, std::pair<tau_t, long> const &y) const {
+    return fprefactor(block, y, [&](long c) { return n_tau(y.first, config.seglists[c]); });
+  }
+
+  // -------------------------------------
+
+  void precompute_fprefactor_t::compute() {
+    long n_color = config.n_color();
+
+    // The rows of all the dets, by decreasing time
+    rows.clear();
+    for (auto [bl, det] : itertools::enumerate(wdata.dets)) {
+      values[bl].resize(det.size());
+      for (long k : range(det.size())) rows.push_back({det.get_y(k).first, long(bl), k});
+    }
+    std::sort(rows.begin(), rows.end(), [](auto const &r1, auto const &r2) { return r1.tau > r2.tau; });
+
+    // Density of each color at the rows, by a merge-walk over its segments
+    long n_rows = long(rows.size());
+    row_taus.resize(n_rows);
+    for (auto const &[r, row] : itertools::enumerate(rows)) row_taus[r] = row.tau;
+    occupations.resize(n_rows * n_color);
+    for (auto const &[c, sl] : itertools::enumerate(config.seglists))
+      n_tau(row_taus, sl, occupations.data() + c * n_rows);
+
+    // I(tau) at the rows, from the occupation profile
+    for (auto const &[r, row] : itertools::enumerate(rows)) {
+      int const *occ        = occupations.data() + r;
+      auto ntau_of          = [occ, n_rows](long c) { return occ[c * n_rows]; };
+      values[row.bl][row.k] = fprefactor(row.bl, wdata.dets[row.bl].get_y(row.k), ntau_of);
+    }
+  }
+
+} // namespace triqs_ctseg
@@ -0,0 +1,77 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <vector>
+#include "./configuration.hpp"
+#include "./work_data.hpp"
+
+namespace triqs_ctseg {
+
+  /**
+  * The prefactors I(tau) of the improved estimators (F(tau), F_l, F_iw, F2_iw) at the c operators of the dets.
+  *
+  * They are computed in one sweep over the rows of the dets by the first measure which needs them after the
+  * configuration changed, and shared by the others. invalidate() must be called when the configuration changes,
+  * i.e. after each cycle (see solver_core).
+  *
+  * The densities n_c(tau) at the rows, needed for all the colors c, are obtained from an occupation profile:
+  * the rows of all the dets are sorted once by decreasing time (the order of the seglists), and a single
+  * merge-walk over the segments of each color gives its density at all the rows, instead of one binary search
+  * per row and color (n_tau).
+  */
+  class precompute_fprefactor_t {
+
+    work_data_t const &wdata;
+    configuration_t const &config;
+    std::vector<std::vector<double>> values; // values[bl][k] : I(tau) at the k-th row of the det of block bl
+    bool valid = false;
+
+    // Occupation profile (kept to avoid reallocation): the rows (time, block, k) of all the dets by decreasing
+    // time, their times, and the density of each color at the rows, occupations[c * n_rows + row]
+    struct row_t {
+      tau_t tau;
+      long bl, k;
+    };
+    std::vector<row_t> rows;
+    std::vector<tau_t> row_taus;
+    std::vector<int> occupations;
+
+    public:
+    precompute_fprefactor_t(work_data_t const &wdata_, configuration_t const &config_)
+       : wdata{wdata_}, config{config_}, values(wdata_.dets.size()) {}
+
+    void invalidate() { valid = false; }
+
+    /// I(tau) at the rows of the det of each block, for the current configuration
+    std::vector<std::vector<double>> const &operator()() {
+      if (not valid) compute();
+      valid = true;
+      return values;
+    }
+
+    /// I(tau) for the c operator y = (tau, inner index) of block
+    [[nodiscard]] double fprefactor(long block, std::pair<tau_t, long> const &y) const;
+
+    private:
+    void compute();
+
+    // I(tau) for the c operator y of block, with ntau(c) the density of color c to the right of y.first
+    template <typename F> [[nodiscard]] double fprefactor(long block, std::pair<tau_t, long> const &y, F &&ntau) const;
+  };
+
+} // namespace triqs_ctseg
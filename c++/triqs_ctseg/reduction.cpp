@@ -0,0 +1,50 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "reduction.hpp"
+#include <algorithm>
+
+namespace triqs_ctseg {
+
+  void buffer_reduction_t::add(void *data, long size, MPI_Datatype type) {
+    if (c.size() == 1 or size == 0) return;
+    int type_size = 0;
+    MPI_Type_size(type, &type_size);
+    auto *p = static_cast<char *>(data);
+    for (long start = 0; start < size; start += chunk_size) {
+      int n = int(std::min(chunk_size, size - start));
+      // Bound the number of chunks in flight (and the buffers of the MPI library)
+      if (long(pending.size()) >= max_pending) {
+        MPI_Wait(&pending.front(), MPI_STATUS_IGNORE);
+        pending.pop_front();
+      }
+      void *chunk = p + start * type_size;
+      auto &r     = pending.emplace_back(MPI_REQUEST_NULL);
+      if (not to_root)
+        MPI_Iallreduce(MPI_IN_PLACE, chunk, n, type, MPI_SUM, c.get(), &r);
+      else // MPI_IN_PLACE is only valid at the root for MPI_Ireduce
+        MPI_Ireduce(c.rank() == 0 ? MPI_IN_PLACE : chunk, c.rank() == 0 ? chunk : nullptr, n, type, MPI_SUM, 0,
+                    c.get(), &r);
+    }
+  }
+
+  void buffer_reduction_t::wait() {
+    for (auto &r : pending) MPI_Wait(&r, MPI_STATUS_IGNORE);
+    pending.clear();
+  }
+
+} // namespace triqs_ctseg
@@ -0,0 +1,63 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <deque>
+#include <complex>
+#include <mpi/mpi.hpp>
+#include <nda/nda.hpp>
+
+namespace triqs_ctseg {
+
+  /**
+  * Sum over the ranks of several flat buffers, in place.
+  *
+  * The buffers are cut into chunks of at most chunk_size elements, each reduced by a non-blocking
+  * MPI_Iallreduce (or MPI_Ireduce to rank 0 if to_root) with MPI_IN_PLACE: all the buffers added are reduced
+  * concurrently, without the temporary copy of mpi::all_reduce, and with at most max_pending chunks in flight.
+  * The reductions are completed by wait() (or the destructor). The buffers must not be used before.
+  * Collective on c: all the ranks must add the same buffers, in the same order.
+  */
+  class buffer_reduction_t {
+
+    mpi::communicator c;
+    bool to_root;
+    long chunk_size, max_pending;
+    std::deque<MPI_Request> pending;
+
+    void add(void *data, long size, MPI_Datatype type);
+
+    public:
+    buffer_reduction_t(mpi::communicator c_, bool to_root_, long chunk_size_ = 1l << 20, long max_pending_ = 16)
+       : c{std::move(c_)}, to_root{to_root_}, chunk_size{chunk_size_}, max_pending{max_pending_} {}
+
+    buffer_reduction_t(buffer_reduction_t const &)            = delete;
+    buffer_reduction_t &operator=(buffer_reduction_t const &) = delete;
+    ~buffer_reduction_t() { wait(); }
+
+    /// Start the reduction of a contiguous array of double or std::complex<double>
+    template <typename A> void add(A &a) {
+      using T = typename A::value_type;
+      static_assert(std::is_same_v<T, double> or std::is_same_v<T, std::complex<double>>);
+      add(a.data(), long(a.size()), std::is_same_v<T, double> ? MPI_DOUBLE : MPI_C_DOUBLE_COMPLEX);
+    }
+
+    /// Complete all the reductions
+    void wait();
+  };
+
+} // namespace triqs_ctseg
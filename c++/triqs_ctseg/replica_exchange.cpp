@@ -0,0 +1,179 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "replica_exchange.hpp"
+#include "work_data.hpp"
+#include "logs.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace triqs_ctseg {
+
+  namespace {
+
+    // Flat representation of a configuration, to be sent over MPI
+    std::vector<uint64_t> pack(configuration_t const &config) {
+      auto buf = std::vector<uint64_t>{uint64_t(config.n_color())};
+      for (auto const &sl : config.seglists) {
+        buf.push_back(sl.size());
+        for (auto const &s : sl) {
+          buf.push_back(s.tau_c.integer());
+          buf.push_back(s.tau_cdag.integer());
+          buf.push_back(uint64_t(s.J_c) | (uint64_t(s.J_cdag) << 1));
+        }
+      }
+      buf.push_back(config.Jperp_list.size());
+      for (auto const &line : config.Jperp_list) {
+        buf.push_back(line.tau_Sminus.integer());
+        buf.push_back(line.tau_Splus.integer());
+        buf.push_back(line.orbital);
+      }
+      return buf;
+    }
+
+    // Inverse of pack
+    void unpack(std::vector<uint64_t> const &buf, configuration_t &config) {
+      long k = 0;
+      config = configuration_t{int(buf[k++])};
+      for (auto &sl : config.seglists) {
+        long n = buf[k++];
+        for (long i = 0; i < n; ++i, k += 3)
+          sl.push_back(segment_t{tau_t{buf[k]}, tau_t{buf[k + 1]}, bool(buf[k + 2] & 1), bool(buf[k + 2] & 2)});
+      }
+      long n = buf[k++];
+      for (long i = 0; i < n; ++i, k += 3)
+        config.add_Jperp_line(Jperp_line_t{tau_t{buf[k]}, tau_t{buf[k + 1]}, int(buf[k + 2])});
+      config.update_counters();
+    }
+
+  } // namespace
+
+  // -------------------------------------
+
+  double static_interaction_energy(configuration_t const &config, nda::matrix<double> const &U) {
+    double E = 0;
+    for (int a = 0; a < config.n_color(); ++a)
+      for (auto const &seg : config.seglists[a]) E += U_overlap(config.seglists, seg, U, a);
+    return E / 2; // Each pair of colors was counted twice
+  }
+
+  // -------------------------------------
+
+  double occupied_length(configuration_t const &config) {
+    double L = 0;
+    for (auto const &sl : config.seglists)
+      for (auto const &seg : sl) L += double(seg.length());
+    return L;
+  }
+
+  // -------------------------------------
+
+  replica_exchange_t::replica_exchange_t(params_t const &p, mpi::communicator c, model_t const &physical_model)
+     : world{c},
+       lambda{p.replica_U_scaling},
+       delta{p.replica_mu_shift},
+       U{physical_model.U},
+       interval{p.replica_exchange_interval} {
+
+    n_replicas = int(std::max(lambda.size(), delta.size()));
+    if (lambda.empty()) lambda.assign(n_replicas, 1);
+    if (delta.empty()) delta.assign(n_replicas, 0);
+    ALWAYS_EXPECTS((lambda.size() == delta.size()),
+                   "Error : replica_U_scaling and replica_mu_shift have different sizes {} and {}", lambda.size(),
+                   delta.size());
+    ALWAYS_EXPECTS((n_replicas >= 2 and c.size() % n_replicas == 0),
+                   "Error : the number of MPI ranks {} must be a multiple of the number of replicas {}", c.size(),
+                   n_replicas);
+    ALWAYS_EXPECTS((lambda[0] == 1 and delta[0] == 0),
+                   "Error : replica 0 is the physical model, its U scaling must be 1 and its mu shift 0");
+    ALWAYS_EXPECTS((p.n_threads == 1 and p.max_time < 0),
+                   "Error : replica exchange needs n_threads = 1 and no max_time");
+    ALWAYS_EXPECTS((interval >= 1), "Error : replica_exchange_interval must be positive, got {}", interval);
+
+    replica      = c.rank() % n_replicas;
+    group        = c.rank() / n_replicas;
+    replica_comm = c.split(replica, c.rank());
+    n_attempted.assign(n_replicas - 1, 0);
+    n_accepted.assign(n_replicas - 1, 0);
+  }
+
+  // -------------------------------------
+
+  std::shared_ptr<model_t const> replica_exchange_t::make_model(std::shared_ptr<model_t const> physical_model) const {
+    if (is_physical()) return physical_model;
+    auto m = std::make_shared<model_t>(*physical_model);
+    m->U *= lambda[replica];
+    for (auto a : range(m->n_color)) m->mu(a) += delta[replica];
+    return m;
+  }
+
+  // -------------------------------------
+
+  void replica_exchange_t::after_cycle(configuration_t &config, work_data_t &wdata,
+                                       triqs::mc_tools::random_generator &rng) {
+    if (++n_cycles % interval != 0) return;
+
+    // Pairs (r, r + 1) with r even, then odd
+    int parity  = (n_exchanges++) % 2;
+    bool lower  = ((replica + parity) % 2 == 0);
+    int partner = lower ? replica + 1 : replica - 1;
+    if (partner < 0 or partner >= n_replicas) return;
+    int partner_rank = group * n_replicas + partner;
+    int lo = lower ? replica : partner, hi = lower ? partner : replica;
+
+    // Exchange (E, L, sign) of the configurations, and a random number drawn by the lower replica.
+    // Both ranks then take the same decision.
+    double mine[4] = {static_interaction_energy(config, U), occupied_length(config), configuration_sign(wdata),
+                      lower ? rng() : 0};
+    double other[4];
+    MPI_Sendrecv(mine, 4, MPI_DOUBLE, partner_rank, 0, other, 4, MPI_DOUBLE, partner_rank, 0, world.get(),
+                 MPI_STATUS_IGNORE);
+    double const *x_lo = lower ? mine : other, *x_hi = lower ? other : mine;
+    double log_ratio   = (lambda[lo] - lambda[hi]) * (x_lo[0] - x_hi[0]) //
+       - (delta[lo] - delta[hi]) * (x_lo[1] - x_hi[1]);
+    bool accept = (x_lo[2] == x_hi[2]) and (x_lo[3] < std::exp(log_ratio));
+    if (lower) {
+      n_attempted[lo] += 1;
+      if (accept) n_accepted[lo] += 1;
+    }
+    if (not accept) return;
+
+    // Swap the configurations, and rebuild the dets
+    auto send   = pack(config);
+    long n_send = send.size(), n_recv = 0;
+    MPI_Sendrecv(&n_send, 1, MPI_LONG, partner_rank, 1, &n_recv, 1, MPI_LONG, partner_rank, 1, world.get(),
+                 MPI_STATUS_IGNORE);
+    auto recv = std::vector<uint64_t>(n_recv);
+    MPI_Sendrecv(send.data(), int(n_send), MPI_UINT64_T, partner_rank, 2, recv.data(), int(n_recv), MPI_UINT64_T,
+                 partner_rank, 2, world.get(), MPI_STATUS_IGNORE);
+    unpack(recv, config);
+    wdata.initialize_from(config);
+  }
+
+  // -------------------------------------
+
+  void replica_exchange_t::report() const {
+    auto attempted = mpi::all_reduce(n_attempted, world);
+    auto accepted  = mpi::all_reduce(n_accepted, world);
+    if (world.rank() != 0) return;
+    for (int r = 0; r < n_replicas - 1; ++r)
+      spdlog::info("Replica exchange {} <-> {}: acceptance rate {:.4f}", r, r + 1,
+                   attempted[r] > 0 ? accepted[r] / attempted[r] : 0.0);
+  }
+
+} // namespace triqs_ctseg
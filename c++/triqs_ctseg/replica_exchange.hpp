@@ -0,0 +1,82 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <memory>
+#include <vector>
+#include <mpi/mpi.hpp>
+#include <triqs/mc_tools/random_generator.hpp>
+
+#include "params.hpp"
+#include "model.hpp"
+#include "configuration.hpp"
+
+namespace triqs_ctseg {
+
+  /**
+  * Replica exchange (parallel tempering) between MPI ranks.
+  *
+  * The ranks are grouped in sets of n_replicas consecutive ranks. In each set, replica r runs the model with the
+  * static interaction U scaled by lambda_r and the chemical potentials shifted by delta_r. Replica 0 is the physical
+  * one (lambda_0 = 1, delta_0 = 0): only its chains measure.
+  * Every interval cycles, neighbouring replicas (r, r + 1), for r alternatively even and odd, propose to swap
+  * their configurations. Since only U and mu differ between the replicas, the swap ratio is
+  *
+  *   exp((lambda_r - lambda_s) (E_r - E_s) - (delta_r - delta_s) (L_r - L_s))
+  *
+  * where E is the static interaction energy sum_{a<b} U_ab int n_a n_b and L the total occupied length
+  * sum_a int n_a of a configuration. The swap is only done between configurations with the same sign.
+  * The dets of the swapped configurations are rebuilt at once (see work_data_t::initialize_from).
+  * All the ranks must do the same number of cycles (no max_time), and a single chain per rank.
+  *
+  */
+  class replica_exchange_t {
+
+    mpi::communicator world, replica_comm;
+    int n_replicas, replica, group;
+    std::vector<double> lambda, delta;
+    nda::matrix<double> U; // Unscaled interaction of the physical model
+    long interval;
+    long n_cycles = 0, n_exchanges = 0;
+    std::vector<double> n_attempted, n_accepted; // per pair (r, r + 1)
+
+    public:
+    replica_exchange_t(params_t const &p, mpi::communicator c, model_t const &physical_model);
+
+    /// Is this rank running the physical model?
+    [[nodiscard]] bool is_physical() const { return replica == 0; }
+
+    /// Communicator of the ranks running the same replica (to collect the results)
+    [[nodiscard]] mpi::communicator const &communicator() const { return replica_comm; }
+
+    /// The model of the replica of this rank
+    [[nodiscard]] std::shared_ptr<model_t const> make_model(std::shared_ptr<model_t const> physical_model) const;
+
+    /// To be called after each cycle, on all ranks. Collective every interval cycles.
+    void after_cycle(configuration_t &config, work_data_t &wdata, triqs::mc_tools::random_generator &rng);
+
+    /// Report the acceptance rates of the swaps (collective)
+    void report() const;
+  };
+
+  // Static interaction energy sum_{a<b} U_ab int n_a n_b of a configuration
+  double static_interaction_energy(configuration_t const &config, nda::matrix<double> const &U);
+
+  // Total occupied length sum_a int n_a of a configuration
+  double occupied_length(configuration_t const &config);
+
+} // namespace triqs_ctseg
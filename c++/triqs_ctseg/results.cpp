@@ -16,17 +16,170 @@
 // Authors: Nikita Kavokine, Hao Lu, Olivier Parcollet, Nils Wentzell
 
 #include "./results.hpp"
+#include "./logs.hpp"
 
 namespace triqs_ctseg {
 
+  namespace {
+
+    // acc = a * acc + b * x, for all the types of results_t
+
+    void combine(double &acc, double x, double a, double b) { acc = a * acc + b * x; }
+
+    template <typename A> void combine(A &acc, A const &x, double a, double b)
+      requires(nda::MemoryArray<A>)
+    {
+      acc = a * acc + b * x;
+    }
+
+    void combine(std::vector<double> &acc, std::vector<double> const &x, double a, double b) {
+      // Histograms of different chains may have different lengths
+      acc.resize(std::max(acc.size(), x.size()), 0);
+      for (auto i : range(acc.size())) acc[i] = a * acc[i] + (i < long(x.size()) ? b * x[i] : 0);
+    }
+
+    template <typename M, typename T> void combine(gf<M, T> &acc, gf<M, T> const &x, double a, double b) {
+      acc.data() = a * acc.data() + b * x.data();
+    }
+
+    template <typename M> void combine(block_gf<M> &acc, block_gf<M> const &x, double a, double b) {
+      for (auto bl : range(acc.size())) combine(acc[bl], x[bl], a, b);
+    }
+
+    template <typename M, typename T> void combine(block2_gf<M, T> &acc, block2_gf<M, T> const &x, double a, double b) {
+      for (auto bl1 : range(acc.size1()))
+        for (auto bl2 : range(acc.size2())) combine(acc(bl1, bl2), x(bl1, bl2), a, b);
+    }
+
+    template <typename K, typename V> void combine(std::map<K, V> &acc, std::map<K, V> const &x, double a, double b) {
+      for (auto &[key, val] : acc) combine(val, x.at(key), a, b);
+    }
+
+    template <typename T> void combine(std::optional<T> &acc, std::optional<T> const &x, double a, double b) {
+      if (acc and x) combine(*acc, *x, a, b);
+    }
+
+    // x = f(x) for all the values of the error bars of results_t
+
+    template <typename F> void transform_values(double &x, F f) { x = f(x); }
+
+    template <typename A, typename F> void transform_values(A &x, F f)
+      requires(nda::MemoryArray<A>)
+    {
+      for (auto &v : x) v = f(v);
+    }
+
+    template <typename M, typename F> void transform_values(gf<M> &x, F f) { transform_values(x.data(), f); }
+
+    template <typename M, typename F> void transform_values(block_gf<M> &x, F f) {
+      for (auto &g : x) transform_values(g, f);
+    }
+
+    template <typename F> void transform_values(block2_gf<imtime> &x, F f) {
+      for (auto bl1 : range(x.size1()))
+        for (auto bl2 : range(x.size2())) transform_values(x(bl1, bl2), f);
+    }
+
+    template <typename K, typename V, typename F> void transform_values(std::map<K, V> &x, F f) {
+      for (auto &[key, val] : x) transform_values(val, f);
+    }
+
+    // Error bars of acc = a * acc + b * x, for independent acc and x : acc = sqrt(a^2 acc^2 + b^2 x^2)
+    template <typename T> void combine_errors(std::optional<T> &acc, std::optional<T> const &x, double a, double b) {
+      if (not(acc and x)) return;
+      auto x2 = *x;
+      transform_values(*acc, [](auto v) { return v * v; });
+      transform_values(x2, [](auto v) { return v * v; });
+      combine(*acc, x2, a * a, b * b);
+      transform_values(*acc, [](auto v) { return std::sqrt(v); });
+    }
+
+    // Sparse histograms (h[i] is the weight of states[i]), possibly with different states
+    void combine_sparse(nda::vector<long> &acc_states, nda::vector<double> &acc, nda::vector<long> const &x_states,
+                        nda::vector<double> const &x, double a, double b) {
+      auto h = std::map<long, double>{};
+      for (auto i : range(acc.size())) h[acc_states(i)] += a * acc(i);
+      for (auto i : range(x.size())) h[x_states(i)] += b * x(i);
+      acc_states = nda::vector<long>(h.size());
+      acc        = nda::vector<double>(h.size());
+      for (long i = 0; auto const &[state, w] : h) {
+        acc_states(i) = state;
+        acc(i++)      = w;
+      }
+    }
+
+  } // namespace
+
+  results_t merge_results(std::vector<results_t> const &chain_results, std::vector<double> const &Z,
+                          std::vector<double> const &N) {
+
+    auto n_chains = chain_results.size();
+    ALWAYS_EXPECTS((n_chains > 0 and Z.size() == n_chains and N.size() == n_chains),
+                   "Error : inconsistent number of chains in merge_results");
+    auto res = chain_results[0];
+    if (chain_results.size() == 1) return res;
+
+    double Z_tot = 0, N_tot = 0;
+    for (auto k : range(chain_results.size())) {
+      Z_tot += Z[k];
+      N_tot += N[k];
+    }
+
+    for (auto k : range(1, chain_results.size())) {
+      auto const &r = chain_results[k];
+      // Weights of the accumulated result and of chain k
+      double aZ = (k == 1) ? Z[0] / Z_tot : 1, bZ = Z[k] / Z_tot;
+      double aN = (k == 1) ? N[0] / N_tot : 1, bN = N[k] / N_tot;
+
+      combine(res.G_tau, r.G_tau, aZ, bZ);
+      combine(res.F_tau, r.F_tau, aZ, bZ);
+      combine(res.G_l, r.G_l, aZ, bZ);
+      combine(res.F_l, r.F_l, aZ, bZ);
+      combine(res.G_iw, r.G_iw, aZ, bZ);
+      combine(res.F_iw, r.F_iw, aZ, bZ);
+      combine(res.nn_tau, r.nn_tau, aZ, bZ);
+      combine(res.G2_iw, r.G2_iw, aZ, bZ);
+      combine(res.F2_iw, r.F2_iw, aZ, bZ);
+      combine(res.Sperp_tau, r.Sperp_tau, aZ, bZ);
+      combine(res.nn_static, r.nn_static, aZ, bZ);
+      combine(res.densities, r.densities, aZ, bZ);
+      if (res.state_hist_states and r.state_hist_states)
+        combine_sparse(*res.state_hist_states, *res.state_hist, *r.state_hist_states, *r.state_hist, aZ, bZ);
+      else
+        combine(res.state_hist, r.state_hist, aZ, bZ);
+      combine(res.pert_order_Delta, r.pert_order_Delta, aN, bN);
+      combine(res.average_order_Delta, r.average_order_Delta, aN, bN);
+      combine(res.pert_order_Jperp, r.pert_order_Jperp, aN, bN);
+      combine(res.average_order_Jperp, r.average_order_Jperp, aN, bN);
+      combine_errors(res.G_tau_error, r.G_tau_error, aZ, bZ);
+      combine_errors(res.densities_error, r.densities_error, aZ, bZ);
+      combine_errors(res.nn_static_error, r.nn_static_error, aZ, bZ);
+      combine_errors(res.nn_tau_error, r.nn_tau_error, aZ, bZ);
+      combine_errors(res.average_sign_error, r.average_sign_error, aN, bN);
+      combine(res.negative_det_fraction, r.negative_det_fraction, aN, bN);
+      combine(res.pert_order_Delta_negative, r.pert_order_Delta_negative, aN, bN);
+    }
+    res.average_sign = Z_tot / N_tot;
+    return res;
+  }
+
+  //------------------------------------
+
   void h5_write(h5::group h5group, std::string subgroup_name, results_t const &c) {
 
     h5::group grp = subgroup_name.empty() ? h5group : h5group.create_group(subgroup_name);
 
     h5_write(grp, "G_tau", c.G_tau);
     h5_write(grp, "average_sign", c.average_sign);
+    h5_write(grp, "n_warmup_cycles_done", c.n_warmup_cycles_done);
     h5_write(grp, "F_tau", c.F_tau);
+    h5_write(grp, "G_l", c.G_l);
+    h5_write(grp, "F_l", c.F_l);
+    h5_write(grp, "G_iw", c.G_iw);
+    h5_write(grp, "F_iw", c.F_iw);
     h5_write(grp, "nn_tau", c.nn_tau);
+    h5_write(grp, "G2_iw", c.G2_iw);
+    h5_write(grp, "F2_iw", c.F2_iw);
     h5_write(grp, "Sperp_tau", c.Sperp_tau);
     h5_write(grp, "nn_static", c.nn_static);
     h5_write(grp, "densities", c.densities);
@@ -35,6 +188,18 @@ namespace triqs_ctseg {
     h5_write(grp, "pert_order_Jperp", c.pert_order_Jperp);
     h5_write(grp, "average_order_Jperp", c.average_order_Jperp);
     h5_write(grp, "state_hist", c.state_hist);
+    h5_write(grp, "state_hist_states", c.state_hist_states);
+    h5_write(grp, "G_tau_error", c.G_tau_error);
+    h5_write(grp, "densities_error", c.densities_error);
+    h5_write(grp, "nn_static_error", c.nn_static_error);
+    h5_write(grp, "nn_tau_error", c.nn_tau_error);
+    h5_write(grp, "average_sign_error", c.average_sign_error);
+    h5_write(grp, "move_timings", c.move_timings);
+    h5_write(grp, "measure_timings", c.measure_timings);
+    h5_write(grp, "det_precision_checks", c.det_precision_checks);
+    h5_write(grp, "negative_det_fraction", c.negative_det_fraction);
+    h5_write(grp, "pert_order_Delta_negative", c.pert_order_Delta_negative);
+    h5_write(grp, "move_sign_changes", c.move_sign_changes);
   }
 
   //------------------------------------
@@ -45,8 +210,15 @@ namespace triqs_ctseg {
 
     h5_read(grp, "G_tau", c.G_tau);
     h5_read(grp, "average_sign", c.average_sign);
+    if (grp.has_key("n_warmup_cycles_done")) h5_read(grp, "n_warmup_cycles_done", c.n_warmup_cycles_done);
     h5_read(grp, "F_tau", c.F_tau);
+    h5_read(grp, "G_l", c.G_l);
+    h5_read(grp, "F_l", c.F_l);
+    h5_read(grp, "G_iw", c.G_iw);
+    h5_read(grp, "F_iw", c.F_iw);
     h5_read(grp, "nn_tau", c.nn_tau);
+    h5_read(grp, "G2_iw", c.G2_iw);
+    h5_read(grp, "F2_iw", c.F2_iw);
     h5_read(grp, "Sperp_tau", c.Sperp_tau);
     h5_read(grp, "nn_static", c.nn_static);
     h5_read(grp, "densities", c.densities);
@@ -55,6 +227,18 @@ namespace triqs_ctseg {
     h5_read(grp, "pert_order_Jperp", c.pert_order_Jperp);
     h5_read(grp, "average_order_Jperp", c.average_order_Jperp);
     h5_read(grp, "state_hist", c.state_hist);
+    h5_read(grp, "state_hist_states", c.state_hist_states);
+    h5_read(grp, "G_tau_error", c.G_tau_error);
+    h5_read(grp, "densities_error", c.densities_error);
+    h5_read(grp, "nn_static_error", c.nn_static_error);
+    h5_read(grp, "nn_tau_error", c.nn_tau_error);
+    h5_read(grp, "average_sign_error", c.average_sign_error);
+    h5_read(grp, "move_timings", c.move_timings);
+    h5_read(grp, "measure_timings", c.measure_timings);
+    h5_read(grp, "det_precision_checks", c.det_precision_checks);
+    h5_read(grp, "negative_det_fraction", c.negative_det_fraction);
+    h5_read(grp, "pert_order_Delta_negative", c.pert_order_Delta_negative);
+    h5_read(grp, "move_sign_changes", c.move_sign_changes);
   }
 
 } // namespace triqs_ctseg
@@ -17,6 +17,7 @@
 
 #pragma once
 #include <optional>
+#include <vector>
 #include <triqs/stat/histograms.hpp>
 #include <triqs/gfs.hpp>
 
@@ -33,9 +34,27 @@ namespace triqs_ctseg {
     /// Self-energy improved estimator :math:`F(\tau)`.
     std::optional<block_gf<imtime>> F_tau;
 
+    /// Legendre coefficients :math:`G_l` of the single-particle Green's function.
+    std::optional<block_gf<legendre>> G_l;
+
+    /// Legendre coefficients :math:`F_l` of the self-energy improved estimator.
+    std::optional<block_gf<legendre>> F_l;
+
+    /// Single-particle Green's function :math:`G(i\omega_n)`, measured directly in Matsubara frequencies.
+    std::optional<block_gf<imfreq>> G_iw;
+
+    /// Self-energy improved estimator :math:`F(i\omega_n)`, measured directly in Matsubara frequencies.
+    std::optional<block_gf<imfreq>> F_iw;
+
     /// Density-density time correlation function :math:`\langle n_a(\tau) n_b(0) \rangle`.
     std::optional<block2_gf<imtime>> nn_tau;
 
+    /// Two-particle Green's function :math:`G^{(2)}_{abcd}(i\omega, i\nu, i\nu')`, for each pair of blocks.
+    std::optional<block2_gf<prod<imfreq, imfreq, imfreq>, tensor_valued<4>>> G2_iw;
+
+    /// Improved estimator :math:`F^{(2)}_{abcd}(i\omega, i\nu, i\nu')` of the two-particle Green's function.
+    std::optional<block2_gf<prod<imfreq, imfreq, imfreq>, tensor_valued<4>>> F2_iw;
+
     /// Perpendicular spin-spin correlation function :math:`\langle S_x(\tau) S_x(0) \rangle`.
     std::optional<gf<imtime>> Sperp_tau;
 
@@ -60,10 +79,65 @@ namespace triqs_ctseg {
     /// State histogram
     std::optional<nda::vector<double>> state_hist;
 
+    /// States of the sparse state histogram (more than 20 colors): state_hist[i] is the weight of state_hist_states[i]
+    std::optional<nda::vector<long>> state_hist_states;
+
+    /// Jackknife error bar of G_tau (n_bins > 0)
+    std::optional<block_gf<imtime>> G_tau_error;
+
+    /// Jackknife error bar of densities (n_bins > 0)
+    std::optional<std::map<std::string, nda::array<double, 1>>> densities_error;
+
+    /// Jackknife error bar of nn_static (n_bins > 0)
+    std::optional<std::map<std::pair<std::string, std::string>, nda::matrix<double>>> nn_static_error;
+
+    /// Jackknife error bar of nn_tau (n_bins > 0)
+    std::optional<block2_gf<imtime>> nn_tau_error;
+
+    /// Jackknife error bar of average_sign (n_bins > 0)
+    std::optional<double> average_sign_error;
+
+    /// Statistics of the moves (measure_timings): [n_attempted, n_zero_ratio, n_accepted, time [s]] for each move,
+    /// summed over the chains and MPI ranks
+    std::optional<std::map<std::string, nda::vector<double>>> move_timings;
+
+    /// Statistics of the measures (measure_timings): [n_calls, time [s]] for each measure, summed over the chains and
+    /// MPI ranks
+    std::optional<std::map<std::string, nda::vector<double>>> measure_timings;
+
+    /// Precision checks of M^-1 (det_adaptive_check): [n_checks, largest error] for each block, the number of checks
+    /// summed and the error maximized over the chains and MPI ranks
+    std::optional<std::map<std::string, nda::vector<double>>> det_precision_checks;
+
+    /// Fraction of the configurations with a negative det, for each block (measure_sign_diagnostics)
+    std::optional<std::map<std::string, double>> negative_det_fraction;
+
+    /// Delta perturbation order histogram of the configurations with a negative sign, normalized as pert_order_Delta
+    /// (measure_sign_diagnostics)
+    std::optional<std::vector<double>> pert_order_Delta_negative;
+
+    /// Sign changes of the moves (measure_sign_diagnostics): [n_accepted, n_sign_changes] for each move, during the
+    /// accumulation, summed over the chains and MPI ranks
+    std::optional<std::map<std::string, nda::vector<double>>> move_sign_changes;
+
     /// Average sign
     double average_sign;
+
+    /// Number of warmup cycles actually done (see adaptive_warmup)
+    long n_warmup_cycles_done = 0;
   };
 
+  /**
+  * Merge the results of independent Markov chains.
+  *
+  * Z[k] and N[k] are the sum of the signs and the number of measurements of chain k.
+  * Quantities normalized by the sum of the signs are averaged with weights Z[k] / sum(Z), the perturbation
+  * order histograms and averages with weights N[k] / sum(N). The average sign is sum(Z) / sum(N).
+  * The error bars of the chains are combined in quadrature, with the same weights.
+  */
+  results_t merge_results(std::vector<results_t> const &chain_results, std::vector<double> const &Z,
+                          std::vector<double> const &N);
+
   /// writes all containers to hdf5 file
   void h5_write(h5::group h5group, std::string subgroup_name, results_t const &c);
 
@@ -0,0 +1,106 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "retarded_potential.hpp"
+
+namespace triqs_ctseg {
+
+  // Add an operator of a given color, and its contribution to the potential of all other operators
+  void retarded_potential_t::insert_op(int color, op_t op, kernel_table_t const &K) {
+    double s = op.is_c ? 1 : -1;
+    op.phi   = s * K(tau_t::zero(), color, color); // Self-interaction (0 if K(0) = 0)
+    K.visit([&](auto const &slice) {
+      for (long c = 0; c < long(ops.size()); ++c) {
+        auto K_in  = slice(color, c);
+        auto K_out = slice(c, color);
+        for (auto &x : ops[c]) {
+          op.phi += (x.is_c ? 1 : -1) * K_in(op.tau - x.tau);
+          x.phi += s * K_out(x.tau - op.tau);
+        }
+      }
+    });
+    auto &v = ops[color];
+    v.insert(std::lower_bound(v.begin(), v.end(), op, is_before), op);
+  }
+
+  // Remove an operator of a given color, and its contribution to the potential of all other operators
+  void retarded_potential_t::remove_op(int color, op_t const &op, kernel_table_t const &K) {
+    auto &v = ops[color];
+    auto it = std::lower_bound(v.begin(), v.end(), op, is_before);
+    assert(it != v.end() and it->tau == op.tau and it->is_c == op.is_c);
+    v.erase(it);
+    double s = op.is_c ? 1 : -1;
+    K.visit([&](auto const &slice) {
+      for (long c = 0; c < long(ops.size()); ++c) {
+        auto K_out = slice(c, color);
+        for (auto &x : ops[c]) x.phi -= s * K_out(x.tau - op.tau);
+      }
+    });
+  }
+
+  // Compare ops[color] with new_ops (both ordered) and apply the removals, then the insertions
+  void retarded_potential_t::apply_diff(int color, kernel_table_t const &K) {
+    removed.clear();
+    added.clear();
+    auto const &v = ops[color];
+    auto it_old   = v.cbegin();
+    auto it_new   = new_ops.cbegin();
+    while (it_old != v.cend() or it_new != new_ops.cend()) {
+      if (it_new == new_ops.cend() or (it_old != v.cend() and is_before(*it_old, *it_new)))
+        removed.push_back(*it_old++);
+      else if (it_old == v.cend() or is_before(*it_new, *it_old))
+        added.push_back(*it_new++);
+      else {
+        ++it_old;
+        ++it_new;
+      }
+    }
+    for (auto const &op : removed) remove_op(color, op, K);
+    for (auto const &op : added) insert_op(color, op, K);
+  }
+
+  // Compute phi of all operators from scratch
+  void retarded_potential_t::recompute(kernel_table_t const &K) {
+    K.visit([&](auto const &slice) {
+      for (long a = 0; a < long(ops.size()); ++a) {
+        for (auto &x : ops[a]) x.phi = 0;
+        for (long c = 0; c < long(ops.size()); ++c) {
+          auto K_ac = slice(a, c);
+          for (auto &x : ops[a])
+            for (auto const &y : ops[c]) x.phi += (y.is_c ? 1 : -1) * K_ac(x.tau - y.tau);
+        }
+      }
+    });
+  }
+
+  double retarded_potential_t::operator()(int color, tau_t const &tau, kernel_table_t const &K) const {
+    auto const &v = ops[color];
+    // Operators are ordered by decreasing time: look for the first one not later than tau
+    auto it = std::lower_bound(v.begin(), v.end(), tau, [](op_t const &x, tau_t const &t) { return x.tau > t; });
+    if (it != v.end() and it->tau == tau) return it->phi;
+    // No operator at tau: direct computation
+    return K.visit([&](auto const &slice) {
+      double phi = 0;
+      for (long c = 0; c < long(ops.size()); ++c) {
+        auto K_ac = slice(color, c);
+        for (auto const &y : ops[c]) phi += (y.is_c ? 1 : -1) * K_ac(tau - y.tau);
+      }
+      return phi;
+    });
+  }
+
+} // namespace triqs_ctseg
@@ -0,0 +1,134 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "./tau_t.hpp"
+#include "./kernels.hpp"
+
+namespace triqs_ctseg {
+
+  /**
+  * Cache of the retarded potential felt by the operators of the configuration.
+  *
+  * For an operator of color a at time tau, we store
+  *
+  *   phi_a(tau) = sum_b s_b K_{a, c_b}(tau - tau_b)
+  *
+  * where the sum runs over all operators b (of color c_b) of the seglists, with s_b = 1 for c and -1 for cdag.
+  * The dynamical interaction between a pair (tau_c, tau_cdag) of color a and the configuration, i.e. the sum over
+  * colors of K_overlap(seglist, tau_c, tau_cdag, K, a, c), is then phi_a(tau_c) - phi_a(tau_cdag).
+  * For operators already in the configuration (removal-type moves), this is a lookup instead of a loop over segments.
+  *
+  * The cache is kept in sync with the seglists by calling update on the modified colors in the accept of the moves,
+  * at a cost O(total number of operators) per changed operator.
+  * It is regularly rebuilt from scratch to avoid the accumulation of rounding errors.
+  *
+  */
+  class retarded_potential_t {
+
+    struct op_t {
+      tau_t tau;
+      bool is_c;
+      double phi = 0;
+    };
+
+    // For each color, the operators ordered by decreasing time (c before cdag at equal times)
+    std::vector<std::vector<op_t>> ops;
+
+    // Operators of the new seglist in update, and removed/added operators in apply_diff
+    // (only kept to avoid reallocation)
+    std::vector<op_t> new_ops, removed, added;
+
+    // Number of updates since the last rebuild
+    long n_updates = 0;
+
+    static bool is_before(op_t const &x, op_t const &y) {
+      return (x.tau > y.tau) or (x.tau == y.tau and x.is_c and not y.is_c);
+    }
+
+    // Fill v with the operators of seglist, in the storage order
+    template <typename Seglist> static void make_ops(Seglist const &seglist, std::vector<op_t> &v) {
+      v.clear();
+      for (auto const &s : seglist) {
+        v.push_back({s.tau_c, true});
+        v.push_back({s.tau_cdag, false});
+      }
+      std::sort(v.begin(), v.end(), is_before);
+    }
+
+    void insert_op(int color, op_t op, kernel_table_t const &K);
+    void remove_op(int color, op_t const &op, kernel_table_t const &K);
+    void apply_diff(int color, kernel_table_t const &K);
+    void recompute(kernel_table_t const &K);
+
+    public:
+    /// Number of updates after which the cache is rebuilt from scratch
+    static constexpr long n_updates_before_rebuild = 1000;
+
+    retarded_potential_t() = default;
+    explicit retarded_potential_t(int n_color) : ops(n_color) {}
+
+    /// Recompute the full cache from the seglists.
+    template <typename Seglists> void rebuild(Seglists const &seglists, kernel_table_t const &K) {
+      ops.resize(seglists.size());
+      for (long c = 0; c < long(seglists.size()); ++c) make_ops(seglists[c], ops[c]);
+      recompute(K);
+      n_updates = 0;
+    }
+
+    /// Bring the cache of color in agreement with seglists[color], after a change in the configuration.
+    template <typename Seglists> void update(int color, Seglists const &seglists, kernel_table_t const &K) {
+      if (++n_updates >= n_updates_before_rebuild) {
+        rebuild(seglists, K);
+        return;
+      }
+      make_ops(seglists[color], new_ops);
+      apply_diff(color, K);
+    }
+
+    /// phi_color(tau). O(log N) if an operator of this color sits at tau, otherwise computed in O(N).
+    [[nodiscard]] double operator()(int color, tau_t const &tau, kernel_table_t const &K) const;
+
+    /// Dynamical interaction of the pair (tau_c, tau_cdag) of a color with the configuration.
+    /// Same as the sum over colors c of K_overlap(seglists[c], tau_c, tau_cdag, K, color, c).
+    [[nodiscard]] double overlap(int color, tau_t const &tau_c, tau_t const &tau_cdag, kernel_table_t const &K) const {
+      return (*this)(color, tau_c, K) - (*this)(color, tau_cdag, K);
+    }
+
+    /// Maximal difference with a cache rebuilt from scratch (for checks)
+    template <typename Seglists>
+    [[nodiscard]] double max_error(Seglists const &seglists, kernel_table_t const &K) const {
+      auto fresh = retarded_potential_t{};
+      fresh.rebuild(seglists, K);
+      double err = 0;
+      for (long c = 0; c < long(ops.size()); ++c) {
+        if (ops[c].size() != fresh.ops[c].size()) return std::numeric_limits<double>::infinity();
+        for (long i = 0; i < long(ops[c].size()); ++i) {
+          if (ops[c][i].tau != fresh.ops[c][i].tau) return std::numeric_limits<double>::infinity();
+          err = std::max(err, std::abs(ops[c][i].phi - fresh.ops[c][i].phi));
+        }
+      }
+      return err;
+    }
+  };
+
+} // namespace triqs_ctseg
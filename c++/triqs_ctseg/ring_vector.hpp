@@ -0,0 +1,235 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <compare>
+#include <initializer_list>
+
+namespace triqs_ctseg {
+
+  /**
+  * A sequence container stored contiguously in a circular buffer.
+  *
+  * It has the subset of the std::vector interface used on the seglists (random access iterators,
+  * insert/erase of a single element, push_back, ...), with two differences in complexity:
+  *
+  *   - insert and erase move the elements on the shorter side of the position, i.e. at most n/2 of them.
+  *     In particular, insertion/removal at the front is O(1), as at the back.
+  *   - rotate_front_to_back and rotate_back_to_front (moving a single element from one end to the other,
+  *     see fix_ordering_first_last) are O(1) instead of O(n).
+  *
+  * The elements are stored in a single array (wrapping around at most once), so a scan of the list
+  * touches at most two contiguous chunks of memory. The capacity is a power of 2.
+  * T must be default constructible and copyable.
+  *
+  */
+  template <typename T> class ring_vector_t {
+
+    std::vector<T> buf; // buf.size() is the capacity, 0 or a power of 2
+    long head = 0;      // Position in buf of the first element
+    long n    = 0;      // Number of elements
+
+    // Position in buf of the i-th element
+    [[nodiscard]] long pos(long i) const { return (head + i) & (long(buf.size()) - 1); }
+
+    // Grow the capacity to at least n_min, and store the elements from the start of the buffer
+    void grow(long n_min) {
+      long cap = std::max(long(buf.size()), 4l);
+      while (cap < n_min) cap *= 2;
+      auto new_buf = std::vector<T>(cap);
+      for (long i = 0; i < n; ++i) new_buf[i] = buf[pos(i)];
+      buf  = std::move(new_buf);
+      head = 0;
+    }
+
+    template <bool Const> class iterator_impl {
+      using container_t = std::conditional_t<Const, ring_vector_t const, ring_vector_t>;
+      friend class iterator_impl<not Const>;
+      container_t *v = nullptr;
+      long i         = 0;
+
+      public:
+      using iterator_category = std::random_access_iterator_tag;
+      using iterator_concept  = std::random_access_iterator_tag;
+      using value_type        = T;
+      using difference_type   = long;
+      using pointer           = std::conditional_t<Const, T const *, T *>;
+      using reference         = std::conditional_t<Const, T const &, T &>;
+
+      iterator_impl() = default;
+      iterator_impl(container_t *v_, long i_) : v{v_}, i{i_} {}
+
+      // iterator -> const_iterator
+      template <bool C = Const>
+        requires(C)
+      iterator_impl(iterator_impl<false> const &it) : v{it.v}, i{it.i} {}
+
+      [[nodiscard]] long index() const { return i; }
+
+      reference operator*() const { return (*v)[i]; }
+      pointer operator->() const { return &(*v)[i]; }
+      reference operator[](long k) const { return (*v)[i + k]; }
+
+      // clang-format off
+      iterator_impl &operator++() { ++i; return *this; }
+      iterator_impl &operator--() { --i; return *this; }
+      iterator_impl operator++(int) { auto r = *this; ++i; return r; }
+      iterator_impl operator--(int) { auto r = *this; --i; return r; }
+      iterator_impl &operator+=(long k) { i += k; return *this; }
+      iterator_impl &operator-=(long k) { i -= k; return *this; }
+      // clang-format on
+
+      friend iterator_impl operator+(iterator_impl it, long k) { return it += k; }
+      friend iterator_impl operator+(long k, iterator_impl it) { return it += k; }
+      friend iterator_impl operator-(iterator_impl it, long k) { return it -= k; }
+
+      template <bool C> long operator-(iterator_impl<C> const &it) const { return i - it.i; }
+      template <bool C> bool operator==(iterator_impl<C> const &it) const { return i == it.i; }
+      template <bool C> std::strong_ordering operator<=>(iterator_impl<C> const &it) const { return i <=> it.i; }
+    };
+
+    public:
+    using value_type      = T;
+    using size_type       = std::size_t;
+    using difference_type = long;
+    using reference       = T &;
+    using const_reference = T const &;
+    using iterator        = iterator_impl<false>;
+    using const_iterator  = iterator_impl<true>;
+
+    ring_vector_t() = default;
+
+    /// n default constructed elements
+    explicit ring_vector_t(size_type n_) {
+      if (n_ > 0) grow(n_);
+      n = n_;
+    }
+
+    ring_vector_t(std::initializer_list<T> l) {
+      reserve(l.size());
+      for (auto const &x : l) push_back(x);
+    }
+
+    [[nodiscard]] size_type size() const { return n; }
+    [[nodiscard]] bool empty() const { return n == 0; }
+    [[nodiscard]] size_type capacity() const { return buf.size(); }
+
+    void reserve(size_type n_) {
+      if (long(n_) > long(buf.size())) grow(n_);
+    }
+
+    void clear() {
+      head = 0;
+      n    = 0;
+    }
+
+    T &operator[](long i) { return buf[pos(i)]; }
+    T const &operator[](long i) const { return buf[pos(i)]; }
+
+    T &front() { return buf[head]; }
+    T const &front() const { return buf[head]; }
+    T &back() { return buf[pos(n - 1)]; }
+    T const &back() const { return buf[pos(n - 1)]; }
+
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, n}; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, n}; }
+    const_iterator cbegin() const { return {this, 0}; }
+    const_iterator cend() const { return {this, n}; }
+
+    friend iterator begin(ring_vector_t &v) { return v.begin(); }
+    friend iterator end(ring_vector_t &v) { return v.end(); }
+    friend const_iterator begin(ring_vector_t const &v) { return v.begin(); }
+    friend const_iterator end(ring_vector_t const &v) { return v.end(); }
+
+    void push_back(T const &x) {
+      if (n == long(buf.size())) grow(n + 1);
+      buf[pos(n)] = x;
+      ++n;
+    }
+
+    void push_front(T const &x) {
+      if (n == long(buf.size())) grow(n + 1);
+      head      = pos(-1);
+      buf[head] = x;
+      ++n;
+    }
+
+    void pop_back() { --n; }
+
+    void pop_front() {
+      head = pos(1);
+      --n;
+    }
+
+    /// Insert x before it. Moves min(k, n - k) elements, where k is the position of it.
+    iterator insert(const_iterator it, T const &x) {
+      long k = it.index();
+      T y    = x; // x may be an element of the list
+      if (n == long(buf.size())) grow(n + 1);
+      if (k < n - k) {
+        head = pos(-1);
+        for (long i = 0; i < k; ++i) buf[pos(i)] = buf[pos(i + 1)];
+      } else {
+        for (long i = n; i > k; --i) buf[pos(i)] = buf[pos(i - 1)];
+      }
+      buf[pos(k)] = y;
+      ++n;
+      return {this, k};
+    }
+
+    /// Erase the element at it. Moves min(k, n - 1 - k) elements, where k is the position of it.
+    iterator erase(const_iterator it) {
+      long k = it.index();
+      if (k < n - 1 - k) {
+        for (long i = k; i > 0; --i) buf[pos(i)] = buf[pos(i - 1)];
+        head = pos(1);
+      } else {
+        for (long i = k; i < n - 1; ++i) buf[pos(i)] = buf[pos(i + 1)];
+      }
+      --n;
+      return {this, k};
+    }
+
+    /// Move the first element to the back. O(1)
+    friend void rotate_front_to_back(ring_vector_t &v) {
+      T x = v.front();
+      v.pop_front();
+      v.push_back(x); // No reallocation: one slot was just freed
+    }
+
+    /// Move the last element to the front. O(1)
+    friend void rotate_back_to_front(ring_vector_t &v) {
+      T x = v.back();
+      v.pop_back();
+      v.push_front(x);
+    }
+
+    friend bool operator==(ring_vector_t const &a, ring_vector_t const &b) {
+      return a.size() == b.size() and std::equal(a.begin(), a.end(), b.begin());
+    }
+  };
+
+  // Same operations on std::vector, in O(n)
+  template <typename T> void rotate_front_to_back(std::vector<T> &v) { std::rotate(v.begin(), v.begin() + 1, v.end()); }
+  template <typename T> void rotate_back_to_front(std::vector<T> &v) { std::rotate(v.begin(), v.end() - 1, v.end()); }
+
+} // namespace triqs_ctseg
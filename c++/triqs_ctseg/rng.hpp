@@ -0,0 +1,130 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <cstdint>
+#include <concepts>
+#include <limits>
+#include <optional>
+#include <string>
+#include <triqs/mc_tools/random_generator.hpp>
+
+namespace triqs_ctseg {
+
+  /**
+  * The xoshiro256++ generator (D. Blackman, S. Vigna, "Scrambled linear pseudorandom number generators", 2021).
+  *
+  * 64 bits per call, period 2^256 - 1, a state of 4 words. The state is initialized from the seed by splitmix64.
+  * jump() advances the state by 2^128 steps : the streams k = 0, 1, ... of a seed (k jumps) never overlap.
+  */
+  class xoshiro256pp {
+
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    public:
+    using result_type = uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    /// The generator of stream number `stream` of the seed (stream jumps of 2^128 steps)
+    explicit xoshiro256pp(uint64_t seed, uint64_t stream = 0) {
+      for (auto &x : s) { // splitmix64
+        uint64_t z = (seed += 0x9e3779b97f4a7c15);
+        z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z          = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        x          = z ^ (z >> 31);
+      }
+      for (uint64_t k = 0; k < stream; ++k) jump();
+    }
+
+    result_type operator()() {
+      uint64_t r = rotl(s[0] + s[3], 23) + s[0];
+      uint64_t t = s[1] << 17;
+      s[2] ^= s[0];
+      s[3] ^= s[1];
+      s[1] ^= s[2];
+      s[0] ^= s[3];
+      s[2] ^= t;
+      s[3] = rotl(s[3], 45);
+      return r;
+    }
+
+    /// Advance the state by 2^128 steps
+    void jump() {
+      static constexpr uint64_t J[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+      uint64_t t[4] = {0, 0, 0, 0};
+      for (auto j : J)
+        for (int b = 0; b < 64; ++b) {
+          if (j & (uint64_t{1} << b))
+            for (int i = 0; i < 4; ++i) t[i] ^= s[i];
+          (*this)();
+        }
+      for (int i = 0; i < 4; ++i) s[i] = t[i];
+    }
+
+    /// Uniform integer in [0, n[, unbiased, with one draw most of the time (D. Lemire, ACM TOMACS 29, 2019). n > 0
+    uint64_t bounded(uint64_t n) {
+      auto m = static_cast<unsigned __int128>((*this)()) * n;
+      if (uint64_t(m) < n) {
+        uint64_t threshold = -n % n; // 2^64 mod n
+        while (uint64_t(m) < threshold) m = static_cast<unsigned __int128>((*this)()) * n;
+      }
+      return uint64_t(m >> 64);
+    }
+
+    /// Uniform double in [0, 1[, with 53 random bits
+    double uniform() { return double((*this)() >> 11) * 0x1.0p-53; }
+  };
+
+  /**
+  * The random numbers of the moves (and of tau_t::random).
+  *
+  * With random_name = "xoshiro256++", they are drawn from a xoshiro256++ generator, whose bounded integers are
+  * unbiased on the full 64-bit range of the times. The generator of each chain is the stream
+  * (rank * n_threads + chain) of random_seed, so the chains of all the ranks and threads have independent
+  * and reproducible streams. The generator of mc_generic (accept/reject) is then the default one.
+  * Otherwise, the calls are forwarded to the generator of mc_generic (random_name, random_seed of the chain).
+  */
+  class rng_t {
+
+    triqs::mc_tools::random_generator *mc_rng;
+    std::optional<xoshiro256pp> x;
+
+    public:
+    /// Name of the generator of rng_t (solve parameter random_name)
+    static constexpr auto xoshiro_name = "xoshiro256++";
+
+    /// Name of the generator of mc_generic for random_name
+    static std::string mc_generic_name(std::string const &random_name) {
+      return random_name == xoshiro_name ? std::string{} : random_name;
+    }
+
+    rng_t(triqs::mc_tools::random_generator &mc_rng_, std::string const &random_name, uint64_t seed, uint64_t stream)
+       : mc_rng{&mc_rng_} {
+      if (random_name == xoshiro_name) x.emplace(seed, stream);
+    }
+
+    /// Uniform double in [0, 1[
+    double operator()() { return x ? x->uniform() : (*mc_rng)(); }
+
+    /// Uniform integer in [0, n[
+    template <std::integral T> T operator()(T n) { return x ? T(x->bounded(uint64_t(n))) : (*mc_rng)(n); }
+  };
+
+} // namespace triqs_ctseg
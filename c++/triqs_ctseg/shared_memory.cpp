@@ -0,0 +1,109 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "shared_memory.hpp"
+#include <map>
+#include <mutex>
+
+namespace triqs_ctseg {
+
+  namespace {
+
+    // The windows of the shared arrays, by creation number, and whether their array is released (not referenced).
+    // Never destroyed: the arrays may be released during the static destruction.
+    struct windows_t {
+      std::mutex mutex;
+      std::map<long, std::pair<MPI_Win, bool>> windows;
+      long n_created = 0;
+      int keyval     = MPI_KEYVAL_INVALID;
+    };
+    windows_t &registry() {
+      static auto *r = new windows_t{};
+      return *r;
+    }
+
+    // Free the (released or all) windows, in the order of their creation. Collective
+    void free_windows(bool all) {
+      auto &r   = registry();
+      auto lock = std::lock_guard{r.mutex};
+      for (auto it = r.windows.begin(); it != r.windows.end();) {
+        if (all or it->second.second) {
+          MPI_Win_free(&it->second.first);
+          it = r.windows.erase(it);
+        } else
+          ++it;
+      }
+    }
+
+    // Called by MPI_Finalize, when MPI_COMM_SELF is freed (while MPI can still be used)
+    int free_at_finalize(MPI_Comm, int, void *, void *) {
+      free_windows(true);
+      return MPI_SUCCESS;
+    }
+
+  } // namespace
+
+  void shared_memory_t::free_released_windows() {
+    int initialized = 0, finalized = 0;
+    MPI_Initialized(&initialized);
+    MPI_Finalized(&finalized);
+    if (initialized and not finalized) free_windows(false);
+  }
+
+  shared_memory_t::shared_memory_t(mpi::communicator c, bool enable) {
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    if (not enable or not initialized) return;
+    MPI_Comm_split_type(c.get(), MPI_COMM_TYPE_SHARED, c.rank(), MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+  }
+
+  shared_memory_t::~shared_memory_t() {
+    // The windows keep their own reference to the group: the communicator can be freed first
+    if (enabled()) MPI_Comm_free(&node_comm);
+  }
+
+  std::shared_ptr<void> shared_memory_t::allocate_shared(long n_bytes, std::function<void(void *)> const &fill) const {
+    MPI_Win win;
+    void *base = nullptr;
+    // Only the first process of the node allocates memory: the array starts at the (page-aligned) window base
+    MPI_Win_allocate_shared(MPI_Aint(node_rank == 0 ? n_bytes : 0), 1, MPI_INFO_NULL, node_comm, &base, &win);
+    MPI_Aint size_0 = 0;
+    int disp_unit   = 1;
+    MPI_Win_shared_query(win, 0, &size_0, &disp_unit, &base);
+    // The fences order the writes of the first process before any read of the other processes
+    MPI_Win_fence(0, win);
+    if (node_rank == 0) fill(base);
+    MPI_Win_fence(0, win);
+    // The window lives as long as the memory: it is only marked as released with its last reference, and freed
+    // collectively later (free_released_windows, or MPI_Finalize)
+    auto &r   = registry();
+    auto lock = std::lock_guard{r.mutex};
+    if (r.keyval == MPI_KEYVAL_INVALID) {
+      MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, free_at_finalize, &r.keyval, nullptr);
+      MPI_Comm_set_attr(MPI_COMM_SELF, r.keyval, nullptr);
+    }
+    long id       = r.n_created++;
+    r.windows[id] = {win, false};
+    return {base, [id](void *) {
+              auto &reg = registry();
+              auto lock = std::lock_guard{reg.mutex};
+              if (auto it = reg.windows.find(id); it != reg.windows.end()) it->second.second = true;
+            }};
+  }
+
+} // namespace triqs_ctseg
@@ -0,0 +1,84 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <memory>
+#include <cstddef>
+#include <functional>
+#include <mpi/mpi.hpp>
+
+namespace triqs_ctseg {
+
+  /**
+  * Allocation of read-only arrays, either private to the process or in MPI-3 shared-memory windows.
+  *
+  * When enabled, the processes of the communicator are grouped by node (MPI_COMM_TYPE_SHARED).
+  * An array is then allocated once per node, filled by the first process of the node, and mapped by the others.
+  *
+  * MPI_Win_free is collective, so it is never called when the last copy of the returned pointer is destroyed
+  * (which may happen at different times on different processes, or after MPI_Finalize, e.g. for the model kept by
+  * the solver). The window is then only marked as released, and the released windows are freed in the order of
+  * their creation by free_released_windows, which must be called collectively, at the same point on all the
+  * processes (at the end of solve). All the windows left are freed when MPI is finalized.
+  *
+  */
+  class shared_memory_t {
+
+    MPI_Comm node_comm = MPI_COMM_NULL;
+    int node_rank      = 0;
+
+    // Allocate n_bytes in a window of node_comm, fill it on the first process of the node and synchronize
+    [[nodiscard]] std::shared_ptr<void> allocate_shared(long n_bytes, std::function<void(void *)> const &fill) const;
+
+    public:
+    /// Private allocation
+    shared_memory_t() = default;
+
+    /// Allocate in shared memory per node if enabled (and MPI is initialized). Collective on c.
+    shared_memory_t(mpi::communicator c, bool enable);
+
+    shared_memory_t(shared_memory_t const &)            = delete;
+    shared_memory_t &operator=(shared_memory_t const &) = delete;
+    ~shared_memory_t();
+
+    /// Free the windows of the arrays which are not referenced any more. Collective over all the processes which
+    /// allocated shared arrays: they must create and release their arrays in the same order (e.g. as members of
+    /// the model).
+    static void free_released_windows();
+
+    /// Are the arrays allocated in shared memory?
+    [[nodiscard]] bool enabled() const { return node_comm != MPI_COMM_NULL; }
+
+    /// Allocate an array of n elements and fill it with fill(T *) on one process per node. Collective if enabled.
+    template <typename T, typename F> [[nodiscard]] std::shared_ptr<T const[]> make_array(long n, F &&fill) const {
+      static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported");
+      if (not enabled()) {
+        auto res = std::shared_ptr<T[]>(new T[n]);
+        fill(res.get());
+        return res;
+      }
+      auto mem = allocate_shared(n * long(sizeof(T)), [n, &fill](void *m) {
+        auto *q = static_cast<T *>(m);
+        std::uninitialized_default_construct_n(q, n);
+        fill(q);
+      });
+      auto *p = static_cast<T const *>(mem.get());
+      return std::shared_ptr<T const[]>(mem, p);
+    }
+  };
+
+} // namespace triqs_ctseg
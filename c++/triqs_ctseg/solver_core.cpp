@@ -17,16 +17,429 @@
 
 #include <triqs/mc_tools/mc_generic.hpp>
 #include <triqs/utility/callbacks.hpp>
+#include <triqs/utility/signal_handler.hpp>
 
 #include "solver_core.hpp"
 #include "work_data.hpp"
 #include "configuration.hpp"
 #include "measures.hpp"
 #include "moves.hpp"
+#include "replica_exchange.hpp"
 #include "logs.hpp"
+#include "tracing.hpp"
+
+#include <thread>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <exception>
+#include <cstdio>
+#include <csignal>
+#include <pthread.h>
 
 namespace triqs_ctseg {
 
+  namespace {
+
+    // The signals which stop a Monte Carlo run (those of the TRIQS signal handler)
+    constexpr int stop_signals[] = {SIGINT, SIGTERM, SIGXCPU, SIGQUIT, SIGUSR1, SIGUSR2};
+
+    sigset_t stop_signal_set() {
+      sigset_t set;
+      sigemptyset(&set);
+      for (int sig : stop_signals) sigaddset(&set, sig);
+      return set;
+    }
+
+    // Take one pending (blocked) stop signal, if any. Returns the signal, or 0.
+    int take_pending_stop_signal() {
+      sigset_t pending;
+      sigpending(&pending);
+      for (int sig : stop_signals) {
+        if (not sigismember(&pending, sig)) continue;
+        sigset_t one;
+        sigemptyset(&one);
+        sigaddset(&one, sig);
+        int received = 0;
+        sigwait(&one, &received);
+        return received;
+      }
+      return 0;
+    }
+
+    // Sum of the signs and number of measurements of a chain, used as weights when merging the chains
+    struct chain_weight {
+      double &Z_out, &N_out;
+      double Z = 0, N = 0;
+      void accumulate(double s) {
+        Z += s;
+        N += 1;
+      }
+      void collect_results(mpi::communicator const &c) {
+        Z_out = mpi::all_reduce(Z, c);
+        N_out = mpi::all_reduce(N, c);
+      }
+    };
+
+    // Whether a model built from (p1, in1) only differs by Delta(tau) from a model built from (p2, in2)
+    bool same_interactions(solve_params_t const &p1, inputs_t const &in1, solve_params_t const &p2,
+                           inputs_t const &in2) {
+      auto same = [](auto const &g1, auto const &g2) { return max_element(abs(g1.data() - g2.data())) == 0; };
+      if (not(p1.h_int == p2.h_int and p1.h_loc0 == p2.h_loc0 and p1.use_shared_memory == p2.use_shared_memory))
+        return false;
+      auto const &g1 = p1.D0_mode_couplings, &g2 = p2.D0_mode_couplings;
+      if (p1.D0_mode_frequencies != p2.D0_mode_frequencies or g1.shape() != g2.shape()
+          or not std::equal(g1.begin(), g1.end(), g2.begin()))
+        return false;
+      if (not same(in1.Jperpt, in2.Jperpt)) return false;
+      for (auto b1 : range(in1.D0t.size1()))
+        for (auto b2 : range(in1.D0t.size2()))
+          if (not same(in1.D0t(b1, b2), in2.D0t(b1, b2))) return false;
+      return true;
+    }
+
+    // Relative change max |D2 - D1| / max |D1| between two hybridization functions
+    double relative_change(block_gf<imtime> const &D1, block_gf<imtime> const &D2) {
+      double diff = 0, norm = 0;
+      for (auto bl : range(D1.size())) {
+        diff = std::max(diff, double(max_element(abs(D2[bl].data() - D1[bl].data()))));
+        norm = std::max(norm, double(max_element(abs(D1[bl].data()))));
+      }
+      return norm > 0 ? diff / norm : 1;
+    }
+
+    // Pairs of inverse moves, by name. The proposal ratio of a move assumes that its inverse is proposed with the
+    // same weight: they must have the same move_weights, and share their attempt probability (adaptive_move_weights)
+    std::vector<std::pair<std::string, std::string>> const inverse_moves = {
+       {"insert", "remove"}, {"split", "regroup"}, {"spin insert", "spin remove"}, {"spin split", "spin regroup"}};
+
+    // The inverse of a move (empty if the move is its own inverse)
+    std::string inverse_move(std::string const &name) {
+      for (auto const &[a, b] : inverse_moves) {
+        if (name == a) return b;
+        if (name == b) return a;
+      }
+      return {};
+    }
+
+    // The weight of a move in move_weights (1 by default)
+    double move_weight(params_t const &p, std::string const &name) {
+      auto it = p.move_weights.find(name);
+      return (it == p.move_weights.end()) ? 1.0 : it->second;
+    }
+
+    // A Markov chain: its own work data (dets, caches), configuration, random generator, moves and measures.
+    // The model is shared between the chains.
+    struct chain_t {
+
+      work_data_t wdata;
+      configuration_t config;
+      results_t results;
+      precompute_fprefactor_t fprefactors; // Improved estimator prefactors, shared by the measures
+      triqs::mc_tools::mc_generic<double> CTQMC;
+      rng_t rng; // Random numbers of the moves
+      double Z = 0, N = 0;
+
+      // Minimal interval (in cycles) between two expensive measurements, see measure_interval_auto
+      long min_interval = 1;
+
+      // Perturbation order after each warmup cycle, to estimate its autocorrelation time
+      std::vector<double> warmup_orders;
+      long n_cycles_done = 0;
+      bool in_warmup = true, interval_auto;
+      int verbosity;
+
+      // Sums of Delta_order, Jperp_order and sign, and number of cycles, since the last reset (adaptive_warmup)
+      nda::vector<double> chunk_sums = nda::zeros<double>(4);
+
+      // Replica exchange between MPI ranks, if any. Only the physical replica measures.
+      replica_exchange_t *rex;
+
+      // Statistics of the moves (adaptive_move_weights, measure_timings, measure_sign_diagnostics) and of the
+      // measures (measure_timings).
+      // Deques for stable addresses.
+      std::deque<moves::move_stats_t> move_stats;
+      std::vector<std::string> move_names;
+      std::deque<measures::measure_stats_t> measure_stats;
+      std::vector<std::string> measure_names;
+      double min_attempt_probability;
+      bool adaptive_moves, timings, sign_diagnostics;
+
+      // Probes of the target error bars (target_*_error), filled by the measures. Deque for stable addresses.
+      std::deque<measures::precision_probe_t> probes;
+
+      // Partial results (partial_results_file) : the measures are collectable, and partial is true while collecting
+      bool dumps, partial = false;
+
+      chain_t(std::shared_ptr<model_t const> model, params_t const &p, int seed, uint64_t stream_seed, uint64_t stream,
+              int verbosity, bool measure_weight, std::string const &stream_file, configuration_t const *initial_config,
+              replica_exchange_t *rex_)
+         : wdata{std::move(model), p},
+           config{wdata.model->n_color},
+           fprefactors{wdata, config},
+           CTQMC(rng_t::mc_generic_name(p.random_name), seed, verbosity),
+           rng{CTQMC.get_rng(), p.random_name, stream_seed, stream},
+           interval_auto{p.measure_interval_auto},
+           verbosity{verbosity},
+           rex{rex_},
+           min_attempt_probability{p.adaptive_move_min_probability},
+           adaptive_moves{p.adaptive_move_weights},
+           timings{p.measure_timings},
+           sign_diagnostics{p.measure_sign_diagnostics},
+           dumps{not p.partial_results_file.empty()} {
+
+        // Start from a given configuration (restart), or from a non-empty configuration when Delta(tau) = 0
+        if (initial_config) {
+          config = *initial_config;
+          // The Monte Carlo sign starts at 1 : a configuration with a negative weight is not a valid starting point
+          if (wdata.initialize_from(config) < 0) {
+            if (verbosity > 0) spdlog::warn("Negative weight of the initial configuration, starting from scratch");
+            config = configuration_t{wdata.model->n_color};
+            wdata.initialize_from(config);
+          }
+        }
+        if (config.n_segments() == 0 and not wdata.model->has_Delta) {
+          config.seglists[0].push_back(segment_t::full_line());
+          config.update_counters(0);
+        }
+
+        // Initialize moves, specialized for the features of the model
+        auto const &m = *wdata.model;
+        if (m.has_Dt and m.offdiag_Delta)
+          add_moves<true, true>(p);
+        else if (m.has_Dt)
+          add_moves<true, false>(p);
+        else if (m.offdiag_Delta)
+          add_moves<false, true>(p);
+        else
+          add_moves<false, false>(p);
+
+        if (not rex or rex->is_physical()) add_measures(p, measure_weight, stream_file);
+
+        // Attempt a replica exchange, invalidate the improved estimator prefactors of the previous cycle, check the
+        // precision of the dets, record the perturbation order and the sign during warmup, and set min_interval at
+        // the end of the warmup
+        if (p.measure_interval_auto or p.adaptive_warmup or p.adaptive_move_weights or p.measure_timings or rex
+            or p.measure_F_tau or p.det_adaptive_check or p.measure_sign_diagnostics) {
+          long n_warmup = p.adaptive_warmup ? -1 : p.n_warmup_cycles; // adaptive : end given by finish_warmup
+          CTQMC.set_after_cycle_duty([this, n_warmup]() {
+            if (rex) rex->after_cycle(config, wdata, CTQMC.get_rng());
+            fprefactors.invalidate();
+            if (not wdata.det_checks.empty()) wdata.check_det_precision(config);
+            if (not in_warmup) return;
+            ++n_cycles_done;
+            if (interval_auto) warmup_orders.push_back(config.Delta_order() + config.Jperp_order());
+            chunk_sums(0) += config.Delta_order();
+            chunk_sums(1) += config.Jperp_order();
+            chunk_sums(2) += configuration_sign(wdata);
+            chunk_sums(3) += 1;
+            if (n_cycles_done == n_warmup) finish_warmup();
+          });
+        }
+
+        // No warmup (e.g. a restart) : the after-cycle duty never reaches n_warmup, the accumulation starts at once
+        if (not p.adaptive_warmup and p.n_warmup_cycles <= 0) finish_warmup();
+      }
+
+      // Add the moves. has_Dt and offdiag_Delta are compile-time in the moves : no branch on them in the static
+      // interaction, diagonal Delta case.
+      template <bool HasDt, bool OffdiagDelta> void add_moves(params_t const &p) {
+        for (auto const &[a, b] : inverse_moves)
+          ALWAYS_EXPECTS((move_weight(p, a) == move_weight(p, b)),
+                         "Error : the inverse moves {} and {} must have the same move_weights, got {} and {}", a, b,
+                         move_weight(p, a), move_weight(p, b));
+
+        if (wdata.model->has_Delta) {
+          if (p.move_insert_segment)
+            add_move(p, moves::insert_segment<HasDt, OffdiagDelta>{wdata, config, rng}, "insert");
+          if (p.move_remove_segment) add_move(p, moves::remove_segment<HasDt>{wdata, config, rng}, "remove");
+          if (p.move_move_segment) add_move(p, moves::move_segment<HasDt, OffdiagDelta>{wdata, config, rng}, "move");
+          if (p.move_split_segment) add_move(p, moves::split_segment<HasDt, OffdiagDelta>{wdata, config, rng}, "split");
+          if (p.move_regroup_segment) add_move(p, moves::regroup_segment<HasDt>{wdata, config, rng}, "regroup");
+        }
+
+        if (wdata.model->has_Jperp) {
+          if (p.move_insert_spin_segment)
+            add_move(p, moves::insert_spin_segment<HasDt>{wdata, config, rng}, "spin insert");
+
+          if (p.move_remove_spin_segment)
+            add_move(p, moves::remove_spin_segment<HasDt>{wdata, config, rng}, "spin remove");
+        }
+
+        if (wdata.model->has_Jperp and wdata.model->has_Delta) {
+          if (p.move_split_spin_segment)
+            add_move(p, moves::split_spin_segment<HasDt>{wdata, config, rng}, "spin split");
+
+          if (p.move_regroup_spin_segment)
+            add_move(p, moves::regroup_spin_segment<HasDt>{wdata, config, rng}, "spin regroup");
+        }
+
+        if (wdata.model->has_Jperp) {
+          if (p.move_swap_spin_lines)
+            add_move(p, moves::swap_spin_lines{wdata, config, rng, p.swap_spin_lines_n_lines}, "spin swap");
+        }
+
+        if (p.move_swap_colors and wdata.model->n_color > 1)
+          add_move(p, moves::swap_colors{wdata, config, rng}, "swap colors");
+      }
+
+      // Add a move, traced with CTSEG_TRACE (see tracing.hpp)
+      template <typename Move> void add_move(params_t const &p, Move &&move, std::string const &name) {
+#ifdef CTSEG_TRACE
+        add_weighted_move(p, moves::traced<std::decay_t<Move>>{std::forward<Move>(move), name}, name);
+#else
+        add_weighted_move(p, std::forward<Move>(move), name);
+#endif
+      }
+
+      // Add a move with its weight in move_weights (1 by default). A weight 0 disables the move.
+      template <typename Move> void add_weighted_move(params_t const &p, Move &&move, std::string const &name) {
+        double w = move_weight(p, name);
+        ALWAYS_EXPECTS((w >= 0), "Error : negative weight {} for the move {}", w, name);
+        if (w == 0) return;
+        if (not adaptive_moves and not timings and not sign_diagnostics) {
+          CTQMC.add_move(std::forward<Move>(move), name, w);
+          return;
+        }
+        move_names.push_back(name);
+        CTQMC.add_move(moves::instrumented<std::decay_t<Move>>{std::forward<Move>(move), &move_stats.emplace_back(),
+                                                        &CTQMC.get_rng()},
+                       name, w);
+      }
+
+      // Add a measure, collectable during the run if partial_results_file
+      template <typename Measure> void add_measure(Measure &&measure, std::string const &name) {
+        if (dumps)
+          add_timed_measure(measures::collectable<std::decay_t<Measure>>{std::forward<Measure>(measure), &partial},
+                            name);
+        else
+          add_timed_measure(std::forward<Measure>(measure), name);
+      }
+
+      // Add a measure, with its timing if measure_timings
+      template <typename Measure> void add_timed_measure(Measure &&measure, std::string const &name) {
+        if (not timings) {
+          CTQMC.add_measure(std::forward<Measure>(measure), name);
+          return;
+        }
+        measure_names.push_back(name);
+        CTQMC.add_measure(measures::timed<std::decay_t<Measure>>{std::forward<Measure>(measure),
+                                                                 &measure_stats.emplace_back()},
+                          name);
+      }
+
+      // A probe for a target error bar, or null if there is no target (negative tolerance)
+      measures::precision_probe_t *add_probe(double tolerance, std::string name) {
+        if (tolerance < 0) return nullptr;
+        return &probes.emplace_back(measures::precision_probe_t{std::move(name), tolerance});
+      }
+
+      // Initialize measurements
+      void add_measures(params_t const &p, bool measure_weight, std::string const &stream_file) {
+        ALWAYS_EXPECTS((p.target_densities_error < 0 or p.measure_densities),
+                       "Error : target_densities_error needs measure_densities");
+        ALWAYS_EXPECTS((p.target_G_tau_error < 0 or p.measure_G_tau), "Error : target_G_tau_error needs measure_G_tau");
+        ALWAYS_EXPECTS((p.target_average_sign_error < 0 or p.measure_average_sign),
+                       "Error : target_average_sign_error needs measure_average_sign");
+
+        if (p.measure_G_tau or p.measure_G_l or p.measure_G_iw)
+          add_measure(measures::interval{measures::G_F_tau{p, wdata, config, results, &fprefactors,
+                                                           add_probe(p.target_G_tau_error, "G(tau)")},
+                                         p.measure_G_tau_every, &min_interval},
+                      "G(tau)/F(tau)");
+        if (p.measure_densities)
+          add_measure(measures::densities{p, wdata, config, results, add_probe(p.target_densities_error, "Densities")},
+                      "Densities");
+        if (p.measure_average_sign)
+          add_measure(measures::average_sign{p, wdata, config, results,
+                                             add_probe(p.target_average_sign_error, "Average sign")},
+                      "Average Sign");
+        if (p.measure_sign_diagnostics)
+          add_measure(measures::sign_diagnostics{p, wdata, config, results}, "Sign diagnostics");
+        if (p.measure_nn_static)
+          add_measure(measures::interval{measures::nn_static{p, wdata, config, results},
+                                         p.measure_nn_static_every, &min_interval},
+                      "<nn>");
+        if (p.measure_nn_tau)
+          add_measure(measures::interval{measures::nn_tau{p, wdata, config, results}, p.measure_nn_tau_every,
+                                         &min_interval},
+                      "<n(tau)n(0)>");
+        if (p.measure_Sperp_tau)
+          add_measure(measures::interval{measures::Sperp_tau{p, wdata, config, results},
+                                         p.measure_Sperp_tau_every, &min_interval},
+                      "<S_x(tau)S_x(0)>");
+        if (p.measure_G2_iw)
+          add_measure(measures::interval{measures::G2_iw{p, wdata, config, results, &fprefactors},
+                                         p.measure_G2_iw_every, &min_interval},
+                      "G2(iw)");
+        if (p.measure_pert_order) {
+          if (wdata.model->has_Delta) {
+            add_measure(measures::pert_order{[this]() { return config.Delta_order(); }, results.pert_order_Delta,
+                                             results.average_order_Delta},
+                        "Perturbation order Delta");
+          }
+          if (wdata.model->has_Jperp) {
+            add_measure(measures::pert_order{[this]() { return config.Jperp_order(); }, results.pert_order_Jperp,
+                                             results.average_order_Jperp},
+                        "Perturbation order Jperp");
+          }
+        }
+        if (p.measure_state_hist)
+          add_measure(measures::state_hist{p, wdata, config, results}, "State histograms");
+
+        // Not collectable (partial_results_file) : its collect_results only writes the pending records
+        if (not stream_file.empty())
+          add_timed_measure(measures::sample_stream{p, config, stream_file}, "Sample stream");
+
+        // Weight of the chain, only needed to merge several chains
+        if (measure_weight) add_measure(chain_weight{Z, N}, "Chain weight");
+      }
+
+      // End of the warmup : set min_interval from the autocorrelation time of the order (measure_interval_auto),
+      // freeze the attempt probabilities of the moves (adaptive_move_weights) and reset their statistics
+      void finish_warmup() {
+        in_warmup = false;
+        if (adaptive_moves) {
+          // A move and its inverse in the same group
+          auto groups = std::vector<std::vector<moves::move_stats_t *>>{};
+          auto group  = std::map<std::string, long>{};
+          for (auto k : range(move_names.size())) {
+            auto it = group.find(inverse_move(move_names[k]));
+            if (it == group.end()) {
+              group[move_names[k]] = long(groups.size());
+              groups.push_back({&move_stats[k]});
+            } else
+              groups[it->second].push_back(&move_stats[k]);
+          }
+          moves::tune_attempt_probabilities(groups, min_attempt_probability);
+          if (verbosity > 0)
+            for (auto k : range(move_names.size()))
+              spdlog::info("Move {}: attempt probability {:.3f}", move_names[k], move_stats[k].attempt_probability);
+        }
+        // Only the accumulation is reported by measure_timings and measure_sign_diagnostics
+        for (auto &s : move_stats) {
+          s.n_attempted = s.n_zero_ratio = s.n_accepted = s.n_sign_changes = s.time = 0;
+          s.recording                                                             = timings or sign_diagnostics;
+        }
+        if (not interval_auto) return;
+        double tau_int = measures::integrated_autocorrelation_time(warmup_orders);
+        min_interval   = std::max(1l, std::lround(2 * tau_int));
+        if (verbosity > 0)
+          spdlog::info("Autocorrelation time of the order: {:.2f} cycles. Expensive measures every {} cycles",
+                       tau_int, min_interval);
+        warmup_orders.clear();
+      }
+
+      // The moves and measures keep references to the members
+      chain_t(chain_t const &)            = delete;
+      chain_t &operator=(chain_t const &) = delete;
+    };
+
+  } // namespace
+
   // ---------------------------------------------------------------------------
 
   solver_core::solver_core(constr_params_t const &p) : constr_params(p) {
@@ -63,73 +476,324 @@ namespace triqs_ctseg {
     // Merge constr_params and solve_params
     params_t p(constr_params, solve_params);
 
-    // ................   Work data & Configuration  ...................
+    // Delta(tau) given by its poles: its values on the mesh, for the checks of the model, the warm start and
+    // the results
+    if (not p.Delta_pole_energies.empty())
+      for (auto bl : range(inputs.Delta.size())) {
+        auto table = Delta_pole_table(p, bl);
+        long size  = p.gf_struct[bl].second;
+        for (auto t : inputs.Delta[bl].mesh())
+          for (auto i : range(size))
+            for (auto j : range(size)) inputs.Delta[bl][t](i, j) = table(tau_t{double(t)}, i, j);
+      }
 
-    // Initialize work data
-    work_data_t wdata{p, inputs, c};
-    // Initialize configuration
-    configuration_t config{wdata.n_color};
-    // Start from a non-empty configuration when Delta(tau) = 0
-    if (not wdata.has_Delta) { config.seglists[0].push_back(segment_t::full_line()); }
+    // ................   Markov chains  ...................
 
-    // ................   QMC  ...................
+    int n_chains = p.n_threads;
+    ALWAYS_EXPECTS((n_chains >= 1), "Error : n_threads must be positive, got {}", n_chains);
 
-    auto CTQMC = triqs::mc_tools::mc_generic<double>(p.random_name, p.random_seed, p.verbosity);
+    // Initialize the model, shared by all chains.
+    // For a warm start, only the hybridization is recomputed, and the warmup is shortened.
+    bool warm = p.warm_start and last_model and last_configuration
+       and same_interactions(*last_model_params, last_model_inputs, solve_params, inputs);
+    std::shared_ptr<model_t const> model;
+    if (warm) {
+      model             = std::make_shared<model_t const>(*last_model, p, inputs, c);
+      double x          = relative_change(last_model_inputs.Delta, inputs.Delta);
+      p.n_warmup_cycles = int(std::lround(std::clamp(x, p.warm_start_warmup_fraction, 1.0) * p.n_warmup_cycles));
+      if (c.rank() == 0) spdlog::info("Warm start: interactions reused, {} warmup cycles", p.n_warmup_cycles);
+    } else
+      model = std::make_shared<model_t const>(p, inputs, c);
+    last_model        = model;
+    last_model_params = solve_params;
+    last_model_inputs = inputs;
+
+    // Replica exchange : each rank runs the model of its replica
+    std::unique_ptr<replica_exchange_t> rex;
+    if (not p.replica_U_scaling.empty() or not p.replica_mu_shift.empty()) {
+      rex   = std::make_unique<replica_exchange_t>(p, c, *model);
+      model = rex->make_model(model);
+    }
 
-    // Initialize moves
-    if (wdata.has_Delta) {
-      if (p.move_insert_segment) CTQMC.add_move(moves::insert_segment{wdata, config, CTQMC.get_rng()}, "insert");
-      if (p.move_remove_segment) CTQMC.add_move(moves::remove_segment{wdata, config, CTQMC.get_rng()}, "remove");
-      if (p.move_move_segment) CTQMC.add_move(moves::move_segment{wdata, config, CTQMC.get_rng()}, "move");
-      if (p.move_split_segment) CTQMC.add_move(moves::split_segment{wdata, config, CTQMC.get_rng()}, "split");
-      if (p.move_regroup_segment) CTQMC.add_move(moves::regroup_segment{wdata, config, CTQMC.get_rng()}, "regroup");
+    // Configuration to start from, if any. It must be reachable by the moves of the new model.
+    configuration_t const *initial_config = nullptr;
+    if ((p.start_from_last_configuration or warm) and last_configuration) {
+      auto const &cfg = *last_configuration;
+      if (cfg.n_color() == model->n_color and (model->has_Delta or cfg.n_hybridized_operators() == 0)
+          and (model->has_Jperp or cfg.Jperp_order() == 0))
+        initial_config = &cfg;
+      else if (c.rank() == 0)
+        spdlog::warn("The last configuration is not compatible with the model, starting from an empty configuration");
     }
 
-    if (wdata.has_Jperp) {
-      if (p.move_insert_spin_segment)
-        CTQMC.add_move(moves::insert_spin_segment{wdata, config, CTQMC.get_rng()}, "spin insert");
+    // random_name = "xoshiro256++" : the chains use the streams rank * n_chains + k of the seed of rank 0 (see rng_t)
+    int stream_seed = p.random_seed;
+    mpi::broadcast(stream_seed, c);
 
-      if (p.move_remove_spin_segment)
-        CTQMC.add_move(moves::remove_spin_segment{wdata, config, CTQMC.get_rng()}, "spin remove");
+    std::vector<std::unique_ptr<chain_t>> chains;
+    for (auto k : range(n_chains)) {
+      // Chain 0 has the seed and verbosity of the single-chain run. The seeds of the other chains are offset
+      // so that they do not collide with the default seeds of the other MPI ranks. The offset is computed in 64 bits
+      // unsigned (no overflow for many ranks and threads), then reduced to the non-negative int seeds of mc_generic.
+      uint64_t offset = uint64_t{928374} * uint64_t(c.size()) * uint64_t(k);
+      int seed        = (k == 0) ? p.random_seed : int((uint32_t(p.random_seed) + offset) % (uint64_t{1} << 31));
+      int verbosity   = (k == 0) ? p.verbosity : 0;
+      auto stream     = std::string{}; // File of the records of the chain (sample_stream_file)
+      if (not p.sample_stream_file.empty()) stream = fmt::format("{}_{}_{}.h5", p.sample_stream_file, c.rank(), k);
+      chains.push_back(std::make_unique<chain_t>(model, p, seed, stream_seed, c.rank() * n_chains + k, verbosity,
+                                                 n_chains > 1, stream, initial_config, rex.get()));
     }
+    if (n_chains > 1 and c.rank() == 0) spdlog::info("Running {} Markov chains per MPI rank", n_chains);
 
-    if (wdata.has_Jperp and wdata.has_Delta) {
-      if (p.move_split_spin_segment)
-        CTQMC.add_move(moves::split_spin_segment{wdata, config, CTQMC.get_rng()}, "spin split");
+    // Run f on all the chains, in parallel threads if there are several of them.
+    // The TRIQS signal handler is process-global and not thread safe, and mc_generic starts, polls and stops it in
+    // each chain. With several threads, the stop signals are blocked in this thread and in the chains (which inherit
+    // its mask) while they run: the handler never receives them, whatever the chains do with it, and a chain stopping
+    // it does not let a signal kill the process. This thread takes them from the pending signals and forwards them to
+    // the chains through interrupted, checked by their stop callback. The handler is started by this thread before
+    // the chains, so that their start() is a no-op.
+    auto interrupted = std::atomic<bool>{false};
+    auto run_all     = [&](auto const &f) {
+      if (n_chains == 1)
+        f(*chains[0]);
+      else {
+        auto signals  = stop_signal_set();
+        auto old_mask = sigset_t{};
+        pthread_sigmask(SIG_BLOCK, &signals, &old_mask);
+        triqs::signal_handler::start();
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(n_chains);
+        auto n_running = std::atomic<int>{n_chains};
+        for (auto k : range(n_chains))
+          threads.emplace_back([&, k]() {
+            try {
+              f(*chains[k]);
+            } catch (...) { errors[k] = std::current_exception(); }
+            --n_running;
+          });
+        while (n_running > 0) {
+          if (int sig = take_pending_stop_signal(); sig != 0) {
+            spdlog::warn("Received signal {}: stopping the chains", sig);
+            interrupted = true;
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        for (auto &t : threads) t.join();
+        triqs::signal_handler::stop();
+        pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+        for (auto &e : errors)
+          if (e) std::rethrow_exception(e);
+      }
+    };
+
+    // Target error bars and partial results : the accumulation is done by chunks
+    bool has_targets = not chains[0]->probes.empty();
+    bool dumps       = not p.partial_results_file.empty();
+    ALWAYS_EXPECTS((not has_targets or not rex),
+                   "Error : the target error bars are not supported with replica exchange");
+    ALWAYS_EXPECTS((not dumps or not rex), "Error : partial_results_file is not supported with replica exchange");
+    ALWAYS_EXPECTS((p.target_check_interval > 0), "Error : target_check_interval must be positive, got {}",
+                   p.target_check_interval);
+    ALWAYS_EXPECTS((p.partial_results_interval > 0), "Error : partial_results_interval must be positive, got {}",
+                   p.partial_results_interval);
+    bool chunked = has_targets or dumps;
+
+    long n_warmup_done = p.n_warmup_cycles;
+    auto clock         = triqs::utility::clock_callback(p.max_time);
+    auto stop          = [&clock, &interrupted]() -> bool { return interrupted or clock(); }; // Shared by the chains
+    auto stopped       = std::atomic<bool>{false}; // The stop callback (max_time or a signal) was triggered
+
+    // Collect the results of each chain over the MPI ranks (of the physical replica), then merge the chains.
+    // The results of a partial collect are copied: the measures write the next ones in place (e.g. nn_tau).
+    auto collect = [&]() {
+      std::vector<results_t> chain_results;
+      std::vector<double> Z, N;
+      for (auto &ch : chains) {
+        ch->CTQMC.collect_results(rex ? rex->communicator() : c);
+        if (ch->partial)
+          chain_results.push_back(ch->results);
+        else
+          chain_results.push_back(std::move(ch->results));
+        Z.push_back(ch->Z);
+        N.push_back(ch->N);
+      }
+      auto res                 = merge_results(chain_results, Z, N);
+      res.n_warmup_cycles_done = n_warmup_done;
+      return res;
+    };
+
+    // Write the partial results after n_done cycles to partial_results_file, in a background thread of rank 0.
+    // The file is written under a temporary name, then renamed : it is always complete.
+    std::thread writer;
+    auto dump = [&](long n_done) {
+      for (auto &ch : chains) ch->partial = true;
+      auto res = collect();
+      for (auto &ch : chains) ch->partial = false;
+      if (c.rank() != 0) return;
+      if (writer.joinable()) writer.join();
+      auto write = [res = std::move(res), config = chains[0]->config, file = p.partial_results_file, n_done]() {
+        try {
+          auto lock = std::lock_guard{measures::h5_mutex};
+          {
+            auto f = h5::file(file + ".tmp", 'w');
+            auto g = h5::group(f);
+            h5_write(g, "results", res);
+            h5_write(g, "configuration", config);
+            h5_write(g, "n_cycles_done", n_done);
+          }
+          std::rename((file + ".tmp").c_str(), file.c_str());
+        } catch (std::exception const &e) { spdlog::warn("Partial results not written to {}: {}", file, e.what()); }
+      };
+      writer = std::thread(std::move(write));
+    };
 
-      if (p.move_regroup_spin_segment)
-        CTQMC.add_move(moves::regroup_spin_segment{wdata, config, CTQMC.get_rng()}, "spin regroup");
+    // Run
+    if (not p.adaptive_warmup and not chunked)
+      run_all(
+         [&](chain_t &ch) { ch.CTQMC.warmup_and_accumulate(p.n_warmup_cycles, p.n_cycles, p.length_cycle, stop); });
+    else if (not p.adaptive_warmup)
+      run_all([&](chain_t &ch) {
+        if (ch.CTQMC.warmup(p.n_warmup_cycles, p.length_cycle, stop) != 0) stopped = true;
+      });
+    else {
+      // Warmup by chunks of warmup_check_interval cycles, until the averages over a chunk (over all chains and
+      // ranks) of the perturbation orders and of the sign agree with those of the previous chunk within
+      // warmup_tolerance, with at least n_warmup_cycles_min and at most n_warmup_cycles cycles.
+      auto previous = nda::vector<double>{};
+      n_warmup_done = 0;
+      while (n_warmup_done < p.n_warmup_cycles and not stopped) {
+        long n = std::min<long>(p.warmup_check_interval, p.n_warmup_cycles - n_warmup_done);
+        run_all([&](chain_t &ch) {
+          ch.chunk_sums() = 0;
+          if (ch.CTQMC.warmup(n, p.length_cycle, stop) != 0) stopped = true;
+        });
+        n_warmup_done += n;
+        // All the ranks leave the loop together (max_time may be reached on some ranks only)
+        if (mpi::all_reduce(int(stopped.load()), c) > 0) {
+          stopped = true;
+          break;
+        }
+
+        nda::vector<double> sums = nda::zeros<double>(4);
+        for (auto &ch : chains) sums += ch->chunk_sums;
+        sums           = mpi::all_reduce(sums, c);
+        auto current   = nda::vector<double>{sums(range(3)) / sums(3)};
+        bool converged = (previous.size() == 3);
+        for (int i = 0; i < 3 and converged; ++i)
+          converged = std::abs(current(i) - previous(i)) <= p.warmup_tolerance * std::max(std::abs(previous(i)), 1.0);
+        if (converged and n_warmup_done >= p.n_warmup_cycles_min) break;
+        previous = current;
+      }
+      if (c.rank() == 0) spdlog::info("Adaptive warmup: {} cycles", n_warmup_done);
+      for (auto &ch : chains) ch->finish_warmup();
     }
 
-    if (wdata.has_Jperp) {
-      if (p.move_swap_spin_lines) CTQMC.add_move(moves::swap_spin_lines{wdata, config, CTQMC.get_rng()}, "spin swap");
+    // The accumulation by chunks is collective: all the ranks must agree on whether the warmup was stopped (max_time)
+    if (p.adaptive_warmup or chunked) stopped = (mpi::all_reduce(int(stopped.load()), c) > 0);
+    if ((p.adaptive_warmup or chunked) and not stopped) {
+      if (not chunked)
+        run_all([&](chain_t &ch) { ch.CTQMC.accumulate(p.n_cycles, p.length_cycle, stop); });
+      else {
+        // Accumulate by chunks of target_check_interval cycles (targets) and/or partial_results_interval cycles
+        // (partial results), until the error bars of the probes (over all the chains and ranks) are below their
+        // targets, with at most n_cycles cycles.
+        auto probes = std::vector<std::deque<measures::precision_probe_t> const *>{};
+        for (auto &ch : chains) probes.push_back(&ch->probes);
+        long chunk = has_targets ? p.target_check_interval : p.partial_results_interval;
+        if (has_targets and dumps) chunk = std::min(p.target_check_interval, p.partial_results_interval);
+        long n_done = 0, next_dump = p.partial_results_interval;
+        while (n_done < p.n_cycles) {
+          long n = std::min<long>(chunk, p.n_cycles - n_done);
+          run_all([&](chain_t &ch) {
+            if (ch.CTQMC.accumulate(n, p.length_cycle, stop) != 0) stopped = true;
+          });
+          n_done += n;
+          // All the ranks leave the loop together
+          if (mpi::all_reduce(int(stopped.load()), c) > 0) break;
+          if (has_targets and measures::max_relative_error(probes, c) <= 1) {
+            if (c.rank() == 0) spdlog::info("Target error bars reached after {} cycles", n_done);
+            break;
+          }
+          if (dumps and n_done >= next_dump and n_done < p.n_cycles) {
+            dump(n_done);
+            next_dump += p.partial_results_interval;
+          }
+        }
+      }
     }
+    if (writer.joinable()) writer.join();
 
-    // Initialize measurements
-    if (p.measure_G_tau) CTQMC.add_measure(measures::G_F_tau{p, wdata, config, results}, "G(tau)/F(tau)");
-    if (p.measure_densities) CTQMC.add_measure(measures::densities{p, wdata, config, results}, "Densities");
-    if (p.measure_average_sign) CTQMC.add_measure(measures::average_sign{p, wdata, config, results}, "Average Sign");
-    if (p.measure_nn_static) CTQMC.add_measure(measures::nn_static{p, wdata, config, results}, "<nn>");
-    if (p.measure_nn_tau) CTQMC.add_measure(measures::nn_tau{p, wdata, config, results}, "<n(tau)n(0)>");
-    if (p.measure_Sperp_tau) CTQMC.add_measure(measures::Sperp_tau{p, wdata, config, results}, "<S_x(tau)S_x(0)>");
-    if (p.measure_pert_order) {
-      if (wdata.has_Delta) {
-        CTQMC.add_measure(measures::pert_order{[&]() { return config.Delta_order(); }, results.pert_order_Delta,
-                                               results.average_order_Delta},
-                          "Perturbation order Delta");
+    results = collect();
+
+    // Statistics of the moves and measures, summed over the chains and the MPI ranks (of the physical replica)
+    if (p.measure_timings) {
+      auto moves_t = std::map<std::string, nda::vector<double>>{}, measures_t = moves_t;
+      for (auto &ch : chains) {
+        for (auto k : range(ch->move_names.size())) {
+          auto const &s = ch->move_stats[k];
+          auto &v       = moves_t.try_emplace(ch->move_names[k], nda::zeros<double>(4)).first->second;
+          v += nda::vector<double>{s.n_attempted, s.n_zero_ratio, s.n_accepted, s.time};
+        }
+        for (auto k : range(ch->measure_names.size())) {
+          auto const &s = ch->measure_stats[k];
+          auto &v       = measures_t.try_emplace(ch->measure_names[k], nda::zeros<double>(2)).first->second;
+          v += nda::vector<double>{s.n_calls, s.time};
+        }
       }
-      if (wdata.has_Jperp) {
-        CTQMC.add_measure(measures::pert_order{[&]() { return config.Jperp_order(); }, results.pert_order_Jperp,
-                                               results.average_order_Jperp},
-                          "Perturbation order Jperp");
+      auto const &rc = rex ? rex->communicator() : c;
+      for (auto &[name, v] : moves_t) v = mpi::all_reduce(v, rc);
+      for (auto &[name, v] : measures_t) v = mpi::all_reduce(v, rc);
+      if (c.rank() == 0) {
+        for (auto const &[name, v] : moves_t)
+          spdlog::info("Move {}: {} attempted ({} with zero ratio), {} accepted, {:.3f} s", name, v(0), v(1), v(2),
+                       v(3));
+        for (auto const &[name, v] : measures_t) spdlog::info("Measure {}: {} calls, {:.3f} s", name, v(0), v(1));
       }
+      results.move_timings    = std::move(moves_t);
+      results.measure_timings = std::move(measures_t);
     }
-    if (p.measure_state_hist) CTQMC.add_measure(measures::state_hist{p, wdata, config, results}, "State histograms");
 
-    // Run and collect results
-    CTQMC.warmup_and_accumulate(p.n_warmup_cycles, p.n_cycles, p.length_cycle,
-                                triqs::utility::clock_callback(p.max_time));
-    CTQMC.collect_results(c);
+    // Sign changes of the moves, summed over the chains and the MPI ranks (of the physical replica)
+    if (p.measure_sign_diagnostics) {
+      auto changes = std::map<std::string, nda::vector<double>>{};
+      for (auto &ch : chains)
+        for (auto k : range(ch->move_names.size())) {
+          auto const &s = ch->move_stats[k];
+          auto &v       = changes.try_emplace(ch->move_names[k], nda::zeros<double>(2)).first->second;
+          v += nda::vector<double>{s.n_accepted, s.n_sign_changes};
+        }
+      auto const &rc = rex ? rex->communicator() : c;
+      for (auto &[name, v] : changes) v = mpi::all_reduce(v, rc);
+      results.move_sign_changes = std::move(changes);
+    }
+
+    // Statistics of the precision checks of the dets, over the chains and the MPI ranks (of the physical replica)
+    if (p.det_adaptive_check) {
+      auto checks    = std::map<std::string, nda::vector<double>>{};
+      auto const &rc = rex ? rex->communicator() : c;
+      for (auto [bl, block] : itertools::enumerate(p.gf_struct)) {
+        double n = 0, err = 0;
+        for (auto &ch : chains) {
+          n += double(ch->wdata.det_checks[bl].n_checks);
+          err = std::max(err, ch->wdata.det_checks[bl].max_error);
+        }
+        checks[block.first] = {mpi::all_reduce(n, rc), mpi::all_reduce(err, rc, MPI_MAX)};
+      }
+      results.det_precision_checks = std::move(checks);
+    }
+
+    // Keep the final configuration, to restart from it
+    last_configuration = chains[0]->config;
+    if (rex) rex->report();
+
+    // Free the shared-memory windows of the tables not used any more (e.g. of the previous model), collectively.
+    // The chains hold references to the model: they are destroyed first.
+    chains.clear();
+    shared_memory_t::free_released_windows();
+
+    // Profile of the hot paths of this rank (CTSEG_TRACE)
+    trace::write_profile(fmt::format("ctseg_profile_{}", c.rank()));
+    trace::reset();
 
     // Report sign and average order
     if (c.rank() == 0) {
@@ -142,6 +806,18 @@ namespace triqs_ctseg {
 
   } // solve
 
+  // ----------------- Views of the results -----------------------
+
+  block_gf_view<imtime> solver_core::F_tau_view() {
+    ALWAYS_EXPECTS((results.F_tau.has_value()), "Error : F_tau was not measured (measure_F_tau)");
+    return *results.F_tau;
+  }
+
+  block2_gf_view<imtime> solver_core::nn_tau_view() {
+    ALWAYS_EXPECTS((results.nn_tau.has_value()), "Error : nn_tau was not measured (measure_nn_tau)");
+    return *results.nn_tau;
+  }
+
   // ----------------- Save to h5 file -----------------------
 
 #define STR(x) #x
@@ -157,6 +833,7 @@ namespace triqs_ctseg {
     h5_write(grp, "solve_params", s.solve_params);
     h5_write(grp, "inputs", s.inputs);
     h5_write(grp, "results", s.results);
+    if (s.last_configuration) h5_write(grp, "configuration", *s.last_configuration);
   }
 
   // Function that reads all containers in hdf5 file
@@ -167,6 +844,11 @@ namespace triqs_ctseg {
     h5_read(grp, "solve_params", s.solve_params);
     h5_read(grp, "inputs", s.inputs);
     h5_read(grp, "results", s.results);
+    if (grp.has_subgroup("configuration")) {
+      auto config = configuration_t{0};
+      h5_read(grp, "configuration", config);
+      s.last_configuration = std::move(config);
+    }
     return s;
   }
 
@@ -20,6 +20,7 @@
 #include <optional>
 #include "params.hpp"
 #include "work_data.hpp"
+#include "configuration.hpp"
 #include "inputs.hpp"
 #include "results.hpp"
 
@@ -37,6 +38,15 @@ namespace triqs_ctseg {
     // mpi communicator
     mpi::communicator c;
 
+    // Configuration of the (first) Markov chain of this MPI rank at the end of the last solve,
+    // see solve_params_t::start_from_last_configuration
+    std::optional<configuration_t> last_configuration;
+
+    // Model of the last solve, with the parameters and inputs it was built from, see solve_params_t::warm_start
+    std::shared_ptr<model_t const> last_model;
+    std::optional<solve_params_t> last_model_params;
+    inputs_t last_model_inputs;
+
     public:
     /**Set of parameters used in the construction of the ``solver_core`` class.
   *
@@ -72,6 +82,19 @@ namespace triqs_ctseg {
     /// Dynamical density-density interaction :math:`D_0(\tau)`
     block2_gf_view<imtime> D0_tau() { return inputs.D0t; }
 
+    // Views of the largest results, without the copy of the whole results_t made by each access to results in Python.
+    // They are invalidated by the next solve.
+
+    /// View of the measured :math:`G(\tau)` (``results.G_tau``), without copy. Invalidated by the next solve
+    block_gf_view<imtime> G_tau_view() { return results.G_tau; }
+
+    /// View of the measured :math:`F(\tau)` (``results.F_tau``), without copy. Invalidated by the next solve
+    block_gf_view<imtime> F_tau_view();
+
+    /// View of the measured :math:`\langle n_a(\tau) n_b(0) \rangle` (``results.nn_tau``), without copy.
+    /// Invalidated by the next solve
+    block2_gf_view<imtime> nn_tau_view();
+
     // --------------- h5 -------------------------
     CPP2PY_IGNORE static std::string hdf5_format() { return "CTSEG_SolverCore"; }
     friend void h5_write(h5::group h5group, std::string subgroup_name, solver_core const &s);
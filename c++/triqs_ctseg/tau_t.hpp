@@ -71,6 +71,9 @@ namespace triqs_ctseg {
     auto operator<=>(tau_t const &tau) const { return n <=> tau.n; }
     bool operator==(tau_t const &tau) const { return n == tau.n; }
 
+    /// Position on the integer grid. Not for users, used by the fast kernel evaluations
+    [[nodiscard]] uint64_t integer() const { return n; }
+
     /// To cast to double, but it has to be done explicitly.
     explicit operator double() const { return _beta * (double(n) / double(n_max)); }
 
@@ -0,0 +1,169 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include "./tracing.hpp"
+
+#ifdef CTSEG_TRACE
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+namespace triqs_ctseg::trace {
+
+  namespace {
+
+    // A node of the call tree: a region, entered from the region of the parent node
+    struct node_t {
+      int region = -1, parent = -1;
+      long n_calls = 0, time = 0;
+      std::vector<int> children;
+    };
+
+    // The call tree of a thread. nodes[0] is the root, current the node of the region being executed.
+    struct tree_t {
+      std::vector<node_t> nodes = std::vector<node_t>(1);
+      int current               = 0;
+    };
+
+    // Registered regions and call trees of all threads (alive or not). The trees of the finished threads are reused
+    // by the next new threads (e.g. the chains of the next run_all): their number is bounded by the number of threads
+    // alive at the same time, not by the number of threads created during the solves.
+    std::mutex mutex;
+    std::vector<std::string> region_names;
+    std::map<std::string, int> region_ids;
+    std::vector<std::shared_ptr<tree_t>> trees;
+    std::vector<tree_t *> free_trees;
+
+    // Puts the tree of the thread back in free_trees when the thread exits
+    struct release_t {
+      tree_t *tree = nullptr;
+      ~release_t() {
+        auto lock = std::lock_guard{mutex};
+        free_trees.push_back(tree);
+      }
+    };
+
+    // Tree for a new thread: a free one, or a new one
+    tree_t *acquire_tree() {
+      thread_local release_t release;
+      auto lock = std::lock_guard{mutex};
+      if (free_trees.empty()) {
+        release.tree = trees.emplace_back(std::make_shared<tree_t>()).get();
+      } else {
+        release.tree = free_trees.back();
+        free_trees.pop_back();
+      }
+      return release.tree;
+    }
+
+    // Call tree of the current thread, acquired at its first use
+    tree_t &local_tree() {
+      thread_local tree_t *t = nullptr;
+      if (t == nullptr) t = acquire_tree();
+      return *t;
+    }
+
+    // Child of node i for region id, created if needed
+    int child(tree_t &t, int i, int id) {
+      for (int k : t.nodes[i].children)
+        if (t.nodes[k].region == id) return k;
+      int k = int(t.nodes.size());
+      t.nodes.push_back(node_t{id, i, 0, 0, {}});
+      t.nodes[i].children.push_back(k);
+      return k;
+    }
+
+    // Add the subtree of node i of t to node j of res
+    void merge(tree_t &res, int j, tree_t const &t, int i) {
+      res.nodes[j].n_calls += t.nodes[i].n_calls;
+      res.nodes[j].time += t.nodes[i].time;
+      for (int k : t.nodes[i].children) merge(res, child(res, j, t.nodes[k].region), t, k);
+    }
+
+    // Write the subtree of node i as JSON
+    void write_json(std::ostream &out, tree_t const &t, int i) {
+      auto const &n = t.nodes[i];
+      out << "{\"name\":\"" << (i == 0 ? std::string{"root"} : region_names[n.region]) << "\",\"calls\":" << n.n_calls
+          << ",\"time_ns\":" << n.time << ",\"children\":[";
+      for (bool first = true; int k : n.children) {
+        if (not first) out << ',';
+        write_json(out, t, k);
+        first = false;
+      }
+      out << "]}";
+    }
+
+    // Write the self times of the subtree of node i as folded stacks
+    void write_folded(std::ostream &out, tree_t const &t, int i, std::string const &stack) {
+      auto const &n = t.nodes[i];
+      long self     = n.time;
+      for (int k : n.children) {
+        self -= t.nodes[k].time;
+        write_folded(out, t, k, stack + ';' + region_names[t.nodes[k].region]);
+      }
+      if (i != 0 and self > 0) out << stack << ' ' << self << '\n';
+    }
+
+  } // namespace
+
+  int register_region(std::string const &name) {
+    auto lock     = std::lock_guard{mutex};
+    auto [it, ok] = region_ids.try_emplace(name, int(region_names.size()));
+    if (ok) region_names.push_back(name);
+    return it->second;
+  }
+
+  void enter(int id) {
+    auto &t   = local_tree();
+    t.current = child(t, t.current, id);
+  }
+
+  void leave(long n_calls, long time) {
+    auto &t = local_tree();
+    auto &n = t.nodes[t.current];
+    n.n_calls += n_calls;
+    n.time += time;
+    t.current = n.parent;
+  }
+
+  void write_profile(std::string const &filename) {
+    auto lock = std::lock_guard{mutex};
+    auto res  = tree_t{};
+    for (auto const &t : trees) merge(res, 0, *t, 0);
+    // The root has no time of its own: it is the sum of the top-level regions
+    for (int k : res.nodes[0].children) res.nodes[0].time += res.nodes[k].time;
+    auto json = std::ofstream{filename + ".json"};
+    write_json(json, res, 0);
+    json << '\n';
+    auto folded = std::ofstream{filename + ".folded"};
+    write_folded(folded, res, 0, "root");
+  }
+
+  void reset() {
+    auto lock = std::lock_guard{mutex};
+    for (auto &t : trees)
+      for (auto &n : t->nodes) n.n_calls = n.time = 0;
+    // The trees of the finished threads are not in use: drop their nodes
+    for (auto *t : free_trees) *t = tree_t{};
+  }
+
+} // namespace triqs_ctseg::trace
+
+#endif
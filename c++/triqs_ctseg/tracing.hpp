@@ -0,0 +1,121 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#pragma once
+#include <string>
+#ifdef CTSEG_TRACE
+#include <chrono>
+#endif
+
+/**
+* Tracing of the hot paths (CMake option CTSEG_TRACE, off by default).
+*
+* CTSEG_TRACE_SCOPE(name) times the enclosing scope, CTSEG_TRACED(name, expr) the evaluation of expr, and
+* CTSEG_TRACE_COUNT(name, n) adds n to a counter. Each thread records the calls and time of the regions in a
+* call tree (a region entered from different regions has one node per caller), reused by the next new thread when
+* it exits. The name is only used to register the region once, in a static variable: no string is formatted or
+* compared on the hot path.
+* trace::write_profile writes the trees of all threads of the process, merged.
+*
+* Without CTSEG_TRACE, the macros expand to nothing (CTSEG_TRACED to expr) and the functions do nothing.
+*/
+
+namespace triqs_ctseg::trace {
+
+#ifdef CTSEG_TRACE
+
+  static constexpr bool enabled = true;
+
+  /// Id of the region name (the same for all calls with the same name)
+  int register_region(std::string const &name);
+
+  /// Enter the region id in the call tree of the current thread
+  void enter(int id);
+
+  /// Leave the current region, adding n_calls and time [ns] to it
+  void leave(long n_calls, long time);
+
+  /// Add n to the counter id, below the current region
+  inline void count(int id, long n) {
+    enter(id);
+    leave(n, 0);
+  }
+
+  /// Time a region from construction to destruction
+  class scope_t {
+    std::chrono::steady_clock::time_point start;
+
+    public:
+    explicit scope_t(int id) {
+      enter(id);
+      start = std::chrono::steady_clock::now();
+    }
+    ~scope_t() {
+      leave(1, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    scope_t(scope_t const &)            = delete;
+    scope_t &operator=(scope_t const &) = delete;
+  };
+
+  /**
+  * Write the profile of this process, i.e. the merged call trees of all threads, to
+  *
+  *   - filename.json: a tree of {"name", "calls", "time_ns", "children"},
+  *   - filename.folded: one line "root;region;subregion self_time_ns" per node, the input of flamegraph tools.
+  *
+  * Must not be called while other threads are recording.
+  */
+  void write_profile(std::string const &filename);
+
+  /// Reset the calls and times of all threads. Must not be called while other threads are recording.
+  void reset();
+
+#else
+
+  static constexpr bool enabled = false;
+
+  inline void write_profile(std::string const &) {}
+  inline void reset() {}
+
+#endif
+
+} // namespace triqs_ctseg::trace
+
+#ifdef CTSEG_TRACE
+#define CTSEG_TRACE_CONCAT_IMPL(a, b) a##b
+#define CTSEG_TRACE_CONCAT(a, b) CTSEG_TRACE_CONCAT_IMPL(a, b)
+#define CTSEG_TRACE_SCOPE(name)                                                                                        \
+  static int const CTSEG_TRACE_CONCAT(ctseg_trace_id_, __LINE__) = triqs_ctseg::trace::register_region(name);          \
+  triqs_ctseg::trace::scope_t CTSEG_TRACE_CONCAT(ctseg_trace_scope_, __LINE__) {                                       \
+    CTSEG_TRACE_CONCAT(ctseg_trace_id_, __LINE__)                                                                      \
+  }
+#define CTSEG_TRACE_COUNT(name, n)                                                                                     \
+  {                                                                                                                    \
+    static int const ctseg_trace_id = triqs_ctseg::trace::register_region(name);                                       \
+    triqs_ctseg::trace::count(ctseg_trace_id, n);                                                                      \
+  }
+#define CTSEG_TRACED(name, ...)                                                                                        \
+  [&]() -> decltype(auto) {                                                                                            \
+    CTSEG_TRACE_SCOPE(name);                                                                                           \
+    return __VA_ARGS__;                                                                                                \
+  }()
+
+#else
+#define CTSEG_TRACE_SCOPE(name)
+#define CTSEG_TRACE_COUNT(name, n)
+#define CTSEG_TRACED(name, ...) (__VA_ARGS__)
+#endif
@@ -16,230 +16,145 @@
 // Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
 
 #include "work_data.hpp"
-#include <nda/basic_functions.hpp>
-#include <nda/traits.hpp>
-#include <triqs/gfs/functions/functions2.hpp>
-#include <triqs/operators/util/extractors.hpp>
+#include "configuration.hpp"
 #include "logs.hpp"
-#include "spdlog/common.h"
-#include "spdlog/spdlog.h"
-
-using namespace triqs::operators::utils;
+#include "tracing.hpp"
 
 namespace triqs_ctseg {
 
   // Work data constructor
-  work_data_t::work_data_t(params_t const &p, inputs_t const &inputs, mpi::communicator c) {
-
-    // Set logger level
-    spdlog::set_pattern("%v");
-    spdlog::set_level(spdlog::level::info);
-    if constexpr (print_logs) spdlog::set_level(spdlog::level::debug);
-
-    // Copy data from inputs
-    double beta = p.beta;
-    gf_struct   = p.gf_struct;
-
-    // Count colors
-    n_color = 0;
-    for (auto const &[bl_name, bl_size] : gf_struct) { n_color += bl_size; }
-
-    // Compute color/block conversion tables
-    for (auto const &color : range(n_color)) {
-      block_number.push_back(find_block_number(color));
-      index_in_block.push_back(find_index_in_block(color));
-    }
+  work_data_t::work_data_t(std::shared_ptr<model_t const> model_, params_t const &p) : model{std::move(model_)} {
 
-    // Print block/index/color correspondence
-    if (c.rank() == 0) {
-      spdlog::info("\n");
-      for (auto const &color : range(n_color)) {
-        spdlog::info("Block: {}    Index: {}    Color: {}", gf_struct[block_number[color]].first, index_in_block[color],
-                     color);
-      }
+    // The determinants, with empty configurations
+    for (auto const &[bl, Delta_bl] : itertools::enumerate(model->Delta_table)) {
+      // Construct the detmanip object for block bl. By default, the initial capacity is small: det_manip
+      // doubles it when needed, and a fixed large capacity per block only costs memory and cache.
+      long init_size = (p.det_init_size > 0 ? p.det_init_size : 16 * model->gf_struct[bl].second);
+      dets.emplace_back(Delta_block_adaptor{Delta_bl}, init_size);
+      // Set parameters
+      dets.back().set_singular_threshold(p.det_singular_threshold);
+      // With det_adaptive_check, the checks of det_manip are replaced by check_det_precision
+      dets.back().set_n_operations_before_check(p.det_adaptive_check ? (1 << 30) : p.det_n_operations_before_check);
+      dets.back().set_precision_warning(p.det_precision_warning);
+      dets.back().set_precision_error(p.det_precision_error);
     }
 
-    // Extract color-dependent chemical potential from operator
-    mu          = nda::zeros<double>(n_color);
-    auto h_loc0 = dict_to_matrix(extract_h_dict(p.h_loc0), p.gf_struct);
-    for (auto const &col : range(n_color)) { mu(col) = -h_loc0(col, col); }
-
-    // .............. Interactions .................
-    // Extract the U from the operator
-    auto U_full = dict_to_matrix(extract_U_dict2(p.h_int), p.gf_struct);
-    U           = nda::matrix<double>{real(U_full)};
-    // We ensure that U(a, a) is 0, which must be true
-    for (int a = 0; a < U.extent(0); ++a)
-      ALWAYS_EXPECTS((abs(U(a, a)) < 1.e-15), "Error. A diagonal element of the interaction matrix is not 0.");
+    if (model->has_Dt) retarded_potential = retarded_potential_t{model->n_color};
+    if (p.det_adaptive_check) det_checks.resize(dets.size());
+    det_precision_warning = p.det_precision_warning;
+    det_precision_error   = p.det_precision_error;
+    early_rejection       = p.early_rejection;
+  } // work_data constructor
 
-    // Report
-    if (c.rank() == 0) {
-      spdlog::info("\n Interaction matrix: U = {} \n", U);
-      spdlog::info("Orbital energies: mu - eps = {} \n", mu);
-    }
+  // -------------------------------------
 
-    // Dynamical interactions: convert Block2Gf to matrix Gf of size n_colors
-    D0t = gf<imtime>({beta, Boson, p.n_tau_bosonic}, {n_color, n_color});
-    for (int c1 : range(n_color)) {
-      for (int c2 : range(n_color)) {
-        D0t.data()(range::all, c1, c2) =
-           inputs.D0t(block_number[c1], block_number[c2]).data()(range::all, index_in_block[c1], index_in_block[c2]);
+  void hybridized_operators(configuration_t const &config, model_t const &model, long bl,
+                            std::vector<std::pair<tau_t, int>> &x, std::vector<std::pair<tau_t, int>> &y) {
+    x.clear();
+    y.clear();
+    for (auto idx : range(model.gf_struct[bl].second))
+      for (auto const &seg : config.seglists[model.block_to_color(bl, idx)]) {
+        if (is_full_line(seg)) continue;
+        if (not seg.J_cdag) x.emplace_back(seg.tau_cdag, idx);
+        if (not seg.J_c) y.emplace_back(seg.tau_c, idx);
       }
-    }
-    // Symetrize
-    for (auto t : D0t.mesh()) D0t[t] = 0.5 * make_regular(D0t[t] + transpose(D0t[t]));
+    ALWAYS_EXPECTS((x.size() == y.size()), "Error : {} c and {} cdag hybridized in block {} of the configuration",
+                   y.size(), x.size(), bl);
+    auto by_time = [](auto const &u, auto const &v) { return u.first < v.first; };
+    std::sort(x.begin(), x.end(), by_time);
+    std::sort(y.begin(), y.end(), by_time);
+  }
 
-    // Do we have D(tau) and Jperp(tau)? Yes, unless the data is 0
-    has_Dt    = max_element(abs(D0t.data())) > 1.e-13;
-    has_Jperp = max_element(abs(inputs.Jperpt.data())) > 1.e-13;
+  // -------------------------------------
 
-    // Check: no Jperp implementation for more than 2 colors
-    if (n_color != 2) {
-      ALWAYS_EXPECTS((not has_Jperp), "Error : has_jperp is true and we have {} colors instead of 2", n_color);
+  double work_data_t::initialize_from(configuration_t const &config) {
+    double sign = 1;
+    std::vector<std::pair<tau_t, int>> x, y;
+    for (auto bl : range(dets.size())) {
+      auto &D = dets[bl];
+      hybridized_operators(config, *model, bl, x, y);
+      D.clear();
+      if (x.empty()) continue;
+      // Fill the matrix Delta(x_i, y_j) and invert it at once, with its full size reserved
+      D.reserve(x.size());
+      D.try_refill(x, y);
+      D.complete_operation();
+      double det = D.determinant();
+      ALWAYS_EXPECTS((std::isfinite(det) and det != 0), "Error : the det of block {} of the configuration is {}", bl,
+                     det);
+      if (det < 0) sign = -sign;
     }
+    current_trace_sign = trace_sign(*this);
+    if (model->has_Dt) retarded_potential.rebuild(config.seglists, model->K_table);
+    return sign * current_trace_sign;
+  }
 
-    // For numerical integration of the D0 and Jperp
-    auto ramp = nda::zeros<double>(p.n_tau_bosonic);
-    for (auto n : range(p.n_tau_bosonic)) { ramp(n) = n * beta / (p.n_tau_bosonic - 1); }
+  // -------------------------------------
 
-    // Dynamical interactions
-    if (has_Dt) {
-      // Compute interaction kernels K(tau), K'(tau) by integrating D(tau)
-      K      = gf<imtime>({beta, Boson, p.n_tau_bosonic}, {n_color, n_color});
-      Kprime = K;
-      for (auto c1 : range(n_color)) {
-        for (auto c2 : range(n_color)) {
-          nda::array<dcomplex, 1> D_data = D0t.data()(range::all, c1, c2);
-          auto first_integral            = nda::zeros<dcomplex>(p.n_tau_bosonic);
-          auto second_integral           = nda::zeros<dcomplex>(p.n_tau_bosonic);
-          // Trapezoidal integration
-          for (int i = 1; i < D_data.size(); ++i) {
-            first_integral(i)  = first_integral(i - 1) + (D_data(i) + D_data(i - 1)) / 2;
-            second_integral(i) = second_integral(i - 1) + (first_integral(i) + first_integral(i - 1)) / 2;
-          }
-          // Normalize by bin size
-          first_integral *= beta / (p.n_tau_bosonic - 1);
-          second_integral *= (beta / (p.n_tau_bosonic - 1)) * (beta / (p.n_tau_bosonic - 1));
-          // Enforce K(0) = K(beta) = 0
-          Kprime.data()(range::all, c1, c2) = first_integral - second_integral(p.n_tau_bosonic - 1) / beta;
-          K.data()(range::all, c1, c2)      = second_integral - ramp * second_integral(p.n_tau_bosonic - 1) / beta;
-          // Renormalize U and mu
-          if (c1 != c2) U(c1, c2) -= real(2 * Kprime.data()(0, c1, c2));
-        }
-        mu(c1) += real(Kprime.data()(0, c1, c1));
-      }
-    }
+  namespace {
 
-    // Jperp interactions
-    if (has_Jperp) {
-      Jperp = inputs.Jperpt;
-      if (not has_Dt)
-        rot_inv = false;
-      else {
-        Kprime_spin = gf<imtime>({beta, Boson, p.n_tau_bosonic}, {n_color, n_color}); // used in computation of F(tau)
-        // Integrate Jperp to obtain the S_z.S_z part of K'(tau) (called Kprime_spin)
-        auto Kprime_J                  = Jperp;
-        nda::array<dcomplex, 1> J_data = Jperp.data()(range::all, 0, 0);
-        auto first_integral            = nda::zeros<dcomplex>(p.n_tau_bosonic);
-        // Trapezoidal integration
-        for (int i = 1; i < J_data.size(); ++i) {
-          first_integral(i) = first_integral(i - 1) + (J_data(i) + J_data(i - 1)) / 2;
+    // max_ij |(M^-1 Delta)_ij - delta_ij| for the det D of Delta(tau), recomputed from its times: O(N^3)
+    double inverse_error(det_t const &D, kernel_table_t const &Delta) {
+      long N = D.size();
+      if (N == 0) return 0;
+      auto f    = Delta_block_adaptor{Delta};
+      auto M    = nda::matrix<double>(N, N);
+      auto Minv = nda::matrix<double>(N, N);
+      for (long i : range(N))
+        for (long j : range(N)) {
+          M(i, j)    = f(D.get_x(i), D.get_y(j));
+          Minv(i, j) = D.inverse_matrix(i, j);
         }
-        // Noramlize by bin size
-        first_integral *= beta / (p.n_tau_bosonic - 1);
-        // Enforce Kprime_J(beta/2) = 0
-        Kprime_J.data()(range::all, 0, 0) = first_integral - first_integral((p.n_tau_bosonic - 1) / 2);
-        // Kprime_spin = +/- Kprime_J depending on color
-        for (auto c1 : range(n_color)) {
-          for (auto c2 : range(n_color)) {
-            Kprime_spin.data()(range::all, c1, c2) = (c1 == c2 ? 1 : -1) * Kprime_J.data()(range::all, 0, 0) / 4;
-          }
-        }
-        auto Kprime_0 = gf<imtime>({beta, Boson, p.n_tau_bosonic}, {n_color, n_color});
-        Kprime_0      = Kprime - Kprime_spin;
-        // The "remainder" Kprime_0 must be color-independent for there to be rotational invariance
-        if (max_element(abs(Kprime_0.data()(range::all, 0, 0) - Kprime_0.data()(range::all, 0, 1))) > 1.e-13)
-          rot_inv = false;
-      }
+      auto P     = nda::matrix<double>(Minv * M);
+      double res = 0;
+      for (long i : range(N))
+        for (long j : range(N)) res = std::max(res, std::abs(P(i, j) - (i == j ? 1 : 0)));
+      return res;
     }
 
-    // Report
-    if (c.rank() == 0) {
-      spdlog::info("Dynamical interactions = {}, Jperp interactions = {} \n", has_Dt, has_Jperp);
-      if (p.measure_F_tau and !rot_inv)
-        spdlog::info("WARNING: Cannot measure F(tau) because spin-spin interaction is not rotationally invariant.");
-    }
+  } // namespace
 
-    // ................  Determinants .....................
-    // Is there a non-zero Delta(tau)?
-    for (auto const &bl : range(inputs.Delta.size())) {
-      if (max_element(abs(inputs.Delta[bl].data())) > 1.e-13) has_Delta = true;
-      // Report if Delta(tau) has imaginary part.
-      if (!is_gf_real(inputs.Delta[bl], 1e-10)) {
-        if (c.rank() == 0) {
-          spdlog::info("WARNING: The Delta(tau) block number {} is not real in tau space", bl);
-          spdlog::info("WARNING: max(Im[Delta(tau)]) = {}", max_element(abs(imag(inputs.Delta[bl].data()))));
-          spdlog::info("WARNING: Disregarding the imaginary component in the calculation.");
-        }
+  void work_data_t::check_det_precision(configuration_t const &config) {
+    constexpr long max_interval = 1024;
+    std::vector<std::pair<tau_t, int>> x, y;
+    for (auto bl : range(det_checks.size())) {
+      auto &chk = det_checks[bl];
+      if (--chk.countdown > 0) continue;
+      auto &D    = dets[bl];
+      double err = inverse_error(D, model->Delta_table[bl]);
+      chk.n_checks += 1;
+      chk.max_error = std::max(chk.max_error, err);
+      ALWAYS_EXPECTS((err < det_precision_error), "Error : the error of M^-1 of block {} is {} > det_precision_error",
+                     bl, err);
+      if (err > det_precision_warning) {
+        spdlog::warn("The error of M^-1 of block {} is {} > det_precision_warning: regenerating it", bl, err);
+        hybridized_operators(config, *model, bl, x, y);
+        D.try_refill(x, y);
+        D.complete_operation();
       }
+      // Back off while the error is far below the warning threshold, tighten when it gets closer
+      if (err < 1.e-3 * det_precision_warning)
+        chk.interval = std::min(2 * chk.interval, max_interval);
+      else if (err > 1.e-1 * det_precision_warning)
+        chk.interval = std::max(chk.interval / 2, 1l);
+      chk.countdown = chk.interval;
     }
-    if (not has_Delta) {
-      ALWAYS_EXPECTS(has_Jperp, "Error : both Jperp(tau) and Delta(tau) are 0: there is nothing to expand.");
-      if (c.rank() == 0) { spdlog::info("Delta(tau) is 0, running only spin moves."); }
-    }
-
-    // Does gf_struct allow for off-diagonal Delta?
-    for (auto const &[s, l] : gf_struct) {
-      if (l > 1) offdiag_Delta = true;
-    }
-
-    // Take the real part of Delta(tau)
-    Delta = map([](gf_const_view<imtime> d) { return real(d); }, inputs.Delta);
-    for (auto const &bl : range(Delta.size())) {
-      // Construct the detmanip object for block bl
-      dets.emplace_back(Delta_block_adaptor{Delta[bl]}, p.det_init_size);
-      // Set parameters
-      dets.back().set_singular_threshold(p.det_singular_threshold);
-      dets.back().set_n_operations_before_check(p.det_n_operations_before_check);
-      dets.back().set_precision_warning(p.det_precision_warning);
-      dets.back().set_precision_error(p.det_precision_error);
-    }
-  } // work_data constructor
-
-  int work_data_t::block_to_color(int block, int idx) const {
-    std::vector<long> gf_block_size_partial_sum;
-    long acc = 0;
-    for (auto const &[s, l] : gf_struct) {
-      gf_block_size_partial_sum.push_back(acc);
-      acc += l;
-    }
-    return gf_block_size_partial_sum[block] + idx;
   }
 
-  long work_data_t::find_block_number(int color) const {
-    long bl            = 0;
-    long colors_so_far = 0;
-    for (auto const &[s, l] : gf_struct) {
-      colors_so_far += l;
-      if (color < colors_so_far) { return bl; }
-      bl++;
-    }
-    ALWAYS_EXPECTS((colors_so_far == n_color), "Error in color-to-block conversion.");
-    return 0;
-  }
+  // -------------------------------------
 
-  long work_data_t::find_index_in_block(int color) const {
-    long colors_so_far = 0;
-    for (auto const &[s, l] : gf_struct) {
-      colors_so_far += l;
-      if (color < colors_so_far) { return color - (colors_so_far - l); }
-    }
-    ALWAYS_EXPECTS((colors_so_far == n_color), "Error in color-to-block conversion.");
-    return 0;
+  double configuration_sign(work_data_t const &wdata) {
+    double sign = wdata.current_trace_sign;
+    for (auto const &D : wdata.dets)
+      if (D.determinant() < 0) sign = -sign;
+    return sign;
   }
 
+  // -------------------------------------
+
   // Additional sign of the trace (computed from dets).
   double trace_sign(work_data_t const &wdata) {
+    CTSEG_TRACE_SCOPE("trace_sign");
     double sign      = 1.0;
     auto const &dets = wdata.dets;
     // For every block, we compute the sign of the permutation that takes
@@ -251,9 +166,11 @@ namespace triqs_ctseg {
     // to the increasing time-and-color-ordered list of operators.
     for (auto bl : range(dets.size())) {
       auto s              = long(dets[bl].size());
-      auto n_colors_in_bl = wdata.gf_struct[bl].second;
-      std::vector<int> number_c_before(n_colors_in_bl, 0);
-      std::vector<int> number_cdag_before(n_colors_in_bl, 0);
+      auto n_colors_in_bl = wdata.model->gf_struct[bl].second;
+      auto &number_c_before    = wdata.number_c_before;
+      auto &number_cdag_before = wdata.number_cdag_before;
+      number_c_before.assign(n_colors_in_bl, 0);
+      number_cdag_before.assign(n_colors_in_bl, 0);
       if (s != 0) {
         // We first compute the sign of the permutation that takes
         // [(c_dag c) (c_dag c) (c_dag c) ...] with the c and c_dag time-ordered to
@@ -314,6 +231,34 @@ namespace triqs_ctseg {
     return sign;
   } // sign computation
 
+  // trace_sign is the sign of the permutation from the det order [(cdag_0 c_0) (cdag_1 c_1) ...] (c and cdag in
+  // increasing time order) to the operators ordered by color then time. In the configuration with the pair
+  // (cdag at row i, c at column j), removing the pair changes the parity of this permutation by
+  //   i + j + n_cdag + n_c + (tau_c < tau_cdag)
+  // where n_cdag (n_c) is the number of other operators of the same color earlier than tau_cdag (tau_c):
+  // the terms for the positions of the removed operators, plus the re-pairing of the rows and columns inbetween.
+  // The insertion is the inverse operation.
+  double trace_sign_ratio(work_data_t const &wdata, long bl, long idx, tau_t const &tau_cdag, tau_t const &tau_c,
+                          bool is_insert) {
+    CTSEG_TRACE_SCOPE("trace_sign_ratio");
+    auto const &D = wdata.dets[bl];
+    long i        = det_lower_bound_x(D, tau_cdag);
+    long j        = det_lower_bound_y(D, tau_c);
+    // Number of operators of color idx in D earlier than tau
+    auto n_before = [&](tau_t const &tau) {
+      if (wdata.model->gf_struct[bl].second == 1) return det_lower_bound_x(D, tau) + det_lower_bound_y(D, tau);
+      long n = 0;
+      for (long k = 0; k < D.size(); ++k) {
+        if (D.get_x(k).second == idx and D.get_x(k).first < tau) ++n;
+        if (D.get_y(k).second == idx and D.get_y(k).first < tau) ++n;
+      }
+      return n;
+    };
+    // For a removal, the pair itself is counted once in n_before(tau_cdag) + n_before(tau_c)
+    long parity = i + j + n_before(tau_cdag) + n_before(tau_c) + (tau_c < tau_cdag) + (is_insert ? 0 : 1);
+    return (parity % 2 == 0) ? 1 : -1;
+  }
+
   // Functions for checking if a time is already in det.
   bool c_in_det(tau_t const &tau, det_t const &D) {
     if (D.size() == 0) return false;
@@ -16,60 +16,81 @@
 // Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
 
 #pragma once
-#include <mpi/mpi.hpp>
+#include <memory>
 #include <triqs/mc_tools/random_generator.hpp>
 #include <triqs/det_manip.hpp>
 
-#include "params.hpp"
-#include "inputs.hpp"
-#include "util.hpp"
+#include "model.hpp"
 #include "dets.hpp"
+#include "retarded_potential.hpp"
 
 namespace triqs_ctseg {
 
+  struct configuration_t;
+
+  // Schedule and statistics of the precision checks of the det of a block (det_adaptive_check)
+  struct det_check_t {
+    long interval = 1, countdown = 1; // Cycles between two checks, and until the next one
+    long n_checks    = 0;
+    double max_error = 0; // Largest max_ij |(M^-1 Delta)_ij - delta_ij| observed
+  };
+
+  // Mutable state of a Markov chain, besides the configuration
   struct work_data_t {
 
-    work_data_t(params_t const &p, inputs_t const &inputs, mpi::communicator c);
+    work_data_t(std::shared_ptr<model_t const> model, params_t const &p);
 
-    nda::matrix<double> U;  // Density-density interaction: U_ab n_a n_b
-    gf_struct_t gf_struct;  // gf_struct of the Green's function (input copied)
-    int n_color;            // Number of colors
-    nda::vector<double> mu; // Chemical potential per color
+    // The model (interactions, kernels, block structure), shared by all chains. See model.hpp
+    std::shared_ptr<model_t const> model;
 
-    bool has_Delta     = false; // There is a non-zero hybridization term
-    bool has_Dt        = false; // There is a non-zero dynamical nn interaction
-    bool has_Jperp     = false; // There is a non-zero Jperp interaction
-    bool rot_inv       = true;  // The spin-spin interaction is rotationally invariant (matters for F(tau) measure)
-    bool minus_sign    = false; // Has a move ever produced a negative sign?
-    bool offdiag_Delta = false; // Does Delta(tau) have blocks of size larger than 1?
+    bool minus_sign = false; // Has a move ever produced a negative sign?
 
-    // Dynamical and spin-spin interaction kernels
-    gf<imtime> D0t, K, Kprime, Jperp, Kprime_spin;
+    bool early_rejection = false; // Two-stage acceptance of the segment moves. See moves/early_rejection.hpp
 
-    // Hybridization function
-    block_gf<imtime, matrix_real_valued> Delta;
+    // trace_sign of the current configuration, updated by the moves with trace_sign_ratio
+    double current_trace_sign = 1;
 
     // The determinants
     // Vector of the det_manip objects, one per block of the input Delta(tau). See dets.hpp
     std::vector<det_t> dets;
 
-    // Color to (block, idx) conversion tables
-    std::vector<long> block_number;   // block numbers corresponding to colors
-    std::vector<long> index_in_block; // index in block of a given color
+    // Cache of the retarded potential of the operators, maintained by the moves if has_Dt. See retarded_potential.hpp
+    retarded_potential_t retarded_potential;
+
+    // Precision checks of the dets, one per block. Empty unless det_adaptive_check
+    std::vector<det_check_t> det_checks;
+    double det_precision_warning, det_precision_error;
 
-    // Find color corresponding to (block, idx)
-    int block_to_color(int block, int idx) const;
+    // Counters of the operators of each color in trace_sign (only kept to avoid reallocation)
+    mutable std::vector<int> number_c_before, number_cdag_before;
 
-    // Find block of color
-    long find_block_number(int color) const;
+    // Rebuild the dets, the trace sign and the retarded potential for a given configuration (e.g. a restart).
+    // Each det is filled and inverted at once (a single LU), instead of replaying the insertions.
+    // Returns the sign of the configuration (product of the signs of the dets and of the trace sign).
+    double initialize_from(configuration_t const &config);
 
-    // Find index of color in its block
-    long find_index_in_block(int color) const;
+    // To be called after each cycle (det_adaptive_check): check M^-1 of the blocks whose countdown is over,
+    // regenerate it if its error is above det_precision_warning, and adapt their intervals.
+    void check_det_precision(configuration_t const &config);
   };
 
+  // The hybridized cdag (x) and c (y) of block bl of the configuration, as (time, index in block),
+  // in increasing time order, i.e. the order of the rows and columns of the dets (see check_dets).
+  void hybridized_operators(configuration_t const &config, model_t const &model, long bl,
+                            std::vector<std::pair<tau_t, int>> &x, std::vector<std::pair<tau_t, int>> &y);
+
   // Additional sign of the trace (computed from dets).
   double trace_sign(work_data_t const &wdata);
 
+  // Sign of the current configuration: product of the signs of the dets and of current_trace_sign.
+  double configuration_sign(work_data_t const &wdata);
+
+  // Ratio of trace_sign after and before the insertion (is_insert) or the removal of a pair of operators in block bl:
+  // a cdag at tau_cdag and a c at tau_c, of the same index idx in the block. Uses the det before the operation.
+  // Only depends on the positions of the two operators: O(log N) for blocks of size 1, O(N) otherwise.
+  double trace_sign_ratio(work_data_t const &wdata, long bl, long idx, tau_t const &tau_cdag, tau_t const &tau_c,
+                          bool is_insert);
+
   // Functions for checking if a time is already in det.
   bool c_in_det(tau_t const &tau, det_t const &D);
 
@@ -46,11 +46,41 @@ c.add_member(c_name = "F_tau",
              read_only= True,
              doc = r"""Self-energy improved estimator :math:`F(\tau)`.""")
 
+c.add_member(c_name = "G_l",
+             c_type = "std::optional<block_gf<legendre>>",
+             read_only= True,
+             doc = r"""Legendre coefficients :math:`G_l` of the single-particle Green's function.""")
+
+c.add_member(c_name = "F_l",
+             c_type = "std::optional<block_gf<legendre>>",
+             read_only= True,
+             doc = r"""Legendre coefficients :math:`F_l` of the self-energy improved estimator.""")
+
+c.add_member(c_name = "G_iw",
+             c_type = "std::optional<block_gf<imfreq>>",
+             read_only= True,
+             doc = r"""Single-particle Green's function :math:`G(i\omega_n)`, measured directly in Matsubara frequencies.""")
+
+c.add_member(c_name = "F_iw",
+             c_type = "std::optional<block_gf<imfreq>>",
+             read_only= True,
+             doc = r"""Self-energy improved estimator :math:`F(i\omega_n)`, measured directly in Matsubara frequencies.""")
+
 c.add_member(c_name = "nn_tau",
              c_type = "std::optional<block2_gf<imtime>>",
              read_only= True,
              doc = r"""Density-density time correlation function :math:`\langle n_a(\tau) n_b(0) \rangle`.""")
 
+c.add_member(c_name = "G2_iw",
+             c_type = "std::optional<block2_gf<prod<imfreq, imfreq, imfreq>, tensor_valued<4>>>",
+             read_only= True,
+             doc = r"""Two-particle Green's function :math:`G^{(2)}_{abcd}(i\omega, i\nu, i\nu')`, for each pair of blocks.""")
+
+c.add_member(c_name = "F2_iw",
+             c_type = "std::optional<block2_gf<prod<imfreq, imfreq, imfreq>, tensor_valued<4>>>",
+             read_only= True,
+             doc = r"""Improved estimator :math:`F^{(2)}_{abcd}(i\omega, i\nu, i\nu')` of the two-particle Green's function.""")
+
 c.add_member(c_name = "Sperp_tau",
              c_type = "std::optional<gf<imtime>>",
              read_only= True,
@@ -91,11 +121,76 @@ c.add_member(c_name = "state_hist",
              read_only= True,
              doc = r"""State histogram""")
 
+c.add_member(c_name = "state_hist_states",
+             c_type = "std::optional<nda::vector<long>>",
+             read_only= True,
+             doc = r"""States of the sparse state histogram (more than 20 colors): state_hist[i] is the weight of state_hist_states[i]""")
+
+c.add_member(c_name = "G_tau_error",
+             c_type = "std::optional<block_gf<imtime>>",
+             read_only= True,
+             doc = r"""Jackknife error bar of G_tau (n_bins > 0)""")
+
+c.add_member(c_name = "densities_error",
+             c_type = "std::optional<std::map<std::string, nda::array<double, 1>>>",
+             read_only= True,
+             doc = r"""Jackknife error bar of densities (n_bins > 0)""")
+
+c.add_member(c_name = "nn_static_error",
+             c_type = "std::optional<std::map<std::pair<std::string, std::string>, nda::matrix<double>>>",
+             read_only= True,
+             doc = r"""Jackknife error bar of nn_static (n_bins > 0)""")
+
+c.add_member(c_name = "nn_tau_error",
+             c_type = "std::optional<block2_gf<imtime>>",
+             read_only= True,
+             doc = r"""Jackknife error bar of nn_tau (n_bins > 0)""")
+
+c.add_member(c_name = "average_sign_error",
+             c_type = "std::optional<double>",
+             read_only= True,
+             doc = r"""Jackknife error bar of average_sign (n_bins > 0)""")
+
+c.add_member(c_name = "move_timings",
+             c_type = "std::optional<std::map<std::string, nda::vector<double>>>",
+             read_only= True,
+             doc = r"""Statistics of the moves (measure_timings): [n_attempted, n_zero_ratio, n_accepted, time [s]] for each move, summed over the chains and MPI ranks""")
+
+c.add_member(c_name = "measure_timings",
+             c_type = "std::optional<std::map<std::string, nda::vector<double>>>",
+             read_only= True,
+             doc = r"""Statistics of the measures (measure_timings): [n_calls, time [s]] for each measure, summed over the chains and MPI ranks""")
+
+c.add_member(c_name = "det_precision_checks",
+             c_type = "std::optional<std::map<std::string, nda::vector<double>>>",
+             read_only= True,
+             doc = r"""Precision checks of M^-1 (det_adaptive_check): [n_checks, largest error] for each block, the number of checks summed and the error maximized over the chains and MPI ranks""")
+
+c.add_member(c_name = "negative_det_fraction",
+             c_type = "std::optional<std::map<std::string, double>>",
+             read_only= True,
+             doc = r"""Fraction of the configurations with a negative det, for each block (measure_sign_diagnostics)""")
+
+c.add_member(c_name = "pert_order_Delta_negative",
+             c_type = "std::optional<std::vector<double>>",
+             read_only= True,
+             doc = r"""Delta perturbation order histogram of the configurations with a negative sign, normalized as pert_order_Delta (measure_sign_diagnostics)""")
+
+c.add_member(c_name = "move_sign_changes",
+             c_type = "std::optional<std::map<std::string, nda::vector<double>>>",
+             read_only= True,
+             doc = r"""Sign changes of the moves (measure_sign_diagnostics): [n_accepted, n_sign_changes] for each move, during the accumulation, summed over the chains and MPI ranks""")
+
 c.add_member(c_name = "average_sign",
              c_type = "double",
              read_only= True,
              doc = r"""Average sign""")
 
+c.add_member(c_name = "n_warmup_cycles_done",
+             c_type = "long",
+             read_only= True,
+             doc = r"""Number of warmup cycles actually done (see adaptive_warmup)""")
+
 module.add_class(c)
 
 # The class solver_core
@@ -147,81 +242,191 @@ c.add_method("""void solve (**solve_params_t)""",
 
 
 
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| Parameter Name                | Type                                 | Default                                 | Documentation                                                                                                     |
-+===============================+======================================+=========================================+===================================================================================================================+
-| h_int                         | triqs::operators::many_body_operator | --                                      | Quartic part of the local Hamiltonian                                                                             |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| h_loc0                        | triqs::operators::many_body_operator | --                                      | Quandratic part of the local Hamiltonian (including chemical potential)                                           |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| n_tau_G                       | int                                  | 0                                       | Number of points on which to measure G(tau)/F(tau) (defaults to n_tau)                                            |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| n_tau_chi2                    | int                                  | 0                                       | Number of points on which to measure 2-point functions (defaults to n_tau_bosonic)                                |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| n_cycles                      | int                                  | --                                      | Number of QMC cycles                                                                                              |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| length_cycle                  | int                                  | 50                                      | Length of a single QMC cycle                                                                                      |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| n_warmup_cycles               | int                                  | 5000                                    | Number of cycles for thermalization                                                                               |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| random_seed                   | int                                  | 34788+928374*mpi::communicator().rank() | Seed for random number generator                                                                                  |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| random_name                   | std::string                          | ""                                      | Name of random number generator                                                                                   |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| max_time                      | int                                  | -1                                      | Maximum runtime in seconds, use -1 to set infinite                                                                |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| verbosity                     | int                                  | mpi::communicator().rank()==0?3:0       | Verbosity level                                                                                                   |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_insert_segment           | bool                                 | true                                    | Whether to perform the move insert segment                                                                        |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_remove_segment           | bool                                 | true                                    | Whether to perform the move remove segment                                                                        |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_move_segment             | bool                                 | true                                    | Whether to perform the move move segment                                                                          |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_split_segment            | bool                                 | true                                    | Whether to perform the move split segment                                                                         |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_regroup_segment          | bool                                 | true                                    | Whether to perform the move group into spin segment                                                               |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_insert_spin_segment      | bool                                 | true                                    | Whether to perform the move insert spin segment                                                                   |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_remove_spin_segment      | bool                                 | true                                    | Whether to perform the move remove spin segment                                                                   |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_split_spin_segment       | bool                                 | true                                    | Whether to perform the move insert spin segment                                                                   |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_regroup_spin_segment     | bool                                 | true                                    | Whether to perform the move remove spin segment                                                                   |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| move_swap_spin_lines          | bool                                 | true                                    | Whether to perform the move swap spin lines                                                                       |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| measure_pert_order            | bool                                 | true                                    | Whether to measure the perturbation order histograms (order in Delta and Jperp)                                   |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| measure_G_tau                 | bool                                 | true                                    | Whether to measure G(tau) (see measures/G_F_tau)                                                                  |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| measure_F_tau                 | bool                                 | false                                   | Whether to measure F(tau) (see measures/G_F_tau)                                                                  |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| measure_densities             | bool                                 | true                                    | Whether to measure densities (see measures/densities)                                                             |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| measure_average_sign          | bool                                 | true                                    | Whether to measure the average sign (see measures/average_sign)                                                   |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| measure_nn_static             | bool                                 | false                                   | Whether to measure <n(0)n(0)> (see measures/nn_static)                                                            |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| measure_nn_tau                | bool                                 | false                                   | Whether to measure <n(tau)n(0)> (see measures/nn_tau)                                                             |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| measure_Sperp_tau             | bool                                 | false                                   | Whether to measure <S_x(tau)S_x(0)> (see measures/Sperp_tau)                                                      |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| measure_state_hist            | bool                                 | false                                   | Whether to measure state histograms (see measures/state_hist)                                                     |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| det_init_size                 | int                                  | 100                                     | The maximum size of the determinant matrix before a resize                                                        |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| det_n_operations_before_check | int                                  | 100                                     | Max number of ops before the test of deviation of the det, M^-1 is performed.                                     |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| det_precision_warning         | double                               | 1.e-8                                   | Threshold for determinant precision warnings                                                                      |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| det_precision_error           | double                               | 1.e-5                                   | Threshold for determinant precision error                                                                         |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| det_singular_threshold        | double                               | -1                                      | Bound for the determinant matrix being singular, abs(det) > singular_threshold. If <0, it is !isnormal(abs(det))  |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
-| histogram_max_order           | int                                  | 1000                                    | Maximum order for the perturbation order histograms                                                               |
-+-------------------------------+--------------------------------------+-----------------------------------------+-------------------------------------------------------------------------------------------------------------------+
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| Parameter Name                | Type                                             | Default                                 | Documentation                                                                                                                                                                                                                                                                                                                                                                                                   |
++===============================+==================================================+=========================================+=================================================================================================================================================================================================================================================================================================================================================================================================================+
+| h_int                         | triqs::operators::many_body_operator             | --                                      | Quartic part of the local Hamiltonian                                                                                                                                                                                                                                                                                                                                                                           |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| h_loc0                        | triqs::operators::many_body_operator             | --                                      | Quandratic part of the local Hamiltonian (including chemical potential)                                                                                                                                                                                                                                                                                                                                         |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| D0_mode_frequencies           | std::vector<double>                              | {}                                      | Retarded density-density interaction as a sum of bosonic modes, instead of D0_tau (which must then be 0): D0_ab(i nu) = sum_k D0_mode_couplings(k, a, b) w_k^2 / ((i nu)^2 - w_k^2), w_k = D0_mode_frequencies[k] > 0. K(tau) and K'(tau) are then evaluated in closed form. Empty: D0_tau is used                                                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| D0_mode_couplings             | nda::array<double, 3>                            | {}                                      | Couplings of the modes of D0_mode_frequencies, of shape (n_modes, n_color, n_color), symmetric in the colors                                                                                                                                                                                                                                                                                                    |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| Delta_pole_energies           | std::vector<double>                              | {}                                      | Hybridization given by its poles (e.g. the frequencies of a discrete Lehmann representation, or bath levels): Delta_ij(i omega) = sum_k Delta_pole_weights[block](k, i, j) / (i omega - Delta_pole_energies[k]). Delta(tau) is then evaluated in closed form, and Delta_tau is overwritten by its values. Empty: Delta_tau is used                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| Delta_pole_weights            | std::map<std::string, nda::array<double, 3>>     | {}                                      | Weights of the poles of Delta_pole_energies for each block, by name (0 if absent), of shape (n_poles, block size, block size)                                                                                                                                                                                                                                                                                   |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| equivalent_blocks             | std::vector<std::vector<std::string>>            | {}                                      | Classes of equivalent blocks, by name, e.g. {{"up", "down"}} for a spin symmetric model. The blocks of a class must have the same size, the same Delta(tau) and equivalent interactions: they then share their Delta table, and G(tau), F(tau), G_l, G_iw and the densities are accumulated once per class (averaged over its blocks). Empty: no equivalent blocks                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_tau_G                       | int                                              | 0                                       | Number of points on which to measure G(tau)/F(tau) (defaults to n_tau)                                                                                                                                                                                                                                                                                                                                          |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_tau_chi2                    | int                                              | 0                                       | Number of points on which to measure 2-point functions (defaults to n_tau_bosonic)                                                                                                                                                                                                                                                                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_legendre_G                  | int                                              | 50                                      | Number of Legendre coefficients of G_l/F_l (see measure_G_l)                                                                                                                                                                                                                                                                                                                                                    |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_iw_G                        | int                                              | 100                                     | Number of positive Matsubara frequencies of G_iw/F_iw (see measure_G_iw)                                                                                                                                                                                                                                                                                                                                        |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_iw_G2                       | int                                              | 10                                      | Number of positive fermionic Matsubara frequencies nu, nu' of G2_iw (see measure_G2_iw)                                                                                                                                                                                                                                                                                                                         |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_iw_G2_bosonic               | int                                              | 1                                       | Number of non-negative bosonic Matsubara frequencies omega of G2_iw (see measure_G2_iw)                                                                                                                                                                                                                                                                                                                         |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_cycles                      | int                                              | --                                      | Number of QMC cycles                                                                                                                                                                                                                                                                                                                                                                                            |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| length_cycle                  | int                                              | 50                                      | Length of a single QMC cycle                                                                                                                                                                                                                                                                                                                                                                                    |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_warmup_cycles               | int                                              | 5000                                    | Number of cycles for thermalization                                                                                                                                                                                                                                                                                                                                                                             |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| adaptive_warmup               | bool                                             | false                                   | Stop the warmup once the average perturbation orders and sign over warmup_check_interval cycles agree with those of the previous interval within warmup_tolerance, after n_warmup_cycles_min to n_warmup_cycles cycles                                                                                                                                                                                          |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_warmup_cycles_min           | int                                              | 500                                     | Minimal number of warmup cycles with adaptive_warmup                                                                                                                                                                                                                                                                                                                                                            |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| warmup_check_interval         | int                                              | 100                                     | Number of cycles between two convergence checks of adaptive_warmup                                                                                                                                                                                                                                                                                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| warmup_tolerance              | double                                           | 0.02                                    | Relative tolerance on the averages of adaptive_warmup (absolute below 1)                                                                                                                                                                                                                                                                                                                                        |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| start_from_last_configuration | bool                                             | false                                   | Start the Markov chains from the last configuration of the previous solve (or of the solver read from h5)                                                                                                                                                                                                                                                                                                       |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| warm_start                    | bool                                             | false                                   | Warm start from the previous solve if only Delta(tau) changed: reuse the interaction kernels and start from the last configuration, with a warmup of n_warmup_cycles times the relative change of Delta(tau), at least warm_start_warmup_fraction                                                                                                                                                               |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| warm_start_warmup_fraction    | double                                           | 0.1                                     | Minimal fraction of n_warmup_cycles for a warm start (see warm_start)                                                                                                                                                                                                                                                                                                                                           |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| replica_U_scaling             | std::vector<double>                              | {}                                      | Replica exchange: scaling factor of the static interaction U for each replica (replica 0 is the physical model, with scaling 1). The number of MPI ranks must be a multiple of the number of replicas. Empty: all 1                                                                                                                                                                                             |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| replica_mu_shift              | std::vector<double>                              | {}                                      | Replica exchange: shift of the chemical potential for each replica (0 for replica 0). Empty: all 0                                                                                                                                                                                                                                                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| replica_exchange_interval     | int                                              | 10                                      | Number of cycles between two replica exchange attempts                                                                                                                                                                                                                                                                                                                                                          |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| random_seed                   | int                                              | 34788+928374*mpi::communicator().rank() | Seed for random number generator                                                                                                                                                                                                                                                                                                                                                                                |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| random_name                   | std::string                                      | ""                                      | Name of random number generator. "xoshiro256++": the moves use a xoshiro256++ generator, with independent streams for all the MPI ranks and threads drawn from the random_seed of rank 0 (see rng.hpp)                                                                                                                                                                                                          |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| max_time                      | int                                              | -1                                      | Maximum runtime in seconds, use -1 to set infinite                                                                                                                                                                                                                                                                                                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| verbosity                     | int                                              | mpi::communicator().rank()==0?3:0       | Verbosity level                                                                                                                                                                                                                                                                                                                                                                                                 |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_threads                     | int                                              | 1                                       | Number of independent Markov chains run in parallel threads on each MPI rank. With several threads, the signals (e.g. SIGINT) are handled by the calling thread, which stops all the chains                                                                                                                                                                                                                      |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| use_shared_memory             | bool                                             | false                                   | Allocate the interpolation tables of the kernels and of Delta(tau) once per node in MPI shared memory                                                                                                                                                                                                                                                                                                           |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| reduce_to_root                | bool                                             | false                                   | Reduce the large measured functions (G(tau), F(tau), G_l, G_iw, <n(tau)n(0)>, <nn>) to rank 0 only, instead of all the ranks. Their results on the other ranks are then the partial sums of the rank, and must not be used                                                                                                                                                                                      |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_insert_segment           | bool                                             | true                                    | Whether to perform the move insert segment                                                                                                                                                                                                                                                                                                                                                                      |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_remove_segment           | bool                                             | true                                    | Whether to perform the move remove segment                                                                                                                                                                                                                                                                                                                                                                      |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_move_segment             | bool                                             | true                                    | Whether to perform the move move segment                                                                                                                                                                                                                                                                                                                                                                        |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_split_segment            | bool                                             | true                                    | Whether to perform the move split segment                                                                                                                                                                                                                                                                                                                                                                       |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_regroup_segment          | bool                                             | true                                    | Whether to perform the move group into spin segment                                                                                                                                                                                                                                                                                                                                                             |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_insert_spin_segment      | bool                                             | true                                    | Whether to perform the move insert spin segment                                                                                                                                                                                                                                                                                                                                                                 |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_remove_spin_segment      | bool                                             | true                                    | Whether to perform the move remove spin segment                                                                                                                                                                                                                                                                                                                                                                 |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_split_spin_segment       | bool                                             | true                                    | Whether to perform the move insert spin segment                                                                                                                                                                                                                                                                                                                                                                 |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_regroup_spin_segment     | bool                                             | true                                    | Whether to perform the move remove spin segment                                                                                                                                                                                                                                                                                                                                                                 |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_swap_spin_lines          | bool                                             | true                                    | Whether to perform the move swap spin lines                                                                                                                                                                                                                                                                                                                                                                     |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| swap_spin_lines_n_lines       | int                                              | 2                                       | Number of spin lines of the move swap spin lines, in [2, 5]. 2: swap of two lines (Metropolis). n > 2: the S+ of n lines are permuted, the permutation being chosen among the n! ones by heat bath                                                                                                                                                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_swap_colors              | bool                                             | false                                   | Whether to perform the global move exchanging the segments of two colors (a spin flip for colors 0 and 1)                                                                                                                                                                                                                                                                                                       |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| importance_sampled_lengths    | bool                                             | false                                   | Draw the lengths of the segments proposed by insert_segment and split_segment from an exponential distribution with a decay length estimated from Delta(tau) and mu, instead of uniformly                                                                                                                                                                                                                       |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| early_rejection               | bool                                             | false                                   | Reject the segment moves (insert, remove, split, regroup, move) on their trace and proposal ratios first, before computing the det ratio (two-stage Metropolis test, exact)                                                                                                                                                                                                                                     |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| move_weights                  | std::map<std::string, double>                    | {}                                      | Proposal weights of the moves, by name as in the acceptance rate report (e.g. "insert", "spin swap"). Default weight 1, 0 disables the move                                                                                                                                                                                                                                                                     |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| adaptive_move_weights         | bool                                             | false                                   | Tune the weights of the moves during the warmup, to maximize the number of accepted moves per second. They are kept fixed during the accumulation                                                                                                                                                                                                                                                               |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| adaptive_move_min_probability | double                                           | 0.1                                     | Minimal relative attempt probability of a move with adaptive_move_weights                                                                                                                                                                                                                                                                                                                                       |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_pert_order            | bool                                             | true                                    | Whether to measure the perturbation order histograms (order in Delta and Jperp)                                                                                                                                                                                                                                                                                                                                 |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_G_tau                 | bool                                             | true                                    | Whether to measure G(tau) (see measures/G_F_tau)                                                                                                                                                                                                                                                                                                                                                                |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_F_tau                 | bool                                             | false                                   | Whether to measure F(tau) (see measures/G_F_tau)                                                                                                                                                                                                                                                                                                                                                                |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_G_l                   | bool                                             | false                                   | Whether to measure the Legendre coefficients G_l (and F_l if measure_F_tau) (see measures/G_F_tau)                                                                                                                                                                                                                                                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_G_iw                  | bool                                             | false                                   | Whether to measure G(i omega_n) (and F(i omega_n) if measure_F_tau) directly in Matsubara frequencies                                                                                                                                                                                                                                                                                                           |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_densities             | bool                                             | true                                    | Whether to measure densities (see measures/densities)                                                                                                                                                                                                                                                                                                                                                           |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_average_sign          | bool                                             | true                                    | Whether to measure the average sign (see measures/average_sign)                                                                                                                                                                                                                                                                                                                                                 |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_sign_diagnostics      | bool                                             | false                                   | Whether to measure the origin of the negative weights: fraction of negative dets of each block, order in Delta of the negative configurations, sign changes of each move (see measures/sign_diagnostics)                                                                                                                                                                                                        |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_nn_static             | bool                                             | false                                   | Whether to measure <n(0)n(0)> (see measures/nn_static)                                                                                                                                                                                                                                                                                                                                                          |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_nn_tau                | bool                                             | false                                   | Whether to measure <n(tau)n(0)> (see measures/nn_tau)                                                                                                                                                                                                                                                                                                                                                           |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| nn_tau_translation_average    | bool                                             | false                                   | Whether to measure <n(tau)n(0)> with the translation-averaged estimator (see measures/nn_tau)                                                                                                                                                                                                                                                                                                                   |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| nn_tau_pairs                  | std::vector<std::pair<std::string, std::string>> | {}                                      | Block pairs (A, B) of <n(tau)n(0)> to measure (see measures/nn_tau), (B, A) being included. Of the color pairs (a, b) and (b, a), only one is measured, the other one is given by chi_ba(tau) = chi_ab(beta - tau). The other blocks of nn_tau are 0. Empty: all the pairs are measured                                                                                                                         |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_Sperp_tau             | bool                                             | false                                   | Whether to measure <S_x(tau)S_x(0)> (see measures/Sperp_tau)                                                                                                                                                                                                                                                                                                                                                    |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| Sperp_tau_translation_average | bool                                             | false                                   | Whether to measure <S_x(tau)S_x(0)> with the translation-averaged insertion estimator (see measures/Sperp_tau)                                                                                                                                                                                                                                                                                                  |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_G2_iw                 | bool                                             | false                                   | Whether to measure the two-particle Green's function G2(i omega, i nu, i nu') (see measures/G2_iw)                                                                                                                                                                                                                                                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_state_hist            | bool                                             | false                                   | Whether to measure state histograms (see measures/state_hist)                                                                                                                                                                                                                                                                                                                                                   |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| sample_stream_file            | std::string                                      | ""                                      | Write one record per measurement (sign, perturbation orders, state at tau = 0 and occupations, see measures/sample_stream) to the h5 files <sample_stream_file>_<rank>_<chain>.h5. Empty: no records                                                                                                                                                                                                            |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| sample_stream_block_size      | long                                             | 10000                                   | Number of records per (compressed) block of the sample_stream_file                                                                                                                                                                                                                                                                                                                                              |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_G_tau_every           | int                                              | 1                                       | Measure G(tau)/F(tau) (and G_l, G_iw) only once every this number of cycles                                                                                                                                                                                                                                                                                                                                     |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_nn_tau_every          | int                                              | 1                                       | Measure <n(tau)n(0)> only once every this number of cycles                                                                                                                                                                                                                                                                                                                                                      |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_nn_static_every       | int                                              | 1                                       | Measure <n(0)n(0)> only once every this number of cycles                                                                                                                                                                                                                                                                                                                                                        |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_Sperp_tau_every       | int                                              | 1                                       | Measure <S_x(tau)S_x(0)> only once every this number of cycles                                                                                                                                                                                                                                                                                                                                                  |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_G2_iw_every           | int                                              | 1                                       | Measure G2(i omega, i nu, i nu') only once every this number of cycles                                                                                                                                                                                                                                                                                                                                          |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_interval_auto         | bool                                             | false                                   | Whether to measure G(tau), <n(tau)n(0)>, <n(0)n(0)> and <S_x(tau)S_x(0)> at most once every 2 tau_int cycles, where tau_int is the integrated autocorrelation time of the perturbation order estimated during warmup                                                                                                                                                                                            |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| measure_timings               | bool                                             | false                                   | Record the number of calls, zero-ratio attempts, acceptances and time of each move, and the number of calls and time of each measure, during the accumulation (results move_timings and measure_timings)                                                                                                                                                                                                        |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| n_bins                        | int                                              | 0                                       | Number of bins for the jackknife error bars of G(tau), the densities, <n(0)n(0)>, <n(tau)n(0)> and the average sign (results *_error). 0 for no error bars, otherwise an even number >= 2 (see measures/binning.hpp)                                                                                                                                                                                            |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| float_histograms              | bool                                             | false                                   | Accumulate the histograms of G(tau), F(tau) and <n(tau)n(0)> in single precision buffers, added to the double precision histograms every 64 measurements. Halves the memory touched by the measures on large meshes                                                                                                                                                                                             |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| target_densities_error        | double                                           | -1                                      | Stop the accumulation (before n_cycles) once the error bars of all the densities are below this value. No target if negative. The error bars are binned as for n_bins (32 bins if n_bins = 0)                                                                                                                                                                                                                   |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| target_G_tau_error            | double                                           | -1                                      | Stop the accumulation once the error bars of the diagonal of G(tau) at the times target_G_tau_points are below this value (with the other targets). No target if negative                                                                                                                                                                                                                                       |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| target_G_tau_points           | std::vector<double>                              | {}                                      | Times in [0, beta] at which the error bars of G(tau) are checked (target_G_tau_error). Empty: beta / 2                                                                                                                                                                                                                                                                                                          |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| target_average_sign_error     | double                                           | -1                                      | Stop the accumulation once the error bar of the average sign is below this value (with the other targets). No target if negative                                                                                                                                                                                                                                                                                |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| target_check_interval         | int                                              | 1000                                    | Number of cycles between two checks of the target error bars                                                                                                                                                                                                                                                                                                                                                    |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| partial_results_file          | std::string                                      | ""                                      | Write the partial results (reduced over all the ranks) and the current configuration to this h5 file every partial_results_interval cycles of the accumulation, in a background thread. Empty: no partial results                                                                                                                                                                                               |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| partial_results_interval      | int                                              | 10000                                   | Number of cycles between two writes of the partial results (partial_results_file)                                                                                                                                                                                                                                                                                                                               |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| det_init_size                 | int                                              | 0                                       | The maximum size of the determinant matrix before a resize. If 0, it is 16 times the block size (the matrices grow as needed, so a small value only saves memory for problems with many blocks).                                                                                                                                                                                                                |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| det_n_operations_before_check | int                                              | 100                                     | Max number of ops before the test of deviation of the det, M^-1 is performed.                                                                                                                                                                                                                                                                                                                                   |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| det_precision_warning         | double                                           | 1.e-8                                   | Threshold for determinant precision warnings                                                                                                                                                                                                                                                                                                                                                                    |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| det_precision_error           | double                                           | 1.e-5                                   | Threshold for determinant precision error                                                                                                                                                                                                                                                                                                                                                                       |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| det_adaptive_check            | bool                                             | false                                   | Check the precision of M^-1 after whole cycles, at an interval of each block that doubles (up to 1024 cycles) while the error is below det_precision_warning / 1000 and halves (down to 1 cycle) when it is above det_precision_warning / 10, instead of every det_n_operations_before_check operations. The number of checks and the largest error of each block are reported in results.det_precision_checks  |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| det_singular_threshold        | double                                           | -1                                      | Bound for the determinant matrix being singular, abs(det) > singular_threshold. If <0, it is !isnormal(abs(det))                                                                                                                                                                                                                                                                                                |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
+| histogram_max_order           | int                                              | 1000                                    | Maximum order for the perturbation order histograms                                                                                                                                                                                                                                                                                                                                                             |
++-------------------------------+--------------------------------------------------+-----------------------------------------+-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------+
 """)
 
 c.add_property(name = "Delta_tau",
@@ -236,6 +441,19 @@ c.add_property(name = "D0_tau",
                getter = cfunction("block2_gf_view<imtime> D0_tau ()"),
                doc = r"""Dynamical density-density interaction :math:`D_0(\tau)`""")
 
+c.add_property(name = "G_tau_view",
+               getter = cfunction("block_gf_view<imtime> G_tau_view ()"),
+               doc = r"""View of the measured :math:`G(\tau)` (``results.G_tau``), without copy. Invalidated by the next solve""")
+
+c.add_property(name = "F_tau_view",
+               getter = cfunction("block_gf_view<imtime> F_tau_view ()"),
+               doc = r"""View of the measured :math:`F(\tau)` (``results.F_tau``), without copy. Invalidated by the next solve""")
+
+c.add_property(name = "nn_tau_view",
+               getter = cfunction("block2_gf_view<imtime> nn_tau_view ()"),
+               doc = r"""View of the measured :math:`\langle n_a(\tau) n_b(0) \rangle` (``results.nn_tau``), without copy.
+Invalidated by the next solve""")
+
 module.add_class(c)
 
 
@@ -254,6 +472,31 @@ c.add_member(c_name = "h_loc0",
              initializer = """  """,
              doc = r"""Quandratic part of the local Hamiltonian (including chemical potential)""")
 
+c.add_member(c_name = "D0_mode_frequencies",
+             c_type = "std::vector<double>",
+             initializer = """ {} """,
+             doc = r"""Retarded density-density interaction as a sum of bosonic modes, instead of D0_tau (which must then be 0): D0_ab(i nu) = sum_k D0_mode_couplings(k, a, b) w_k^2 / ((i nu)^2 - w_k^2), w_k = D0_mode_frequencies[k] > 0. K(tau) and K'(tau) are then evaluated in closed form. Empty: D0_tau is used""")
+
+c.add_member(c_name = "D0_mode_couplings",
+             c_type = "nda::array<double, 3>",
+             initializer = """ {} """,
+             doc = r"""Couplings of the modes of D0_mode_frequencies, of shape (n_modes, n_color, n_color), symmetric in the colors""")
+
+c.add_member(c_name = "Delta_pole_energies",
+             c_type = "std::vector<double>",
+             initializer = """ {} """,
+             doc = r"""Hybridization given by its poles (e.g. the frequencies of a discrete Lehmann representation, or bath levels): Delta_ij(i omega) = sum_k Delta_pole_weights[block](k, i, j) / (i omega - Delta_pole_energies[k]). Delta(tau) is then evaluated in closed form, and Delta_tau is overwritten by its values. Empty: Delta_tau is used""")
+
+c.add_member(c_name = "Delta_pole_weights",
+             c_type = "std::map<std::string, nda::array<double, 3>>",
+             initializer = """ {} """,
+             doc = r"""Weights of the poles of Delta_pole_energies for each block, by name (0 if absent), of shape (n_poles, block size, block size)""")
+
+c.add_member(c_name = "equivalent_blocks",
+             c_type = "std::vector<std::vector<std::string>>",
+             initializer = """ {} """,
+             doc = r"""Classes of equivalent blocks, by name, e.g. {{"up", "down"}} for a spin symmetric model. The blocks of a class must have the same size, the same Delta(tau) and equivalent interactions: they then share their Delta table, and G(tau), F(tau), G_l, G_iw and the densities are accumulated once per class (averaged over its blocks). Empty: no equivalent blocks""")
+
 c.add_member(c_name = "n_tau_G",
              c_type = "int",
              initializer = """ 0 """,
@@ -264,6 +507,26 @@ c.add_member(c_name = "n_tau_chi2",
              initializer = """ 0 """,
              doc = r"""Number of points on which to measure 2-point functions (defaults to n_tau_bosonic)""")
 
+c.add_member(c_name = "n_legendre_G",
+             c_type = "int",
+             initializer = """ 50 """,
+             doc = r"""Number of Legendre coefficients of G_l/F_l (see measure_G_l)""")
+
+c.add_member(c_name = "n_iw_G",
+             c_type = "int",
+             initializer = """ 100 """,
+             doc = r"""Number of positive Matsubara frequencies of G_iw/F_iw (see measure_G_iw)""")
+
+c.add_member(c_name = "n_iw_G2",
+             c_type = "int",
+             initializer = """ 10 """,
+             doc = r"""Number of positive fermionic Matsubara frequencies nu, nu' of G2_iw (see measure_G2_iw)""")
+
+c.add_member(c_name = "n_iw_G2_bosonic",
+             c_type = "int",
+             initializer = """ 1 """,
+             doc = r"""Number of non-negative bosonic Matsubara frequencies omega of G2_iw (see measure_G2_iw)""")
+
 c.add_member(c_name = "n_cycles",
              c_type = "int",
              initializer = """  """,
@@ -279,6 +542,56 @@ c.add_member(c_name = "n_warmup_cycles",
              initializer = """ 5000 """,
              doc = r"""Number of cycles for thermalization""")
 
+c.add_member(c_name = "adaptive_warmup",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Stop the warmup once the average perturbation orders and sign over warmup_check_interval cycles agree with those of the previous interval within warmup_tolerance, after n_warmup_cycles_min to n_warmup_cycles cycles""")
+
+c.add_member(c_name = "n_warmup_cycles_min",
+             c_type = "int",
+             initializer = """ 500 """,
+             doc = r"""Minimal number of warmup cycles with adaptive_warmup""")
+
+c.add_member(c_name = "warmup_check_interval",
+             c_type = "int",
+             initializer = """ 100 """,
+             doc = r"""Number of cycles between two convergence checks of adaptive_warmup""")
+
+c.add_member(c_name = "warmup_tolerance",
+             c_type = "double",
+             initializer = """ 0.02 """,
+             doc = r"""Relative tolerance on the averages of adaptive_warmup (absolute below 1)""")
+
+c.add_member(c_name = "start_from_last_configuration",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Start the Markov chains from the last configuration of the previous solve (or of the solver read from h5)""")
+
+c.add_member(c_name = "warm_start",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Warm start from the previous solve if only Delta(tau) changed: reuse the interaction kernels and start from the last configuration, with a warmup of n_warmup_cycles times the relative change of Delta(tau), at least warm_start_warmup_fraction""")
+
+c.add_member(c_name = "warm_start_warmup_fraction",
+             c_type = "double",
+             initializer = """ 0.1 """,
+             doc = r"""Minimal fraction of n_warmup_cycles for a warm start (see warm_start)""")
+
+c.add_member(c_name = "replica_U_scaling",
+             c_type = "std::vector<double>",
+             initializer = """ {} """,
+             doc = r"""Replica exchange: scaling factor of the static interaction U for each replica (replica 0 is the physical model, with scaling 1). The number of MPI ranks must be a multiple of the number of replicas. Empty: all 1""")
+
+c.add_member(c_name = "replica_mu_shift",
+             c_type = "std::vector<double>",
+             initializer = """ {} """,
+             doc = r"""Replica exchange: shift of the chemical potential for each replica (0 for replica 0). Empty: all 0""")
+
+c.add_member(c_name = "replica_exchange_interval",
+             c_type = "int",
+             initializer = """ 10 """,
+             doc = r"""Number of cycles between two replica exchange attempts""")
+
 c.add_member(c_name = "random_seed",
              c_type = "int",
              initializer = """ 34788+928374*mpi::communicator().rank() """,
@@ -287,7 +600,7 @@ c.add_member(c_name = "random_seed",
 c.add_member(c_name = "random_name",
              c_type = "std::string",
              initializer = """ "" """,
-             doc = r"""Name of random number generator""")
+             doc = r"""Name of random number generator. "xoshiro256++": the moves use a xoshiro256++ generator, with independent streams for all the MPI ranks and threads drawn from the random_seed of rank 0 (see rng.hpp)""")
 
 c.add_member(c_name = "max_time",
              c_type = "int",
@@ -299,6 +612,21 @@ c.add_member(c_name = "verbosity",
              initializer = """ mpi::communicator().rank()==0?3:0 """,
              doc = r"""Verbosity level""")
 
+c.add_member(c_name = "n_threads",
+             c_type = "int",
+             initializer = """ 1 """,
+             doc = r"""Number of independent Markov chains run in parallel threads on each MPI rank. With several threads, the signals (e.g. SIGINT) are handled by the calling thread, which stops all the chains""")
+
+c.add_member(c_name = "use_shared_memory",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Allocate the interpolation tables of the kernels and of Delta(tau) once per node in MPI shared memory""")
+
+c.add_member(c_name = "reduce_to_root",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Reduce the large measured functions (G(tau), F(tau), G_l, G_iw, <n(tau)n(0)>, <nn>) to rank 0 only, instead of all the ranks. Their results on the other ranks are then the partial sums of the rank, and must not be used""")
+
 c.add_member(c_name = "move_insert_segment",
              c_type = "bool",
              initializer = """ true """,
@@ -349,6 +677,41 @@ c.add_member(c_name = "move_swap_spin_lines",
              initializer = """ true """,
              doc = r"""Whether to perform the move swap spin lines""")
 
+c.add_member(c_name = "swap_spin_lines_n_lines",
+             c_type = "int",
+             initializer = """ 2 """,
+             doc = r"""Number of spin lines of the move swap spin lines, in [2, 5]. 2: swap of two lines (Metropolis). n > 2: the S+ of n lines are permuted, the permutation being chosen among the n! ones by heat bath""")
+
+c.add_member(c_name = "move_swap_colors",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Whether to perform the global move exchanging the segments of two colors (a spin flip for colors 0 and 1)""")
+
+c.add_member(c_name = "importance_sampled_lengths",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Draw the lengths of the segments proposed by insert_segment and split_segment from an exponential distribution with a decay length estimated from Delta(tau) and mu, instead of uniformly""")
+
+c.add_member(c_name = "early_rejection",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Reject the segment moves (insert, remove, split, regroup, move) on their trace and proposal ratios first, before computing the det ratio (two-stage Metropolis test, exact)""")
+
+c.add_member(c_name = "move_weights",
+             c_type = "std::map<std::string, double>",
+             initializer = """ {} """,
+             doc = r"""Proposal weights of the moves, by name as in the acceptance rate report (e.g. "insert", "spin swap"). Default weight 1, 0 disables the move""")
+
+c.add_member(c_name = "adaptive_move_weights",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Tune the weights of the moves during the warmup, to maximize the number of accepted moves per second. They are kept fixed during the accumulation""")
+
+c.add_member(c_name = "adaptive_move_min_probability",
+             c_type = "double",
+             initializer = """ 0.1 """,
+             doc = r"""Minimal relative attempt probability of a move with adaptive_move_weights""")
+
 c.add_member(c_name = "measure_pert_order",
              c_type = "bool",
              initializer = """ true """,
@@ -364,6 +727,16 @@ c.add_member(c_name = "measure_F_tau",
              initializer = """ false """,
              doc = r"""Whether to measure F(tau) (see measures/G_F_tau)""")
 
+c.add_member(c_name = "measure_G_l",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Whether to measure the Legendre coefficients G_l (and F_l if measure_F_tau) (see measures/G_F_tau)""")
+
+c.add_member(c_name = "measure_G_iw",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Whether to measure G(i omega_n) (and F(i omega_n) if measure_F_tau) directly in Matsubara frequencies""")
+
 c.add_member(c_name = "measure_densities",
              c_type = "bool",
              initializer = """ true """,
@@ -374,6 +747,11 @@ c.add_member(c_name = "measure_average_sign",
              initializer = """ true """,
              doc = r"""Whether to measure the average sign (see measures/average_sign)""")
 
+c.add_member(c_name = "measure_sign_diagnostics",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Whether to measure the origin of the negative weights: fraction of negative dets of each block, order in Delta of the negative configurations, sign changes of each move (see measures/sign_diagnostics)""")
+
 c.add_member(c_name = "measure_nn_static",
              c_type = "bool",
              initializer = """ false """,
@@ -384,20 +762,130 @@ c.add_member(c_name = "measure_nn_tau",
              initializer = """ false """,
              doc = r"""Whether to measure <n(tau)n(0)> (see measures/nn_tau)""")
 
+c.add_member(c_name = "nn_tau_translation_average",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Whether to measure <n(tau)n(0)> with the translation-averaged estimator (see measures/nn_tau)""")
+
+c.add_member(c_name = "nn_tau_pairs",
+             c_type = "std::vector<std::pair<std::string, std::string>>",
+             initializer = """ {} """,
+             doc = r"""Block pairs (A, B) of <n(tau)n(0)> to measure (see measures/nn_tau), (B, A) being included. Of the color pairs (a, b) and (b, a), only one is measured, the other one is given by chi_ba(tau) = chi_ab(beta - tau). The other blocks of nn_tau are 0. Empty: all the pairs are measured""")
+
 c.add_member(c_name = "measure_Sperp_tau",
              c_type = "bool",
              initializer = """ false """,
              doc = r"""Whether to measure <S_x(tau)S_x(0)> (see measures/Sperp_tau)""")
 
+c.add_member(c_name = "Sperp_tau_translation_average",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Whether to measure <S_x(tau)S_x(0)> with the translation-averaged insertion estimator (see measures/Sperp_tau)""")
+
+c.add_member(c_name = "measure_G2_iw",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Whether to measure the two-particle Green's function G2(i omega, i nu, i nu') (see measures/G2_iw)""")
+
 c.add_member(c_name = "measure_state_hist",
              c_type = "bool",
              initializer = """ false """,
              doc = r"""Whether to measure state histograms (see measures/state_hist)""")
 
+c.add_member(c_name = "sample_stream_file",
+             c_type = "std::string",
+             initializer = """ "" """,
+             doc = r"""Write one record per measurement (sign, perturbation orders, state at tau = 0 and occupations, see measures/sample_stream) to the h5 files <sample_stream_file>_<rank>_<chain>.h5. Empty: no records""")
+
+c.add_member(c_name = "sample_stream_block_size",
+             c_type = "long",
+             initializer = """ 10000 """,
+             doc = r"""Number of records per (compressed) block of the sample_stream_file""")
+
+c.add_member(c_name = "measure_G_tau_every",
+             c_type = "int",
+             initializer = """ 1 """,
+             doc = r"""Measure G(tau)/F(tau) (and G_l, G_iw) only once every this number of cycles""")
+
+c.add_member(c_name = "measure_nn_tau_every",
+             c_type = "int",
+             initializer = """ 1 """,
+             doc = r"""Measure <n(tau)n(0)> only once every this number of cycles""")
+
+c.add_member(c_name = "measure_nn_static_every",
+             c_type = "int",
+             initializer = """ 1 """,
+             doc = r"""Measure <n(0)n(0)> only once every this number of cycles""")
+
+c.add_member(c_name = "measure_Sperp_tau_every",
+             c_type = "int",
+             initializer = """ 1 """,
+             doc = r"""Measure <S_x(tau)S_x(0)> only once every this number of cycles""")
+
+c.add_member(c_name = "measure_G2_iw_every",
+             c_type = "int",
+             initializer = """ 1 """,
+             doc = r"""Measure G2(i omega, i nu, i nu') only once every this number of cycles""")
+
+c.add_member(c_name = "measure_interval_auto",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Whether to measure G(tau), <n(tau)n(0)>, <n(0)n(0)> and <S_x(tau)S_x(0)> at most once every 2 tau_int cycles, where tau_int is the integrated autocorrelation time of the perturbation order estimated during warmup""")
+
+c.add_member(c_name = "measure_timings",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Record the number of calls, zero-ratio attempts, acceptances and time of each move, and the number of calls and time of each measure, during the accumulation (results move_timings and measure_timings)""")
+
+c.add_member(c_name = "n_bins",
+             c_type = "int",
+             initializer = """ 0 """,
+             doc = r"""Number of bins for the jackknife error bars of G(tau), the densities, <n(0)n(0)>, <n(tau)n(0)> and the average sign (results *_error). 0 for no error bars, otherwise an even number >= 2 (see measures/binning.hpp)""")
+
+c.add_member(c_name = "float_histograms",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Accumulate the histograms of G(tau), F(tau) and <n(tau)n(0)> in single precision buffers, added to the double precision histograms every 64 measurements. Halves the memory touched by the measures on large meshes""")
+
+c.add_member(c_name = "target_densities_error",
+             c_type = "double",
+             initializer = """ -1 """,
+             doc = r"""Stop the accumulation (before n_cycles) once the error bars of all the densities are below this value. No target if negative. The error bars are binned as for n_bins (32 bins if n_bins = 0)""")
+
+c.add_member(c_name = "target_G_tau_error",
+             c_type = "double",
+             initializer = """ -1 """,
+             doc = r"""Stop the accumulation once the error bars of the diagonal of G(tau) at the times target_G_tau_points are below this value (with the other targets). No target if negative""")
+
+c.add_member(c_name = "target_G_tau_points",
+             c_type = "std::vector<double>",
+             initializer = """ {} """,
+             doc = r"""Times in [0, beta] at which the error bars of G(tau) are checked (target_G_tau_error). Empty: beta / 2""")
+
+c.add_member(c_name = "target_average_sign_error",
+             c_type = "double",
+             initializer = """ -1 """,
+             doc = r"""Stop the accumulation once the error bar of the average sign is below this value (with the other targets). No target if negative""")
+
+c.add_member(c_name = "target_check_interval",
+             c_type = "int",
+             initializer = """ 1000 """,
+             doc = r"""Number of cycles between two checks of the target error bars""")
+
+c.add_member(c_name = "partial_results_file",
+             c_type = "std::string",
+             initializer = """ "" """,
+             doc = r"""Write the partial results (reduced over all the ranks) and the current configuration to this h5 file every partial_results_interval cycles of the accumulation, in a background thread. Empty: no partial results""")
+
+c.add_member(c_name = "partial_results_interval",
+             c_type = "int",
+             initializer = """ 10000 """,
+             doc = r"""Number of cycles between two writes of the partial results (partial_results_file)""")
+
 c.add_member(c_name = "det_init_size",
              c_type = "int",
-             initializer = """ 100 """,
-             doc = r"""The maximum size of the determinant matrix before a resize""")
+             initializer = """ 0 """,
+             doc = r"""The maximum size of the determinant matrix before a resize. If 0, it is 16 times the block size (the matrices grow as needed, so a small value only saves memory for problems with many blocks).""")
 
 c.add_member(c_name = "det_n_operations_before_check",
              c_type = "int",
@@ -414,6 +902,11 @@ c.add_member(c_name = "det_precision_error",
              initializer = """ 1.e-5 """,
              doc = r"""Threshold for determinant precision error""")
 
+c.add_member(c_name = "det_adaptive_check",
+             c_type = "bool",
+             initializer = """ false """,
+             doc = r"""Check the precision of M^-1 after whole cycles, at an interval of each block that doubles (up to 1024 cycles) while the error is below det_precision_warning / 1000 and halves (down to 1 cycle) when it is above det_precision_warning / 10, instead of every det_n_operations_before_check operations. The number of checks and the largest error of each block are reported in results.det_precision_checks""")
+
 c.add_member(c_name = "det_singular_threshold",
              c_type = "double",
              initializer = """ -1 """,
@@ -0,0 +1,84 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nils Wentzell
+
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs/test_tools/arrays.hpp>
+#include <triqs_ctseg/solver_core.hpp>
+
+using triqs::operators::n;
+using namespace triqs_ctseg;
+
+TEST(CTSEG, G2_iw) {
+
+  mpi::communicator c; // Start the mpi
+
+  double beta    = 10.0;
+  double U       = 1.0;
+  double mu      = 0.5;
+  double epsilon = 0.2;
+  int n_iw       = 1000;
+
+  constr_params_t param_constructor;
+  param_constructor.beta      = beta;
+  param_constructor.gf_struct = {{"up", 1}, {"down", 1}};
+  param_constructor.n_tau     = 1001;
+
+  solver_core Solver(param_constructor);
+
+  solve_params_t param_solve;
+  param_solve.h_int           = U * n("up", 0) * n("down", 0);
+  param_solve.h_loc0          = -mu * (n("up", 0) + n("down", 0));
+  param_solve.n_cycles        = 1000;
+  param_solve.n_warmup_cycles = 1000;
+  param_solve.length_cycle    = 50;
+  param_solve.random_seed     = 23488;
+  param_solve.measure_G2_iw   = true;
+  param_solve.measure_F_tau   = true;
+  param_solve.n_iw_G2         = 4;
+  param_solve.n_iw_G2_bosonic = 3;
+
+  nda::clef::placeholder<0> om_;
+  auto Delta_w   = gf<imfreq>({beta, Fermion, n_iw}, {1, 1});
+  auto Delta_tau = gf<imtime>({beta, Fermion, param_constructor.n_tau}, {1, 1});
+  Delta_w(om_) << 1.0 / (om_ - epsilon);
+  Delta_tau()           = fourier(Delta_w);
+  Solver.Delta_tau()[0] = Delta_tau;
+  Solver.Delta_tau()[1] = Delta_tau;
+
+  Solver.solve(param_solve);
+
+  auto const &G2 = Solver.results.G2_iw.value();
+  EXPECT_EQ(G2.size1(), 2);
+  EXPECT_EQ(G2.size2(), 2);
+  for (int bl1 : {0, 1}) {
+    for (int bl2 : {0, 1}) {
+      auto const &d = G2(bl1, bl2).data();
+      EXPECT_EQ(d.shape(), (std::array<long, 7>{3, 8, 8, 1, 1, 1, 1}));
+      EXPECT_GT(max_element(abs(d)), 1.e-3);
+    }
+  }
+
+  // Pauli principle : the direct and exchange terms cancel exactly at omega = 0, nu = nu' in the same color,
+  // also for the improved estimator
+  auto const &F2 = Solver.results.F2_iw.value();
+  for (int bl : {0, 1})
+    for (int m : range(8)) {
+      EXPECT_NEAR(std::abs(G2(bl, bl).data()(0, m, m, 0, 0, 0, 0)), 0, 1.e-10);
+      EXPECT_NEAR(std::abs(F2(bl, bl).data()(0, m, m, 0, 0, 0, 0)), 0, 1.e-10);
+    }
+}
+MAKE_MAIN;
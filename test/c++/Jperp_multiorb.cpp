@@ -0,0 +1,89 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include <cmath>
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs_ctseg/solver_core.hpp>
+
+using triqs::operators::n;
+using namespace triqs_ctseg;
+
+// Two identical orbitals coupled only by Jperp within each orbital: the results per orbital must be those of a
+// single orbital, and the Jperp order twice as large.
+TEST(CTSEG, Jperp_multiorb) {
+
+  mpi::communicator c; // Start the mpi
+
+  double beta      = 10.0;
+  double U         = 4.0;
+  double mu        = 2.0;
+  double epsilon   = 0.3;
+  int n_iw         = 5000;
+  int n_tau        = 2001;
+  double precision = 2.e-2; // Statistical
+
+  nda::clef::placeholder<0> om_;
+  auto Delta_w   = gf<imfreq>({beta, Fermion, n_iw}, {1, 1});
+  auto Delta_tau = gf<imtime>({beta, Fermion, n_tau}, {1, 1});
+  Delta_w(om_) << 1.0 / (om_ - epsilon) + 1.0 / (om_ + epsilon);
+  Delta_tau() = fourier(Delta_w);
+  auto J0w    = gf<imfreq>({beta, Boson, n_iw}, {1, 1});
+  J0w(om_) << 4.0 / (om_ * om_ - 1.0);
+
+  auto run = [&](int n_orb) {
+    constr_params_t param_constructor;
+    param_constructor.beta          = beta;
+    param_constructor.n_tau         = n_tau;
+    param_constructor.n_tau_bosonic = n_tau;
+    // The two spins of each orbital are adjacent colors
+    for (int o : range(n_orb)) {
+      param_constructor.gf_struct.emplace_back("up_" + std::to_string(o), 1);
+      param_constructor.gf_struct.emplace_back("down_" + std::to_string(o), 1);
+    }
+    auto S = std::make_unique<solver_core>(param_constructor);
+
+    solve_params_t param_solve;
+    for (int o : range(n_orb)) {
+      auto up = "up_" + std::to_string(o), dn = "down_" + std::to_string(o);
+      param_solve.h_int  = param_solve.h_int + U * n(up, 0) * n(dn, 0);
+      param_solve.h_loc0 = param_solve.h_loc0 - mu * (n(up, 0) + n(dn, 0));
+    }
+    param_solve.n_cycles        = 20000;
+    param_solve.n_warmup_cycles = 1000;
+    param_solve.length_cycle    = 50;
+    param_solve.random_seed     = 23488;
+
+    for (int bl : range(2 * n_orb)) S->Delta_tau()[bl] = Delta_tau;
+    S->Jperp_tau() = fourier(J0w);
+    S->solve(param_solve);
+    return S;
+  };
+
+  auto S1 = run(1);
+  auto S2 = run(2);
+
+  auto const &d1 = S1->results.densities.value();
+  auto const &d2 = S2->results.densities.value();
+  for (int o : range(2))
+    for (std::string s : {"up_", "down_"}) EXPECT_NEAR(d2.at(s + std::to_string(o))(0), d1.at(s + "0")(0), precision);
+
+  double order1 = S1->results.average_order_Jperp.value();
+  double order2 = S2->results.average_order_Jperp.value();
+  EXPECT_GT(order1, 0.1);
+  EXPECT_NEAR(order2 / (2 * order1), 1, 0.1);
+}
+MAKE_MAIN;
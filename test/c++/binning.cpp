@@ -0,0 +1,103 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Olivier Parcollet, Nils Wentzell
+
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <random>
+#include <triqs/test_tools/arrays.hpp>
+#include <triqs_ctseg/measures/binning.hpp>
+#include <triqs_ctseg/measures/precision_probe.hpp>
+
+using namespace triqs_ctseg;
+
+// ------------------------------
+
+TEST(binning, jackknife) {
+  // AR(1) process x_{t+1} = rho x_t + noise, of variance 1 / (1 - rho^2) and tau_int = (1 + rho) / (2 (1 - rho)).
+  // The error of the mean is sqrt(2 tau_int var / N)
+  auto c     = mpi::communicator{};
+  auto rng   = std::mt19937_64{1 + c.rank()};
+  auto noise = std::normal_distribution<double>{};
+  long N     = 3 << 16; // 48 bins at the end
+  for (double rho : {0.0, 0.5, 0.9}) {
+    auto bins = measures::binning_t<double>{64, 0.0};
+    double x = 0, sum = 0, Z = 0;
+    for (long t = 0; t < N; ++t) {
+      x = rho * x + noise(rng);
+      sum += x;
+      Z += 1;
+      bins.accumulate(Z, [&] { return sum; });
+    }
+    double tau_int  = (1 + rho) / (2 * (1 - rho));
+    double expected = std::sqrt(2 * tau_int / (1 - rho * rho) / double(N * c.size()));
+    EXPECT_NEAR(bins.error(c), expected, 0.3 * expected);
+  }
+}
+
+// ------------------------------
+
+TEST(binning, arrays) {
+  // Two independent series with variances 1 and 4, and a constant one
+  auto c    = mpi::communicator{};
+  auto rng  = std::mt19937_64{2 + c.rank()};
+  auto g    = std::normal_distribution<double>{};
+  auto bins = measures::binning_t<nda::array<double, 1>>{64, nda::zeros<double>(3)};
+  auto sum  = nda::zeros<double>(3);
+  long N    = 100000;
+  for (long t = 1; t <= N; ++t) {
+    sum += nda::array<double, 1>{g(rng), 2 * g(rng), 1.0};
+    bins.accumulate(double(t), [&] { return sum; });
+  }
+  auto err = bins.error(c);
+  double e = 1 / std::sqrt(double(N * c.size()));
+  EXPECT_NEAR(err(0), e, 0.4 * e);
+  EXPECT_NEAR(err(1), 2 * e, 0.8 * e);
+  EXPECT_NEAR(err(2), 0, 1.e-12);
+
+  // No binning
+  auto none = measures::binning_t<double>{0, 0.0};
+  EXPECT_FALSE(none.enabled());
+  none.accumulate(1, [] { return 1.0; });
+  EXPECT_EQ(none.error(c), 0);
+}
+
+// ------------------------------
+
+TEST(binning, precision_probes) {
+  // Two chains measuring the same unit-variance series : the error bars are combined in quadrature
+  auto c      = mpi::communicator{};
+  auto rng    = std::mt19937_64{3 + c.rank()};
+  auto g      = std::normal_distribution<double>{};
+  auto chains = std::vector<std::deque<measures::precision_probe_t>>(2);
+  for (auto &ch : chains) ch.emplace_back(measures::precision_probe_t{"x", 0.01}).start(64, 1);
+  auto probes = std::vector<std::deque<measures::precision_probe_t> const *>{&chains[0], &chains[1]};
+
+  // Not trusted before 16 bins
+  EXPECT_EQ(measures::max_relative_error(probes, c), std::numeric_limits<double>::infinity());
+
+  long N = 3 << 14;
+  for (auto &ch : chains) {
+    double sum = 0;
+    for (long t = 1; t <= N; ++t) {
+      sum += g(rng);
+      ch[0].bins.accumulate(double(t), [&] { return nda::array<double, 1>{sum}; });
+    }
+  }
+  double expected = 1 / std::sqrt(double(2 * N * c.size())) / 0.01;
+  EXPECT_NEAR(measures::max_relative_error(probes, c), expected, 0.4 * expected);
+}
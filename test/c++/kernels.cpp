@@ -0,0 +1,195 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include <cmath>
+#include <random>
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs_ctseg/kernels.hpp>
+#include <triqs_ctseg/configuration.hpp>
+#include <triqs_ctseg/retarded_potential.hpp>
+#include <triqs_ctseg/model.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs_ctseg;
+
+TEST(kernels, interpolation) {
+
+  double beta = 20;
+  tau_t::set_beta(beta);
+  double precision = 1.e-12;
+
+  // A 2x2 real kernel
+  auto g = gf<imtime, matrix_real_valued>{{beta, Fermion, 101}, {2, 2}};
+  for (auto t : g.mesh()) {
+    double x = double(t);
+    g[t]     = nda::matrix<double>{{std::exp(-x), x * x}, {std::cos(x), -0.5}};
+  }
+  auto table = kernel_table_t{g};
+  EXPECT_EQ(table.size(), 101);
+
+  // Compare with the gf evaluator, including both ends of the interval
+  for (auto n : range(1000)) {
+    auto tau = tau_t{uint64_t((tau_t::n_max / 999) * n)};
+    if (n == 999) tau = tau_t::beta();
+    for (auto i : range(2))
+      for (auto j : range(2)) EXPECT_NEAR(table(tau, i, j), g(double(tau))(i, j), precision);
+  }
+}
+
+TEST(kernels, retarded_potential) {
+
+  double beta = 10;
+  tau_t::set_beta(beta);
+  double precision = 1.e-12;
+  int n_color      = 3;
+
+  // A color-dependent kernel
+  auto g = gf<imtime, matrix_real_valued>{{beta, Boson, 51}, {n_color, n_color}};
+  for (auto t : g.mesh()) {
+    double x = double(t);
+    for (auto a : range(n_color))
+      for (auto b : range(n_color)) g[t](a, b) = std::sin(0.3 * x * (a + b + 1)) + 0.1 * a * b;
+  }
+  auto K = kernel_table_t{g};
+
+  auto rng      = std::mt19937_64{1};
+  auto seglists = std::vector<seglist_t>(n_color);
+  auto rpot     = retarded_potential_t{n_color};
+
+  // Reference: sum over colors of K_overlap
+  auto K_overlap_all = [&](int a, tau_t const &tau_c, tau_t const &tau_cdag) {
+    double res = 0;
+    for (auto c : range(n_color)) res += K_overlap(seglists[c], tau_c, tau_cdag, K, a, c);
+    return res;
+  };
+
+  for (int n = 0; n < 2000; ++n) {
+    // Random insertion or removal of a segment in a random color
+    int c    = rng() % n_color;
+    auto &sl = seglists[c];
+    if (sl.size() < 2 or rng() % 2 == 0)
+      sl.push_back(segment_t{tau_t{uint64_t(rng())}, tau_t{uint64_t(rng())}});
+    else
+      sl.erase(sl.begin() + rng() % sl.size());
+    rpot.update(c, seglists, K);
+
+    // Compare for operators in the configuration (cached), and at arbitrary times
+    int a = rng() % n_color;
+    if (not seglists[a].empty()) {
+      auto const &s = seglists[a][rng() % seglists[a].size()];
+      EXPECT_NEAR(rpot.overlap(a, s.tau_c, s.tau_cdag, K), K_overlap_all(a, s.tau_c, s.tau_cdag), precision);
+    }
+    auto tau1 = tau_t{uint64_t(rng())}, tau2 = tau_t{uint64_t(rng())};
+    EXPECT_NEAR(rpot.overlap(a, tau1, tau2, K), K_overlap_all(a, tau1, tau2), precision);
+  }
+  EXPECT_LT(rpot.max_error(seglists, K), precision);
+}
+
+TEST(kernels, bosonic_modes) {
+
+  double beta = 10;
+  tau_t::set_beta(beta);
+  double precision = 1.e-6;
+  mpi::communicator c;
+
+  // Two bosonic modes, with couplings between the two colors
+  auto w = std::vector<double>{1, 3};
+  auto g = nda::array<double, 3>{{{0.5, -0.2}, {-0.2, 0.5}}, {{0.25, 0.1}, {0.1, 0.3}}};
+
+  auto constr_params          = constr_params_t{};
+  constr_params.beta          = beta;
+  constr_params.gf_struct     = {{"up", 1}, {"down", 1}};
+  constr_params.n_tau_bosonic = 10001;
+  auto solve_params           = solve_params_t{};
+  solve_params.h_int          = 2.0 * triqs::operators::n("up", 0) * triqs::operators::n("down", 0);
+
+  auto inputs     = inputs_t{};
+  inputs.Delta    = block_gf<imtime>({beta, Fermion, 101}, constr_params.gf_struct);
+  inputs.D0t      = make_block2_gf<imtime>({beta, Boson, constr_params.n_tau_bosonic}, constr_params.gf_struct);
+  inputs.Jperpt   = gf<imtime>({beta, Boson, constr_params.n_tau_bosonic}, {1, 1});
+  inputs.Delta()  = 0;
+  inputs.Jperpt() = 0;
+
+  // D0(tau) of the modes: the Fourier transform of g w^2 / ((i nu)^2 - w^2)
+  for (auto a : range(2))
+    for (auto b : range(2))
+      for (auto t : inputs.D0t(a, b).mesh()) {
+        double x = double(t), res = 0;
+        for (auto k : range(2))
+          res -= g(k, a, b) * w[k] / 2 * std::cosh(w[k] * (beta / 2 - x)) / std::sinh(w[k] * beta / 2);
+        inputs.D0t(a, b)[t] = res;
+      }
+  auto model_tau = model_t{params_t{constr_params, solve_params}, inputs, c};
+
+  // The same interaction, given as modes
+  inputs.D0t()                     = 0;
+  solve_params.D0_mode_frequencies = w;
+  solve_params.D0_mode_couplings   = g;
+  auto model_modes                 = model_t{params_t{constr_params, solve_params}, inputs, c};
+  EXPECT_EQ(model_modes.K_table.n_exp_terms(), 2);
+
+  // Closed form against the numerical integration of D0(tau)
+  EXPECT_ARRAY_NEAR(model_tau.U, model_modes.U, precision);
+  EXPECT_ARRAY_NEAR(model_tau.mu, model_modes.mu, precision);
+  auto rng = std::mt19937_64{1};
+  for (int n = 0; n < 1000; ++n) {
+    auto tau = tau_t{uint64_t(rng())};
+    for (auto a : range(2))
+      for (auto b : range(2)) {
+        EXPECT_NEAR(model_tau.K_table(tau, a, b), model_modes.K_table(tau, a, b), precision);
+        EXPECT_NEAR(model_tau.Kprime_table(tau, a, b), model_modes.Kprime_table(tau, a, b), precision);
+      }
+  }
+  EXPECT_NEAR(model_modes.K_table(tau_t::zero(), 0, 1), 0, 1.e-14);
+  EXPECT_NEAR(model_modes.K_table(tau_t::beta(), 0, 1), 0, 1.e-14);
+}
+
+TEST(kernels, Delta_poles) {
+
+  double beta = 20;
+  tau_t::set_beta(beta);
+  double precision = 1.e-13;
+
+  // Two poles, one of them negative (large, to check that there is no overflow), in a block of size 2
+  auto solve_params                = solve_params_t{};
+  solve_params.Delta_pole_energies = {0.5, -40};
+  solve_params.Delta_pole_weights  = {{"up", nda::array<double, 3>{{{1, 0.2}, {0.2, 0.5}}, {{0.3, 0}, {0, 0.7}}}}};
+  auto constr_params               = constr_params_t{};
+  constr_params.beta               = beta;
+  constr_params.gf_struct          = {{"up", 2}, {"down", 1}};
+  auto p                           = params_t{constr_params, solve_params};
+
+  auto up = Delta_pole_table(p, 0), down = Delta_pole_table(p, 1);
+  EXPECT_EQ(up.n_exp_terms(), 2);
+  auto const &W = p.Delta_pole_weights["up"];
+  for (auto n : range(100)) {
+    auto tau = tau_t{uint64_t((tau_t::n_max / 99) * n)};
+    double x = double(tau);
+    for (auto i : range(2))
+      for (auto j : range(2)) {
+        double res = 0;
+        for (auto k : range(2)) {
+          double e = p.Delta_pole_energies[k];
+          res -= W(k, i, j) * (e >= 0 ? std::exp(-e * x) / (1 + std::exp(-e * beta)) :
+                                        std::exp(e * (beta - x)) / (1 + std::exp(e * beta)));
+        }
+        EXPECT_NEAR(up(tau, i, j), res, precision);
+      }
+    EXPECT_EQ(down(tau, 0, 0), 0); // No weights given for this block
+  }
+}
+MAKE_MAIN;
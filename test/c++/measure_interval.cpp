@@ -0,0 +1,61 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Olivier Parcollet, Nils Wentzell
+
+#include <random>
+#include <triqs/test_tools/arrays.hpp>
+#include <triqs_ctseg/measures/interval.hpp>
+
+using namespace triqs_ctseg;
+
+// A measure counting its calls
+struct counter_t {
+  long &n;
+  void accumulate(double) { ++n; }
+  void collect_results(mpi::communicator const &) {}
+};
+
+// ------------------------------
+
+TEST(measure_interval, interval) {
+  long n = 0, min_interval = 1;
+  auto m = measures::interval{counter_t{n}, 3, &min_interval};
+  for (int i = 0; i < 30; ++i) m.accumulate(1);
+  EXPECT_EQ(n, 10);
+
+  // The minimal interval can be changed during the run
+  min_interval = 5;
+  for (int i = 0; i < 30; ++i) m.accumulate(1);
+  EXPECT_EQ(n, 16);
+}
+
+// ------------------------------
+
+TEST(measure_interval, autocorrelation_time) {
+  // AR(1) process x_{t+1} = rho x_t + noise: tau_int = (1 + rho) / (2 (1 - rho))
+  auto rng   = std::mt19937_64{1};
+  auto noise = std::normal_distribution<double>{};
+  for (double rho : {0.0, 0.5, 0.9}) {
+    auto x = std::vector<double>(200000);
+    for (long t = 1; t < long(x.size()); ++t) x[t] = rho * x[t - 1] + noise(rng);
+    double expected = (1 + rho) / (2 * (1 - rho));
+    EXPECT_NEAR(measures::integrated_autocorrelation_time(x), expected, 0.1 * expected);
+  }
+
+  // Degenerate cases
+  EXPECT_EQ(measures::integrated_autocorrelation_time({}), 0.5);
+  EXPECT_EQ(measures::integrated_autocorrelation_time(std::vector<double>(10, 1.0)), 0.5);
+}
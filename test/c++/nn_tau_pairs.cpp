@@ -0,0 +1,76 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include <cmath>
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs/test_tools/arrays.hpp>
+#include <triqs_ctseg/solver_core.hpp>
+
+using triqs::operators::n;
+using namespace triqs_ctseg;
+
+TEST(CTSEG, nn_tau_pairs) {
+
+  mpi::communicator c; // Start the mpi
+
+  double beta    = 10.0;
+  double U       = 1.0;
+  double mu      = 0.5;
+  double epsilon = 0.2;
+  int n_iw       = 1000;
+
+  constr_params_t param_constructor;
+  param_constructor.beta      = beta;
+  param_constructor.gf_struct = {{"up", 1}, {"down", 1}};
+  param_constructor.n_tau     = 1001;
+
+  solver_core Solver(param_constructor);
+
+  solve_params_t param_solve;
+  param_solve.h_int                      = U * n("up", 0) * n("down", 0);
+  param_solve.h_loc0                     = -mu * (n("up", 0) + n("down", 0));
+  param_solve.n_cycles                   = 2000;
+  param_solve.n_warmup_cycles            = 100;
+  param_solve.length_cycle               = 50;
+  param_solve.random_seed                = 23488;
+  param_solve.measure_nn_tau             = true;
+  param_solve.nn_tau_translation_average = true;
+
+  nda::clef::placeholder<0> om_;
+  auto Delta_w   = gf<imfreq>({beta, Fermion, n_iw}, {1, 1});
+  auto Delta_tau = gf<imtime>({beta, Fermion, param_constructor.n_tau}, {1, 1});
+  Delta_w(om_) << 1.0 / (om_ - epsilon);
+  Delta_tau()           = fourier(Delta_w);
+  Solver.Delta_tau()[0] = Delta_tau;
+  Solver.Delta_tau()[1] = Delta_tau;
+
+  // All the pairs
+  Solver.solve(param_solve);
+  auto nn_all = Solver.results.nn_tau.value();
+
+  // Only (down, up) and its transpose, measured once. The moves do not depend on the measures: same Markov chain
+  param_solve.nn_tau_pairs = {{"down", "up"}};
+  Solver.solve(param_solve);
+  auto nn = Solver.results.nn_tau.value();
+
+  // (up, down) is measured, (down, up) is given by chi(beta - tau), which is exact for the translation average
+  EXPECT_GF_NEAR(nn(0, 1), nn_all(0, 1), 1.e-10);
+  EXPECT_GF_NEAR(nn(1, 0), nn_all(1, 0), 1.e-10);
+  EXPECT_ARRAY_NEAR(nn(0, 0).data(), nda::zeros<double>(nn(0, 0).data().shape()), 1.e-14);
+  EXPECT_ARRAY_NEAR(nn(1, 1).data(), nda::zeros<double>(nn(1, 1).data().shape()), 1.e-14);
+}
+MAKE_MAIN;
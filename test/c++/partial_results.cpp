@@ -0,0 +1,82 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include <cmath>
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs/test_tools/arrays.hpp>
+#include <triqs_ctseg/solver_core.hpp>
+
+using triqs::operators::n;
+using namespace triqs_ctseg;
+
+TEST(CTSEG, partial_results) {
+
+  mpi::communicator c; // Start the mpi
+
+  double beta    = 10.0;
+  double U       = 1.0;
+  double mu      = 0.5;
+  double epsilon = 0.2;
+  int n_iw       = 1000;
+
+  constr_params_t param_constructor;
+  param_constructor.beta      = beta;
+  param_constructor.gf_struct = {{"up", 1}, {"down", 1}};
+  param_constructor.n_tau     = 1001;
+
+  solver_core Solver(param_constructor);
+
+  solve_params_t param_solve;
+  param_solve.h_int           = U * n("up", 0) * n("down", 0);
+  param_solve.h_loc0          = -mu * (n("up", 0) + n("down", 0));
+  param_solve.n_cycles        = 2000;
+  param_solve.n_warmup_cycles = 100;
+  param_solve.length_cycle    = 50;
+  param_solve.random_seed     = 23488;
+  param_solve.measure_nn_tau  = true;
+
+  nda::clef::placeholder<0> om_;
+  auto Delta_w   = gf<imfreq>({beta, Fermion, n_iw}, {1, 1});
+  auto Delta_tau = gf<imtime>({beta, Fermion, param_constructor.n_tau}, {1, 1});
+  Delta_w(om_) << 1.0 / (om_ - epsilon);
+  Delta_tau()           = fourier(Delta_w);
+  Solver.Delta_tau()[0] = Delta_tau;
+  Solver.Delta_tau()[1] = Delta_tau;
+
+  Solver.solve(param_solve);
+  auto nn        = Solver.results.nn_tau.value();
+  auto densities = Solver.results.densities.value();
+
+  // Same run, with a partial result every 300 cycles: the measures collect their results several times, in place.
+  // The dumps do not change the Markov chain: same final results.
+  param_solve.partial_results_file     = "partial_results.out.h5";
+  param_solve.partial_results_interval = 300;
+  Solver.solve(param_solve);
+  EXPECT_GF_NEAR(Solver.results.nn_tau.value()(0, 1), nn(0, 1), 1.e-10);
+  EXPECT_GF_NEAR(Solver.results.nn_tau.value()(1, 1), nn(1, 1), 1.e-10);
+  for (auto const &bl : {"up", "down"})
+    EXPECT_ARRAY_NEAR(Solver.results.densities.value()[bl], densities[bl], 1.e-10);
+
+  // The last partial result, after 1800 cycles
+  if (c.rank() == 0) {
+    h5::file f("partial_results.out.h5", 'r');
+    long n_done = 0;
+    h5_read(f, "n_cycles_done", n_done);
+    EXPECT_EQ(n_done, 1800);
+  }
+}
+MAKE_MAIN;
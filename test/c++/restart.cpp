@@ -0,0 +1,79 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nikita Kavokine, Olivier Parcollet, Nils Wentzell
+
+#include <cmath>
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs/test_tools/arrays.hpp>
+#include <triqs_ctseg/solver_core.hpp>
+
+using triqs::operators::n;
+using namespace triqs_ctseg;
+
+TEST(CTSEG, restart) {
+
+  mpi::communicator c; // Start the mpi
+
+  double beta    = 20.0;
+  double U       = 1.0;
+  double mu      = 0.5;
+  double epsilon = 0.2;
+  int n_iw       = 1000;
+
+  constr_params_t param_constructor;
+  param_constructor.beta      = beta;
+  param_constructor.gf_struct = {{"up", 1}, {"down", 1}};
+  param_constructor.n_tau     = 1001;
+
+  solver_core Solver(param_constructor);
+
+  solve_params_t param_solve;
+  param_solve.h_int           = U * n("up", 0) * n("down", 0);
+  param_solve.h_loc0          = -mu * (n("up", 0) + n("down", 0));
+  param_solve.n_cycles        = 20000;
+  param_solve.n_warmup_cycles = 1000;
+  param_solve.length_cycle    = 50;
+  param_solve.random_seed     = 23488;
+
+  nda::clef::placeholder<0> om_;
+  auto Delta_w   = gf<imfreq>({beta, Fermion, n_iw}, {1, 1});
+  auto Delta_tau = gf<imtime>({beta, Fermion, param_constructor.n_tau}, {1, 1});
+  Delta_w(om_) << 1.0 / (om_ - epsilon);
+  Delta_tau()           = fourier(Delta_w);
+  Solver.Delta_tau()[0] = Delta_tau;
+  Solver.Delta_tau()[1] = Delta_tau;
+
+  Solver.solve(param_solve);
+  auto densities = Solver.results.densities.value();
+
+  // Save the solver with its final configuration, and restart without warmup from the stored configuration.
+  // The dets are rebuilt at once from the configuration.
+  {
+    h5::file out_file("restart.out.h5", 'w');
+    h5_write(out_file, "solver", Solver);
+  }
+  h5::file in_file("restart.out.h5", 'r');
+  auto Solver2 = solver_core::h5_read_construct(in_file, "solver");
+
+  param_solve.n_warmup_cycles               = 0;
+  param_solve.random_seed                   = 1234;
+  param_solve.start_from_last_configuration = true;
+  Solver2.solve(param_solve);
+
+  // Same physics, independent samples
+  for (auto const &bl : {"up", "down"}) EXPECT_NEAR(Solver2.results.densities.value()[bl](0), densities[bl](0), 0.02);
+}
+MAKE_MAIN;
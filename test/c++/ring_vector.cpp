@@ -0,0 +1,88 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Olivier Parcollet, Nils Wentzell
+
+#include <random>
+#include <triqs/test_tools/arrays.hpp>
+#include <triqs_ctseg/ring_vector.hpp>
+#include <triqs_ctseg/configuration.hpp>
+
+using namespace triqs_ctseg;
+
+static_assert(std::random_access_iterator<ring_vector_t<int>::iterator>);
+static_assert(std::random_access_iterator<ring_vector_t<int>::const_iterator>);
+
+// ------------------------------
+
+TEST(ring_vector, random_operations) {
+  // Same random sequence of operations on a ring_vector_t and a std::vector
+  auto rng = std::mt19937{1};
+  auto r   = ring_vector_t<int>{};
+  auto v   = std::vector<int>{};
+
+  for (int n = 0; n < 100000; ++n) {
+    int x = rng();
+    switch (v.empty() ? 0 : rng() % 5) {
+      case 0: {
+        long k = rng() % (v.size() + 1);
+        v.insert(v.begin() + k, x);
+        r.insert(r.begin() + k, x);
+        break;
+      }
+      case 1: {
+        long k = rng() % v.size();
+        v.erase(v.begin() + k);
+        r.erase(r.begin() + k);
+        break;
+      }
+      case 2:
+        rotate_front_to_back(v);
+        rotate_front_to_back(r);
+        break;
+      case 3:
+        rotate_back_to_front(v);
+        rotate_back_to_front(r);
+        break;
+      case 4:
+        if (v.size() > 40) {
+          v.clear();
+          r.clear();
+        }
+        v.push_back(x);
+        r.push_back(x);
+        break;
+    }
+    ASSERT_EQ(r.size(), v.size());
+    ASSERT_TRUE(std::equal(v.begin(), v.end(), r.begin(), r.end()));
+  }
+}
+
+// ------------------------------
+
+TEST(seglist, fix_ordering_first_last) {
+  tau_t::set_beta(10);
+  auto S = [](double x, double y) { return segment_t{tau_t{x}, tau_t{y}}; };
+
+  // First c moved beyond beta : first segment becomes cyclic and goes to the back
+  auto sl = seglist_t{S(1, 8), S(7, 6), S(5, 4), S(3, 2)};
+  fix_ordering_first_last(sl);
+  EXPECT_EQ(sl, (seglist_t{S(7, 6), S(5, 4), S(3, 2), S(1, 8)}));
+
+  // Last c moved beyond 0 : last segment goes to the front
+  sl = seglist_t{S(7, 6), S(5, 4), S(3, 2), S(9, 8)};
+  fix_ordering_first_last(sl);
+  EXPECT_EQ(sl, (seglist_t{S(9, 8), S(7, 6), S(5, 4), S(3, 2)}));
+}
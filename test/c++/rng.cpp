@@ -0,0 +1,77 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Olivier Parcollet, Nils Wentzell
+
+#include <cmath>
+#include <vector>
+#include <triqs/test_tools/arrays.hpp>
+#include <triqs_ctseg/rng.hpp>
+
+using namespace triqs_ctseg;
+
+// ------------------------------
+
+TEST(rng, streams) {
+  // Reproducible
+  auto a = xoshiro256pp{1}, b = xoshiro256pp{1};
+  for (int n = 0; n < 100; ++n) ASSERT_EQ(a(), b());
+
+  // The streams of a seed differ, and stream k is k jumps
+  auto s0 = xoshiro256pp{1, 0}, s1 = xoshiro256pp{1, 1}, s2 = xoshiro256pp{1, 2};
+  auto j  = xoshiro256pp{1};
+  j.jump();
+  j.jump();
+  for (int n = 0; n < 100; ++n) {
+    auto x0 = s0(), x1 = s1(), x2 = s2();
+    EXPECT_NE(x0, x1);
+    EXPECT_NE(x1, x2);
+    EXPECT_EQ(x2, j());
+  }
+}
+
+// ------------------------------
+
+TEST(rng, bounded) {
+  auto rng = xoshiro256pp{3};
+
+  // Chi^2 of the frequencies of [0, 7[ : 6 degrees of freedom, far below the 1e-4 quantile (27.9)
+  long N     = 700000;
+  auto count = std::vector<long>(7, 0);
+  for (long n = 0; n < N; ++n) count[rng.bounded(7)]++;
+  double chi2 = 0;
+  for (auto c : count) chi2 += std::pow(c - N / 7.0, 2) / (N / 7.0);
+  EXPECT_LT(chi2, 27.9);
+
+  // Full 64-bit range : x < n, and the upper half of [0, n[ is drawn half of the time
+  uint64_t n = (uint64_t{1} << 63) + 12345;
+  long upper  = 0;
+  for (long k = 0; k < 100000; ++k) {
+    auto x = rng.bounded(n);
+    ASSERT_LT(x, n);
+    upper += (x >= n / 2);
+  }
+  EXPECT_NEAR(upper / 100000.0, 0.5, 0.01);
+  EXPECT_EQ(rng.bounded(1), 0);
+
+  // Uniform doubles in [0, 1[
+  double sum = 0;
+  for (long k = 0; k < 100000; ++k) {
+    double x = rng.uniform();
+    ASSERT_TRUE(x >= 0 and x < 1);
+    sum += x;
+  }
+  EXPECT_NEAR(sum / 100000, 0.5, 0.005);
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2022-2024 Simons Foundation
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You may obtain a copy of the License at
+//     https://www.gnu.org/licenses/gpl-3.0.txt
+//
+// Authors: Nils Wentzell
+
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs/test_tools/arrays.hpp>
+#include <triqs_ctseg/solver_core.hpp>
+
+using triqs::operators::n;
+using namespace triqs_ctseg;
+
+TEST(CTSEG, sample_stream) {
+
+  mpi::communicator c; // Start the mpi
+
+  double beta    = 20.0;
+  double U       = 1.0;
+  double mu      = 0.5;
+  double epsilon = 0.2;
+  int n_iw       = 1000;
+
+  constr_params_t param_constructor;
+  param_constructor.beta      = beta;
+  param_constructor.gf_struct = {{"up", 1}, {"down", 1}};
+  param_constructor.n_tau     = 1001;
+
+  solver_core Solver(param_constructor);
+
+  solve_params_t param_solve;
+  param_solve.h_int                    = U * n("up", 0) * n("down", 0);
+  param_solve.h_loc0                   = -mu * (n("up", 0) + n("down", 0));
+  param_solve.n_cycles                 = 2500;
+  param_solve.n_warmup_cycles          = 1000;
+  param_solve.length_cycle             = 50;
+  param_solve.random_seed              = 23488;
+  param_solve.measure_pert_order       = true;
+  param_solve.sample_stream_file       = "sample_stream";
+  param_solve.sample_stream_block_size = 1000;
+
+  nda::clef::placeholder<0> om_;
+  auto Delta_w   = gf<imfreq>({beta, Fermion, n_iw}, {1, 1});
+  auto Delta_tau = gf<imtime>({beta, Fermion, param_constructor.n_tau}, {1, 1});
+  Delta_w(om_) << 1.0 / (om_ - epsilon);
+  Delta_tau()           = fourier(Delta_w);
+  Solver.Delta_tau()[0] = Delta_tau;
+  Solver.Delta_tau()[1] = Delta_tau;
+
+  Solver.solve(param_solve);
+  if (c.size() > 1) return; // The results are reduced over the ranks, the records are not
+
+  // One record per cycle, in blocks of sample_stream_block_size records
+  h5::file f("sample_stream_0_0.h5", 'r');
+  auto g       = h5::group(f).open_group("samples");
+  auto columns = h5::read<std::vector<std::string>>(g, "columns");
+  EXPECT_EQ(columns, (std::vector<std::string>{"sign", "Delta_order", "Jperp_order", "state", "n_0", "n_1"}));
+  auto n_blocks = h5::read<long>(g, "n_blocks");
+  EXPECT_EQ(n_blocks, 3);
+
+  long n_records = 0;
+  auto sum       = nda::zeros<double>(6);
+  for (auto b : range(n_blocks)) {
+    auto block = h5::read<nda::array<double, 2>>(g, std::to_string(b));
+    EXPECT_EQ(block.extent(1), 6);
+    for (auto i : range(block.extent(0))) sum += block(i, range::all);
+    n_records += block.extent(0);
+  }
+  EXPECT_EQ(n_records, param_solve.n_cycles);
+
+  // The averages of the records are the measured averages (no sign problem)
+  auto avg = nda::array<double, 1>{sum / n_records};
+  EXPECT_NEAR(avg(0), 1, 1.e-12);
+  EXPECT_NEAR(avg(1), Solver.results.average_order_Delta.value(), 1.e-10);
+  EXPECT_NEAR(avg(4), Solver.results.densities.value()["up"](0), 1.e-10);
+  EXPECT_NEAR(avg(5), Solver.results.densities.value()["down"](0), 1.e-10);
+}
+MAKE_MAIN;
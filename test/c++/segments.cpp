@@ -18,12 +18,17 @@
 #include <iostream>
 
 #include <cmath>
+#include <random>
 #include <triqs/test_tools/arrays.hpp>
+#include <h5/h5.hpp>
 #include <triqs_ctseg/tau_t.hpp>
 #include <triqs_ctseg/configuration.hpp>
+#include <triqs_ctseg/replica_exchange.hpp>
+#include <triqs_ctseg/work_data.hpp>
 
+using namespace triqs::gfs;
 using namespace triqs_ctseg;
-using vs_t = std::vector<segment_t>;
+using vs_t = seglist_t;
 
 double beta      = 10;
 double precision = 1.e-13;
@@ -54,6 +59,40 @@ TEST(segment, flip) {
   //std::cout  << vf << std::endl;
   EXPECT_EQ(flip(v), vf);
   EXPECT_EQ(flip(flip(v)), v);
+
+  // In a reused buffer
+  auto buf = vs_t{S(9, 8), S(7, 6), S(5, 4)};
+  flip(v, buf);
+  EXPECT_EQ(buf, vf);
+  flip(vs_t{}, buf);
+  EXPECT_EQ(buf, vs_t{segment_t::full_line()});
+  flip(vs_t{segment_t::full_line()}, buf);
+  EXPECT_TRUE(buf.empty());
+}
+
+// ------------------------------
+
+TEST(segment, flipped_seglist_view) {
+  tau_t::set_beta(beta);
+
+  // Non-cyclic, cyclic, with a single segment, empty and full line
+  auto lists =
+     std::vector<vs_t>{{S(8, 6), S(4, 3), S(2, 1)}, {S(7, 5), S(1, 9)}, {S(6, 2)}, {}, {segment_t::full_line()}};
+  auto segs = std::vector<segment_t>{S(5.5, 5.2), S(2.5, 2.2), S(4.5, 1.5), S(0.5, 9.5), S(9.8, 8.5)};
+  for (auto const &v : lists) {
+    auto vf  = flip(v);
+    auto fsl = flipped_seglist_t{v};
+    ASSERT_EQ(fsl.size(), vf.size());
+    for (long i = 0; i < fsl.size(); ++i) EXPECT_EQ(fsl[i], vf[i]);
+    if (not vf.empty()) EXPECT_EQ(fsl.back(), vf.back());
+
+    for (double x : {9.9, 7.0, 5.0, 3.5, 1.0, 0.1})
+      EXPECT_EQ(lower_bound(fsl, tau_t{x}), lower_bound(vf, tau_t{x}) - vf.begin());
+    for (auto const &seg : segs) {
+      EXPECT_NEAR(overlap(fsl, seg), overlap(vf, seg), precision);
+      EXPECT_EQ(is_insertable_into(seg, fsl), is_insertable_into(seg, vf));
+    }
+  }
 }
 
 // ------------------------------
@@ -87,5 +126,263 @@ TEST(segment, is_insertable) {
   EXPECT_TRUE(is_insertable_into(S(0.5, 5), v));
 }
 
+// ------------------------------
+
+TEST(segment, overlaps_all_colors) {
+  tau_t::set_beta(beta);
+
+  auto seglists = std::vector<vs_t>{{S(4, 3), S(2, 1)}, {}, {S(6, 5), S(1, 7)}, {segment_t::full_line()}};
+  auto U        = nda::matrix<double>{{0, 1, 2, 3}, {1, 0, 4, 5}, {2, 4, 0, 6}, {3, 5, 6, 0}};
+
+  // A non-cyclic and a cyclic segment
+  for (auto seg : {S(5.5, 1.5), S(0.5, 8.5)}) {
+    auto ov = std::vector<double>{};
+    overlaps(seglists, seg, ov);
+    ASSERT_EQ(ov.size(), seglists.size());
+    for (int c = 0; c < 4; ++c) EXPECT_NEAR(ov[c], overlap(seglists[c], seg), precision);
+
+    for (int color = 0; color < 4; ++color) {
+      double ref = 0;
+      for (int c = 0; c < 4; ++c)
+        if (c != color) ref += U(color, c) * overlap(seglists[c], seg);
+      EXPECT_NEAR(U_overlap(seglists, seg, U, color), ref, precision);
+    }
+  }
+}
+
+// ------------------------------
+
+TEST(segment, overlaps_n_color) {
+  tau_t::set_beta(beta);
+
+  // Compile-time color loops (2, 6 colors) and run-time ones (3, 7 colors), see dispatch_n_color
+  for (int n_color : {2, 3, 6, 7}) {
+    auto seglists = std::vector<vs_t>(n_color);
+    auto U        = nda::matrix<double>(n_color, n_color);
+    for (int a = 0; a < n_color; ++a) {
+      seglists[a] = vs_t{S(8 - 0.3 * a, 6 + 0.1 * a), S(3 - 0.2 * a, 1 + 0.1 * a)};
+      for (int b = 0; b < n_color; ++b) U(a, b) = (a == b) ? 0 : a + b + 1;
+    }
+    for (auto seg : {S(5.5, 1.5), S(0.5, 8.5)}) {
+      auto ov = std::vector<double>{};
+      overlaps(seglists, seg, ov);
+      ASSERT_EQ(ov.size(), n_color);
+      for (int c = 0; c < n_color; ++c) EXPECT_NEAR(ov[c], overlap(seglists[c], seg), precision);
+      for (int color = 0; color < n_color; ++color) {
+        double ref = 0;
+        for (int c = 0; c < n_color; ++c)
+          if (c != color) ref += U(color, c) * overlap(seglists[c], seg);
+        EXPECT_NEAR(U_overlap(seglists, seg, U, color), ref, precision);
+      }
+    }
+  }
+}
+
+// ------------------------------
+
+TEST(segment, n_tau_sorted) {
+  tau_t::set_beta(beta);
+
+  // Non cyclic, cyclic, empty and full line seglists
+  auto seglists = std::vector<vs_t>{{S(4, 3), S(2, 1)}, {S(6, 5), S(1, 7)}, {}, {segment_t::full_line()}};
+
+  // Decreasing times, including the ends of the segments, beta and 0
+  auto taus = std::vector<tau_t>{tau_t::beta()};
+  for (int k = 199; k > 0; --k) taus.push_back(make_tau(k * beta / 200));
+  taus.push_back(tau_t::zero());
+
+  for (auto const &sl : seglists) {
+    auto res = std::vector<int>(taus.size());
+    n_tau(taus, sl, res.data());
+    for (auto k : range(taus.size())) EXPECT_EQ(res[k], n_tau(taus[k], sl));
+  }
+}
+
+// ------------------------------
+
+TEST(segment, colored_ordered_ops) {
+  tau_t::set_beta(beta);
+
+  // Empty list, non-cyclic segments, cyclic segment at the back, full line
+  auto seglists = std::vector<vs_t>{{}, {S(9, 8), S(4, 3), S(2, 1)}, {S(6, 5), S(1.5, 7)}, {segment_t::full_line()}};
+
+  // Reference: all the operators, sorted by decreasing time
+  std::vector<colored_ops_t> ref;
+  for (int c = 0; c < 4; ++c)
+    for (auto const &s : seglists[c]) {
+      ref.push_back({s.tau_c, c, false});
+      ref.push_back({s.tau_cdag, c, true});
+      if (is_cyclic(s)) {
+        ref.push_back({tau_t::beta(), c, false});
+        ref.push_back({tau_t::zero(), c, true});
+      }
+    }
+  std::sort(ref.begin(), ref.end(), [](auto const &a, auto const &b) { return b.tau < a.tau; });
+
+  auto merger = colored_ops_merger_t{};
+  for (int n = 0; n < 2; ++n) { // the second call reuses the buffers
+    auto const &ops = merger(seglists);
+    ASSERT_EQ(ops.size(), ref.size());
+    for (auto i : range(ops.size())) {
+      if (i > 0) EXPECT_FALSE(ops[i - 1].tau < ops[i].tau);
+      // Operators at equal times (beta and 0) may come in any order of colors
+      if (ops[i].tau == tau_t::beta() or ops[i].tau == tau_t::zero()) continue;
+      EXPECT_EQ(ops[i].tau, ref[i].tau);
+      EXPECT_EQ(ops[i].color, ref[i].color);
+      EXPECT_EQ(ops[i].is_cdag, ref[i].is_cdag);
+    }
+  }
+}
+
+TEST(configuration, h5) {
+  tau_t::set_beta(beta);
+
+  auto config                  = configuration_t{3};
+  config.seglists[0]           = vs_t{S(9, 8), S(4, 3), S(1, 7)};
+  config.seglists[2]           = vs_t{segment_t::full_line()};
+  config.seglists[0][1].J_c    = true;
+  config.seglists[0][2].J_cdag = true;
+  config.Jperp_list.push_back(Jperp_line_t{make_tau(4), make_tau(7)});
+  config.update_counters();
+
+  {
+    auto f = h5::file("configuration.h5", 'w');
+    h5_write(f, "config", config);
+  }
+  auto config2 = configuration_t{0};
+  {
+    auto f = h5::file("configuration.h5", 'r');
+    h5_read(f, "config", config2);
+  }
+
+  ASSERT_EQ(config2.n_color(), 3);
+  for (int c = 0; c < 3; ++c) {
+    ASSERT_EQ(config2.seglists[c].size(), config.seglists[c].size());
+    for (auto i : range(config.seglists[c].size())) {
+      auto const &s1 = config.seglists[c][i], &s2 = config2.seglists[c][i];
+      EXPECT_EQ(s1.tau_c, s2.tau_c);
+      EXPECT_EQ(s1.tau_cdag, s2.tau_cdag);
+      EXPECT_EQ(s1.J_c, s2.J_c);
+      EXPECT_EQ(s1.J_cdag, s2.J_cdag);
+    }
+  }
+  ASSERT_EQ(config2.Jperp_order(), 1);
+  EXPECT_EQ(config2.Jperp_list[0].tau_Sminus, config.Jperp_list[0].tau_Sminus);
+  EXPECT_EQ(config2.Jperp_list[0].tau_Splus, config.Jperp_list[0].tau_Splus);
+  EXPECT_NE(config2.find_Jperp_line(make_tau(7)), nullptr);
+  EXPECT_EQ(config2.n_segments(), config.n_segments());
+  EXPECT_EQ(config2.n_operators(), config.n_operators());
+}
+
+// ------------------------------
+
+TEST(configuration, Jperp_index) {
+  tau_t::set_beta(beta);
+  auto rng    = std::mt19937_64{1};
+  auto config = configuration_t{2};
+  auto random = [&]() { return tau_t{uint64_t(rng())}; };
+
+  for (int n = 0; n < 10000; ++n) {
+    auto &jl = config.Jperp_list;
+    long k   = jl.size();
+    switch (k < 2 ? 0 : rng() % 4) {
+      case 0: config.add_Jperp_line(Jperp_line_t{random(), random()}); break;
+      case 1: config.erase_Jperp_line(rng() % k); break;
+      case 2: { // Swap the S+ of two lines, as in swap_spin_lines
+        long i = rng() % k, j = (i + 1 + rng() % (k - 1)) % k;
+        auto l1 = jl[i], l2 = jl[j];
+        config.set_Jperp_line(i, {l1.tau_Sminus, l2.tau_Splus});
+        config.set_Jperp_line(j, {l2.tau_Sminus, l1.tau_Splus});
+        break;
+      }
+      case 3: config.set_Jperp_line(rng() % k, Jperp_line_t{random(), random()}); break;
+    }
+
+    // Compare with a linear search
+    ASSERT_EQ(config.Jperp_index.size(), 2 * jl.size());
+    for (auto const &line : jl) {
+      for (auto tau : {line.tau_Sminus, line.tau_Splus}) {
+        auto *l = config.find_Jperp_line(tau);
+        ASSERT_NE(l, nullptr);
+        EXPECT_EQ(*l, line);
+      }
+    }
+  }
+  EXPECT_EQ(config.find_Jperp_line(random()), nullptr);
+}
+
+// ------------------------------
+
+TEST(configuration, interaction_energy) {
+  tau_t::set_beta(beta);
+
+  auto config        = configuration_t{3};
+  config.seglists[0] = vs_t{S(9, 8), S(4, 2)};
+  config.seglists[1] = vs_t{S(8.5, 3)};
+  config.seglists[2] = vs_t{segment_t::full_line()};
+  config.update_counters();
+  auto U = nda::matrix<double>{{0, 1, 2}, {1, 0, 3}, {2, 3, 0}};
+
+  // sum_{a<b} U_ab int n_a n_b, and sum_a int n_a, used by the replica exchange
+  EXPECT_NEAR(static_interaction_energy(config, U), 1 * 1.5 + 2 * 3 + 3 * 5.5, 1.e-12);
+  EXPECT_NEAR(occupied_length(config), 3 + 5.5 + 10, 1.e-12);
+}
+
+// ------------------------------
+
+TEST(work_data, trace_sign_ratio) {
+  tau_t::set_beta(beta);
+
+  // Blocks of 1, 2 and 3 colors
+  auto constr_params          = constr_params_t{};
+  constr_params.beta          = beta;
+  constr_params.gf_struct     = {{"a", 1}, {"b", 2}, {"c", 3}};
+  constr_params.n_tau_bosonic = 101;
+  auto solve_params           = solve_params_t{};
+  solve_params.h_int          = triqs::operators::n("a", 0) * triqs::operators::n("b", 0);
+  auto p                      = params_t{constr_params, solve_params};
+
+  // A hybridization with non-singular dets
+  auto inputs     = inputs_t{};
+  inputs.Delta    = block_gf<imtime>({beta, Fermion, 201}, constr_params.gf_struct);
+  inputs.D0t      = make_block2_gf<imtime>({beta, Boson, constr_params.n_tau_bosonic}, constr_params.gf_struct);
+  inputs.Jperpt   = gf<imtime>({beta, Boson, constr_params.n_tau_bosonic}, {1, 1});
+  inputs.D0t()    = 0;
+  inputs.Jperpt() = 0;
+  for (auto &g : inputs.Delta)
+    for (auto t : g.mesh())
+      for (auto i : range(g.target_shape()[0]))
+        for (auto j : range(g.target_shape()[1]))
+          g[t](i, j) = (i == j ? -0.5 : -0.1) * std::exp(-double(1 + i + j) * double(t) / beta);
+
+  auto model  = std::make_shared<model_t const>(p, inputs, mpi::communicator{});
+  auto wdata  = work_data_t{model, p};
+  auto config = configuration_t{model->n_color};
+  wdata.initialize_from(config);
+
+  // Random insertions and removals of a segment, compared with the ratio of the full trace signs
+  auto rng    = std::mt19937_64{1};
+  auto random = [&]() { return tau_t{uint64_t(rng())}; };
+  for (int n = 0; n < 2000; ++n) {
+    int color      = rng() % model->n_color;
+    long bl        = model->block_number[color];
+    long idx       = model->index_in_block[color];
+    auto &sl       = config.seglists[color];
+    bool is_insert = sl.size() < 2 or (sl.size() < 5 and rng() % 2 == 0);
+    auto seg       = is_insert ? segment_t{random(), random()} : sl[rng() % sl.size()];
+    if (is_insert and not is_insertable_into(seg, sl)) continue;
+
+    double sign  = wdata.current_trace_sign;
+    double ratio = trace_sign_ratio(wdata, bl, idx, seg.tau_cdag, seg.tau_c, is_insert);
+    if (is_insert)
+      sl.insert(std::upper_bound(sl.begin(), sl.end(), seg), seg);
+    else
+      sl.erase(std::find(sl.begin(), sl.end(), seg));
+    config.update_counters(color);
+    wdata.initialize_from(config);
+    ASSERT_EQ(ratio, wdata.current_trace_sign / sign);
+  }
+}
+
 // TEST OVERLAP
 //